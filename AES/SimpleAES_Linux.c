@@ -1,20 +1,54 @@
+#include <linux/atomic.h>
+#include <linux/bitmap.h>
+#include <linux/capability.h>
+#include <linux/cdev.h>
 #include <linux/clk.h>
+#include <linux/debugfs.h>
+#include <linux/dma-map-ops.h>
+#include <linux/dma-mapping.h>
+#include <linux/dmapool.h>
 #include <linux/errno.h>
+#include <linux/eventfd.h>
 #include <linux/fs.h>
+#include <linux/highmem.h>
+#include <linux/hrtimer.h>
+#include <linux/idr.h>
 #include <linux/init.h>
 #include <linux/interrupt.h>
 #include <linux/kernel.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/mm.h>
 #include <linux/mod_devicetable.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/of.h>
+#include <linux/of_device.h>
 #include <linux/of_irq.h>
+#include <linux/percpu.h>
 #include <linux/platform_device.h>
+#include <linux/poll.h>
+#include <linux/rcuwait.h>
+#include <linux/scatterlist.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
+#include <linux/sort.h>
 #include <linux/wait.h>
+#include <linux/wait_bit.h>
 #include <linux/uaccess.h>
+#include <linux/workqueue.h>
+
+#include <crypto/aes.h>
+#include <crypto/algapi.h>
+#include <crypto/engine.h>
+#include <crypto/gf128mul.h>
+#include <crypto/internal/skcipher.h>
 
 #include "SimpleAES.h"
 
+#define CREATE_TRACE_POINTS
+#include "SimpleAES_Trace.h"
+
 // =============================================================================
 // Driver Info
 // =============================================================================
@@ -31,31 +65,391 @@ MODULE_VERSION("0.1.0");
 // Device functions
 
 static irqreturn_t SimpleAES_IrqHandler(int irq_no, void *dev_id);
-static Result_BoolError SimpleAES_Encrypt(SimpleAES *InstancePtr, u8 key[],
+static irqreturn_t SimpleAES_IrqThread(int irq_no, void *dev_id);
+static bool SimpleAES_ReapCompletion(SimpleAES *InstancePtr);
+static Result_BoolError SimpleAES_Encrypt(SimpleAES *InstancePtr,
+					  FileContext *FilePtr, u8 key[],
 					  u8 i_data[], u8 o_data[]);
-static Result_BoolError SimpleAES_Decrypt(SimpleAES *InstancePtr, u8 key[],
+static Result_BoolError SimpleAES_Decrypt(SimpleAES *InstancePtr,
+					  FileContext *FilePtr, u8 key[],
 					  u8 i_data[], u8 o_data[]);
+static int SimpleAES_EncryptBatch(SimpleAES *InstancePtr, FileContext *FilePtr,
+				  IOCTL_BatchData *BatchPtr);
+static int SimpleAES_DecryptBatch(SimpleAES *InstancePtr, FileContext *FilePtr,
+				  IOCTL_BatchData *BatchPtr);
+static Result_BoolError SimpleAES_EncryptChain(SimpleAES *InstancePtr,
+					       FileContext *FilePtr,
+					       IOCTL_ChainData *ChainPtr);
+static Result_BoolError SimpleAES_DecryptChain(SimpleAES *InstancePtr,
+					       FileContext *FilePtr,
+					       IOCTL_ChainData *ChainPtr);
+static Result_BoolError SimpleAES_EncryptKeyed(SimpleAES *InstancePtr,
+					       FileContext *FilePtr,
+					       IOCTL_KeyedData *KeyedPtr);
+static Result_BoolError SimpleAES_DecryptKeyed(SimpleAES *InstancePtr,
+					       FileContext *FilePtr,
+					       IOCTL_KeyedData *KeyedPtr);
+static int SimpleAES_EncryptFixed(SimpleAES *InstancePtr, FileContext *FilePtr,
+				  IOCTL_FixedData *FixedPtr);
+static int SimpleAES_DecryptFixed(SimpleAES *InstancePtr, FileContext *FilePtr,
+				  IOCTL_FixedData *FixedPtr);
 static Result_BoolError SimpleAES_RunOp(SimpleAES *InstancePtr,
-					ORG_SIMPLE_OpMode mode, u8 key[],
-					u8 i_data[], u8 o_data[]);
-static bool SimpleAES_Busy(SimpleAES *InstancePtr);
+					ORG_SIMPLE_OpMode mode,
+					ORG_SIMPLE_CompletionMode completion,
+					SchedClient *ClientPtr,
+					u8 key[], u8 i_data[], u8 o_data[]);
+static Result_BoolError SimpleAES_RunBlock(SimpleAES *InstancePtr,
+					   ORG_SIMPLE_OpMode mode,
+					   ORG_SIMPLE_CompletionMode completion,
+					   SchedClient *ClientPtr,
+					   HwBuffer *KeyBufPtr,
+					   HwBuffer *InputBufPtr,
+					   HwBuffer *OutputBufPtr);
+static Result_BoolError
+SimpleAES_RunBlockTimed(SimpleAES *InstancePtr, ORG_SIMPLE_OpMode mode,
+			ORG_SIMPLE_CompletionMode completion,
+			SchedClient *ClientPtr, HwBuffer *KeyBufPtr,
+			HwBuffer *InputBufPtr, HwBuffer *OutputBufPtr,
+			u64 phase_ns[]);
+static ORG_SIMPLE_Error
+SimpleAES_RunBatchBlock(SimpleAES *InstancePtr, ORG_SIMPLE_OpMode mode,
+			ORG_SIMPLE_CompletionMode completion,
+			SchedClient *ClientPtr,
+			IOCTL_Block *BlockPtr, HwBuffer *KeyBufPtr,
+			HwBuffer *InputBufPtr, HwBuffer *OutputBufPtr,
+			void **LoadedKeyPtr);
+static ORG_SIMPLE_Error
+SimpleAES_RunMappedBlock(SimpleAES *InstancePtr, ORG_SIMPLE_OpMode mode,
+			 ORG_SIMPLE_CompletionMode completion,
+			 SchedClient *ClientPtr,
+			 IOCTL_BatchData *BatchPtr, size_t offset,
+			 HwBuffer *KeyBufPtr, UserDmaMap *InputMapPtr,
+			 UserDmaMap *OutputMapPtr, void **LoadedKeyPtr);
+static bool SimpleAES_CanZeroCopy(IOCTL_BatchData *BatchPtr);
+static bool SimpleAES_MapBatch(SimpleAES *InstancePtr,
+			       IOCTL_BatchData *BatchPtr,
+			       UserDmaMap *InputMapPtr,
+			       UserDmaMap *OutputMapPtr);
+static bool SimpleAES_CanPipeline(IOCTL_BatchData *BatchPtr,
+				  ORG_SIMPLE_CompletionMode completion);
+static void SimpleAES_StageBlock(struct device *dev_ptr,
+				 IOCTL_BatchData *BatchPtr, unsigned int idx,
+				 PipeSlot *SlotPtr, bool zerocopy,
+				 UserDmaMap *InputMapPtr,
+				 UserDmaMap *OutputMapPtr);
+static int SimpleAES_DrainBlock(struct device *dev_ptr,
+				IOCTL_BatchData *BatchPtr, unsigned int idx,
+				PipeSlot *SlotPtr);
+static void SimpleAES_RequeuePipeline(SimpleAES *InstancePtr,
+				      Pipeline *PipePtr,
+				      unsigned int *AttemptPtr);
+static int SimpleAES_RunPipeline(SimpleAES *InstancePtr,
+				 ORG_SIMPLE_OpMode mode,
+				 SchedClient *ClientPtr,
+				 IOCTL_BatchData *BatchPtr);
+static unsigned int SimpleAES_StageDesc(SimpleAES *InstancePtr,
+					IOCTL_BatchData *BatchPtr,
+					ORG_SIMPLE_OpMode mode,
+					unsigned int first, unsigned int count,
+					ORG_SIMPLE_Error key_err, bool zerocopy,
+					UserDmaMap *InputMapPtr,
+					UserDmaMap *OutputMapPtr);
+static bool SimpleAES_DescDone(DescRing *RingPtr, u32 idx);
+static int SimpleAES_DrainDesc(SimpleAES *InstancePtr,
+			       IOCTL_BatchData *BatchPtr, u32 idx);
+static void SimpleAES_RingDoorbell(SimpleAES *InstancePtr);
+static void SimpleAES_RingStart(SimpleAES *InstancePtr, u32 idx);
+static void SimpleAES_RequeueRing(SimpleAES *InstancePtr,
+				  unsigned int *AttemptPtr);
+static int SimpleAES_RunRing(SimpleAES *InstancePtr, ORG_SIMPLE_OpMode mode,
+			     SchedClient *ClientPtr,
+			     IOCTL_BatchData *BatchPtr);
+static int SimpleAES_RunBatch(SimpleAES *InstancePtr, ORG_SIMPLE_OpMode mode,
+			      ORG_SIMPLE_CompletionMode completion,
+			      SchedClient *ClientPtr,
+			      IOCTL_BatchData *BatchPtr);
+static int SimpleAES_RunEngineBatch(SimpleAES *InstancePtr,
+				    ORG_SIMPLE_OpMode mode,
+				    ORG_SIMPLE_CompletionMode completion,
+				    SchedClient *ClientPtr,
+				    IOCTL_BatchData *BatchPtr);
+static Result_BoolError
+SimpleAES_CipherBlock(SimpleAES *InstancePtr, ORG_SIMPLE_OpMode mode,
+		      ORG_SIMPLE_CompletionMode completion,
+		      SchedClient *ClientPtr, HwBuffer *KeyBufPtr,
+		      HwBuffer *InputBufPtr, HwBuffer *OutputBufPtr,
+		      const u8 *src, u8 *dst);
+static Result_BoolError
+SimpleAES_RunChainChunk(SimpleAES *InstancePtr, ORG_SIMPLE_OpMode mode,
+			ORG_SIMPLE_CompletionMode completion,
+			SchedClient *ClientPtr,
+			ORG_SIMPLE_ChainMode chain, HwBuffer *KeyBufPtr,
+			HwBuffer *InputBufPtr, HwBuffer *OutputBufPtr, u8 iv[],
+			u8 *chunk, unsigned int len);
+static Result_BoolError SimpleAES_RunChain(SimpleAES *InstancePtr,
+					   ORG_SIMPLE_OpMode mode,
+					   ORG_SIMPLE_CompletionMode completion,
+					   SchedClient *ClientPtr,
+					   IOCTL_ChainData *ChainPtr);
+static Result_BoolError
+SimpleAES_RunChainSg(SimpleAES *InstancePtr, ORG_SIMPLE_OpMode mode,
+		     ORG_SIMPLE_CompletionMode completion,
+		     SchedClient *ClientPtr,
+		     ORG_SIMPLE_ChainMode chain, const u8 *key, u8 iv[],
+		     struct scatterlist *src, struct scatterlist *dst,
+		     unsigned int length);
+static Result_BoolError SimpleAES_RunKeyedOp(SimpleAES *InstancePtr,
+					     ORG_SIMPLE_OpMode mode,
+					     FileContext *FilePtr, u32 handle,
+					     u8 i_data[], u8 o_data[]);
+static int SimpleAES_RunFixedOp(SimpleAES *InstancePtr, ORG_SIMPLE_OpMode mode,
+				FileContext *FilePtr, IOCTL_FixedData *FixedPtr);
+static ORG_SIMPLE_Error SimpleAES_DecodeIrq(SimpleAES *InstancePtr,
+					    u32 irq_stat);
+static ORG_SIMPLE_Error SimpleAES_DecodeErr(u32 code);
+static void SimpleAES_IssueStaged(SimpleAES *InstancePtr);
+static int SimpleAES_PollCompletion(SimpleAES *InstancePtr,
+				    ORG_SIMPLE_CompletionMode completion,
+				    u64 tag, u64 start_ns,
+				    ORG_SIMPLE_Error *ErrPtr);
+static void SimpleAES_UpdatePollAverage(SimpleAES *InstancePtr, u64 ns);
+static long SimpleAES_Timeout(SimpleAES *InstancePtr);
+static int SimpleAES_WaitBlock(SimpleAES *InstancePtr,
+			       ORG_SIMPLE_CompletionMode completion, u64 tag,
+			       u64 start_ns, ORG_SIMPLE_Error *ErrPtr);
+static bool SimpleAES_Watchdog(SimpleAES *InstancePtr,
+			       unsigned int *StrikesPtr);
+static void SimpleAES_ResetEngine(SimpleAES *InstancePtr);
+static Result_BoolError
+SimpleAES_ProgramMode(SimpleAES *InstancePtr, ORG_SIMPLE_OpMode mode,
+		      ORG_SIMPLE_CompletionMode completion);
 static Result_BoolError SimpleAES_SetMode(SimpleAES *InstancePtr,
-					  ORG_SIMPLE_OpMode mode);
-static Result_BoolError SimpleAES_SetKeyAddr(SimpleAES *InstancePtr, u32 addr);
-static Result_BoolError SimpleAES_SetInputAddr(SimpleAES *InstancePtr,
-					       u32 addr);
-static Result_BoolError SimpleAES_SetOutputAddr(SimpleAES *InstancePtr,
-						u32 addr);
+					  ORG_SIMPLE_OpMode mode,
+					  ORG_SIMPLE_CompletionMode completion);
+static Result_BoolError SimpleAES_Submit(SimpleAES *InstancePtr,
+					 ORG_SIMPLE_OpMode mode,
+					 ORG_SIMPLE_CompletionMode completion,
+					 u32 key_addr, u32 input_addr,
+					 u32 output_addr, u64 *StartNsPtr);
 static void SimpleAES_WaitCompletion(SimpleAES *InstancePtr);
 
+// Software AES
+
+static bool SimpleAES_PreferCpu(SimpleAES *InstancePtr,
+				unsigned int num_blocks);
+static Result_BoolError SimpleAES_SoftRunOp(SimpleAES *InstancePtr,
+					    ORG_SIMPLE_OpMode mode, u8 key[],
+					    u8 i_data[], u8 o_data[]);
+static Result_BoolError SimpleAES_SoftRunBlock(SimpleAES *InstancePtr,
+					       ORG_SIMPLE_OpMode mode,
+					       HwBuffer *KeyBufPtr,
+					       HwBuffer *InputBufPtr,
+					       HwBuffer *OutputBufPtr);
+static Result_BoolError
+SimpleAES_SoftRunMapped(SimpleAES *InstancePtr, ORG_SIMPLE_OpMode mode,
+			HwBuffer *KeyBufPtr, UserDmaMap *InputMapPtr,
+			size_t in_offset, UserDmaMap *OutputMapPtr,
+			size_t out_offset);
+static int SimpleAES_SoftRunBatch(SimpleAES *InstancePtr,
+				  ORG_SIMPLE_OpMode mode,
+				  IOCTL_BatchData *BatchPtr);
+static int SimpleAES_SoftLoad(IOCTL_BatchData *BatchPtr, unsigned int base,
+			      unsigned int *CountPtr, IOCTL_Block *BlocksPtr,
+			      u8 *buf);
+static void SimpleAES_SoftCipher(struct skcipher_request *req,
+				 ORG_SIMPLE_OpMode mode,
+				 IOCTL_Block *BlocksPtr, u8 *buf,
+				 unsigned int count);
+static int SimpleAES_SoftStore(IOCTL_BatchData *BatchPtr, unsigned int base,
+			       unsigned int count, IOCTL_Block *BlocksPtr,
+			       u8 *buf);
+static void SimpleAES_UpdateAverage(u64 *AvgPtr, u64 ns);
+static void SimpleAES_UpdateEngineCost(SimpleAES *InstancePtr, u64 waits,
+				       u64 begin_ns, unsigned int num_blocks);
+static int SimpleAES_SelfTest(SimpleAES *InstancePtr);
+
+// Software ecb(aes) transforms
+
+static void SoftCipherPool_Init(SoftCipherPool *InstancePtr);
+static struct crypto_skcipher *SoftCipherPool_Get(SoftCipherPool *InstancePtr);
+static void SoftCipherPool_Put(SoftCipherPool *InstancePtr,
+			       struct crypto_skcipher *tfm);
+static void SoftCipherPool_DeInit(SoftCipherPool *InstancePtr);
+
 // std.Notification<Error>
 
-static int Notification_Error_Init(Notification_Error *InstancePtr);
-static void Notification_Error_Send(Notification_Error *InstancePtr,
-				    ORG_SIMPLE_Error data);
-static int Notification_Error_Receive(Notification_Error *InstancePtr,
-				      ORG_SIMPLE_Error *DataPtr);
-static void Notification_Error_DeInit(Notification_Error *InstancePtr);
+NOTIFICATION_DECLARE_FUNCS(Error, ORG_SIMPLE_Error);
+
+// Engine scheduler
+
+static void Scheduler_Init(Scheduler *InstancePtr);
+static void SchedClient_Init(SchedClient *InstancePtr, unsigned int weight);
+static void Scheduler_Acquire(Scheduler *InstancePtr, SchedClient *ClientPtr,
+			      SchedTicket *TicketPtr, unsigned int cost);
+static void Scheduler_Release(Scheduler *InstancePtr);
+static void Scheduler_Detach(Scheduler *InstancePtr, SchedClient *ClientPtr);
+static void Scheduler_Charge(Scheduler *InstancePtr, SchedClient *ClientPtr,
+			     SchedTicket *TicketPtr);
+static void Scheduler_GrantNext(Scheduler *InstancePtr);
+static enum hrtimer_restart Scheduler_IdleTimeout(struct hrtimer *timer_ptr);
+
+// Latency statistics
+
+static void LatencyStats_Init(LatencyStats *InstancePtr);
+static void LatencyStats_Record(LatencyStats *InstancePtr, u64 ns);
+static int LatencyStats_Compare(const void *a, const void *b);
+static void LatencyStats_Percentiles(LatencyStats *InstancePtr, u64 *P50Ptr,
+				     u64 *P99Ptr);
+
+// Operation phase statistics
+
+static void OpPhaseStats_Init(OpPhaseStats *InstancePtr);
+static void OpPhaseStats_Record(OpPhaseStats *InstancePtr,
+				const u64 phase_ns[]);
+
+// Per-CPU statistics (debugfs)
+
+static unsigned long SimpleAES_LockRegfile(SimpleAES *InstancePtr);
+static void SimpleAES_StatsHist(SimpleAES *InstancePtr, unsigned int hist,
+				u64 val);
+static void SimpleAES_StatsStage(SimpleAES *InstancePtr,
+				 ORG_SIMPLE_OpPhase phase, u64 ns);
+static void SimpleAES_StatsComplete(SimpleAES *InstancePtr,
+				    ORG_SIMPLE_Error err);
+static void SimpleAES_StatsCpu(SimpleAES *InstancePtr,
+			       unsigned int num_blocks);
+static void SimpleAES_StatsSum(SimpleAES *InstancePtr, SimpleAESStats *SumPtr);
+#ifdef SIMPLEAES_MMIO_PROFILE
+static void SimpleAES_MmioProfile(SimpleAESMmioSite *SitePtr);
+#endif
+
+// std.Pool<HwBuffer>
+
+static int HwBufferPool_Init(HwBufferPool *InstancePtr, struct device *dev_ptr,
+			     bool streaming, unsigned int depth,
+			     unsigned int max_depth);
+static int HwBufferPool_Alloc(HwBufferPool *InstancePtr, HwBuffer *BufPtr);
+static void HwBufferPool_Free(HwBufferPool *InstancePtr, HwBuffer *BufPtr);
+static int HwBufferPool_Get(HwBufferPool *InstancePtr, HwBuffer *BufPtr);
+static void HwBufferPool_Put(HwBufferPool *InstancePtr, HwBuffer *BufPtr);
+static void HwBufferPool_DeInit(HwBufferPool *InstancePtr);
+static void HwOpRecord_Split(const HwBuffer *OpBufPtr, HwBuffer *KeyBufPtr,
+			     HwBuffer *InputBufPtr, HwBuffer *OutputBufPtr);
+static void HwBuffer_SyncForDevice(struct device *dev_ptr, HwBuffer *BufPtr,
+				   size_t len);
+static void HwBuffer_SyncForCpu(struct device *dev_ptr, HwBuffer *BufPtr,
+				size_t len);
+static int HwBuffer_CopyBench(struct device *dev_ptr, bool streaming,
+			      size_t len, u64 *InNsPtr, u64 *OutNsPtr);
+
+// Pinned user buffers
+
+static int UserDmaMap_Init(UserDmaMap *InstancePtr, struct device *dev_ptr,
+			   void __user *uaddr, size_t len,
+			   enum dma_data_direction dir, bool fixed);
+static void UserDmaMap_PageRange(UserDmaMap *InstancePtr,
+				 unsigned int page_idx, size_t *OffsetPtr,
+				 size_t *LenPtr);
+static unsigned int UserDmaMap_Locate(UserDmaMap *InstancePtr, size_t offset,
+				      size_t *MapOffsetPtr);
+static int UserDmaMap_BusAddr(UserDmaMap *InstancePtr, size_t offset,
+			      size_t len, dma_addr_t *AddrPtr);
+static void UserDmaMap_SyncForDevice(UserDmaMap *InstancePtr,
+				     struct device *dev_ptr, size_t offset,
+				     size_t len);
+static void UserDmaMap_SyncForCpu(UserDmaMap *InstancePtr,
+				  struct device *dev_ptr, size_t offset,
+				  size_t len);
+static void *UserDmaMap_Map(UserDmaMap *InstancePtr, struct device *dev_ptr,
+			    size_t offset);
+static void UserDmaMap_Unmap(UserDmaMap *InstancePtr, struct device *dev_ptr,
+			     void *cpu_addr, size_t offset);
+static void UserDmaMap_DeInit(UserDmaMap *InstancePtr,
+			      struct device *dev_ptr);
+
+// Registered (fixed) buffers
+
+static int FixedBuffer_Init(FixedBuffer *InstancePtr, struct device *dev_ptr,
+			    IOCTL_BufferRegion *RegionPtr);
+static int FixedBuffer_BusAddr(FixedBuffer *InstancePtr, size_t offset,
+			       size_t len, dma_addr_t *AddrPtr);
+static void FixedBuffer_DeInit(FixedBuffer *InstancePtr,
+			       struct device *dev_ptr);
+
+// Key table
+
+static int KeyTable_Init(KeyTable *InstancePtr, struct device *dev_ptr,
+			 unsigned int num_slots);
+static int KeyTable_Acquire(KeyTable *InstancePtr, KeyEntry *KeyPtr,
+			    HwBuffer *SlotBufPtr);
+static void KeyTable_Release(KeyTable *InstancePtr, HwBuffer *SlotBufPtr);
+static void KeyTable_Drop(KeyTable *InstancePtr, KeyEntry *KeyPtr);
+static void KeyTable_DeInit(KeyTable *InstancePtr, struct device *dev_ptr);
+
+// Descriptor ring
+
+static int DescRing_Init(DescRing *InstancePtr, struct device *dev_ptr);
+static u32 DescRing_BusAddr(DescRing *InstancePtr, const void *cpu_ptr);
+static HwDesc *DescRing_Desc(DescRing *InstancePtr, u32 idx);
+static RingSlot *DescRing_Slot(DescRing *InstancePtr, u32 idx);
+static void DescRing_DeInit(DescRing *InstancePtr, struct device *dev_ptr);
+
+// Per-open-file state
+
+static int FileContext_SetKey(FileContext *InstancePtr, void *key,
+			      unsigned int *HandlePtr);
+static int FileContext_ClearKey(FileContext *InstancePtr, unsigned int handle);
+static ORG_SIMPLE_Error FileContext_AcquireKey(FileContext *InstancePtr,
+					       unsigned int handle,
+					       HwBuffer *KeyBufPtr);
+static int FileContext_RegisterBuffers(FileContext *InstancePtr,
+				       IOCTL_BufferSet *SetPtr);
+static void FileContext_UnregisterBuffers(FileContext *InstancePtr);
+static int FileContext_SetEventfd(FileContext *InstancePtr, int fd);
+static SimpleAES *FileContext_Engine(FileContext *InstancePtr, bool stateless);
+static SchedClient *FileContext_Client(FileContext *InstancePtr,
+				       SimpleAES *SimpleAESPtr);
+static bool FileContext_TryAdmit(FileContext *InstancePtr);
+static int FileContext_Admit(FileContext *InstancePtr, bool nonblock);
+static void FileContext_Retire(FileContext *InstancePtr);
+
+// Asynchronous requests
+
+static int AsyncRequest_Submit(FileContext *FilePtr,
+			       IOCTL_AsyncSubmit *SubmitPtr);
+static void AsyncRequest_Work(struct work_struct *work_ptr);
+static void AsyncRequest_Complete(AsyncRequest *InstancePtr);
+static void AsyncRequest_Free(AsyncRequest *InstancePtr);
+
+// Shared-memory ring
+
+static int Ring_Init(Ring *InstancePtr, FileContext *FilePtr,
+		     IOCTL_RingSetup *SetupPtr);
+static bool Ring_InDataArea(Ring *InstancePtr, u32 offset, size_t len);
+static ORG_SIMPLE_Error Ring_RunSqe(Ring *InstancePtr, const RingSqe *SqePtr);
+static unsigned int Ring_Submit(Ring *InstancePtr, unsigned int to_submit);
+static bool Ring_SqReady(Ring *InstancePtr);
+static unsigned int Ring_CqReady(Ring *InstancePtr);
+static int Ring_SqPollThread(void *data);
+static int Ring_Enter(Ring *InstancePtr, IOCTL_RingEnter *EnterPtr);
+static void Ring_DeInit(Ring *InstancePtr);
+
+// Crypto API (skcipher) provider
+
+static int SimpleAES_RegisterAlgs(void);
+static void SimpleAES_UnregisterAlgs(void);
+static int simpleaes_skcipher_init(struct crypto_skcipher *tfm);
+static void simpleaes_skcipher_exit(struct crypto_skcipher *tfm);
+static int simpleaes_skcipher_setkey(struct crypto_skcipher *tfm,
+				     const u8 *key, unsigned int keylen);
+static int simpleaes_skcipher_queue(struct skcipher_request *req,
+				    ORG_SIMPLE_OpMode mode);
+static int simpleaes_skcipher_fallback(struct skcipher_request *req,
+				       ORG_SIMPLE_OpMode mode);
+static int simpleaes_skcipher_encrypt(struct skcipher_request *req);
+static int simpleaes_skcipher_decrypt(struct skcipher_request *req);
+static int simpleaes_skcipher_do_one_request(struct crypto_engine *engine,
+					     void *areq);
 
 // Character device (cdev) callbacks
 
@@ -64,356 +458,6572 @@ static int simpleaes_cdev_release(struct inode *inode_ptr,
 				  struct file *file_ptr);
 static long simpleaes_cdev_ioctl(struct file *file_ptr, unsigned int cmd,
 				 unsigned long arg);
+static long SimpleAES_Ioctl(SimpleAES *InstancePtr, FileContext *FilePtr,
+			    unsigned int cmd, unsigned long arg);
+static int simpleaes_cdev_mmap(struct file *file_ptr,
+			       struct vm_area_struct *vma_ptr);
+static ssize_t simpleaes_cdev_read(struct file *file_ptr, char __user *buf,
+				   size_t count, loff_t *offset);
+static __poll_t simpleaes_cdev_poll(struct file *file_ptr,
+				    poll_table *wait_ptr);
 
 // Device management
 
+static void SimpleAES_Attach(SimpleAES *InstancePtr);
+static void SimpleAES_Detach(SimpleAES *InstancePtr);
+static SimpleAES *SimpleAES_AcquireIdle(void);
+static void SimpleAES_Hold(SimpleAES *InstancePtr);
+static void SimpleAES_Release(SimpleAES *InstancePtr);
+static void SimpleAES_DebugfsInit(SimpleAES *InstancePtr);
 static int SimpleAES_probe(struct platform_device *pdev);
 static int SimpleAES_remove(struct platform_device *pdev);
+static int __init SimpleAES_init(void);
+static void __exit SimpleAES_exit(void);
 
 // =============================================================================
 // Variable Definitions
 // =============================================================================
 
 static struct file_operations simpleaes_cdev_fops = {
+	.owner		= THIS_MODULE,
 	.open		= simpleaes_cdev_open,
 	.unlocked_ioctl = simpleaes_cdev_ioctl,
+	.mmap		= simpleaes_cdev_mmap,
+	.read		= simpleaes_cdev_read,
+	.poll		= simpleaes_cdev_poll,
 	.release	= simpleaes_cdev_release,
 };
 
+// DMA record pool sizing (one HwOpRecord per in-flight operation)
+static unsigned int pool_depth = 4;
+module_param(pool_depth, uint, 0444);
+MODULE_PARM_DESC(pool_depth, "Number of DMA records pre-allocated per device");
+
+static unsigned int pool_max_depth = 32;
+module_param(pool_max_depth, uint, 0444);
+MODULE_PARM_DESC(pool_max_depth,
+		 "Maximum number of DMA records kept in the per-device pool");
+
+static unsigned int dma_records = ORG_SIMPLE_DMA_AUTO;
+module_param(dma_records, uint, 0444);
+MODULE_PARM_DESC(dma_records,
+		 "Operation record memory (0=auto 1=coherent 2=streaming)");
+
+static unsigned int key_slots = 16;
+module_param(key_slots, uint, 0444);
+MODULE_PARM_DESC(key_slots, "Number of key table slots per device");
+
+// 256 blocks: a shorter batch would still pin and map a whole page on each
+// side for less than a page of copying saved
+static unsigned int zerocopy_threshold = 4096;
+module_param(zerocopy_threshold, uint, 0644);
+MODULE_PARM_DESC(zerocopy_threshold,
+		 "Smallest contiguous batch (bytes) mapped directly for DMA");
+
+static unsigned int completion_mode = ORG_SIMPLE_COMPLETION_IRQ;
+module_param(completion_mode, uint, 0644);
+MODULE_PARM_DESC(completion_mode,
+		 "Default completion mode for new files (0=irq 1=poll 2=hybrid)");
+
+static unsigned int poll_budget_ns = 20000;
+module_param(poll_budget_ns, uint, 0644);
+MODULE_PARM_DESC(poll_budget_ns,
+		 "Longest spin before a polled op falls back to the interrupt");
+
+static unsigned int op_timeout_us = 10000;
+module_param(op_timeout_us, uint, 0644);
+MODULE_PARM_DESC(op_timeout_us,
+		 "Shortest completion deadline (us), 0=no deadline");
+
+static unsigned int op_timeout_factor = 16;
+module_param(op_timeout_factor, uint, 0644);
+MODULE_PARM_DESC(op_timeout_factor,
+		 "Completion deadline in multiples of the average block time");
+
+static unsigned int op_retries = 2;
+module_param(op_retries, uint, 0644);
+MODULE_PARM_DESC(op_retries,
+		 "Times an operation is requeued after engine resets");
+
+static unsigned int sched_queue_limit = 16;
+module_param(sched_queue_limit, uint, 0644);
+MODULE_PARM_DESC(sched_queue_limit,
+		 "Synchronous operations a file may have queued at once");
+
+static unsigned int sched_idle_us = 50;
+module_param(sched_idle_us, uint, 0644);
+MODULE_PARM_DESC(sched_idle_us,
+		 "How long the engine stays idle for a client that released it "
+		 "behind its share, before serving others (0 = never)");
+
+static unsigned int pipeline_burst = 16;
+module_param(pipeline_burst, uint, 0644);
+MODULE_PARM_DESC(pipeline_burst,
+		 "Blocks a pipelined batch runs per scheduler turn");
+
+static unsigned int desc_ring = 1;
+module_param(desc_ring, uint, 0644);
+MODULE_PARM_DESC(desc_ring,
+		 "Run streaming batches on the descriptor ring of ver3 engines");
+
+static unsigned int ring_burst = 256;
+module_param(ring_burst, uint, 0644);
+MODULE_PARM_DESC(ring_burst,
+		 "Blocks a descriptor ring batch runs per scheduler turn");
+
+static unsigned int ring_mem_max = 64 * 1024 * 1024;
+module_param(ring_mem_max, uint, 0644);
+MODULE_PARM_DESC(ring_mem_max,
+		 "Bytes of coherent memory all submission rings may hold");
+
+static unsigned int ring_sqpoll;
+module_param(ring_sqpoll, uint, 0644);
+MODULE_PARM_DESC(ring_sqpoll,
+		 "Let files without CAP_SYS_NICE start SQPOLL threads");
+
+static unsigned int cpu_dispatch = ORG_SIMPLE_DISPATCH_AUTO;
+module_param(cpu_dispatch, uint, 0644);
+MODULE_PARM_DESC(cpu_dispatch,
+		 "Where single ops and batches run (0=engine 1=auto 2=cpu)");
+
+static unsigned int cpu_threshold;
+module_param(cpu_threshold, uint, 0644);
+MODULE_PARM_DESC(cpu_threshold,
+		 "Largest request (bytes) always run in software (0=none)");
+
+static unsigned int crypto_priority = 400;
+module_param(crypto_priority, uint, 0444);
+MODULE_PARM_DESC(crypto_priority,
+		 "Crypto API priority of the skcipher algorithms");
+
+// Engine instances, sharing one chrdev region and class. Minor 0 is the
+// aggregate node, minor id + 1 the node of engine <id>.
+static DEFINE_MUTEX(simpleaes_devices_mutex); // Attach/detach, algorithms
+static DEFINE_SPINLOCK(simpleaes_devices_lock); // simpleaes_devices
+static LIST_HEAD(simpleaes_devices);
+static DEFINE_IDA(simpleaes_ida);
+static dev_t simpleaes_devno;
+static struct class *simpleaes_class;
+static struct dentry *simpleaes_debugfs_root; // <debugfs>/simpleaes
+#ifdef SIMPLEAES_MMIO_PROFILE
+static DEFINE_SPINLOCK(simpleaes_mmio_sites_lock); // simpleaes_mmio_sites
+static LIST_HEAD(simpleaes_mmio_sites);
+#endif
+static struct cdev simpleaes_aggregate_cdev;
+
+// Coherent memory held by the submission rings of every open file
+static atomic64_t simpleaes_ring_mem = ATOMIC64_INIT(0);
+
+// Checked against software AES at probe time, and the 128-bit ones against
+// every engine: FIPS-197 appendix C.1 and B, the first block of SP 800-38A
+// F.1.1 (ECB-AES128), FIPS-197 C.2 and C.3, and the first blocks of SP 800-38A
+// F.1.3 (ECB-AES192) and F.1.5 (ECB-AES256)
+static const KnownAnswer simpleaes_known_answers[] = {
+	{
+		.key_len = AES_KEYSIZE_128,
+		.key = {
+			0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+			0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+		},
+		.plain = {
+			0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+			0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff,
+		},
+		.cipher = {
+			0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+			0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a,
+		},
+	},
+	{
+		.key_len = AES_KEYSIZE_128,
+		.key = {
+			0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+			0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c,
+		},
+		.plain = {
+			0x32, 0x43, 0xf6, 0xa8, 0x88, 0x5a, 0x30, 0x8d,
+			0x31, 0x31, 0x98, 0xa2, 0xe0, 0x37, 0x07, 0x34,
+		},
+		.cipher = {
+			0x39, 0x25, 0x84, 0x1d, 0x02, 0xdc, 0x09, 0xfb,
+			0xdc, 0x11, 0x85, 0x97, 0x19, 0x6a, 0x0b, 0x32,
+		},
+	},
+	{
+		.key_len = AES_KEYSIZE_128,
+		.key = {
+			0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+			0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c,
+		},
+		.plain = {
+			0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96,
+			0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+		},
+		.cipher = {
+			0x3a, 0xd7, 0x7b, 0xb4, 0x0d, 0x7a, 0x36, 0x60,
+			0xa8, 0x9e, 0xca, 0xf3, 0x24, 0x66, 0xef, 0x97,
+		},
+	},
+	{
+		.key_len = AES_KEYSIZE_192,
+		.key = {
+			0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+			0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+			0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+		},
+		.plain = {
+			0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+			0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff,
+		},
+		.cipher = {
+			0xdd, 0xa9, 0x7c, 0xa4, 0x86, 0x4c, 0xdf, 0xe0,
+			0x6e, 0xaf, 0x70, 0xa0, 0xec, 0x0d, 0x71, 0x91,
+		},
+	},
+	{
+		.key_len = AES_KEYSIZE_256,
+		.key = {
+			0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+			0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+			0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+			0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f,
+		},
+		.plain = {
+			0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+			0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff,
+		},
+		.cipher = {
+			0x8e, 0xa2, 0xb7, 0xca, 0x51, 0x67, 0x45, 0xbf,
+			0xea, 0xfc, 0x49, 0x90, 0x4b, 0x49, 0x60, 0x89,
+		},
+	},
+	{
+		.key_len = AES_KEYSIZE_192,
+		.key = {
+			0x8e, 0x73, 0xb0, 0xf7, 0xda, 0x0e, 0x64, 0x52,
+			0xc8, 0x10, 0xf3, 0x2b, 0x80, 0x90, 0x79, 0xe5,
+			0x62, 0xf8, 0xea, 0xd2, 0x52, 0x2c, 0x6b, 0x7b,
+		},
+		.plain = {
+			0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96,
+			0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+		},
+		.cipher = {
+			0xbd, 0x33, 0x4f, 0x1d, 0x6e, 0x45, 0xf2, 0x5f,
+			0xf7, 0x12, 0xa2, 0x14, 0x57, 0x1f, 0xa5, 0xcc,
+		},
+	},
+	{
+		.key_len = AES_KEYSIZE_256,
+		.key = {
+			0x60, 0x3d, 0xeb, 0x10, 0x15, 0xca, 0x71, 0xbe,
+			0x2b, 0x73, 0xae, 0xf0, 0x85, 0x7d, 0x77, 0x81,
+			0x1f, 0x35, 0x2c, 0x07, 0x3b, 0x61, 0x08, 0xd7,
+			0x2d, 0x98, 0x10, 0xa3, 0x09, 0x14, 0xdf, 0xf4,
+		},
+		.plain = {
+			0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96,
+			0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+		},
+		.cipher = {
+			0xf3, 0xee, 0xd1, 0xbd, 0xb5, 0xd2, 0xa0, 0x3c,
+			0x06, 0x4b, 0x5a, 0x7e, 0x3d, 0xb1, 0x81, 0xf8,
+		},
+	},
+};
+
+// Crypto API algorithms (registered while at least one engine is attached)
+static bool simpleaes_algs_registered;
+
+static SkcipherAlg simpleaes_algs[] = {
+	{
+		.chain = ORG_SIMPLE_CHAIN_ECB,
+		.alg = {
+			.base.cra_name		= "ecb(aes)",
+			.base.cra_driver_name	= "ecb-aes-simpleaes",
+			.base.cra_blocksize	= AES_BLOCK_SIZE,
+			.min_keysize		= AES_MIN_KEY_SIZE,
+			.max_keysize		= AES_MAX_KEY_SIZE,
+		},
+	},
+	{
+		.chain = ORG_SIMPLE_CHAIN_CBC,
+		.alg = {
+			.base.cra_name		= "cbc(aes)",
+			.base.cra_driver_name	= "cbc-aes-simpleaes",
+			.base.cra_blocksize	= AES_BLOCK_SIZE,
+			.min_keysize		= AES_MIN_KEY_SIZE,
+			.max_keysize		= AES_MAX_KEY_SIZE,
+			.ivsize			= AES_BLOCK_SIZE,
+		},
+	},
+	{
+		.chain = ORG_SIMPLE_CHAIN_CTR,
+		.alg = {
+			.base.cra_name		= "ctr(aes)",
+			.base.cra_driver_name	= "ctr-aes-simpleaes",
+			.base.cra_blocksize	= 1,
+			.min_keysize		= AES_MIN_KEY_SIZE,
+			.max_keysize		= AES_MAX_KEY_SIZE,
+			.ivsize			= AES_BLOCK_SIZE,
+			.chunksize		= AES_BLOCK_SIZE,
+		},
+	},
+};
+
 // =============================================================================
 // Function Definitions
 // =============================================================================
 
 // Device functions
 
+// Top half: masks the interrupt and defers the completions to the thread
 static irqreturn_t SimpleAES_IrqHandler(int irq_no, void *dev_id)
 {
 	SimpleAES *simpleaes_ptr = (SimpleAES *)dev_id;
 
-	Notification_Error *notif   = &simpleaes_ptr->notif;
 	void __iomem *ptr	    = simpleaes_ptr->regfile.ptr;
+	u32 *shadow		    = simpleaes_ptr->regfile.shadow;
 	struct spinlock_t *lock_ptr = &simpleaes_ptr->regfile.lock;
 
 	unsigned long lock_irq_flags;
 	u32 irq_stat;
-	u32 stat_err;
 
-	spin_lock_irqsave(lock_ptr, lock_irq_flags);
+	lock_irq_flags = SimpleAES_LockRegfile(simpleaes_ptr);
+
+	// The line is shared: another device may raise it while the engine's
+	// clock is off (SimpleAES_ResetEngine)
+	if (simpleaes_ptr->regfile.gated) {
+		spin_unlock_irqrestore(lock_ptr, lock_irq_flags);
+		return IRQ_NONE;
+	}
 
+	// A polling waiter may already have consumed the completion
 	irq_stat = SIMPLEAES_REG_READ(IRQ, ptr);
-	if (irq_stat[0] == 1) {
-		Notification_Error_Send(notif, ERROR_OK);
-	} else if (irq_stat[1] == 1) {
-		stat_err = SIMPLEAES_FIELD_READ(ERR, STAT, ptr);
-		switch (stat_err) {
-		case 1:
-			Notification_Error_Send(notif, ERROR_KEY);
-			break;
-		case 2:
-			Notification_Error_Send(notif, ERROR_INPUT);
+	if (!(irq_stat & (SIMPLEAES_IRQ_COMPLETE_Mask | SIMPLEAES_IRQ_ERR_Mask |
+			  SIMPLEAES_IRQ_RING_Mask))) {
+		spin_unlock_irqrestore(lock_ptr, lock_irq_flags);
+		trace_simpleaes_irq(simpleaes_ptr->id, irq_stat, false);
+		return IRQ_NONE;
+	}
+
+	if (SIMPLEAES_SHADOW_FIELD_READ(IE, CTRL, shadow)) {
+		SIMPLEAES_SHADOW_FIELD_WRITE(0, IE, CTRL, ptr, shadow);
+		simpleaes_ptr->irq_rearm = true;
+	}
+
+	spin_unlock_irqrestore(lock_ptr, lock_irq_flags);
+	trace_simpleaes_irq(simpleaes_ptr->id, irq_stat, true);
+
+	return IRQ_WAKE_THREAD;
+}
+
+// Bottom half: reaps every pending completion, yielding after each budget,
+// and wakes the waiters in batches. After a busy wakeup it keeps polling
+// for up to usecs for the next completion before it re-arms the interrupt,
+// like a NAPI poll that used up its budget.
+static irqreturn_t SimpleAES_IrqThread(int irq_no, void *dev_id)
+{
+	SimpleAES *simpleaes_ptr = (SimpleAES *)dev_id;
+
+	Notification_Error *notif   = &simpleaes_ptr->notif;
+	void __iomem *ptr	    = simpleaes_ptr->regfile.ptr;
+	struct spinlock_t *lock_ptr = &simpleaes_ptr->regfile.lock;
+
+	unsigned int budget = max(READ_ONCE(simpleaes_ptr->irq_coalesce.budget),
+				  1U);
+	unsigned int frames = READ_ONCE(simpleaes_ptr->irq_coalesce.frames);
+	u64 poll_ns = (u64)READ_ONCE(simpleaes_ptr->irq_coalesce.usecs) *
+		      NSEC_PER_USEC;
+
+	unsigned long lock_irq_flags;
+	unsigned int reaped = 0;
+	u64 idle_ns	    = 0;
+
+	atomic64_inc(&simpleaes_ptr->irq_wakeups);
+
+	for (;;) {
+		if (SimpleAES_ReapCompletion(simpleaes_ptr)) {
+			reaped++;
+			idle_ns = 0;
+			if (!(reaped % budget)) {
+				Notification_Error_Flush(notif);
+				cond_resched();
+			}
+			continue;
+		}
+
+		// Waiters can only start their next operation once woken
+		Notification_Error_Flush(notif);
+
+		// Poll only for interrupt-mode users, and only under load
+		if (!poll_ns || reaped < frames ||
+		    !READ_ONCE(simpleaes_ptr->irq_rearm)) {
 			break;
-		case 3:
-			Notification_Error_Send(notif, ERROR_OUTPUT);
+		}
+		if (!idle_ns) {
+			idle_ns = ktime_get_ns();
+		} else if (ktime_get_ns() - idle_ns >= poll_ns) {
 			break;
 		}
+		cpu_relax();
+	}
+
+	// A completion that landed while IE was masked raises the interrupt
+	// again as soon as IE is set. A reset in progress re-arms it instead.
+	spin_lock_irqsave(lock_ptr, lock_irq_flags);
+	if (simpleaes_ptr->irq_rearm && !simpleaes_ptr->regfile.gated) {
+		SIMPLEAES_SHADOW_FIELD_WRITE(1, IE, CTRL, ptr,
+					     simpleaes_ptr->regfile.shadow);
+		simpleaes_ptr->irq_rearm = false;
+	}
+	spin_unlock_irqrestore(lock_ptr, lock_irq_flags);
+
+	atomic64_add(reaped, &simpleaes_ptr->irq_completions);
+
+	return IRQ_HANDLED;
+}
+
+// Takes one completion off the engine and hands it to its waiter. The
+// waiter is only woken by the next Notification_Error_Flush. Returns false
+// if no completion is pending.
+static bool SimpleAES_ReapCompletion(SimpleAES *InstancePtr)
+{
+	Notification_Error *notif   = &InstancePtr->notif;
+	void __iomem *ptr	    = InstancePtr->regfile.ptr;
+	struct spinlock_t *lock_ptr = &InstancePtr->regfile.lock;
+
+	unsigned long lock_irq_flags;
+	ORG_SIMPLE_Error notif_val;
+	Pipeline *pipe_ptr;
+	PipeSlot *slot_ptr;
+	u32 irq_stat;
+	u64 tag = 0;
+
+	lock_irq_flags = SimpleAES_LockRegfile(InstancePtr);
+
+	irq_stat = SIMPLEAES_REG_READ(IRQ, ptr);
+
+	// Ring descriptors report in memory (DSTAT): the interrupt only wakes
+	// the ring's waiter
+	if (irq_stat & SIMPLEAES_IRQ_RING_Mask) {
+		SIMPLEAES_REG_WRITE(SIMPLEAES_IRQ_RING_Mask, IRQ, ptr);
+		irq_stat &= ~SIMPLEAES_IRQ_RING_Mask;
+		atomic64_inc(&InstancePtr->ring_ptr->wakeups);
+		wake_up(&InstancePtr->ring_ptr->wq);
+		if (!irq_stat) {
+			spin_unlock_irqrestore(lock_ptr, lock_irq_flags);
+			return true;
+		}
+	}
+
+	if (!(irq_stat &
+	      (SIMPLEAES_IRQ_COMPLETE_Mask | SIMPLEAES_IRQ_ERR_Mask))) {
+		spin_unlock_irqrestore(lock_ptr, lock_irq_flags);
+		return false;
 	}
 
+	notif_val = SimpleAES_DecodeIrq(InstancePtr, irq_stat);
 	SIMPLEAES_REG_WRITE(irq_stat, IRQ, ptr);
+	InstancePtr->regfile.inflight = false;
+	SimpleAES_StatsComplete(InstancePtr, notif_val);
+
+	// A pipelined batch gets its next block started before the waiter
+	// even wakes up
+	pipe_ptr = InstancePtr->pipe_ptr;
+	if (pipe_ptr) {
+		slot_ptr = &pipe_ptr->slots[pipe_ptr->completed %
+					    ORG_SIMPLE_PIPELINE_DEPTH];
+		slot_ptr->done_ns = ktime_get_ns();
+		slot_ptr->err	  = notif_val;
+		pipe_ptr->busy_ns += slot_ptr->done_ns - pipe_ptr->issue_ns;
+		SimpleAES_StatsStage(InstancePtr, ORG_SIMPLE_PHASE_ENGINE,
+				     slot_ptr->done_ns - pipe_ptr->issue_ns);
+		smp_store_release(&pipe_ptr->completed,
+				  pipe_ptr->completed + 1);
+		SimpleAES_IssueStaged(InstancePtr);
+		wake_up(&pipe_ptr->wq);
+	} else {
+		// The engine only runs the operation of the ticket holding it
+		tag = READ_ONCE(InstancePtr->sched.current_tag);
+		WRITE_ONCE(InstancePtr->reap_ns, ktime_get_ns());
+	}
 
 	spin_unlock_irqrestore(lock_ptr, lock_irq_flags);
+	trace_simpleaes_reap(InstancePtr->id, tag, notif_val);
 
-	return IRQ_HANDLED;
+	// Publishing the completion needs no regfile lock
+	if (tag) {
+		Notification_Error_Post(notif, notif_val, tag);
+	}
+
+	return true;
+}
+
+// Called with the regfile lock held
+static ORG_SIMPLE_Error SimpleAES_DecodeIrq(SimpleAES *InstancePtr,
+					    u32 irq_stat)
+{
+	void __iomem *ptr = InstancePtr->regfile.ptr;
+
+	if (irq_stat & SIMPLEAES_IRQ_COMPLETE_Mask) {
+		return ERROR_OK;
+	}
+
+	return SimpleAES_DecodeErr(SIMPLEAES_FIELD_READ(ERR, STAT, ptr));
+}
+
+// STAT.ERR (DSTAT.ERR) code of a failed operation
+static ORG_SIMPLE_Error SimpleAES_DecodeErr(u32 code)
+{
+	switch (code) {
+	case 1:
+		return ERROR_KEY;
+	case 2:
+		return ERROR_INPUT;
+	case 3:
+		return ERROR_OUTPUT;
+	default:
+		return ERROR_OTHER;
+	}
+}
+
+// Starts the oldest staged block once the engine is idle. Blocks that failed
+// staging are completed without reaching the engine. Called with the regfile
+// lock held.
+static void SimpleAES_IssueStaged(SimpleAES *InstancePtr)
+{
+	Pipeline *pipe_ptr = InstancePtr->pipe_ptr;
+	void __iomem *ptr  = InstancePtr->regfile.ptr;
+	u32 *shadow	   = InstancePtr->regfile.shadow;
+	PipeSlot *slot_ptr;
+
+	while (pipe_ptr->started == pipe_ptr->completed &&
+	       pipe_ptr->started < pipe_ptr->staged) {
+		slot_ptr = &pipe_ptr->slots[pipe_ptr->started %
+					    ORG_SIMPLE_PIPELINE_DEPTH];
+		pipe_ptr->started++;
+
+		if (slot_ptr->err != ERROR_OK) {
+			smp_store_release(&pipe_ptr->completed,
+					  pipe_ptr->completed + 1);
+			continue;
+		}
+
+		SIMPLEAES_SHADOW_UPDATE((u32)slot_ptr->key_buf.bus_addr, KAR,
+					ptr, shadow);
+		SIMPLEAES_SHADOW_UPDATE(slot_ptr->input_addr, IAR, ptr, shadow);
+
+		// Writing OAR starts the operation
+		pipe_ptr->issue_ns = ktime_get_ns();
+		SIMPLEAES_SHADOW_WRITE(slot_ptr->output_addr, OAR, ptr, shadow);
+		InstancePtr->regfile.inflight = true;
+		break;
+	}
+}
+
+static int SimpleAES_PollCompletion(SimpleAES *InstancePtr,
+				    ORG_SIMPLE_CompletionMode completion,
+				    u64 tag, u64 start_ns,
+				    ORG_SIMPLE_Error *ErrPtr)
+{
+	void __iomem *ptr	    = InstancePtr->regfile.ptr;
+	struct spinlock_t *lock_ptr = &InstancePtr->regfile.lock;
+	u32 done_mask = SIMPLEAES_IRQ_COMPLETE_Mask | SIMPLEAES_IRQ_ERR_Mask;
+
+	unsigned long lock_irq_flags;
+	u64 budget_ns, ewma_ns;
+	u32 irq_stat;
+	int ret;
+
+	// Hybrid mode spins for about twice the recent completion time, so a
+	// slow op gives the CPU back early instead of burning the full budget
+	budget_ns = poll_budget_ns;
+	ewma_ns	  = READ_ONCE(InstancePtr->poll_ewma_ns);
+	if (completion == ORG_SIMPLE_COMPLETION_HYBRID && ewma_ns) {
+		budget_ns = min_t(u64, budget_ns, 2 * ewma_ns);
+	}
+
+	do {
+		lock_irq_flags = SimpleAES_LockRegfile(InstancePtr);
+		irq_stat       = SIMPLEAES_REG_READ(IRQ, ptr);
+		if (irq_stat & done_mask) {
+			*ErrPtr = SimpleAES_DecodeIrq(InstancePtr, irq_stat);
+			SIMPLEAES_REG_WRITE(irq_stat, IRQ, ptr);
+			InstancePtr->regfile.inflight = false;
+			SimpleAES_StatsComplete(InstancePtr, *ErrPtr);
+			WRITE_ONCE(InstancePtr->reap_ns, ktime_get_ns());
+			spin_unlock_irqrestore(lock_ptr, lock_irq_flags);
+
+			SimpleAES_UpdatePollAverage(InstancePtr,
+						    ktime_get_ns() - start_ns);
+			return 0;
+		}
+		spin_unlock_irqrestore(lock_ptr, lock_irq_flags);
+
+		cpu_relax();
+	} while (ktime_get_ns() - start_ns < budget_ns && !need_resched());
+
+	// Budget exhausted: enable the interrupt and sleep. If the op finished
+	// in the meantime, consume it here so the handler finds nothing.
+	lock_irq_flags = SimpleAES_LockRegfile(InstancePtr);
+	SIMPLEAES_SHADOW_FIELD_WRITE(1, IE, CTRL, ptr,
+				     InstancePtr->regfile.shadow);
+	irq_stat = SIMPLEAES_REG_READ(IRQ, ptr);
+	if (irq_stat & done_mask) {
+		*ErrPtr = SimpleAES_DecodeIrq(InstancePtr, irq_stat);
+		SIMPLEAES_REG_WRITE(irq_stat, IRQ, ptr);
+		InstancePtr->regfile.inflight = false;
+		SimpleAES_StatsComplete(InstancePtr, *ErrPtr);
+		WRITE_ONCE(InstancePtr->reap_ns, ktime_get_ns());
+		spin_unlock_irqrestore(lock_ptr, lock_irq_flags);
+		return 0;
+	}
+	spin_unlock_irqrestore(lock_ptr, lock_irq_flags);
+
+	ret = Notification_Error_Receive(&InstancePtr->notif, tag, ErrPtr,
+					 SimpleAES_Timeout(InstancePtr));
+
+	// Slow completions feed the average too, so the budget tracks them
+	if (!ret) {
+		SimpleAES_UpdatePollAverage(InstancePtr,
+					    ktime_get_ns() - start_ns);
+	}
+	return ret;
+}
+
+static void SimpleAES_UpdatePollAverage(SimpleAES *InstancePtr, u64 ns)
+{
+	SimpleAES_UpdateAverage(&InstancePtr->poll_ewma_ns, ns);
+}
+
+// Completion deadline (jiffies): op_timeout_factor times the average block
+// time, and at least op_timeout_us
+static long SimpleAES_Timeout(SimpleAES *InstancePtr)
+{
+	u64 min_ns = (u64)READ_ONCE(op_timeout_us) * NSEC_PER_USEC;
+	u64 avg_ns = READ_ONCE(op_timeout_factor) *
+		     READ_ONCE(InstancePtr->engine_ewma_ns);
+
+	if (!min_ns) {
+		return MAX_SCHEDULE_TIMEOUT;
+	}
+	return nsecs_to_jiffies(max(min_ns, avg_ns)) + 1;
+}
+
+// Waits for the completion of the ticket holder's operation, handing the
+// engine to the watchdog each time the deadline passes. Returns -EAGAIN if
+// the watchdog had to reset the engine, which dropped the operation.
+static int SimpleAES_WaitBlock(SimpleAES *InstancePtr,
+			       ORG_SIMPLE_CompletionMode completion, u64 tag,
+			       u64 start_ns, ORG_SIMPLE_Error *ErrPtr)
+{
+	Notification_Error *notif = &InstancePtr->notif;
+
+	unsigned int strikes = 0;
+	int ret;
+
+	if (completion == ORG_SIMPLE_COMPLETION_IRQ) {
+		ret = Notification_Error_Receive(
+			notif, tag, ErrPtr, SimpleAES_Timeout(InstancePtr));
+	} else {
+		ret = SimpleAES_PollCompletion(InstancePtr, completion, tag,
+					       start_ns, ErrPtr);
+	}
+
+	while (ret == -ETIMEDOUT) {
+		if (SimpleAES_Watchdog(InstancePtr, &strikes)) {
+			return -EAGAIN;
+		}
+		ret = Notification_Error_Receive(
+			notif, tag, ErrPtr, SimpleAES_Timeout(InstancePtr));
+	}
+
+	return ret;
+}
+
+// Looks at the engine after a wait passed its deadline. A completion still
+// pending (late or lost interrupt) is reaped here. An idle engine with
+// nothing pending means the interrupt thread has taken the completion and is
+// about to post it, so the first such strike only waits again. Otherwise the
+// engine is stuck (STAT.BUSY) or lost the operation, and is reset. Returns
+// true after a reset.
+static bool SimpleAES_Watchdog(SimpleAES *InstancePtr,
+			       unsigned int *StrikesPtr)
+{
+	void __iomem *ptr	    = InstancePtr->regfile.ptr;
+	struct spinlock_t *lock_ptr = &InstancePtr->regfile.lock;
+
+	unsigned long lock_irq_flags;
+	bool busy;
+
+	this_cpu_inc(InstancePtr->stats->timeouts);
+
+	if (SimpleAES_ReapCompletion(InstancePtr)) {
+		Notification_Error_Flush(&InstancePtr->notif);
+		return false;
+	}
+
+	lock_irq_flags = SimpleAES_LockRegfile(InstancePtr);
+	busy	       = SIMPLEAES_FIELD_READ(BUSY, STAT, ptr);
+	spin_unlock_irqrestore(lock_ptr, lock_irq_flags);
+
+	if (!busy && !(*StrikesPtr)++) {
+		return false;
+	}
+
+	SimpleAES_ResetEngine(InstancePtr);
+	return true;
 }
 
-static Result_BoolError SimpleAES_Encrypt(SimpleAES *InstancePtr, u8 key[],
+// Fast reset: gating the engine clock returns the register file to its
+// reset values and drops the operation in flight. CTRL, KAR and IAR get
+// their shadows back; OAR would start an operation, so only its shadow is
+// reset. Called by the ticket holder, so no other operation uses the engine.
+// The interrupt line is shared and stays enabled: the engine's interrupt is
+// masked and the handlers keep off the registers while the clock is off. If
+// the clock cannot be re-enabled, it stays off and so do the handlers.
+static void SimpleAES_ResetEngine(SimpleAES *InstancePtr)
+{
+	struct device *dev_ptr	    = &InstancePtr->pdev_ptr->dev;
+	DescRing *ring_ptr	    = InstancePtr->ring_ptr;
+	void __iomem *ptr	    = InstancePtr->regfile.ptr;
+	u32 *shadow		    = InstancePtr->regfile.shadow;
+	struct spinlock_t *lock_ptr = &InstancePtr->regfile.lock;
+
+	unsigned long lock_irq_flags;
+	u64 begin_ns, reset_ns;
+	int ret;
+
+	begin_ns = ktime_get_ns();
+
+	// CTRL.IE is masked in the register only: the shadow keeps it, so the
+	// restore below sets it again
+	lock_irq_flags = SimpleAES_LockRegfile(InstancePtr);
+	SIMPLEAES_REG_WRITE(SIMPLEAES_FIELD_SET(0, IE, CTRL,
+						SIMPLEAES_SHADOW(CTRL, shadow)),
+			    CTRL, ptr);
+	InstancePtr->regfile.gated = true;
+	spin_unlock_irqrestore(lock_ptr, lock_irq_flags);
+
+	// Handlers that started before the mask are done after this
+	synchronize_irq(InstancePtr->irq_line);
+
+	clk_disable_unprepare(InstancePtr->axi_clock);
+	ret = clk_prepare_enable(InstancePtr->axi_clock);
+	if (ret) {
+		// The engine is gone: requests take the software path
+		dev_err(dev_ptr, "failed to re-enable clock after reset");
+		WRITE_ONCE(InstancePtr->engine_faulted, true);
+	} else {
+		lock_irq_flags = SimpleAES_LockRegfile(InstancePtr);
+		InstancePtr->regfile.gated = false;
+
+		// The interrupt thread left a masked IE to the reset
+		if (InstancePtr->irq_rearm) {
+			SIMPLEAES_SHADOW(CTRL, shadow) = SIMPLEAES_FIELD_SET(
+				1, IE, CTRL, SIMPLEAES_SHADOW(CTRL, shadow));
+			InstancePtr->irq_rearm = false;
+		}
+		SIMPLEAES_REG_WRITE(SIMPLEAES_IRQ_COMPLETE_Mask |
+					    SIMPLEAES_IRQ_ERR_Mask,
+				    IRQ, ptr);
+		SIMPLEAES_REG_WRITE(SIMPLEAES_SHADOW(CTRL, shadow), CTRL, ptr);
+		SIMPLEAES_REG_WRITE(SIMPLEAES_SHADOW(KAR, shadow), KAR, ptr);
+		SIMPLEAES_REG_WRITE(SIMPLEAES_SHADOW(IAR, shadow), IAR, ptr);
+		SIMPLEAES_SHADOW(OAR, shadow) = 0;
+		InstancePtr->regfile.inflight = false;
+
+		// The reset disabled the ring. An idle ring is started again
+		// here, one with descriptors in flight by its waiter
+		// (SimpleAES_RequeueRing).
+		if (ring_ptr) {
+			SIMPLEAES_REG_WRITE(SIMPLEAES_IRQ_RING_Mask, IRQ, ptr);
+			SIMPLEAES_SHADOW(RBAR, shadow)	= 0;
+			SIMPLEAES_SHADOW(RCFG, shadow)	= 0;
+			SIMPLEAES_SHADOW(RTAIL, shadow) = 0;
+			if (ring_ptr->head == ring_ptr->tail) {
+				SimpleAES_RingStart(InstancePtr,
+						    ring_ptr->tail);
+			}
+		}
+		spin_unlock_irqrestore(lock_ptr, lock_irq_flags);
+	}
+
+	reset_ns = ktime_get_ns() - begin_ns;
+	this_cpu_inc(InstancePtr->stats->resets);
+	this_cpu_add(InstancePtr->stats->reset_ns, reset_ns);
+	SimpleAES_StatsHist(InstancePtr, ORG_SIMPLE_HIST_RESET, reset_ns);
+	dev_warn_ratelimited(dev_ptr, "engine stuck, reset in %llu ns",
+			     reset_ns);
+}
+
+static Result_BoolError SimpleAES_Encrypt(SimpleAES *InstancePtr,
+					  FileContext *FilePtr, u8 key[],
 					  u8 i_data[], u8 o_data[])
 {
-	return SimpleAES_RunOp(InstancePtr, ORG_SIMPLE_OPMODE_ENCRYPT, key,
+	return SimpleAES_RunOp(InstancePtr, ORG_SIMPLE_OPMODE_ENCRYPT,
+			       FilePtr->completion,
+			       FileContext_Client(FilePtr, InstancePtr), key,
 			       i_data, o_data);
 }
 
-static Result_BoolError SimpleAES_Decrypt(SimpleAES *InstancePtr, u8 key[],
+static Result_BoolError SimpleAES_Decrypt(SimpleAES *InstancePtr,
+					  FileContext *FilePtr, u8 key[],
 					  u8 i_data[], u8 o_data[])
 {
-	return SimpleAES_RunOp(InstancePtr, ORG_SIMPLE_OPMODE_DECRYPT, key,
+	return SimpleAES_RunOp(InstancePtr, ORG_SIMPLE_OPMODE_DECRYPT,
+			       FilePtr->completion,
+			       FileContext_Client(FilePtr, InstancePtr), key,
 			       i_data, o_data);
 }
 
-static bool SimpleAES_Busy(SimpleAES *InstancePtr)
+static int SimpleAES_EncryptBatch(SimpleAES *InstancePtr, FileContext *FilePtr,
+				  IOCTL_BatchData *BatchPtr)
+{
+	return SimpleAES_RunBatch(InstancePtr, ORG_SIMPLE_OPMODE_ENCRYPT,
+				  FilePtr->completion,
+				  FileContext_Client(FilePtr, InstancePtr),
+				  BatchPtr);
+}
+
+static int SimpleAES_DecryptBatch(SimpleAES *InstancePtr, FileContext *FilePtr,
+				  IOCTL_BatchData *BatchPtr)
+{
+	return SimpleAES_RunBatch(InstancePtr, ORG_SIMPLE_OPMODE_DECRYPT,
+				  FilePtr->completion,
+				  FileContext_Client(FilePtr, InstancePtr),
+				  BatchPtr);
+}
+
+static Result_BoolError SimpleAES_EncryptChain(SimpleAES *InstancePtr,
+					       FileContext *FilePtr,
+					       IOCTL_ChainData *ChainPtr)
+{
+	return SimpleAES_RunChain(InstancePtr, ORG_SIMPLE_OPMODE_ENCRYPT,
+				  FilePtr->completion,
+				  FileContext_Client(FilePtr, InstancePtr),
+				  ChainPtr);
+}
+
+static Result_BoolError SimpleAES_DecryptChain(SimpleAES *InstancePtr,
+					       FileContext *FilePtr,
+					       IOCTL_ChainData *ChainPtr)
+{
+	return SimpleAES_RunChain(InstancePtr, ORG_SIMPLE_OPMODE_DECRYPT,
+				  FilePtr->completion,
+				  FileContext_Client(FilePtr, InstancePtr),
+				  ChainPtr);
+}
+
+static Result_BoolError SimpleAES_EncryptKeyed(SimpleAES *InstancePtr,
+					       FileContext *FilePtr,
+					       IOCTL_KeyedData *KeyedPtr)
+{
+	return SimpleAES_RunKeyedOp(InstancePtr, ORG_SIMPLE_OPMODE_ENCRYPT,
+				    FilePtr, KeyedPtr->handle,
+				    KeyedPtr->i_data_ptr, KeyedPtr->o_data_ptr);
+}
+
+static Result_BoolError SimpleAES_DecryptKeyed(SimpleAES *InstancePtr,
+					       FileContext *FilePtr,
+					       IOCTL_KeyedData *KeyedPtr)
+{
+	return SimpleAES_RunKeyedOp(InstancePtr, ORG_SIMPLE_OPMODE_DECRYPT,
+				    FilePtr, KeyedPtr->handle,
+				    KeyedPtr->i_data_ptr, KeyedPtr->o_data_ptr);
+}
+
+static int SimpleAES_EncryptFixed(SimpleAES *InstancePtr, FileContext *FilePtr,
+				  IOCTL_FixedData *FixedPtr)
+{
+	return SimpleAES_RunFixedOp(InstancePtr, ORG_SIMPLE_OPMODE_ENCRYPT,
+				    FilePtr, FixedPtr);
+}
+
+static int SimpleAES_DecryptFixed(SimpleAES *InstancePtr, FileContext *FilePtr,
+				  IOCTL_FixedData *FixedPtr)
+{
+	return SimpleAES_RunFixedOp(InstancePtr, ORG_SIMPLE_OPMODE_DECRYPT,
+				    FilePtr, FixedPtr);
+}
+
+// Programs CTRL for the next operation, refusing while the engine is busy.
+// The ticket holder normally finds the last operation reaped, and then the
+// engine idle without reading STAT. Called with the regfile lock held.
+static Result_BoolError
+SimpleAES_ProgramMode(SimpleAES *InstancePtr, ORG_SIMPLE_OpMode mode,
+		      ORG_SIMPLE_CompletionMode completion)
+{
+	void __iomem *ptr = InstancePtr->regfile.ptr;
+	u32 *shadow	  = InstancePtr->regfile.shadow;
+	bool irq_enable	  = completion == ORG_SIMPLE_COMPLETION_IRQ;
+	u32 ctrl;
+
+	if (InstancePtr->regfile.inflight &&
+	    SIMPLEAES_FIELD_READ(BUSY, STAT, ptr)) {
+		this_cpu_inc(InstancePtr->stats->busy);
+		return RESULT_BOOLERROR_ERR(ERROR_BUSY);
+	}
+
+	// Polled ops keep the interrupt masked until their budget runs out.
+	// While the interrupt thread drains, it owns IE and re-arms it for
+	// interrupt-mode ops when it is done.
+	if (InstancePtr->irq_rearm) {
+		InstancePtr->irq_rearm = irq_enable;
+		irq_enable	       = false;
+	}
+
+	// OP and IE in one write, none if CTRL already holds them
+	ctrl = SIMPLEAES_FIELD_SET((u32)mode, OP, CTRL,
+				   SIMPLEAES_SHADOW(CTRL, shadow));
+	ctrl = SIMPLEAES_FIELD_SET(irq_enable ? 1 : 0, IE, CTRL, ctrl);
+	SIMPLEAES_SHADOW_UPDATE(ctrl, CTRL, ptr, shadow);
+
+	return RESULT_BOOLERROR_OK(1);
+}
+
+static Result_BoolError SimpleAES_SetMode(SimpleAES *InstancePtr,
+					  ORG_SIMPLE_OpMode mode,
+					  ORG_SIMPLE_CompletionMode completion)
 {
-	void __iomem *ptr	    = InstancePtr->regfile.ptr;
 	struct spinlock_t *lock_ptr = &InstancePtr->regfile.lock;
+	Result_BoolError err_boolerror;
 	unsigned long lock_irq_flags;
-	u32 stat_busy;
 
-	spin_lock_irqsave(lock_ptr, lock_irq_flags);
-	stat_busy = SIMPLEAES_FIELD_READ(BUSY, STAT, ptr);
+	lock_irq_flags = SimpleAES_LockRegfile(InstancePtr);
+	err_boolerror  = SimpleAES_ProgramMode(InstancePtr, mode, completion);
 	spin_unlock_irqrestore(lock_ptr, lock_irq_flags);
 
-	return stat_busy == 1;
+	return err_boolerror;
+}
+
+// Programs and starts one operation under a single regfile lock hold. The
+// engine reads KAR and IAR on every operation, so they are only rewritten
+// when they change; writing OAR starts the operation (at *StartNsPtr).
+static Result_BoolError SimpleAES_Submit(SimpleAES *InstancePtr,
+					 ORG_SIMPLE_OpMode mode,
+					 ORG_SIMPLE_CompletionMode completion,
+					 u32 key_addr, u32 input_addr,
+					 u32 output_addr, u64 *StartNsPtr)
+{
+	void __iomem *ptr	    = InstancePtr->regfile.ptr;
+	u32 *shadow		    = InstancePtr->regfile.shadow;
+	struct spinlock_t *lock_ptr = &InstancePtr->regfile.lock;
+	Result_BoolError err_boolerror;
+	unsigned long lock_irq_flags;
+
+	lock_irq_flags = SimpleAES_LockRegfile(InstancePtr);
+
+	err_boolerror = SimpleAES_ProgramMode(InstancePtr, mode, completion);
+	if (err_boolerror.variant == RESULT_ERR) {
+		spin_unlock_irqrestore(lock_ptr, lock_irq_flags);
+		return err_boolerror;
+	}
+
+	SIMPLEAES_SHADOW_UPDATE(key_addr, KAR, ptr, shadow);
+	SIMPLEAES_SHADOW_UPDATE(input_addr, IAR, ptr, shadow);
+	*StartNsPtr = ktime_get_ns();
+	SIMPLEAES_SHADOW_WRITE(output_addr, OAR, ptr, shadow);
+	InstancePtr->regfile.inflight = true;
+
+	spin_unlock_irqrestore(lock_ptr, lock_irq_flags);
+
+	return RESULT_BOOLERROR_OK(1);
+}
+
+static Result_BoolError SimpleAES_RunOp(SimpleAES *InstancePtr,
+					ORG_SIMPLE_OpMode mode,
+					ORG_SIMPLE_CompletionMode completion,
+					SchedClient *ClientPtr,
+					u8 key[], u8 i_data[], u8 o_data[])
+{
+	struct device *dev_ptr = &InstancePtr->pdev_ptr->dev;
+	HwBufferPool *pool_ptr = &InstancePtr->buf_pool;
+
+	HwBuffer op_buf, key_buf, input_buf, output_buf;
+	Result_BoolError ret_err_boolerror = RESULT_BOOLERROR_OK(1);
+	Result_BoolError err_boolerror;
+	u64 phase_ns[ORG_SIMPLE_OP_PHASES];
+	u64 begin_ns, stamp_ns, waits;
+	unsigned long ret_copy;
+
+	if (SimpleAES_PreferCpu(InstancePtr, 1)) {
+		return SimpleAES_SoftRunOp(InstancePtr, mode, key, i_data,
+					   o_data);
+	}
+
+	trace_simpleaes_op_begin(InstancePtr->id, mode, completion);
+	waits	 = READ_ONCE(InstancePtr->sched.waits);
+	begin_ns = ktime_get_ns();
+	stamp_ns = begin_ns;
+
+	if (HwBufferPool_Get(pool_ptr, &op_buf)) {
+		dev_err(dev_ptr, "failed to allocate operation record");
+		ret_err_boolerror = RESULT_BOOLERROR_ERR(ERROR_OTHER);
+		goto __simpleaes_runop_ret;
+	}
+	HwOpRecord_Split(&op_buf, &key_buf, &input_buf, &output_buf);
+
+	phase_ns[ORG_SIMPLE_PHASE_ALLOC] = ktime_get_ns() - stamp_ns;
+	stamp_ns += phase_ns[ORG_SIMPLE_PHASE_ALLOC];
+	SimpleAES_StatsStage(InstancePtr, ORG_SIMPLE_PHASE_ALLOC,
+			     phase_ns[ORG_SIMPLE_PHASE_ALLOC]);
+
+	ret_copy = copy_from_user(key_buf.cpu_addr, key, ORG_SIMPLE_KEY_SIZE);
+	if (ret_copy) {
+		dev_err(dev_ptr, "failed to copy key");
+		ret_err_boolerror = RESULT_BOOLERROR_ERR(ERROR_KEY);
+		goto __simpleaes_runop_undo_res1;
+	}
+
+	ret_copy =
+		copy_from_user(input_buf.cpu_addr, i_data, ORG_SIMPLE_KD_SIZE);
+	if (ret_copy) {
+		dev_err(dev_ptr, "failed to copy input data");
+		ret_err_boolerror = RESULT_BOOLERROR_ERR(ERROR_INPUT);
+		goto __simpleaes_runop_undo_res1;
+	}
+
+	phase_ns[ORG_SIMPLE_PHASE_COPY_IN] = ktime_get_ns() - stamp_ns;
+	SimpleAES_StatsStage(InstancePtr, ORG_SIMPLE_PHASE_COPY_IN,
+			     phase_ns[ORG_SIMPLE_PHASE_COPY_IN]);
+
+	err_boolerror = SimpleAES_RunBlockTimed(InstancePtr, mode, completion,
+						ClientPtr, &key_buf, &input_buf,
+						&output_buf, phase_ns);
+	if (err_boolerror.variant == RESULT_ERR) {
+		ret_err_boolerror = err_boolerror;
+		goto __simpleaes_runop_undo_res1;
+	}
+
+	stamp_ns = ktime_get_ns();
+	ret_copy =
+		copy_to_user(o_data, output_buf.cpu_addr, ORG_SIMPLE_KD_SIZE);
+	if (ret_copy) {
+		dev_err(dev_ptr, "failed to copy output data");
+		ret_err_boolerror = RESULT_BOOLERROR_ERR(ERROR_OUTPUT);
+		goto __simpleaes_runop_undo_res1;
+	}
+
+	phase_ns[ORG_SIMPLE_PHASE_COPY_OUT] = ktime_get_ns() - stamp_ns;
+	SimpleAES_StatsStage(InstancePtr, ORG_SIMPLE_PHASE_COPY_OUT,
+			     phase_ns[ORG_SIMPLE_PHASE_COPY_OUT]);
+
+	OpPhaseStats_Record(&InstancePtr->op_phases, phase_ns);
+	SimpleAES_StatsHist(InstancePtr, ORG_SIMPLE_HIST_OP,
+			    ktime_get_ns() - begin_ns);
+	SimpleAES_UpdateEngineCost(InstancePtr, waits, begin_ns, 1);
+
+	// The record goes back to the pool on both success and error paths
+
+__simpleaes_runop_undo_res1:
+	HwBufferPool_Put(pool_ptr, &op_buf);
+
+__simpleaes_runop_ret:
+	if (trace_simpleaes_op_end_enabled()) {
+		trace_simpleaes_op_end(InstancePtr->id,
+				       ret_err_boolerror.variant == RESULT_ERR ?
+					       ret_err_boolerror.value.err :
+					       ERROR_OK,
+				       ktime_get_ns() - begin_ns);
+	}
+	return ret_err_boolerror;
+}
+
+static Result_BoolError SimpleAES_RunBlock(SimpleAES *InstancePtr,
+					   ORG_SIMPLE_OpMode mode,
+					   ORG_SIMPLE_CompletionMode completion,
+					   SchedClient *ClientPtr,
+					   HwBuffer *KeyBufPtr,
+					   HwBuffer *InputBufPtr,
+					   HwBuffer *OutputBufPtr)
+{
+	return SimpleAES_RunBlockTimed(InstancePtr, mode, completion,
+				       ClientPtr, KeyBufPtr, InputBufPtr,
+				       OutputBufPtr, NULL);
+}
+
+// Accounts the queue, MMIO, engine and wakeup stages of every path that
+// runs one block at a time, and fills them in phase_ns (optional)
+static Result_BoolError
+SimpleAES_RunBlockTimed(SimpleAES *InstancePtr, ORG_SIMPLE_OpMode mode,
+			ORG_SIMPLE_CompletionMode completion,
+			SchedClient *ClientPtr, HwBuffer *KeyBufPtr,
+			HwBuffer *InputBufPtr, HwBuffer *OutputBufPtr,
+			u64 phase_ns[])
+{
+	struct device *dev_ptr = &InstancePtr->pdev_ptr->dev;
+	Result_BoolError err_boolerror;
+	ORG_SIMPLE_Error notif_val;
+	unsigned int attempt;
+	SchedTicket ticket;
+	u64 queue_ns, grant_ns, start_ns, reap_ns, end_ns;
+	int ret;
+
+	// A faulted engine (failed self-test, clock lost after a reset) is
+	// never programmed again: its blocks run in software
+	if (READ_ONCE(InstancePtr->engine_faulted)) {
+		return SimpleAES_SoftRunBlock(InstancePtr, mode, KeyBufPtr,
+					      InputBufPtr, OutputBufPtr);
+	}
+
+	HwBuffer_SyncForDevice(dev_ptr, KeyBufPtr, ORG_SIMPLE_KEY_SIZE);
+	HwBuffer_SyncForDevice(dev_ptr, InputBufPtr, ORG_SIMPLE_BLOCK_SIZE);
+	HwBuffer_SyncForDevice(dev_ptr, OutputBufPtr, ORG_SIMPLE_BLOCK_SIZE);
+
+	// One operation at a time: the engine has a single register set.
+	// Waiters are served fairly per client.
+	queue_ns = ktime_get_ns();
+	Scheduler_Acquire(&InstancePtr->sched, ClientPtr, &ticket, 1);
+	grant_ns = ktime_get_ns();
+	SimpleAES_StatsStage(InstancePtr, ORG_SIMPLE_PHASE_QUEUE,
+			     grant_ns - queue_ns);
+
+	// The engine may have been lost while this operation waited for it
+	if (READ_ONCE(InstancePtr->engine_faulted)) {
+		Scheduler_Release(&InstancePtr->sched);
+		HwBuffer_SyncForCpu(dev_ptr, OutputBufPtr,
+				    ORG_SIMPLE_BLOCK_SIZE);
+		return SimpleAES_SoftRunBlock(InstancePtr, mode, KeyBufPtr,
+					      InputBufPtr, OutputBufPtr);
+	}
+
+	// A reset engine dropped the operation: it is requeued, still holding
+	// the engine, up to op_retries times
+	for (attempt = 0;; attempt++) {
+		err_boolerror = SimpleAES_Submit(InstancePtr, mode, completion,
+						 (u32)KeyBufPtr->bus_addr,
+						 (u32)InputBufPtr->bus_addr,
+						 (u32)OutputBufPtr->bus_addr,
+						 &start_ns);
+		if (err_boolerror.variant == RESULT_ERR) {
+			dev_err(dev_ptr, "failed to set operation mode");
+			goto __simpleaes_runblocktimed_undo_res1;
+		}
+		if (!attempt) {
+			SimpleAES_StatsStage(InstancePtr, ORG_SIMPLE_PHASE_MMIO,
+					     start_ns - grant_ns);
+		}
+
+		ret = SimpleAES_WaitBlock(InstancePtr, completion, ticket.tag,
+					  start_ns, &notif_val);
+		if (ret != -EAGAIN) {
+			break;
+		}
+		if (attempt >= READ_ONCE(op_retries) ||
+		    READ_ONCE(InstancePtr->engine_faulted)) {
+			this_cpu_inc(InstancePtr->stats->errors[ERROR_TIMEOUT]);
+			err_boolerror = RESULT_BOOLERROR_ERR(ERROR_TIMEOUT);
+			goto __simpleaes_runblocktimed_undo_res1;
+		}
+		this_cpu_inc(InstancePtr->stats->requeues);
+	}
+	if (ret) {
+		dev_err(dev_ptr, "Operation failed");
+		err_boolerror = RESULT_BOOLERROR_ERR(ERROR_OTHER);
+		goto __simpleaes_runblocktimed_undo_res1;
+	}
+
+	end_ns = ktime_get_ns();
+	LatencyStats_Record(&InstancePtr->latency[completion],
+			    end_ns - start_ns);
+	SimpleAES_UpdateAverage(&InstancePtr->engine_ewma_ns,
+				end_ns - start_ns);
+
+	// The completion is seen by the interrupt thread or by the poll loop.
+	// Only the ticket holder's operation runs, so reap_ns is ours.
+	reap_ns = clamp(READ_ONCE(InstancePtr->reap_ns), start_ns, end_ns);
+	SimpleAES_StatsStage(InstancePtr, ORG_SIMPLE_PHASE_ENGINE,
+			     reap_ns - start_ns);
+	SimpleAES_StatsStage(InstancePtr, ORG_SIMPLE_PHASE_WAKEUP,
+			     end_ns - reap_ns);
+	if (phase_ns) {
+		phase_ns[ORG_SIMPLE_PHASE_QUEUE]  = grant_ns - queue_ns;
+		phase_ns[ORG_SIMPLE_PHASE_MMIO]	  = start_ns - grant_ns;
+		phase_ns[ORG_SIMPLE_PHASE_ENGINE] = reap_ns - start_ns;
+		phase_ns[ORG_SIMPLE_PHASE_WAKEUP] = end_ns - reap_ns;
+	}
+
+	err_boolerror = notif_val == ERROR_OK ?
+				RESULT_BOOLERROR_OK(1) :
+				RESULT_BOOLERROR_ERR(notif_val);
+
+__simpleaes_runblocktimed_undo_res1:
+	Scheduler_Release(&InstancePtr->sched);
+	HwBuffer_SyncForCpu(dev_ptr, OutputBufPtr, ORG_SIMPLE_BLOCK_SIZE);
+	return err_boolerror;
+}
+
+static ORG_SIMPLE_Error
+SimpleAES_RunBatchBlock(SimpleAES *InstancePtr, ORG_SIMPLE_OpMode mode,
+			ORG_SIMPLE_CompletionMode completion,
+			SchedClient *ClientPtr,
+			IOCTL_Block *BlockPtr, HwBuffer *KeyBufPtr,
+			HwBuffer *InputBufPtr, HwBuffer *OutputBufPtr,
+			void **LoadedKeyPtr)
+{
+	Result_BoolError err_boolerror;
+	u64 stamp_ns = ktime_get_ns();
+
+	// The key buffer is only refilled when the block uses another key
+	if (BlockPtr->key_ptr != *LoadedKeyPtr) {
+		*LoadedKeyPtr = NULL;
+		if (copy_from_user(KeyBufPtr->cpu_addr, BlockPtr->key_ptr,
+				   ORG_SIMPLE_KD_SIZE)) {
+			return ERROR_KEY;
+		}
+		*LoadedKeyPtr = BlockPtr->key_ptr;
+	}
+
+	if (copy_from_user(InputBufPtr->cpu_addr, BlockPtr->i_data_ptr,
+			   ORG_SIMPLE_KD_SIZE)) {
+		return ERROR_INPUT;
+	}
+	SimpleAES_StatsStage(InstancePtr, ORG_SIMPLE_PHASE_COPY_IN,
+			     ktime_get_ns() - stamp_ns);
+
+	err_boolerror = SimpleAES_RunBlock(InstancePtr, mode, completion,
+					   ClientPtr, KeyBufPtr, InputBufPtr,
+					   OutputBufPtr);
+	if (err_boolerror.variant == RESULT_ERR) {
+		return err_boolerror.value.err;
+	}
+
+	stamp_ns = ktime_get_ns();
+	if (copy_to_user(BlockPtr->o_data_ptr, OutputBufPtr->cpu_addr,
+			 ORG_SIMPLE_KD_SIZE)) {
+		return ERROR_OUTPUT;
+	}
+	SimpleAES_StatsStage(InstancePtr, ORG_SIMPLE_PHASE_COPY_OUT,
+			     ktime_get_ns() - stamp_ns);
+
+	return ERROR_OK;
+}
+
+static ORG_SIMPLE_Error
+SimpleAES_RunMappedBlock(SimpleAES *InstancePtr, ORG_SIMPLE_OpMode mode,
+			 ORG_SIMPLE_CompletionMode completion,
+			 SchedClient *ClientPtr,
+			 IOCTL_BatchData *BatchPtr, size_t offset,
+			 HwBuffer *KeyBufPtr, UserDmaMap *InputMapPtr,
+			 UserDmaMap *OutputMapPtr, void **LoadedKeyPtr)
+{
+	HwBuffer input_buf  = { .cpu_addr = NULL, .slot = -1 };
+	HwBuffer output_buf = { .cpu_addr = NULL, .slot = -1 };
+	Result_BoolError err_boolerror;
+
+	if (!*LoadedKeyPtr) {
+		if (copy_from_user(KeyBufPtr->cpu_addr, BatchPtr->key_ptr,
+				   ORG_SIMPLE_KD_SIZE)) {
+			return ERROR_KEY;
+		}
+		*LoadedKeyPtr = BatchPtr->key_ptr;
+	}
+
+	// The engine reads and writes the caller's pages directly
+	if (UserDmaMap_BusAddr(InputMapPtr, offset, ORG_SIMPLE_KD_SIZE,
+			       &input_buf.bus_addr)) {
+		return ERROR_INPUT;
+	}
+	if (UserDmaMap_BusAddr(OutputMapPtr, offset, ORG_SIMPLE_KD_SIZE,
+			       &output_buf.bus_addr)) {
+		return ERROR_OUTPUT;
+	}
+
+	err_boolerror = SimpleAES_RunBlock(InstancePtr, mode, completion,
+					   ClientPtr, KeyBufPtr, &input_buf,
+					   &output_buf);
+	if (err_boolerror.variant == RESULT_ERR) {
+		return err_boolerror.value.err;
+	}
+
+	return ERROR_OK;
+}
+
+static bool SimpleAES_CanZeroCopy(IOCTL_BatchData *BatchPtr)
+{
+	unsigned long i_addr = (unsigned long)BatchPtr->i_data_ptr;
+	unsigned long o_addr = (unsigned long)BatchPtr->o_data_ptr;
+	size_t span = (size_t)BatchPtr->num_blocks * ORG_SIMPLE_KD_SIZE;
+
+	if (BatchPtr->blocks_ptr || span < zerocopy_threshold) {
+		return false;
+	}
+
+	// A block must never straddle two pages
+	if (!IS_ALIGNED(i_addr, ORG_SIMPLE_KD_SIZE) ||
+	    !IS_ALIGNED(o_addr, ORG_SIMPLE_KD_SIZE)) {
+		return false;
+	}
+
+	// In-place or overlapping requests keep using the bounce buffers
+	return i_addr + span <= o_addr || o_addr + span <= i_addr;
+}
+
+// Large contiguous batches are mapped directly. If pinning fails the batch
+// silently falls back to the bounce buffers.
+static bool SimpleAES_MapBatch(SimpleAES *InstancePtr,
+			       IOCTL_BatchData *BatchPtr,
+			       UserDmaMap *InputMapPtr,
+			       UserDmaMap *OutputMapPtr)
+{
+	struct device *dev_ptr = &InstancePtr->pdev_ptr->dev;
+	size_t span = (size_t)BatchPtr->num_blocks * ORG_SIMPLE_KD_SIZE;
+
+	if (!SimpleAES_CanZeroCopy(BatchPtr) ||
+	    UserDmaMap_Init(InputMapPtr, dev_ptr, BatchPtr->i_data_ptr, span,
+			    DMA_TO_DEVICE, false)) {
+		return false;
+	}
+
+	if (UserDmaMap_Init(OutputMapPtr, dev_ptr, BatchPtr->o_data_ptr, span,
+			    DMA_FROM_DEVICE, false)) {
+		UserDmaMap_DeInit(InputMapPtr, dev_ptr);
+		return false;
+	}
+
+	atomic64_inc(&InstancePtr->zerocopy_batches);
+	return true;
+}
+
+// Staging runs ahead of the results, so a block's input must not be another
+// block's output. Descriptor batches may chain blocks that way and are run
+// one block at a time.
+static bool SimpleAES_CanPipeline(IOCTL_BatchData *BatchPtr,
+				  ORG_SIMPLE_CompletionMode completion)
+{
+	unsigned long i_addr = (unsigned long)BatchPtr->i_data_ptr;
+	unsigned long o_addr = (unsigned long)BatchPtr->o_data_ptr;
+	size_t span = (size_t)BatchPtr->num_blocks * ORG_SIMPLE_KD_SIZE;
+
+	if (completion != ORG_SIMPLE_COMPLETION_IRQ ||
+	    BatchPtr->blocks_ptr || BatchPtr->num_blocks < 2) {
+		return false;
+	}
+
+	return i_addr == o_addr || i_addr + span <= o_addr ||
+	       o_addr + span <= i_addr;
+}
+
+// Fills a free slot with block idx. Failures are left in the slot and
+// reported with the block.
+static void SimpleAES_StageBlock(struct device *dev_ptr,
+				 IOCTL_BatchData *BatchPtr, unsigned int idx,
+				 PipeSlot *SlotPtr, bool zerocopy,
+				 UserDmaMap *InputMapPtr,
+				 UserDmaMap *OutputMapPtr)
+{
+	size_t offset = (size_t)idx * ORG_SIMPLE_KD_SIZE;
+	u8 *i_data    = (u8 *)BatchPtr->i_data_ptr + offset;
+	dma_addr_t bus_addr;
+
+	SlotPtr->err	    = ERROR_OK;
+	SlotPtr->done_ns    = 0;
+	SlotPtr->o_data_ptr = zerocopy ? NULL :
+					 (u8 *)BatchPtr->o_data_ptr + offset;
+
+	if (!SlotPtr->loaded_key) {
+		if (copy_from_user(SlotPtr->key_buf.cpu_addr,
+				   BatchPtr->key_ptr, ORG_SIMPLE_KD_SIZE)) {
+			SlotPtr->err = ERROR_KEY;
+			return;
+		}
+		SlotPtr->loaded_key = BatchPtr->key_ptr;
+		HwBuffer_SyncForDevice(dev_ptr, &SlotPtr->key_buf,
+				       ORG_SIMPLE_KEY_SIZE);
+	}
+
+	// The engine reads and writes the caller's pages directly
+	if (zerocopy) {
+		if (UserDmaMap_BusAddr(InputMapPtr, offset, ORG_SIMPLE_KD_SIZE,
+				       &bus_addr)) {
+			SlotPtr->err = ERROR_INPUT;
+			return;
+		}
+		SlotPtr->input_addr = (u32)bus_addr;
+
+		if (UserDmaMap_BusAddr(OutputMapPtr, offset, ORG_SIMPLE_KD_SIZE,
+				       &bus_addr)) {
+			SlotPtr->err = ERROR_OUTPUT;
+			return;
+		}
+		SlotPtr->output_addr = (u32)bus_addr;
+		return;
+	}
+
+	if (copy_from_user(SlotPtr->input_buf.cpu_addr, i_data,
+			   ORG_SIMPLE_KD_SIZE)) {
+		SlotPtr->err = ERROR_INPUT;
+		return;
+	}
+	HwBuffer_SyncForDevice(dev_ptr, &SlotPtr->input_buf,
+			       ORG_SIMPLE_BLOCK_SIZE);
+	HwBuffer_SyncForDevice(dev_ptr, &SlotPtr->output_buf,
+			       ORG_SIMPLE_BLOCK_SIZE);
+	SlotPtr->input_addr  = (u32)SlotPtr->input_buf.bus_addr;
+	SlotPtr->output_addr = (u32)SlotPtr->output_buf.bus_addr;
+}
+
+// Hands the result of a completed block back to the caller
+static int SimpleAES_DrainBlock(struct device *dev_ptr,
+				IOCTL_BatchData *BatchPtr, unsigned int idx,
+				PipeSlot *SlotPtr)
+{
+	ORG_SIMPLE_Error err = SlotPtr->err;
+
+	if (err == ERROR_OK && SlotPtr->o_data_ptr) {
+		HwBuffer_SyncForCpu(dev_ptr, &SlotPtr->output_buf,
+				    ORG_SIMPLE_BLOCK_SIZE);
+	}
+	if (err == ERROR_OK && SlotPtr->o_data_ptr &&
+	    copy_to_user(SlotPtr->o_data_ptr, SlotPtr->output_buf.cpu_addr,
+			 ORG_SIMPLE_KD_SIZE)) {
+		err = ERROR_OUTPUT;
+	}
+
+	// Per-block results never fail the rest of the batch
+	if (BatchPtr->err_ptr && put_user(err, &BatchPtr->err_ptr[idx])) {
+		return -EFAULT;
+	}
+
+	if (err != ERROR_OK) {
+		BatchPtr->num_failed++;
+	}
+	BatchPtr->num_done++;
+
+	return 0;
+}
+
+// After an engine reset, restarts the block the reset dropped, or fails it
+// with ERROR_TIMEOUT once it was requeued op_retries times. A lost engine
+// (engine_faulted) fails every staged block and is not programmed again.
+static void SimpleAES_RequeuePipeline(SimpleAES *InstancePtr,
+				      Pipeline *PipePtr,
+				      unsigned int *AttemptPtr)
+{
+	struct spinlock_t *lock_ptr = &InstancePtr->regfile.lock;
+
+	unsigned long lock_irq_flags;
+	PipeSlot *slot_ptr;
+
+	lock_irq_flags = SimpleAES_LockRegfile(InstancePtr);
+
+	if (READ_ONCE(InstancePtr->engine_faulted)) {
+		while (PipePtr->completed < PipePtr->staged) {
+			slot_ptr = &PipePtr->slots[PipePtr->completed %
+						   ORG_SIMPLE_PIPELINE_DEPTH];
+			slot_ptr->err = ERROR_TIMEOUT;
+			this_cpu_inc(InstancePtr->stats->errors[ERROR_TIMEOUT]);
+			smp_store_release(&PipePtr->completed,
+					  PipePtr->completed + 1);
+		}
+		PipePtr->started = PipePtr->completed;
+		spin_unlock_irqrestore(lock_ptr, lock_irq_flags);
+		return;
+	}
+
+	// The block may have completed before the interrupt was masked
+	if (PipePtr->started > PipePtr->completed) {
+		if (*AttemptPtr < READ_ONCE(op_retries)) {
+			(*AttemptPtr)++;
+			this_cpu_inc(InstancePtr->stats->requeues);
+		} else {
+			slot_ptr = &PipePtr->slots[PipePtr->completed %
+						   ORG_SIMPLE_PIPELINE_DEPTH];
+			slot_ptr->err = ERROR_TIMEOUT;
+			this_cpu_inc(InstancePtr->stats->errors[ERROR_TIMEOUT]);
+			smp_store_release(&PipePtr->completed,
+					  PipePtr->completed + 1);
+		}
+		PipePtr->started = PipePtr->completed;
+		SimpleAES_IssueStaged(InstancePtr);
+	}
+
+	spin_unlock_irqrestore(lock_ptr, lock_irq_flags);
+}
+
+// Runs a contiguous batch with up to ORG_SIMPLE_PIPELINE_DEPTH blocks in
+// flight: while the engine runs block N, block N+1 is staged and block N-1
+// drained. The interrupt handler starts each staged block, so the engine
+// only idles when the caller falls behind. The engine is held for
+// pipeline_burst blocks per scheduler ticket.
+static int SimpleAES_RunPipeline(SimpleAES *InstancePtr,
+				 ORG_SIMPLE_OpMode mode,
+				 SchedClient *ClientPtr,
+				 IOCTL_BatchData *BatchPtr)
+{
+	struct device *dev_ptr	    = &InstancePtr->pdev_ptr->dev;
+	HwBufferPool *pool_ptr	    = &InstancePtr->buf_pool;
+	struct spinlock_t *lock_ptr = &InstancePtr->regfile.lock;
+	unsigned int num_blocks	    = BatchPtr->num_blocks;
+
+	UserDmaMap input_map, output_map;
+	Result_BoolError err_boolerror;
+	unsigned long lock_irq_flags;
+	unsigned int num_slots, end, strikes = 0, attempt = 0;
+	PipeSlot *slot_ptr;
+	SchedTicket ticket;
+	Pipeline pipe;
+	bool zerocopy;
+	u64 start_ns, stamp_ns;
+	int ret = 0;
+
+	BatchPtr->num_done   = 0;
+	BatchPtr->num_failed = 0;
+
+	memset(&pipe, 0, sizeof(pipe));
+	init_waitqueue_head(&pipe.wq);
+
+	zerocopy = SimpleAES_MapBatch(InstancePtr, BatchPtr, &input_map,
+				      &output_map);
+
+	for (num_slots = 0; num_slots < ORG_SIMPLE_PIPELINE_DEPTH;
+	     num_slots++) {
+		slot_ptr = &pipe.slots[num_slots];
+		if (HwBufferPool_Get(pool_ptr, &slot_ptr->op_buf)) {
+			break;
+		}
+		HwOpRecord_Split(&slot_ptr->op_buf, &slot_ptr->key_buf,
+				 &slot_ptr->input_buf, &slot_ptr->output_buf);
+	}
+	if (num_slots < ORG_SIMPLE_PIPELINE_DEPTH) {
+		dev_err(dev_ptr, "failed to allocate pipeline buffers");
+		ret = -ENOMEM;
+		goto __simpleaes_runpipeline_undo_res1;
+	}
+
+	while (pipe.drained < num_blocks) {
+		end = min(num_blocks,
+			  pipe.drained + max(READ_ONCE(pipeline_burst), 1U));
+
+		stamp_ns = ktime_get_ns();
+		Scheduler_Acquire(&InstancePtr->sched, ClientPtr, &ticket,
+				  end - pipe.drained);
+		start_ns = ktime_get_ns();
+		SimpleAES_StatsStage(InstancePtr, ORG_SIMPLE_PHASE_QUEUE,
+				     start_ns - stamp_ns);
+
+		// A lost engine leaves the rest to SimpleAES_RunBatch
+		if (READ_ONCE(InstancePtr->engine_faulted)) {
+			Scheduler_Release(&InstancePtr->sched);
+			break;
+		}
+
+		err_boolerror = SimpleAES_SetMode(InstancePtr, mode,
+						  ORG_SIMPLE_COMPLETION_IRQ);
+		if (err_boolerror.variant == RESULT_ERR) {
+			dev_err(dev_ptr, "failed to set operation mode");
+			Scheduler_Release(&InstancePtr->sched);
+			ret = -EBUSY;
+			break;
+		}
+
+		spin_lock_irqsave(lock_ptr, lock_irq_flags);
+		InstancePtr->pipe_ptr = &pipe;
+		spin_unlock_irqrestore(lock_ptr, lock_irq_flags);
+
+		while (pipe.drained < end) {
+			// Fill every free slot before waiting
+			while (!ret && pipe.staged < end &&
+			       pipe.staged - pipe.drained <
+				       ORG_SIMPLE_PIPELINE_DEPTH &&
+			       !READ_ONCE(InstancePtr->engine_faulted)) {
+				if (fatal_signal_pending(current)) {
+					ret = -EINTR;
+					break;
+				}
+
+				stamp_ns = ktime_get_ns();
+				SimpleAES_StageBlock(
+					dev_ptr, BatchPtr, pipe.staged,
+					&pipe.slots[pipe.staged %
+						    ORG_SIMPLE_PIPELINE_DEPTH],
+					zerocopy, &input_map, &output_map);
+				SimpleAES_StatsStage(InstancePtr,
+						     ORG_SIMPLE_PHASE_COPY_IN,
+						     ktime_get_ns() - stamp_ns);
+
+				spin_lock_irqsave(lock_ptr, lock_irq_flags);
+				pipe.staged++;
+				SimpleAES_IssueStaged(InstancePtr);
+				spin_unlock_irqrestore(lock_ptr,
+						       lock_irq_flags);
+			}
+
+			// After a failure only the blocks in flight finish
+			if (ret || READ_ONCE(InstancePtr->engine_faulted)) {
+				end = pipe.staged;
+				if (pipe.drained == end) {
+					break;
+				}
+			}
+
+			// Not interruptible: the engine is writing to the slots
+			if (!wait_event_timeout(
+				    pipe.wq,
+				    smp_load_acquire(&pipe.completed) >
+					    pipe.drained,
+				    SimpleAES_Timeout(InstancePtr))) {
+				if (SimpleAES_Watchdog(InstancePtr, &strikes)) {
+					SimpleAES_RequeuePipeline(
+						InstancePtr, &pipe, &attempt);
+				}
+				continue;
+			}
+			strikes = 0;
+			attempt = 0;
+
+			slot_ptr = &pipe.slots[pipe.drained %
+					       ORG_SIMPLE_PIPELINE_DEPTH];
+			stamp_ns = ktime_get_ns();
+			if (slot_ptr->done_ns) {
+				SimpleAES_StatsStage(
+					InstancePtr, ORG_SIMPLE_PHASE_WAKEUP,
+					stamp_ns - slot_ptr->done_ns);
+			}
+			if (!ret) {
+				ret = SimpleAES_DrainBlock(dev_ptr, BatchPtr,
+							   pipe.drained,
+							   slot_ptr);
+				SimpleAES_StatsStage(InstancePtr,
+						     ORG_SIMPLE_PHASE_COPY_OUT,
+						     ktime_get_ns() - stamp_ns);
+			}
+			pipe.drained++;
+		}
+
+		// The interrupt handler may still be using the pipeline until
+		// it is detached under the regfile lock
+		spin_lock_irqsave(lock_ptr, lock_irq_flags);
+		InstancePtr->pipe_ptr = NULL;
+		spin_unlock_irqrestore(lock_ptr, lock_irq_flags);
+
+		atomic64_add(ktime_get_ns() - start_ns,
+			     &InstancePtr->pipeline_span_ns);
+		Scheduler_Release(&InstancePtr->sched);
+
+		if (ret) {
+			break;
+		}
+		cond_resched();
+	}
+
+	atomic64_add(pipe.busy_ns, &InstancePtr->pipeline_busy_ns);
+	atomic64_add(pipe.drained, &InstancePtr->pipeline_blocks);
+
+__simpleaes_runpipeline_undo_res1:
+	while (num_slots--) {
+		HwBufferPool_Put(pool_ptr, &pipe.slots[num_slots].op_buf);
+	}
+
+	// Unmapping syncs the output back and dirties the pinned pages
+	if (zerocopy) {
+		UserDmaMap_DeInit(&output_map, dev_ptr);
+		UserDmaMap_DeInit(&input_map, dev_ptr);
+	}
+
+	return ret;
+}
+
+// Posts descriptor tail for up to count blocks from block first and returns
+// the blocks it covers, at most ORG_SIMPLE_RING_DESC_BLOCKS either way so
+// that a failed descriptor fails as few blocks. Bounced blocks go through the
+// entry's data area; zero-copy runs also end at a page boundary, where the
+// caller's buffer stops being contiguous on the bus. Failures are posted as
+// empty descriptors and reported with their blocks.
+static unsigned int SimpleAES_StageDesc(SimpleAES *InstancePtr,
+					IOCTL_BatchData *BatchPtr,
+					ORG_SIMPLE_OpMode mode,
+					unsigned int first, unsigned int count,
+					ORG_SIMPLE_Error key_err, bool zerocopy,
+					UserDmaMap *InputMapPtr,
+					UserDmaMap *OutputMapPtr)
+{
+	DescRing *ring_ptr = InstancePtr->ring_ptr;
+	unsigned int entry = ring_ptr->tail % ORG_SIMPLE_RING_ENTRIES;
+	HwRingArea *area   = ring_ptr->area;
+	HwDesc *desc_ptr   = &area->descs[entry];
+	RingSlot *slot_ptr = &ring_ptr->slots[entry];
+	size_t offset	   = (size_t)first * ORG_SIMPLE_KD_SIZE;
+	unsigned long i_addr = (unsigned long)BatchPtr->i_data_ptr + offset;
+	unsigned long o_addr = (unsigned long)BatchPtr->o_data_ptr + offset;
+	dma_addr_t input_addr = 0, output_addr = 0;
+	ORG_SIMPLE_Error err  = key_err;
+	u32 ctrl;
+
+	count = min_t(unsigned int, count, ORG_SIMPLE_RING_DESC_BLOCKS);
+	if (zerocopy) {
+		count = min_t(unsigned int, count,
+			      (PAGE_SIZE - max(offset_in_page(i_addr),
+					       offset_in_page(o_addr))) /
+				      ORG_SIMPLE_KD_SIZE);
+	}
+
+	// The engine reads and writes the caller's pages directly
+	if (err == ERROR_OK && zerocopy) {
+		if (UserDmaMap_BusAddr(InputMapPtr, offset,
+				       count * ORG_SIMPLE_KD_SIZE,
+				       &input_addr)) {
+			err = ERROR_INPUT;
+		} else if (UserDmaMap_BusAddr(OutputMapPtr, offset,
+					      count * ORG_SIMPLE_KD_SIZE,
+					      &output_addr)) {
+			err = ERROR_OUTPUT;
+		}
+	} else if (err == ERROR_OK) {
+		if (copy_from_user(area->data[entry].input, (void *)i_addr,
+				   count * ORG_SIMPLE_KD_SIZE)) {
+			err = ERROR_INPUT;
+		}
+		input_addr  = DescRing_BusAddr(ring_ptr,
+					       area->data[entry].input);
+		output_addr = DescRing_BusAddr(ring_ptr,
+					       area->data[entry].output);
+	}
+
+	slot_ptr->first	 = first;
+	slot_ptr->count	 = count;
+	slot_ptr->bounce = !zerocopy;
+	slot_ptr->err	 = err;
+
+	// Every half ring interrupts, so the ring is refilled before it runs
+	// dry
+	ctrl = SIMPLEAES_FIELD_SET((u32)mode, OP, DCTRL, 0);
+	ctrl = SIMPLEAES_FIELD_SET(err == ERROR_OK ? count : 0, COUNT, DCTRL,
+				   ctrl);
+	if (entry % (ORG_SIMPLE_RING_ENTRIES / 2) ==
+	    ORG_SIMPLE_RING_ENTRIES / 2 - 1) {
+		ctrl = SIMPLEAES_FIELD_SET(1, IRQ, DCTRL, ctrl);
+	}
+
+	desc_ptr->ctrl = cpu_to_le32(ctrl);
+	desc_ptr->kar  = cpu_to_le32(DescRing_BusAddr(ring_ptr, area->key));
+	desc_ptr->iar  = cpu_to_le32((u32)input_addr);
+	desc_ptr->oar  = cpu_to_le32((u32)output_addr);
+	desc_ptr->stat = 0;
+	ring_ptr->tail++;
+
+	return count;
+}
+
+// DSTAT.DONE of descriptor idx
+static bool SimpleAES_DescDone(DescRing *RingPtr, u32 idx)
+{
+	HwDesc *desc_ptr = DescRing_Desc(RingPtr, idx);
+
+	return le32_to_cpu(READ_ONCE(desc_ptr->stat)) &
+	       SIMPLEAES_DSTAT_DONE_Mask;
+}
+
+// Hands the results of completed descriptor idx back to the caller. The
+// engine stops a descriptor at its first failed block, so that block and
+// the ones after it get the descriptor's error.
+static int SimpleAES_DrainDesc(SimpleAES *InstancePtr,
+			       IOCTL_BatchData *BatchPtr, u32 idx)
+{
+	DescRing *ring_ptr = InstancePtr->ring_ptr;
+	unsigned int entry = idx % ORG_SIMPLE_RING_ENTRIES;
+	RingSlot *slot_ptr = &ring_ptr->slots[entry];
+	ORG_SIMPLE_Error err = slot_ptr->err;
+	unsigned int done = 0, i;
+	u8 *o_data;
+	u32 stat;
+
+	// DSTAT is written last: the output before it is complete
+	stat = le32_to_cpu(READ_ONCE(ring_ptr->area->descs[entry].stat));
+	dma_rmb();
+
+	if (err == ERROR_OK) {
+		done = slot_ptr->count;
+		if (SIMPLEAES_FIELD_GET(ERR, DSTAT, stat)) {
+			err = SimpleAES_DecodeErr(
+				SIMPLEAES_FIELD_GET(ERR, DSTAT, stat));
+			done = min_t(unsigned int, done,
+				     SIMPLEAES_FIELD_GET(COUNT, DSTAT, stat));
+			SimpleAES_StatsComplete(InstancePtr, err);
+		}
+		this_cpu_add(InstancePtr->stats->ops, done);
+		this_cpu_add(InstancePtr->stats->bytes,
+			     done * ORG_SIMPLE_BLOCK_SIZE);
+		this_cpu_add(InstancePtr->stats->errors[ERROR_OK], done);
+	}
+
+	o_data = (u8 *)BatchPtr->o_data_ptr +
+		 (size_t)slot_ptr->first * ORG_SIMPLE_KD_SIZE;
+	if (done && slot_ptr->bounce &&
+	    copy_to_user(o_data, ring_ptr->area->data[entry].output,
+			 done * ORG_SIMPLE_KD_SIZE)) {
+		err  = ERROR_OUTPUT;
+		done = 0;
+	}
+
+	// Per-block results never fail the rest of the batch
+	for (i = 0; i < slot_ptr->count; i++) {
+		if (BatchPtr->err_ptr &&
+		    put_user(i < done ? ERROR_OK : err,
+			     &BatchPtr->err_ptr[slot_ptr->first + i])) {
+			return -EFAULT;
+		}
+		if (i >= done) {
+			BatchPtr->num_failed++;
+		}
+		BatchPtr->num_done++;
+	}
+
+	return 0;
+}
+
+// Makes the descriptors posted since the last doorbell visible to the
+// engine. The engine has not fetched anything at or past RTAIL yet, so the
+// last of them can still be told to interrupt: the waiter always learns when
+// the ring has run dry. The register write orders the descriptor stores
+// before it.
+static void SimpleAES_RingDoorbell(SimpleAES *InstancePtr)
+{
+	DescRing *ring_ptr	    = InstancePtr->ring_ptr;
+	void __iomem *ptr	    = InstancePtr->regfile.ptr;
+	struct spinlock_t *lock_ptr = &InstancePtr->regfile.lock;
+	HwDesc *desc_ptr = DescRing_Desc(ring_ptr, ring_ptr->tail - 1);
+
+	unsigned long lock_irq_flags;
+
+	desc_ptr->ctrl |= cpu_to_le32(SIMPLEAES_DCTRL_IRQ_Mask);
+
+	lock_irq_flags = SimpleAES_LockRegfile(InstancePtr);
+	SIMPLEAES_SHADOW_WRITE(SIMPLEAES_FIELD_SET(ring_ptr->tail, IDX, RTAIL,
+						   0),
+			       RTAIL, ptr, InstancePtr->regfile.shadow);
+	spin_unlock_irqrestore(lock_ptr, lock_irq_flags);
+
+	atomic64_inc(&ring_ptr->doorbells);
+}
+
+// Enables the ring with descriptor idx as the next one the engine fetches,
+// and rings the doorbell for any posted after it. Called with the regfile
+// lock held and the ring disabled.
+static void SimpleAES_RingStart(SimpleAES *InstancePtr, u32 idx)
+{
+	DescRing *ring_ptr = InstancePtr->ring_ptr;
+	void __iomem *ptr  = InstancePtr->regfile.ptr;
+	u32 *shadow	   = InstancePtr->regfile.shadow;
+	u32 rcfg;
+
+	// Enabling loads RHEAD and RCIDX from RTAIL
+	SIMPLEAES_SHADOW_WRITE(SIMPLEAES_FIELD_SET(idx, IDX, RTAIL, 0), RTAIL,
+			       ptr, shadow);
+	SIMPLEAES_SHADOW_UPDATE(DescRing_BusAddr(ring_ptr, ring_ptr->area),
+				RBAR, ptr, shadow);
+	rcfg = SIMPLEAES_FIELD_SET(1, EN, RCFG, 0);
+	rcfg = SIMPLEAES_FIELD_SET(ORG_SIMPLE_RING_ORDER, SIZE, RCFG, rcfg);
+	SIMPLEAES_SHADOW_WRITE(rcfg, RCFG, ptr, shadow);
+
+	if (idx != ring_ptr->tail) {
+		SIMPLEAES_SHADOW_WRITE(SIMPLEAES_FIELD_SET(ring_ptr->tail, IDX,
+							   RTAIL, 0),
+				       RTAIL, ptr, shadow);
+	}
+}
+
+// After an engine reset, restarts the ring at the first descriptor the reset
+// left unfinished, or fails that descriptor with ERROR_TIMEOUT once it was
+// requeued op_retries times (all of them if the engine is gone)
+static void SimpleAES_RequeueRing(SimpleAES *InstancePtr,
+				  unsigned int *AttemptPtr)
+{
+	DescRing *ring_ptr	    = InstancePtr->ring_ptr;
+	struct spinlock_t *lock_ptr = &InstancePtr->regfile.lock;
+	bool faulted = READ_ONCE(InstancePtr->engine_faulted);
+
+	unsigned long lock_irq_flags;
+	RingSlot *slot_ptr;
+	u32 idx = ring_ptr->head;
+
+	lock_irq_flags = SimpleAES_LockRegfile(InstancePtr);
+
+	// Descriptors may have completed before the interrupt was masked
+	while (idx != ring_ptr->tail && SimpleAES_DescDone(ring_ptr, idx)) {
+		idx++;
+	}
+
+	if (idx != ring_ptr->tail) {
+		if (*AttemptPtr < READ_ONCE(op_retries) && !faulted) {
+			(*AttemptPtr)++;
+			this_cpu_inc(InstancePtr->stats->requeues);
+		} else {
+			do {
+				slot_ptr = DescRing_Slot(ring_ptr, idx);
+				slot_ptr->err = ERROR_TIMEOUT;
+				this_cpu_add(InstancePtr->stats
+						     ->errors[ERROR_TIMEOUT],
+					     slot_ptr->count);
+				DescRing_Desc(ring_ptr, idx)->stat =
+					cpu_to_le32(SIMPLEAES_DSTAT_DONE_Mask);
+				idx++;
+			} while (faulted && idx != ring_ptr->tail);
+		}
+	}
+
+	// A lost engine is not programmed again
+	if (!faulted) {
+		SimpleAES_RingStart(InstancePtr, idx);
+	}
+
+	spin_unlock_irqrestore(lock_ptr, lock_irq_flags);
+}
+
+// Runs a contiguous batch on the descriptor ring of a ver3 engine. Each
+// descriptor covers a run of blocks with the key loaded once per scheduler
+// turn, and the engine moves on to the next descriptor by itself: the
+// driver writes one doorbell per refill and takes an interrupt every half
+// ring instead of one register sequence and one interrupt per block. The
+// engine is held for ring_burst blocks per scheduler ticket.
+static int SimpleAES_RunRing(SimpleAES *InstancePtr, ORG_SIMPLE_OpMode mode,
+			     SchedClient *ClientPtr,
+			     IOCTL_BatchData *BatchPtr)
+{
+	struct device *dev_ptr	= &InstancePtr->pdev_ptr->dev;
+	DescRing *ring_ptr	= InstancePtr->ring_ptr;
+	unsigned int num_blocks = BatchPtr->num_blocks;
+
+	UserDmaMap input_map, output_map;
+	Result_BoolError err_boolerror;
+	ORG_SIMPLE_Error key_err;
+	unsigned int staged = 0, drained = 0, end, strikes = 0, attempt = 0;
+	SchedTicket ticket;
+	u64 stamp_ns;
+	u32 posted;
+	bool zerocopy;
+	int ret = 0;
+
+	BatchPtr->num_done   = 0;
+	BatchPtr->num_failed = 0;
+
+	zerocopy = SimpleAES_MapBatch(InstancePtr, BatchPtr, &input_map,
+				      &output_map);
+
+	while (drained < num_blocks) {
+		end = min(num_blocks,
+			  drained + max(READ_ONCE(ring_burst), 1U));
+
+		stamp_ns = ktime_get_ns();
+		Scheduler_Acquire(&InstancePtr->sched, ClientPtr, &ticket,
+				  end - drained);
+		SimpleAES_StatsStage(InstancePtr, ORG_SIMPLE_PHASE_QUEUE,
+				     ktime_get_ns() - stamp_ns);
+
+		// A lost engine leaves the rest to SimpleAES_RunBatch
+		if (READ_ONCE(InstancePtr->engine_faulted)) {
+			Scheduler_Release(&InstancePtr->sched);
+			break;
+		}
+
+		// Descriptors carry OP: this only enables the interrupt
+		err_boolerror = SimpleAES_SetMode(InstancePtr, mode,
+						  ORG_SIMPLE_COMPLETION_IRQ);
+		if (err_boolerror.variant == RESULT_ERR) {
+			dev_err(dev_ptr, "failed to set operation mode");
+			Scheduler_Release(&InstancePtr->sched);
+			ret = -EBUSY;
+			break;
+		}
+
+		// The ring is empty between turns, so the key can be replaced
+		key_err = ERROR_OK;
+		if (copy_from_user(ring_ptr->area->key, BatchPtr->key_ptr,
+				   ORG_SIMPLE_KD_SIZE)) {
+			key_err = ERROR_KEY;
+		}
+
+		while (drained < end) {
+			// Fill every free entry, then ring the doorbell once
+			posted = ring_ptr->tail;
+			while (!ret && staged < end &&
+			       ring_ptr->tail - ring_ptr->head <
+				       ORG_SIMPLE_RING_ENTRIES &&
+			       !READ_ONCE(InstancePtr->engine_faulted)) {
+				if (fatal_signal_pending(current)) {
+					ret = -EINTR;
+					break;
+				}
+
+				stamp_ns = ktime_get_ns();
+				staged += SimpleAES_StageDesc(
+					InstancePtr, BatchPtr, mode, staged,
+					end - staged, key_err, zerocopy,
+					&input_map, &output_map);
+				SimpleAES_StatsStage(InstancePtr,
+						     ORG_SIMPLE_PHASE_COPY_IN,
+						     ktime_get_ns() - stamp_ns);
+			}
+			if (ring_ptr->tail != posted) {
+				atomic64_add(ring_ptr->tail - posted,
+					     &ring_ptr->descs);
+				SimpleAES_RingDoorbell(InstancePtr);
+			}
+
+			// After a failure only the descriptors posted finish
+			if (ret || READ_ONCE(InstancePtr->engine_faulted)) {
+				end = staged;
+				if (drained == end) {
+					break;
+				}
+			}
+
+			// Not interruptible: the engine is writing to the ring
+			if (!wait_event_timeout(
+				    ring_ptr->wq,
+				    SimpleAES_DescDone(ring_ptr, ring_ptr->head),
+				    SimpleAES_Timeout(InstancePtr))) {
+				if (SimpleAES_Watchdog(InstancePtr, &strikes)) {
+					SimpleAES_RequeueRing(InstancePtr,
+							      &attempt);
+				}
+				continue;
+			}
+			strikes = 0;
+			attempt = 0;
+
+			while (ring_ptr->head != ring_ptr->tail &&
+			       SimpleAES_DescDone(ring_ptr, ring_ptr->head)) {
+				if (!ret) {
+					stamp_ns = ktime_get_ns();
+					ret = SimpleAES_DrainDesc(
+						InstancePtr, BatchPtr,
+						ring_ptr->head);
+					SimpleAES_StatsStage(
+						InstancePtr,
+						ORG_SIMPLE_PHASE_COPY_OUT,
+						ktime_get_ns() - stamp_ns);
+				}
+				drained += DescRing_Slot(ring_ptr,
+							 ring_ptr->head)->count;
+				ring_ptr->head++;
+			}
+		}
+
+		Scheduler_Release(&InstancePtr->sched);
+
+		if (ret) {
+			break;
+		}
+		cond_resched();
+	}
+
+	atomic64_add(drained, &ring_ptr->blocks);
+
+	// Unmapping syncs the output back and dirties the pinned pages
+	if (zerocopy) {
+		UserDmaMap_DeInit(&output_map, dev_ptr);
+		UserDmaMap_DeInit(&input_map, dev_ptr);
+	}
+
+	return ret;
+}
+
+static int SimpleAES_RunBatch(SimpleAES *InstancePtr, ORG_SIMPLE_OpMode mode,
+			      ORG_SIMPLE_CompletionMode completion,
+			      SchedClient *ClientPtr,
+			      IOCTL_BatchData *BatchPtr)
+{
+	IOCTL_BatchData rest;
+	unsigned int done;
+	u64 begin_ns, waits;
+	int ret;
+
+	if (SimpleAES_PreferCpu(InstancePtr, BatchPtr->num_blocks)) {
+		return SimpleAES_SoftRunBatch(InstancePtr, mode, BatchPtr);
+	}
+
+	waits	 = READ_ONCE(InstancePtr->sched.waits);
+	begin_ns = ktime_get_ns();
+
+	ret = SimpleAES_RunEngineBatch(InstancePtr, mode, completion,
+				       ClientPtr, BatchPtr);
+
+	SimpleAES_UpdateEngineCost(InstancePtr, waits, begin_ns,
+				   BatchPtr->num_done);
+
+	// A pipeline or ring that lost its engine stops short: the blocks it
+	// had not started run in software
+	done = BatchPtr->num_done;
+	if (ret || done == BatchPtr->num_blocks) {
+		return ret;
+	}
+	rest		= *BatchPtr;
+	rest.num_blocks -= done;
+	if (rest.blocks_ptr) {
+		rest.blocks_ptr += done;
+	} else {
+		rest.i_data_ptr = (u8 *)rest.i_data_ptr +
+				  (size_t)done * ORG_SIMPLE_KD_SIZE;
+		rest.o_data_ptr = (u8 *)rest.o_data_ptr +
+				  (size_t)done * ORG_SIMPLE_KD_SIZE;
+		if (rest.err_ptr) {
+			rest.err_ptr += done;
+		}
+	}
+
+	ret = SimpleAES_SoftRunBatch(InstancePtr, mode, &rest);
+
+	BatchPtr->num_done += rest.num_done;
+	BatchPtr->num_failed += rest.num_failed;
+	return ret;
+}
+
+static int SimpleAES_RunEngineBatch(SimpleAES *InstancePtr,
+				    ORG_SIMPLE_OpMode mode,
+				    ORG_SIMPLE_CompletionMode completion,
+				    SchedClient *ClientPtr,
+				    IOCTL_BatchData *BatchPtr)
+{
+	struct device *dev_ptr = &InstancePtr->pdev_ptr->dev;
+	HwBufferPool *pool_ptr = &InstancePtr->buf_pool;
+
+	HwBuffer op_buf, key_buf, input_buf, output_buf;
+	UserDmaMap input_map, output_map;
+	void *loaded_key = NULL;
+	bool zerocopy;
+	IOCTL_Block block;
+	unsigned int idx;
+	int ret = 0;
+
+	// Streaming batches keep the engine busy while data is copied. A ver3
+	// engine takes whole runs of blocks per descriptor.
+	if (SimpleAES_CanPipeline(BatchPtr, completion)) {
+		if (InstancePtr->ring_ptr && READ_ONCE(desc_ring)) {
+			return SimpleAES_RunRing(InstancePtr, mode, ClientPtr,
+						 BatchPtr);
+		}
+		return SimpleAES_RunPipeline(InstancePtr, mode, ClientPtr,
+					     BatchPtr);
+	}
+
+	BatchPtr->num_done   = 0;
+	BatchPtr->num_failed = 0;
+
+	if (HwBufferPool_Get(pool_ptr, &op_buf)) {
+		dev_err(dev_ptr, "failed to allocate operation record");
+		ret = -ENOMEM;
+		goto __simpleaes_runenginebatch_ret;
+	}
+	HwOpRecord_Split(&op_buf, &key_buf, &input_buf, &output_buf);
+
+	zerocopy = SimpleAES_MapBatch(InstancePtr, BatchPtr, &input_map,
+				      &output_map);
+
+	for (idx = 0; idx < BatchPtr->num_blocks; idx++) {
+		if (fatal_signal_pending(current)) {
+			ret = -EINTR;
+			break;
+		}
+
+		if (BatchPtr->blocks_ptr) {
+			if (copy_from_user(&block, &BatchPtr->blocks_ptr[idx],
+					   sizeof(block))) {
+				ret = -EFAULT;
+				break;
+			}
+		} else {
+			block.key_ptr	 = BatchPtr->key_ptr;
+			block.i_data_ptr = (u8 *)BatchPtr->i_data_ptr +
+					   idx * ORG_SIMPLE_KD_SIZE;
+			block.o_data_ptr = (u8 *)BatchPtr->o_data_ptr +
+					   idx * ORG_SIMPLE_KD_SIZE;
+		}
+
+		if (zerocopy) {
+			block.err = SimpleAES_RunMappedBlock(
+				InstancePtr, mode, completion, ClientPtr,
+				BatchPtr, (size_t)idx * ORG_SIMPLE_KD_SIZE,
+				&key_buf,
+				&input_map, &output_map, &loaded_key);
+
+			// The engine was lost: SimpleAES_RunBatch runs this
+			// block and the rest in software
+			if (block.err == ERROR_FAULTED) {
+				break;
+			}
+		} else {
+			block.err = SimpleAES_RunBatchBlock(
+				InstancePtr, mode, completion, ClientPtr,
+				&block, &key_buf, &input_buf, &output_buf,
+				&loaded_key);
+		}
+
+		// Per-block results never fail the rest of the batch
+		if (BatchPtr->blocks_ptr) {
+			if (put_user(block.err,
+				     &BatchPtr->blocks_ptr[idx].err)) {
+				ret = -EFAULT;
+				break;
+			}
+		} else if (BatchPtr->err_ptr) {
+			if (put_user(block.err, &BatchPtr->err_ptr[idx])) {
+				ret = -EFAULT;
+				break;
+			}
+		}
+
+		if (block.err != ERROR_OK) {
+			BatchPtr->num_failed++;
+		}
+		BatchPtr->num_done++;
+
+		cond_resched();
+	}
+
+	// Unmapping syncs the output back and dirties the pinned pages
+	if (zerocopy) {
+		UserDmaMap_DeInit(&output_map, dev_ptr);
+		UserDmaMap_DeInit(&input_map, dev_ptr);
+	}
+
+	HwBufferPool_Put(pool_ptr, &op_buf);
+
+__simpleaes_runenginebatch_ret:
+	return ret;
+}
+
+static Result_BoolError
+SimpleAES_CipherBlock(SimpleAES *InstancePtr, ORG_SIMPLE_OpMode mode,
+		      ORG_SIMPLE_CompletionMode completion,
+		      SchedClient *ClientPtr, HwBuffer *KeyBufPtr,
+		      HwBuffer *InputBufPtr, HwBuffer *OutputBufPtr,
+		      const u8 *src, u8 *dst)
+{
+	Result_BoolError err_boolerror;
+
+	memcpy(InputBufPtr->cpu_addr, src, ORG_SIMPLE_BLOCK_SIZE);
+
+	err_boolerror = SimpleAES_RunBlock(InstancePtr, mode, completion,
+					   ClientPtr, KeyBufPtr, InputBufPtr,
+					   OutputBufPtr);
+	if (err_boolerror.variant == RESULT_ERR) {
+		return err_boolerror;
+	}
+
+	memcpy(dst, OutputBufPtr->cpu_addr, ORG_SIMPLE_BLOCK_SIZE);
+	return RESULT_BOOLERROR_OK(1);
+}
+
+static Result_BoolError
+SimpleAES_RunChainChunk(SimpleAES *InstancePtr, ORG_SIMPLE_OpMode mode,
+			ORG_SIMPLE_CompletionMode completion,
+			SchedClient *ClientPtr,
+			ORG_SIMPLE_ChainMode chain, HwBuffer *KeyBufPtr,
+			HwBuffer *InputBufPtr, HwBuffer *OutputBufPtr, u8 iv[],
+			u8 *chunk, unsigned int len)
+{
+	u8 block[ORG_SIMPLE_BLOCK_SIZE];
+	Result_BoolError err_boolerror;
+	unsigned int pos, n;
+	le128 tweak;
+	u8 *blk;
+
+	for (pos = 0; pos < len; pos += ORG_SIMPLE_BLOCK_SIZE) {
+		blk = chunk + pos;
+		n   = min_t(unsigned int, len - pos, ORG_SIMPLE_BLOCK_SIZE);
+
+		switch (chain) {
+		case ORG_SIMPLE_CHAIN_ECB:
+			err_boolerror = SimpleAES_CipherBlock(
+				InstancePtr, mode, completion, ClientPtr,
+				KeyBufPtr, InputBufPtr, OutputBufPtr, blk,
+				blk);
+			break;
+
+		case ORG_SIMPLE_CHAIN_CBC:
+			if (mode == ORG_SIMPLE_OPMODE_ENCRYPT) {
+				// C[i] = E(P[i] ^ C[i-1])
+				crypto_xor(blk, iv, ORG_SIMPLE_BLOCK_SIZE);
+				err_boolerror = SimpleAES_CipherBlock(
+					InstancePtr, mode, completion,
+					ClientPtr, KeyBufPtr, InputBufPtr,
+					OutputBufPtr, blk, blk);
+				memcpy(iv, blk, ORG_SIMPLE_BLOCK_SIZE);
+			} else {
+				// P[i] = D(C[i]) ^ C[i-1]
+				memcpy(block, blk, ORG_SIMPLE_BLOCK_SIZE);
+				err_boolerror = SimpleAES_CipherBlock(
+					InstancePtr, mode, completion,
+					ClientPtr, KeyBufPtr, InputBufPtr,
+					OutputBufPtr, blk, blk);
+				crypto_xor(blk, iv, ORG_SIMPLE_BLOCK_SIZE);
+				memcpy(iv, block, ORG_SIMPLE_BLOCK_SIZE);
+			}
+			break;
+
+		case ORG_SIMPLE_CHAIN_CTR:
+			// Both directions XOR with E(counter)
+			err_boolerror = SimpleAES_CipherBlock(
+				InstancePtr, ORG_SIMPLE_OPMODE_ENCRYPT,
+				completion, ClientPtr, KeyBufPtr, InputBufPtr,
+				OutputBufPtr, iv, block);
+			crypto_xor(blk, block, n);
+			crypto_inc(iv, ORG_SIMPLE_BLOCK_SIZE);
+			break;
+
+		case ORG_SIMPLE_CHAIN_XTS:
+			// C[i] = E(P[i] ^ T[i]) ^ T[i], T[i+1] = T[i] * alpha
+			crypto_xor(blk, iv, ORG_SIMPLE_BLOCK_SIZE);
+			err_boolerror = SimpleAES_CipherBlock(
+				InstancePtr, mode, completion, ClientPtr,
+				KeyBufPtr, InputBufPtr, OutputBufPtr, blk,
+				blk);
+			crypto_xor(blk, iv, ORG_SIMPLE_BLOCK_SIZE);
+			memcpy(&tweak, iv, sizeof(tweak));
+			gf128mul_x_ble(&tweak, &tweak);
+			memcpy(iv, &tweak, sizeof(tweak));
+			break;
+
+		default:
+			err_boolerror = RESULT_BOOLERROR_ERR(ERROR_OTHER);
+			break;
+		}
+
+		if (err_boolerror.variant == RESULT_ERR) {
+			return err_boolerror;
+		}
+	}
+
+	return RESULT_BOOLERROR_OK(1);
+}
+
+static Result_BoolError SimpleAES_RunChain(SimpleAES *InstancePtr,
+					   ORG_SIMPLE_OpMode mode,
+					   ORG_SIMPLE_CompletionMode completion,
+					   SchedClient *ClientPtr,
+					   IOCTL_ChainData *ChainPtr)
+{
+	struct device *dev_ptr = &InstancePtr->pdev_ptr->dev;
+	HwBufferPool *pool_ptr = &InstancePtr->buf_pool;
+
+	HwBuffer op_buf, key_buf, input_buf, output_buf;
+	Result_BoolError ret_err_boolerror = RESULT_BOOLERROR_OK(1);
+	Result_BoolError err_boolerror;
+	u8 iv[ORG_SIMPLE_BLOCK_SIZE];
+	unsigned int offset, len;
+	u64 stamp_ns;
+	u8 *chunk;
+
+	chunk = kmalloc(ORG_SIMPLE_CHAIN_CHUNK_SIZE, GFP_KERNEL);
+	if (!chunk) {
+		ret_err_boolerror = RESULT_BOOLERROR_ERR(ERROR_OTHER);
+		goto __simpleaes_runchain_ret;
+	}
+
+	if (HwBufferPool_Get(pool_ptr, &op_buf)) {
+		dev_err(dev_ptr, "failed to allocate operation record");
+		ret_err_boolerror = RESULT_BOOLERROR_ERR(ERROR_OTHER);
+		goto __simpleaes_runchain_undo_res1;
+	}
+	HwOpRecord_Split(&op_buf, &key_buf, &input_buf, &output_buf);
+
+	memcpy(iv, ChainPtr->iv, ORG_SIMPLE_BLOCK_SIZE);
+
+	// XTS: the initial tweak is the IV encrypted under the tweak key
+	if (ChainPtr->chain == ORG_SIMPLE_CHAIN_XTS) {
+		if (copy_from_user(key_buf.cpu_addr, ChainPtr->tweak_key_ptr,
+				   ORG_SIMPLE_KD_SIZE)) {
+			dev_err(dev_ptr, "failed to copy tweak key");
+			ret_err_boolerror = RESULT_BOOLERROR_ERR(ERROR_KEY);
+			goto __simpleaes_runchain_undo_res2;
+		}
+
+		err_boolerror = SimpleAES_CipherBlock(
+			InstancePtr, ORG_SIMPLE_OPMODE_ENCRYPT, completion,
+			ClientPtr, &key_buf, &input_buf, &output_buf, iv, iv);
+		if (err_boolerror.variant == RESULT_ERR) {
+			ret_err_boolerror = err_boolerror;
+			goto __simpleaes_runchain_undo_res2;
+		}
+	}
+
+	if (copy_from_user(key_buf.cpu_addr, ChainPtr->key_ptr,
+			   ORG_SIMPLE_KD_SIZE)) {
+		dev_err(dev_ptr, "failed to copy key");
+		ret_err_boolerror = RESULT_BOOLERROR_ERR(ERROR_KEY);
+		goto __simpleaes_runchain_undo_res2;
+	}
+
+	for (offset = 0; offset < ChainPtr->length; offset += len) {
+		len = min(ChainPtr->length - offset,
+			  ORG_SIMPLE_CHAIN_CHUNK_SIZE);
+
+		stamp_ns = ktime_get_ns();
+		if (copy_from_user(chunk, (u8 *)ChainPtr->i_data_ptr + offset,
+				   len)) {
+			dev_err(dev_ptr, "failed to copy input data");
+			ret_err_boolerror = RESULT_BOOLERROR_ERR(ERROR_INPUT);
+			goto __simpleaes_runchain_undo_res2;
+		}
+		SimpleAES_StatsStage(InstancePtr, ORG_SIMPLE_PHASE_COPY_IN,
+				     ktime_get_ns() - stamp_ns);
+
+		err_boolerror = SimpleAES_RunChainChunk(
+			InstancePtr, mode, completion, ClientPtr,
+			ChainPtr->chain, &key_buf, &input_buf, &output_buf, iv,
+			chunk, len);
+		if (err_boolerror.variant == RESULT_ERR) {
+			ret_err_boolerror = err_boolerror;
+			goto __simpleaes_runchain_undo_res2;
+		}
+
+		stamp_ns = ktime_get_ns();
+		if (copy_to_user((u8 *)ChainPtr->o_data_ptr + offset, chunk,
+				 len)) {
+			dev_err(dev_ptr, "failed to copy output data");
+			ret_err_boolerror = RESULT_BOOLERROR_ERR(ERROR_OUTPUT);
+			goto __simpleaes_runchain_undo_res2;
+		}
+		SimpleAES_StatsStage(InstancePtr, ORG_SIMPLE_PHASE_COPY_OUT,
+				     ktime_get_ns() - stamp_ns);
+
+		cond_resched();
+	}
+
+	// Hand the chaining value back so the stream can be continued
+	if (ChainPtr->chain == ORG_SIMPLE_CHAIN_CBC ||
+	    ChainPtr->chain == ORG_SIMPLE_CHAIN_CTR) {
+		memcpy(ChainPtr->iv, iv, ORG_SIMPLE_BLOCK_SIZE);
+	}
+
+__simpleaes_runchain_undo_res2:
+	HwBufferPool_Put(pool_ptr, &op_buf);
+
+__simpleaes_runchain_undo_res1:
+	memzero_explicit(iv, sizeof(iv));
+	kfree_sensitive(chunk);
+
+__simpleaes_runchain_ret:
+	return ret_err_boolerror;
+}
+
+// Same as SimpleAES_RunChain for kernel scatterlists (Crypto API requests).
+// The chaining value in iv is updated in place.
+static Result_BoolError
+SimpleAES_RunChainSg(SimpleAES *InstancePtr, ORG_SIMPLE_OpMode mode,
+		     ORG_SIMPLE_CompletionMode completion,
+		     SchedClient *ClientPtr,
+		     ORG_SIMPLE_ChainMode chain, const u8 *key, u8 iv[],
+		     struct scatterlist *src, struct scatterlist *dst,
+		     unsigned int length)
+{
+	struct device *dev_ptr = &InstancePtr->pdev_ptr->dev;
+	HwBufferPool *pool_ptr = &InstancePtr->buf_pool;
+
+	HwBuffer op_buf, key_buf, input_buf, output_buf;
+	Result_BoolError ret_err_boolerror = RESULT_BOOLERROR_OK(1);
+	Result_BoolError err_boolerror;
+	unsigned int offset, len;
+	u64 stamp_ns;
+	u8 *chunk;
+
+	chunk = kmalloc(ORG_SIMPLE_CHAIN_CHUNK_SIZE, GFP_KERNEL);
+	if (!chunk) {
+		ret_err_boolerror = RESULT_BOOLERROR_ERR(ERROR_OTHER);
+		goto __simpleaes_runchainsg_ret;
+	}
+
+	if (HwBufferPool_Get(pool_ptr, &op_buf)) {
+		dev_err(dev_ptr, "failed to allocate operation record");
+		ret_err_boolerror = RESULT_BOOLERROR_ERR(ERROR_OTHER);
+		goto __simpleaes_runchainsg_undo_res1;
+	}
+	HwOpRecord_Split(&op_buf, &key_buf, &input_buf, &output_buf);
+
+	memcpy(key_buf.cpu_addr, key, ORG_SIMPLE_KEY_SIZE);
+
+	for (offset = 0; offset < length; offset += len) {
+		len = min(length - offset, ORG_SIMPLE_CHAIN_CHUNK_SIZE);
+
+		stamp_ns = ktime_get_ns();
+		sg_pcopy_to_buffer(src, sg_nents(src), chunk, len, offset);
+		SimpleAES_StatsStage(InstancePtr, ORG_SIMPLE_PHASE_COPY_IN,
+				     ktime_get_ns() - stamp_ns);
+
+		err_boolerror = SimpleAES_RunChainChunk(
+			InstancePtr, mode, completion, ClientPtr, chain,
+			&key_buf, &input_buf, &output_buf, iv, chunk, len);
+		if (err_boolerror.variant == RESULT_ERR) {
+			ret_err_boolerror = err_boolerror;
+			goto __simpleaes_runchainsg_undo_res2;
+		}
+
+		stamp_ns = ktime_get_ns();
+		sg_pcopy_from_buffer(dst, sg_nents(dst), chunk, len, offset);
+		SimpleAES_StatsStage(InstancePtr, ORG_SIMPLE_PHASE_COPY_OUT,
+				     ktime_get_ns() - stamp_ns);
+
+		cond_resched();
+	}
+
+__simpleaes_runchainsg_undo_res2:
+	HwBufferPool_Put(pool_ptr, &op_buf);
+
+__simpleaes_runchainsg_undo_res1:
+	kfree_sensitive(chunk);
+
+__simpleaes_runchainsg_ret:
+	return ret_err_boolerror;
+}
+
+static Result_BoolError SimpleAES_RunKeyedOp(SimpleAES *InstancePtr,
+					     ORG_SIMPLE_OpMode mode,
+					     FileContext *FilePtr, u32 handle,
+					     u8 i_data[], u8 o_data[])
+{
+	struct device *dev_ptr = &InstancePtr->pdev_ptr->dev;
+	HwBufferPool *pool_ptr = &InstancePtr->buf_pool;
+
+	HwBuffer op_buf, key_buf, input_buf, output_buf;
+	Result_BoolError ret_err_boolerror = RESULT_BOOLERROR_OK(1);
+	Result_BoolError err_boolerror;
+	ORG_SIMPLE_Error key_err;
+	unsigned long ret_copy;
+	u64 stamp_ns;
+
+	key_err = FileContext_AcquireKey(FilePtr, handle, &key_buf);
+	if (key_err != ERROR_OK) {
+		ret_err_boolerror = RESULT_BOOLERROR_ERR(key_err);
+		goto __simpleaes_runkeyedop_ret;
+	}
+
+	// The key stays in its key table slot; only the data is in the record
+	if (HwBufferPool_Get(pool_ptr, &op_buf)) {
+		dev_err(dev_ptr, "failed to allocate operation record");
+		ret_err_boolerror = RESULT_BOOLERROR_ERR(ERROR_OTHER);
+		goto __simpleaes_runkeyedop_undo_res1;
+	}
+	HwOpRecord_Split(&op_buf, NULL, &input_buf, &output_buf);
+
+	stamp_ns = ktime_get_ns();
+	ret_copy =
+		copy_from_user(input_buf.cpu_addr, i_data, ORG_SIMPLE_KD_SIZE);
+	if (ret_copy) {
+		dev_err(dev_ptr, "failed to copy input data");
+		ret_err_boolerror = RESULT_BOOLERROR_ERR(ERROR_INPUT);
+		goto __simpleaes_runkeyedop_undo_res2;
+	}
+	SimpleAES_StatsStage(InstancePtr, ORG_SIMPLE_PHASE_COPY_IN,
+			     ktime_get_ns() - stamp_ns);
+
+	err_boolerror = SimpleAES_RunBlock(
+		InstancePtr, mode, FilePtr->completion,
+		FileContext_Client(FilePtr, InstancePtr), &key_buf, &input_buf,
+		&output_buf);
+	if (err_boolerror.variant == RESULT_ERR) {
+		ret_err_boolerror = err_boolerror;
+		goto __simpleaes_runkeyedop_undo_res2;
+	}
+
+	stamp_ns = ktime_get_ns();
+	ret_copy =
+		copy_to_user(o_data, output_buf.cpu_addr, ORG_SIMPLE_KD_SIZE);
+	if (ret_copy) {
+		dev_err(dev_ptr, "failed to copy output data");
+		ret_err_boolerror = RESULT_BOOLERROR_ERR(ERROR_OUTPUT);
+		goto __simpleaes_runkeyedop_undo_res2;
+	}
+	SimpleAES_StatsStage(InstancePtr, ORG_SIMPLE_PHASE_COPY_OUT,
+			     ktime_get_ns() - stamp_ns);
+
+__simpleaes_runkeyedop_undo_res2:
+	HwBufferPool_Put(pool_ptr, &op_buf);
+
+__simpleaes_runkeyedop_undo_res1:
+	KeyTable_Release(&InstancePtr->key_table, &key_buf);
+
+__simpleaes_runkeyedop_ret:
+	return ret_err_boolerror;
+}
+
+static int SimpleAES_RunFixedOp(SimpleAES *InstancePtr, ORG_SIMPLE_OpMode mode,
+				FileContext *FilePtr, IOCTL_FixedData *FixedPtr)
+{
+	struct device *dev_ptr = &InstancePtr->pdev_ptr->dev;
+	size_t span = (size_t)FixedPtr->num_blocks * ORG_SIMPLE_KD_SIZE;
+
+	HwBuffer key_buf;
+	HwBuffer input_buf  = { .cpu_addr = NULL, .slot = -1 };
+	HwBuffer output_buf = { .cpu_addr = NULL, .slot = -1 };
+	FixedBuffer *in_ptr, *out_ptr;
+	Result_BoolError err_boolerror;
+	ORG_SIMPLE_Error key_err;
+	size_t offset;
+	int ret = 0;
+
+	FixedPtr->num_done = 0;
+
+	// Registered buffers stay mapped until the last op using them ends
+	down_read(&FilePtr->bufs_lock);
+
+	if (FixedPtr->in_index >= FilePtr->num_bufs ||
+	    FixedPtr->out_index >= FilePtr->num_bufs) {
+		ret = -EINVAL;
+		goto __simpleaes_runfixedop_undo_res1;
+	}
+	in_ptr	= &FilePtr->bufs[FixedPtr->in_index];
+	out_ptr = &FilePtr->bufs[FixedPtr->out_index];
+
+	if (FixedPtr->in_offset > in_ptr->len ||
+	    span > in_ptr->len - FixedPtr->in_offset ||
+	    FixedPtr->out_offset > out_ptr->len ||
+	    span > out_ptr->len - FixedPtr->out_offset) {
+		ret = -EINVAL;
+		goto __simpleaes_runfixedop_undo_res1;
+	}
+
+	key_err = FileContext_AcquireKey(FilePtr, FixedPtr->handle, &key_buf);
+	if (key_err != ERROR_OK) {
+		ret = key_err == ERROR_KEY ? -ENOENT : -EBUSY;
+		goto __simpleaes_runfixedop_undo_res1;
+	}
+
+	for (offset = 0; offset < span; offset += ORG_SIMPLE_KD_SIZE) {
+		if (fatal_signal_pending(current)) {
+			ret = -EINTR;
+			break;
+		}
+
+		// Blocks that straddle two pages cannot be addressed
+		if (FixedBuffer_BusAddr(in_ptr, FixedPtr->in_offset + offset,
+					ORG_SIMPLE_KD_SIZE,
+					&input_buf.bus_addr) ||
+		    FixedBuffer_BusAddr(out_ptr, FixedPtr->out_offset + offset,
+					ORG_SIMPLE_KD_SIZE,
+					&output_buf.bus_addr)) {
+			ret = -EINVAL;
+			break;
+		}
+
+		// The mappings live as long as the registration: both ranges
+		// go back to the device, so that no dirty CPU line of the
+		// output is written back over what the engine writes
+		UserDmaMap_SyncForDevice(&in_ptr->map, dev_ptr,
+					 FixedPtr->in_offset + offset,
+					 ORG_SIMPLE_KD_SIZE);
+		UserDmaMap_SyncForDevice(&out_ptr->map, dev_ptr,
+					 FixedPtr->out_offset + offset,
+					 ORG_SIMPLE_KD_SIZE);
+
+		err_boolerror = SimpleAES_RunBlock(
+			InstancePtr, mode, FilePtr->completion,
+			FileContext_Client(FilePtr, InstancePtr), &key_buf,
+			&input_buf, &output_buf);
+
+		// A faulted engine does not take the block, even when it was
+		// lost while the block waited for it: it runs in software on
+		// the pages
+		if (err_boolerror.variant == RESULT_ERR &&
+		    err_boolerror.value.err == ERROR_FAULTED) {
+			err_boolerror = SimpleAES_SoftRunMapped(
+				InstancePtr, mode, &key_buf, &in_ptr->map,
+				FixedPtr->in_offset + offset, &out_ptr->map,
+				FixedPtr->out_offset + offset);
+		} else if (err_boolerror.variant == RESULT_OK) {
+			UserDmaMap_SyncForCpu(&out_ptr->map, dev_ptr,
+					      FixedPtr->out_offset + offset,
+					      ORG_SIMPLE_KD_SIZE);
+		}
+
+		if (err_boolerror.variant == RESULT_ERR) {
+			ret = -EIO;
+			break;
+		}
+
+		FixedPtr->num_done++;
+		cond_resched();
+	}
+
+	KeyTable_Release(&InstancePtr->key_table, &key_buf);
+
+__simpleaes_runfixedop_undo_res1:
+	up_read(&FilePtr->bufs_lock);
+	return ret;
+}
+
+// Software AES
+
+// Chooses the CPU when the engine is faulted, when the request is at most
+// cpu_threshold bytes, or when the CPU would finish it before the engine
+// gets through the blocks queued ahead and then this request. Both request
+// costs are per block and include the copies, so they compare like for like.
+static bool SimpleAES_PreferCpu(SimpleAES *InstancePtr,
+				unsigned int num_blocks)
+{
+	unsigned int batch = num_blocks > 1;
+	u64 cpu_ns	   = READ_ONCE(InstancePtr->cpu_ewma_ns[batch]);
+	u64 cost_ns	   = READ_ONCE(InstancePtr->engine_cost_ns[batch]);
+	u64 engine_ns	   = READ_ONCE(InstancePtr->engine_ewma_ns);
+	u64 ahead_ns;
+	bool cpu;
+
+	if (READ_ONCE(InstancePtr->engine_faulted)) {
+		return true;
+	}
+
+	switch (READ_ONCE(cpu_dispatch)) {
+	case ORG_SIMPLE_DISPATCH_ENGINE:
+		return false;
+	case ORG_SIMPLE_DISPATCH_CPU:
+		return true;
+	default:
+		break;
+	}
+
+	if ((u64)num_blocks * ORG_SIMPLE_BLOCK_SIZE <=
+	    READ_ONCE(cpu_threshold)) {
+		return true;
+	}
+
+	// Each path runs until it has been measured once
+	if (!cost_ns) {
+		return false;
+	}
+	if (!cpu_ns) {
+		return true;
+	}
+
+	ahead_ns = (u64)READ_ONCE(InstancePtr->sched.queued) * engine_ns;
+	cpu	 = (u64)num_blocks * cpu_ns <
+	      ahead_ns + (u64)num_blocks * cost_ns;
+
+	// Costs only change when their path runs: small requests now and then
+	// take the losing path to refresh it
+	if (num_blocks <= ORG_SIMPLE_SOFT_CHUNK &&
+	    !(atomic_inc_return(&InstancePtr->dispatch_seq) %
+	      ORG_SIMPLE_DISPATCH_PROBE)) {
+		return !cpu;
+	}
+
+	return cpu;
+}
+
+// Same interface and results as SimpleAES_RunOp, on the CPU
+static Result_BoolError SimpleAES_SoftRunOp(SimpleAES *InstancePtr,
+					    ORG_SIMPLE_OpMode mode, u8 key[],
+					    u8 i_data[], u8 o_data[])
+{
+	Result_BoolError ret_err_boolerror = RESULT_BOOLERROR_OK(1);
+	struct crypto_aes_ctx aes;
+	u8 key_data[ORG_SIMPLE_BLOCK_SIZE];
+	u8 data[ORG_SIMPLE_BLOCK_SIZE];
+	u64 start_ns = ktime_get_ns();
+
+	SimpleAES_StatsCpu(InstancePtr, 1);
+
+	if (copy_from_user(key_data, key, ORG_SIMPLE_BLOCK_SIZE)) {
+		return RESULT_BOOLERROR_ERR(ERROR_KEY);
+	}
+	if (copy_from_user(data, i_data, ORG_SIMPLE_BLOCK_SIZE)) {
+		ret_err_boolerror = RESULT_BOOLERROR_ERR(ERROR_INPUT);
+		goto __simpleaes_softrunop_ret;
+	}
+
+	aes_expandkey(&aes, key_data, AES_KEYSIZE_128);
+	if (mode == ORG_SIMPLE_OPMODE_ENCRYPT) {
+		aes_encrypt(&aes, data, data);
+	} else {
+		aes_decrypt(&aes, data, data);
+	}
+	memzero_explicit(&aes, sizeof(aes));
+
+	if (copy_to_user(o_data, data, ORG_SIMPLE_BLOCK_SIZE)) {
+		ret_err_boolerror = RESULT_BOOLERROR_ERR(ERROR_OUTPUT);
+		goto __simpleaes_softrunop_ret;
+	}
+
+	SimpleAES_UpdateAverage(&InstancePtr->cpu_ewma_ns[0],
+				ktime_get_ns() - start_ns);
+
+__simpleaes_softrunop_ret:
+	memzero_explicit(key_data, sizeof(key_data));
+	return ret_err_boolerror;
+}
+
+// Same interface and results as SimpleAES_RunBlock, on the CPU. A block
+// mapped for DMA only (zero-copy) has no kernel address: it is not run and
+// ERROR_FAULTED tells the caller to run it in software itself.
+static Result_BoolError SimpleAES_SoftRunBlock(SimpleAES *InstancePtr,
+					       ORG_SIMPLE_OpMode mode,
+					       HwBuffer *KeyBufPtr,
+					       HwBuffer *InputBufPtr,
+					       HwBuffer *OutputBufPtr)
+{
+	struct crypto_aes_ctx aes;
+
+	if (!KeyBufPtr->cpu_addr || !InputBufPtr->cpu_addr ||
+	    !OutputBufPtr->cpu_addr) {
+		return RESULT_BOOLERROR_ERR(ERROR_FAULTED);
+	}
+	SimpleAES_StatsCpu(InstancePtr, 1);
+
+	aes_expandkey(&aes, KeyBufPtr->cpu_addr, AES_KEYSIZE_128);
+	if (mode == ORG_SIMPLE_OPMODE_ENCRYPT) {
+		aes_encrypt(&aes, OutputBufPtr->cpu_addr,
+			    InputBufPtr->cpu_addr);
+	} else {
+		aes_decrypt(&aes, OutputBufPtr->cpu_addr,
+			    InputBufPtr->cpu_addr);
+	}
+	memzero_explicit(&aes, sizeof(aes));
+
+	return RESULT_BOOLERROR_OK(1);
+}
+
+// Runs a block of pinned user pages in software, for a block the engine
+// did not take because it faulted
+static Result_BoolError
+SimpleAES_SoftRunMapped(SimpleAES *InstancePtr, ORG_SIMPLE_OpMode mode,
+			HwBuffer *KeyBufPtr, UserDmaMap *InputMapPtr,
+			size_t in_offset, UserDmaMap *OutputMapPtr,
+			size_t out_offset)
+{
+	struct device *dev_ptr = &InstancePtr->pdev_ptr->dev;
+	HwBuffer input_buf     = { .slot = -1 };
+	HwBuffer output_buf    = { .slot = -1 };
+	Result_BoolError err_boolerror;
+
+	input_buf.cpu_addr  = UserDmaMap_Map(InputMapPtr, dev_ptr, in_offset);
+	output_buf.cpu_addr = UserDmaMap_Map(OutputMapPtr, dev_ptr,
+					     out_offset);
+
+	err_boolerror = SimpleAES_SoftRunBlock(InstancePtr, mode, KeyBufPtr,
+					       &input_buf, &output_buf);
+
+	UserDmaMap_Unmap(OutputMapPtr, dev_ptr, output_buf.cpu_addr,
+			 out_offset);
+	UserDmaMap_Unmap(InputMapPtr, dev_ptr, input_buf.cpu_addr, in_offset);
+
+	return err_boolerror;
+}
+
+// Same interface and results as SimpleAES_RunBatch, on the CPU. Blocks are
+// loaded, run and stored ORG_SIMPLE_SOFT_CHUNK at a time, and each run of
+// blocks with one key is a single ecb(aes) request: the Crypto API serves it
+// with the CPU's AES instructions where there are any.
+static int SimpleAES_SoftRunBatch(SimpleAES *InstancePtr,
+				  ORG_SIMPLE_OpMode mode,
+				  IOCTL_BatchData *BatchPtr)
+{
+	struct skcipher_request *req = NULL;
+	IOCTL_Block *blocks	     = NULL;
+	u8 *buf			     = NULL;
+	u64 start_ns		     = ktime_get_ns();
+
+	struct crypto_skcipher *tfm;
+	unsigned int base, count, idx, end;
+	int ret = 0;
+
+	BatchPtr->num_done   = 0;
+	BatchPtr->num_failed = 0;
+
+	SimpleAES_StatsCpu(InstancePtr, BatchPtr->num_blocks);
+
+	tfm = SoftCipherPool_Get(&InstancePtr->soft_pool);
+	if (IS_ERR(tfm)) {
+		return PTR_ERR(tfm);
+	}
+
+	req    = skcipher_request_alloc(tfm, GFP_KERNEL);
+	blocks = kmalloc_array(ORG_SIMPLE_SOFT_CHUNK, sizeof(IOCTL_Block),
+			       GFP_KERNEL);
+	buf    = kmalloc(ORG_SIMPLE_SOFT_CHUNK * ORG_SIMPLE_KD_SIZE,
+			 GFP_KERNEL);
+	if (!req || !blocks || !buf) {
+		ret = -ENOMEM;
+		goto __simpleaes_softrunbatch_undo_res1;
+	}
+
+	for (base = 0; base < BatchPtr->num_blocks && !ret; base += count) {
+		if (fatal_signal_pending(current)) {
+			ret = -EINTR;
+			break;
+		}
+
+		// A descriptor that cannot be read ends the batch after the
+		// blocks before it
+		count = min_t(unsigned int, BatchPtr->num_blocks - base,
+			      ORG_SIMPLE_SOFT_CHUNK);
+		ret   = SimpleAES_SoftLoad(BatchPtr, base, &count, blocks, buf);
+
+		for (idx = 0; idx < count; idx = end) {
+			for (end = idx + 1; end < count &&
+			     blocks[end].key_ptr == blocks[idx].key_ptr;
+			     end++) {
+			}
+			SimpleAES_SoftCipher(req, mode, &blocks[idx],
+					     buf + idx * ORG_SIMPLE_KD_SIZE,
+					     end - idx);
+		}
+
+		if (SimpleAES_SoftStore(BatchPtr, base, count, blocks, buf)) {
+			ret = -EFAULT;
+		}
+
+		cond_resched();
+	}
+
+	if (BatchPtr->num_done) {
+		SimpleAES_UpdateAverage(
+			&InstancePtr->cpu_ewma_ns[BatchPtr->num_blocks > 1],
+			div_u64(ktime_get_ns() - start_ns,
+				BatchPtr->num_done));
+	}
+
+__simpleaes_softrunbatch_undo_res1:
+	kfree_sensitive(buf);
+	kfree(blocks);
+	skcipher_request_free(req);
+	SoftCipherPool_Put(&InstancePtr->soft_pool, tfm);
+	return ret;
+}
+
+// Loads the descriptors and inputs of *CountPtr blocks from base on. Blocks
+// whose input cannot be read are marked ERROR_INPUT. A descriptor that
+// cannot be read cuts *CountPtr to the blocks before it and returns -EFAULT.
+static int SimpleAES_SoftLoad(IOCTL_BatchData *BatchPtr, unsigned int base,
+			      unsigned int *CountPtr, IOCTL_Block *BlocksPtr,
+			      u8 *buf)
+{
+	unsigned int count = *CountPtr;
+	unsigned int idx;
+	int ret = 0;
+
+	if (BatchPtr->blocks_ptr) {
+		if (copy_from_user(BlocksPtr, &BatchPtr->blocks_ptr[base],
+				   count * sizeof(IOCTL_Block))) {
+			for (idx = 0; idx < count; idx++) {
+				if (copy_from_user(
+					    &BlocksPtr[idx],
+					    &BatchPtr->blocks_ptr[base + idx],
+					    sizeof(IOCTL_Block))) {
+					break;
+				}
+			}
+			*CountPtr = count = idx;
+			ret		  = -EFAULT;
+		}
+	} else {
+		for (idx = 0; idx < count; idx++) {
+			BlocksPtr[idx].key_ptr	  = BatchPtr->key_ptr;
+			BlocksPtr[idx].i_data_ptr = (u8 *)BatchPtr->i_data_ptr +
+						    (size_t)(base + idx) *
+							    ORG_SIMPLE_KD_SIZE;
+			BlocksPtr[idx].o_data_ptr = (u8 *)BatchPtr->o_data_ptr +
+						    (size_t)(base + idx) *
+							    ORG_SIMPLE_KD_SIZE;
+		}
+
+		// Contiguous inputs take one copy unless part of them faults
+		if (!copy_from_user(buf, BlocksPtr[0].i_data_ptr,
+				    (size_t)count * ORG_SIMPLE_KD_SIZE)) {
+			for (idx = 0; idx < count; idx++) {
+				BlocksPtr[idx].err = ERROR_OK;
+			}
+			return 0;
+		}
+	}
+
+	for (idx = 0; idx < count; idx++) {
+		BlocksPtr[idx].err =
+			copy_from_user(buf + idx * ORG_SIMPLE_KD_SIZE,
+				       BlocksPtr[idx].i_data_ptr,
+				       ORG_SIMPLE_KD_SIZE) ?
+				ERROR_INPUT :
+				ERROR_OK;
+	}
+
+	return ret;
+}
+
+// Runs count blocks of buf that share the key of BlocksPtr[0]. A key that
+// cannot be read fails all of them with ERROR_KEY, before any input error,
+// as on the engine.
+static void SimpleAES_SoftCipher(struct skcipher_request *req,
+				 ORG_SIMPLE_OpMode mode,
+				 IOCTL_Block *BlocksPtr, u8 *buf,
+				 unsigned int count)
+{
+	struct crypto_skcipher *tfm = crypto_skcipher_reqtfm(req);
+	unsigned int len	    = count * ORG_SIMPLE_KD_SIZE;
+	ORG_SIMPLE_Error err	    = ERROR_OK;
+
+	u8 key_data[ORG_SIMPLE_KEY_SIZE];
+	struct crypto_wait wait;
+	struct scatterlist sg;
+	unsigned int idx;
+	int ret;
+
+	if (copy_from_user(key_data, BlocksPtr[0].key_ptr,
+			   ORG_SIMPLE_KEY_SIZE) ||
+	    crypto_skcipher_setkey(tfm, key_data, ORG_SIMPLE_KEY_SIZE)) {
+		err = ERROR_KEY;
+	} else {
+		crypto_init_wait(&wait);
+		sg_init_one(&sg, buf, len);
+		skcipher_request_set_callback(req,
+					      CRYPTO_TFM_REQ_MAY_SLEEP |
+						      CRYPTO_TFM_REQ_MAY_BACKLOG,
+					      crypto_req_done, &wait);
+		skcipher_request_set_crypt(req, &sg, &sg, len, NULL);
+		ret = crypto_wait_req(mode == ORG_SIMPLE_OPMODE_ENCRYPT ?
+					      crypto_skcipher_encrypt(req) :
+					      crypto_skcipher_decrypt(req),
+				      &wait);
+		if (ret) {
+			err = ERROR_OTHER;
+		}
+	}
+	memzero_explicit(key_data, sizeof(key_data));
+
+	for (idx = 0; idx < count && err != ERROR_OK; idx++) {
+		if (err == ERROR_KEY || BlocksPtr[idx].err == ERROR_OK) {
+			BlocksPtr[idx].err = err;
+		}
+	}
+}
+
+// Stores the outputs of the blocks that succeeded and every block's result.
+// A result that cannot be written ends the batch at that block (-EFAULT).
+static int SimpleAES_SoftStore(IOCTL_BatchData *BatchPtr, unsigned int base,
+			       unsigned int count, IOCTL_Block *BlocksPtr,
+			       u8 *buf)
+{
+	bool stored = false;
+	unsigned int idx;
+
+	// Contiguous outputs of blocks that all succeeded take one copy
+	if (!BatchPtr->blocks_ptr) {
+		for (idx = 0; idx < count && BlocksPtr[idx].err == ERROR_OK;
+		     idx++) {
+		}
+		stored = idx == count &&
+			 !copy_to_user(BlocksPtr[0].o_data_ptr, buf,
+				       (size_t)count * ORG_SIMPLE_KD_SIZE);
+	}
+
+	for (idx = 0; idx < count; idx++) {
+		if (!stored && BlocksPtr[idx].err == ERROR_OK &&
+		    copy_to_user(BlocksPtr[idx].o_data_ptr,
+				 buf + idx * ORG_SIMPLE_KD_SIZE,
+				 ORG_SIMPLE_KD_SIZE)) {
+			BlocksPtr[idx].err = ERROR_OUTPUT;
+		}
+
+		// Per-block results never fail the rest of the batch
+		if (BatchPtr->blocks_ptr) {
+			if (put_user(BlocksPtr[idx].err,
+				     &BatchPtr->blocks_ptr[base + idx].err)) {
+				return -EFAULT;
+			}
+		} else if (BatchPtr->err_ptr) {
+			if (put_user(BlocksPtr[idx].err,
+				     &BatchPtr->err_ptr[base + idx])) {
+				return -EFAULT;
+			}
+		}
+
+		if (BlocksPtr[idx].err != ERROR_OK) {
+			BatchPtr->num_failed++;
+		}
+		BatchPtr->num_done++;
+	}
+
+	return 0;
+}
+
+static void SimpleAES_UpdateAverage(u64 *AvgPtr, u64 ns)
+{
+	u64 ewma_ns = READ_ONCE(*AvgPtr);
+
+	// 1/8 weight for the newest sample
+	ewma_ns = ewma_ns ? ewma_ns - (ewma_ns >> 3) + (ns >> 3) : ns;
+	WRITE_ONCE(*AvgPtr, ewma_ns);
+}
+
+// Engine request costs leave out queueing, which SimpleAES_PreferCpu adds
+// from the queue at the time: samples during which any ticket waited for
+// the engine (sched.waits moved since waits was read) are dropped
+static void SimpleAES_UpdateEngineCost(SimpleAES *InstancePtr, u64 waits,
+				       u64 begin_ns, unsigned int num_blocks)
+{
+	if (!num_blocks || READ_ONCE(InstancePtr->sched.waits) != waits) {
+		return;
+	}
+
+	SimpleAES_UpdateAverage(&InstancePtr->engine_cost_ns[num_blocks > 1],
+				div_u64(ktime_get_ns() - begin_ns, num_blocks));
+}
+
+// Runs every known-answer vector both ways on the kernel AES library and on
+// the ecb(aes) transform of software batches, then the 128-bit ones on the
+// engine. A software mismatch fails the probe. An engine mismatch leaves the
+// device up but sends all of its work to the CPU.
+static int SimpleAES_SelfTest(SimpleAES *InstancePtr)
+{
+	struct device *dev_ptr = &InstancePtr->pdev_ptr->dev;
+	HwBufferPool *pool_ptr = &InstancePtr->buf_pool;
+	unsigned int num_checks = 2 * ARRAY_SIZE(simpleaes_known_answers);
+
+	HwBuffer op_buf, key_buf, input_buf, output_buf;
+	struct skcipher_request *req = NULL;
+	struct crypto_skcipher *tfm;
+	Result_BoolError err_boolerror;
+	const KnownAnswer *answer_ptr;
+	struct crypto_aes_ctx aes;
+	u8 data[ORG_SIMPLE_BLOCK_SIZE];
+	struct crypto_wait wait;
+	struct scatterlist sg;
+	const u8 *expected;
+	ORG_SIMPLE_OpMode mode;
+	u8 *buf = NULL;
+	unsigned int i;
+	int ret = 0;
+
+	for (i = 0; i < num_checks; i++) {
+		answer_ptr = &simpleaes_known_answers[i / 2];
+		aes_expandkey(&aes, answer_ptr->key, answer_ptr->key_len);
+		if (i % 2) {
+			aes_decrypt(&aes, data, answer_ptr->cipher);
+			expected = answer_ptr->plain;
+		} else {
+			aes_encrypt(&aes, data, answer_ptr->plain);
+			expected = answer_ptr->cipher;
+		}
+		if (memcmp(data, expected, ORG_SIMPLE_BLOCK_SIZE)) {
+			dev_err(dev_ptr,
+				"software AES failed known-answer test %u", i);
+			ret = -EIO;
+			goto __simpleaes_selftest_ret;
+		}
+	}
+
+	tfm = SoftCipherPool_Get(&InstancePtr->soft_pool);
+	if (IS_ERR(tfm)) {
+		dev_err(dev_ptr, "no ecb(aes) for software batches");
+		ret = PTR_ERR(tfm);
+		goto __simpleaes_selftest_ret;
+	}
+
+	// The scatterlist needs memory that is not on the stack
+	req = skcipher_request_alloc(tfm, GFP_KERNEL);
+	buf = kmalloc(ORG_SIMPLE_BLOCK_SIZE, GFP_KERNEL);
+	if (!req || !buf) {
+		ret = -ENOMEM;
+		goto __simpleaes_selftest_undo_res1;
+	}
+
+	for (i = 0; i < num_checks; i++) {
+		answer_ptr = &simpleaes_known_answers[i / 2];
+		expected   = i % 2 ? answer_ptr->plain : answer_ptr->cipher;
+		memcpy(buf, i % 2 ? answer_ptr->cipher : answer_ptr->plain,
+		       ORG_SIMPLE_BLOCK_SIZE);
+
+		ret = crypto_skcipher_setkey(tfm, answer_ptr->key,
+					     answer_ptr->key_len);
+		if (!ret) {
+			crypto_init_wait(&wait);
+			sg_init_one(&sg, buf, ORG_SIMPLE_BLOCK_SIZE);
+			skcipher_request_set_callback(
+				req, CRYPTO_TFM_REQ_MAY_SLEEP, crypto_req_done,
+				&wait);
+			skcipher_request_set_crypt(req, &sg, &sg,
+						   ORG_SIMPLE_BLOCK_SIZE,
+						   NULL);
+			ret = i % 2 ? crypto_skcipher_decrypt(req) :
+				      crypto_skcipher_encrypt(req);
+			ret = crypto_wait_req(ret, &wait);
+		}
+		if (ret || memcmp(buf, expected, ORG_SIMPLE_BLOCK_SIZE)) {
+			dev_err(dev_ptr,
+				"ecb(aes) failed known-answer test %u", i);
+			ret = -EIO;
+			goto __simpleaes_selftest_undo_res1;
+		}
+	}
+
+	if (HwBufferPool_Get(pool_ptr, &op_buf)) {
+		ret = -ENOMEM;
+		goto __simpleaes_selftest_undo_res1;
+	}
+	HwOpRecord_Split(&op_buf, &key_buf, &input_buf, &output_buf);
+
+	for (i = 0; i < num_checks; i++) {
+		answer_ptr = &simpleaes_known_answers[i / 2];
+		mode	   = i % 2 ? ORG_SIMPLE_OPMODE_DECRYPT :
+				     ORG_SIMPLE_OPMODE_ENCRYPT;
+		expected   = i % 2 ? answer_ptr->plain : answer_ptr->cipher;
+		if (answer_ptr->key_len != ORG_SIMPLE_KEY_SIZE) {
+			continue;
+		}
+
+		memcpy(key_buf.cpu_addr, answer_ptr->key, ORG_SIMPLE_KEY_SIZE);
+		memcpy(input_buf.cpu_addr,
+		       i % 2 ? answer_ptr->cipher : answer_ptr->plain,
+		       ORG_SIMPLE_BLOCK_SIZE);
+
+		err_boolerror = SimpleAES_RunBlock(
+			InstancePtr, mode, ORG_SIMPLE_COMPLETION_IRQ,
+			&InstancePtr->crypto_client, &key_buf, &input_buf,
+			&output_buf);
+		if (err_boolerror.variant == RESULT_ERR ||
+		    memcmp(output_buf.cpu_addr, expected,
+			   ORG_SIMPLE_BLOCK_SIZE)) {
+			dev_warn(dev_ptr, "engine failed known-answer test %u",
+				 i);
+			InstancePtr->engine_faulted = true;
+			break;
+		}
+	}
+
+	HwBufferPool_Put(pool_ptr, &op_buf);
+
+__simpleaes_selftest_undo_res1:
+	kfree(buf);
+	skcipher_request_free(req);
+	SoftCipherPool_Put(&InstancePtr->soft_pool, tfm);
+
+__simpleaes_selftest_ret:
+	memzero_explicit(&aes, sizeof(aes));
+	return ret;
+}
+
+// Software ecb(aes) transforms
+
+static void SoftCipherPool_Init(SoftCipherPool *InstancePtr)
+{
+	spin_lock_init(&InstancePtr->lock);
+	InstancePtr->count = 0;
+}
+
+// An idle transform, or a new one. CRYPTO_ALG_NEED_FALLBACK in the mask
+// keeps this driver's own ecb(aes) out.
+static struct crypto_skcipher *SoftCipherPool_Get(SoftCipherPool *InstancePtr)
+{
+	struct crypto_skcipher *tfm = NULL;
+
+	spin_lock(&InstancePtr->lock);
+	if (InstancePtr->count) {
+		tfm = InstancePtr->tfms[--InstancePtr->count];
+	}
+	spin_unlock(&InstancePtr->lock);
+
+	if (!tfm) {
+		tfm = crypto_alloc_skcipher("ecb(aes)", 0,
+					    CRYPTO_ALG_NEED_FALLBACK);
+	}
+	return tfm;
+}
+
+// Keeps the transform for reuse, or frees it when ORG_SIMPLE_SOFT_TFMS are
+// already idle
+static void SoftCipherPool_Put(SoftCipherPool *InstancePtr,
+			       struct crypto_skcipher *tfm)
+{
+	spin_lock(&InstancePtr->lock);
+	if (InstancePtr->count < ORG_SIMPLE_SOFT_TFMS) {
+		InstancePtr->tfms[InstancePtr->count++] = tfm;
+		tfm					 = NULL;
+	}
+	spin_unlock(&InstancePtr->lock);
+
+	crypto_free_skcipher(tfm);
+}
+
+static void SoftCipherPool_DeInit(SoftCipherPool *InstancePtr)
+{
+	while (InstancePtr->count) {
+		crypto_free_skcipher(InstancePtr->tfms[--InstancePtr->count]);
+	}
+}
+
+// std.Notification<Error>
+
+NOTIFICATION_DEFINE_FUNCS(Error, ORG_SIMPLE_Error)
+
+// Engine scheduler
+
+static void Scheduler_Init(Scheduler *InstancePtr)
+{
+	spin_lock_init(&InstancePtr->lock);
+	INIT_LIST_HEAD(&InstancePtr->active);
+	InstancePtr->busy	  = false;
+	InstancePtr->next_tag	  = 0;
+	InstancePtr->current_tag  = 0;
+	InstancePtr->current_cost = 0;
+	InstancePtr->queued	  = 0;
+	InstancePtr->waits	  = 0;
+	InstancePtr->vclock	  = 0;
+	InstancePtr->current_client = NULL;
+	InstancePtr->idle_client    = NULL;
+	InstancePtr->idle_holds	    = 0;
+	InstancePtr->idle_hits	    = 0;
+	hrtimer_init(&InstancePtr->idle_timer, CLOCK_MONOTONIC,
+		     HRTIMER_MODE_REL);
+	InstancePtr->idle_timer.function = Scheduler_IdleTimeout;
+}
+
+static void SchedClient_Init(SchedClient *InstancePtr, unsigned int weight)
+{
+	INIT_LIST_HEAD(&InstancePtr->node);
+	INIT_LIST_HEAD(&InstancePtr->queue);
+	InstancePtr->weight = weight;
+	InstancePtr->vtime  = 0;
+}
+
+// Returns once the ticket holds the engine for cost blocks; Scheduler_Release
+// hands it on
+static void Scheduler_Acquire(Scheduler *InstancePtr, SchedClient *ClientPtr,
+			      SchedTicket *TicketPtr, unsigned int cost)
+{
+	unsigned long lock_irq_flags;
+
+	init_completion(&TicketPtr->grant);
+	TicketPtr->cost = cost;
+
+	spin_lock_irqsave(&InstancePtr->lock, lock_irq_flags);
+	TicketPtr->tag = ++InstancePtr->next_tag;
+	WRITE_ONCE(InstancePtr->queued, InstancePtr->queued + cost);
+
+	// The engine was kept idle for this client
+	if (InstancePtr->idle_client == ClientPtr) {
+		hrtimer_try_to_cancel(&InstancePtr->idle_timer);
+		InstancePtr->idle_client = NULL;
+		WRITE_ONCE(InstancePtr->idle_hits, InstancePtr->idle_hits + 1);
+		Scheduler_Charge(InstancePtr, ClientPtr, TicketPtr);
+		spin_unlock_irqrestore(&InstancePtr->lock, lock_irq_flags);
+		return;
+	}
+
+	// Idle engine: take it without queueing
+	if (!InstancePtr->busy) {
+		InstancePtr->busy = true;
+		Scheduler_Charge(InstancePtr, ClientPtr, TicketPtr);
+		spin_unlock_irqrestore(&InstancePtr->lock, lock_irq_flags);
+		return;
+	}
+	WRITE_ONCE(InstancePtr->waits, InstancePtr->waits + 1);
+
+	// A client that gets work starts no earlier than the current virtual
+	// time, so time spent idle is not banked
+	if (list_empty(&ClientPtr->queue)) {
+		ClientPtr->vtime = max(ClientPtr->vtime, InstancePtr->vclock);
+		list_add_tail(&ClientPtr->node, &InstancePtr->active);
+	}
+	list_add_tail(&TicketPtr->node, &ClientPtr->queue);
+	spin_unlock_irqrestore(&InstancePtr->lock, lock_irq_flags);
+
+	wait_for_completion(&TicketPtr->grant);
+}
+
+// A client with one operation at a time (a single-threaded file) has no
+// ticket waiting when it releases the engine, so handing the engine straight
+// on would make clients alternate whatever their weights. If the releasing
+// client is behind every waiting one, the engine stays idle for up to
+// sched_idle_us for its next operation instead.
+static void Scheduler_Release(Scheduler *InstancePtr)
+{
+	unsigned int idle_us = READ_ONCE(sched_idle_us);
+	SchedClient *client_ptr, *waiting_ptr;
+	unsigned long lock_irq_flags;
+	bool behind;
+
+	spin_lock_irqsave(&InstancePtr->lock, lock_irq_flags);
+	WRITE_ONCE(InstancePtr->queued,
+		   InstancePtr->queued - InstancePtr->current_cost);
+
+	client_ptr = InstancePtr->current_client;
+	behind	   = idle_us && list_empty(&client_ptr->queue) &&
+		 !list_empty(&InstancePtr->active);
+	list_for_each_entry(waiting_ptr, &InstancePtr->active, node) {
+		behind = behind && client_ptr->vtime < waiting_ptr->vtime;
+	}
+
+	if (behind) {
+		InstancePtr->idle_client  = client_ptr;
+		InstancePtr->current_cost = 0;
+		WRITE_ONCE(InstancePtr->idle_holds,
+			   InstancePtr->idle_holds + 1);
+		hrtimer_start(&InstancePtr->idle_timer,
+			      ns_to_ktime((u64)idle_us * NSEC_PER_USEC),
+			      HRTIMER_MODE_REL);
+	} else {
+		Scheduler_GrantNext(InstancePtr);
+	}
+	spin_unlock_irqrestore(&InstancePtr->lock, lock_irq_flags);
+}
+
+// Stops keeping the engine idle for ClientPtr (for any client if NULL),
+// before the client goes away
+static void Scheduler_Detach(Scheduler *InstancePtr, SchedClient *ClientPtr)
+{
+	unsigned long lock_irq_flags;
+
+	spin_lock_irqsave(&InstancePtr->lock, lock_irq_flags);
+	if (InstancePtr->idle_client &&
+	    (!ClientPtr || InstancePtr->idle_client == ClientPtr)) {
+		// A timeout already running finds idle_client cleared
+		hrtimer_try_to_cancel(&InstancePtr->idle_timer);
+		InstancePtr->idle_client = NULL;
+		Scheduler_GrantNext(InstancePtr);
+	}
+	spin_unlock_irqrestore(&InstancePtr->lock, lock_irq_flags);
+}
+
+static enum hrtimer_restart Scheduler_IdleTimeout(struct hrtimer *timer_ptr)
+{
+	Scheduler *sched_ptr = container_of(timer_ptr, Scheduler, idle_timer);
+	unsigned long lock_irq_flags;
+
+	// The client did not come back in time
+	spin_lock_irqsave(&sched_ptr->lock, lock_irq_flags);
+	if (sched_ptr->idle_client) {
+		sched_ptr->idle_client = NULL;
+		Scheduler_GrantNext(sched_ptr);
+	}
+	spin_unlock_irqrestore(&sched_ptr->lock, lock_irq_flags);
+
+	return HRTIMER_NORESTART;
+}
+
+// Hands the engine to TicketPtr and charges its blocks, over the client's
+// weight, from the later of the client's and the scheduler's virtual time.
+// Called with the scheduler lock held.
+static void Scheduler_Charge(Scheduler *InstancePtr, SchedClient *ClientPtr,
+			     SchedTicket *TicketPtr)
+{
+	u64 start = max(ClientPtr->vtime, InstancePtr->vclock);
+	u64 cost  = (u64)TicketPtr->cost * ORG_SIMPLE_SCHED_BLOCK_VTIME;
+
+	InstancePtr->vclock = start;
+	ClientPtr->vtime =
+		start + div_u64(cost, max(READ_ONCE(ClientPtr->weight), 1U));
+
+	InstancePtr->current_client = ClientPtr;
+	InstancePtr->current_cost   = TicketPtr->cost;
+	WRITE_ONCE(InstancePtr->current_tag, TicketPtr->tag);
+}
+
+// Start-time fair queueing: the waiting client with the least virtual time
+// goes next, in arrival order among equals. A block costs a client of weight
+// w a w-th of what it costs one of weight 1, so of two clients keeping the
+// engine busy the first gets w times the blocks. Called with the scheduler
+// lock held.
+static void Scheduler_GrantNext(Scheduler *InstancePtr)
+{
+	SchedClient *client_ptr = NULL, *waiting_ptr;
+	SchedTicket *ticket_ptr;
+
+	list_for_each_entry(waiting_ptr, &InstancePtr->active, node) {
+		if (!client_ptr || waiting_ptr->vtime < client_ptr->vtime) {
+			client_ptr = waiting_ptr;
+		}
+	}
+	if (!client_ptr) {
+		InstancePtr->busy	    = false;
+		InstancePtr->current_client = NULL;
+		return;
+	}
+
+	ticket_ptr = list_first_entry(&client_ptr->queue, SchedTicket, node);
+	list_del(&ticket_ptr->node);
+	if (list_empty(&client_ptr->queue)) {
+		list_del_init(&client_ptr->node);
+	}
+
+	Scheduler_Charge(InstancePtr, client_ptr, ticket_ptr);
+	complete(&ticket_ptr->grant);
+}
+
+// Latency statistics
+
+static void LatencyStats_Init(LatencyStats *InstancePtr)
+{
+	spin_lock_init(&InstancePtr->lock);
+	InstancePtr->count = 0;
+	InstancePtr->next  = 0;
+}
+
+static void LatencyStats_Record(LatencyStats *InstancePtr, u64 ns)
+{
+	unsigned long lock_irq_flags;
+
+	spin_lock_irqsave(&InstancePtr->lock, lock_irq_flags);
+	InstancePtr->samples[InstancePtr->next] = min_t(u64, ns, U32_MAX);
+	InstancePtr->next = (InstancePtr->next + 1) % ORG_SIMPLE_LATENCY_SAMPLES;
+	if (InstancePtr->count < ORG_SIMPLE_LATENCY_SAMPLES) {
+		InstancePtr->count++;
+	}
+	spin_unlock_irqrestore(&InstancePtr->lock, lock_irq_flags);
+}
+
+static int LatencyStats_Compare(const void *a, const void *b)
+{
+	u32 lhs = *(const u32 *)a;
+	u32 rhs = *(const u32 *)b;
+
+	return lhs < rhs ? -1 : lhs > rhs;
+}
+
+static void LatencyStats_Percentiles(LatencyStats *InstancePtr, u64 *P50Ptr,
+				     u64 *P99Ptr)
+{
+	unsigned long lock_irq_flags;
+	unsigned int count;
+	u32 *sorted;
+
+	*P50Ptr = 0;
+	*P99Ptr = 0;
+
+	sorted = kmalloc_array(ORG_SIMPLE_LATENCY_SAMPLES, sizeof(u32),
+			       GFP_KERNEL);
+	if (!sorted) {
+		return;
+	}
+
+	// Sort a snapshot so recording is never held up by a reader
+	spin_lock_irqsave(&InstancePtr->lock, lock_irq_flags);
+	count = InstancePtr->count;
+	memcpy(sorted, InstancePtr->samples, count * sizeof(u32));
+	spin_unlock_irqrestore(&InstancePtr->lock, lock_irq_flags);
+
+	if (count) {
+		sort(sorted, count, sizeof(u32), LatencyStats_Compare, NULL);
+		*P50Ptr = sorted[(count - 1) * 50 / 100];
+		*P99Ptr = sorted[(count - 1) * 99 / 100];
+	}
+
+	kfree(sorted);
+}
+
+// Operation phase statistics
+
+static void OpPhaseStats_Init(OpPhaseStats *InstancePtr)
+{
+	unsigned int i;
+
+	atomic64_set(&InstancePtr->ops, 0);
+	for (i = 0; i < ORG_SIMPLE_OP_PHASES; i++) {
+		atomic64_set(&InstancePtr->phase_ns[i], 0);
+	}
+}
+
+static void OpPhaseStats_Record(OpPhaseStats *InstancePtr,
+				const u64 phase_ns[])
+{
+	unsigned int i;
+
+	for (i = 0; i < ORG_SIMPLE_OP_PHASES; i++) {
+		atomic64_add(phase_ns[i], &InstancePtr->phase_ns[i]);
+	}
+	atomic64_inc(&InstancePtr->ops);
+}
+
+// Per-CPU statistics (debugfs)
+
+// Takes the regfile lock, accounting for the wait when another CPU holds it
+static unsigned long SimpleAES_LockRegfile(SimpleAES *InstancePtr)
+{
+	struct spinlock_t *lock_ptr = &InstancePtr->regfile.lock;
+	unsigned long lock_irq_flags;
+	u64 wait_ns;
+
+	if (spin_trylock_irqsave(lock_ptr, lock_irq_flags)) {
+		return lock_irq_flags;
+	}
+
+	wait_ns = ktime_get_ns();
+	spin_lock_irqsave(lock_ptr, lock_irq_flags);
+	wait_ns = ktime_get_ns() - wait_ns;
+
+	this_cpu_inc(InstancePtr->stats->lock_contended);
+	SimpleAES_StatsHist(InstancePtr, ORG_SIMPLE_HIST_LOCK, wait_ns);
+	trace_simpleaes_regfile_contended(InstancePtr->id, wait_ns);
+
+	return lock_irq_flags;
+}
+
+static void SimpleAES_StatsHist(SimpleAES *InstancePtr, unsigned int hist,
+				u64 val)
+{
+	unsigned int bucket =
+		min_t(unsigned int, fls64(val), ORG_SIMPLE_HIST_BUCKETS - 1);
+
+	this_cpu_inc(InstancePtr->stats->hist[hist][bucket]);
+}
+
+// Accounts ns spent in one stage, by any path: its histogram and tracepoint
+static void SimpleAES_StatsStage(SimpleAES *InstancePtr,
+				 ORG_SIMPLE_OpPhase phase, u64 ns)
+{
+	SimpleAES_StatsHist(InstancePtr, phase, ns);
+
+	switch (phase) {
+	case ORG_SIMPLE_PHASE_ALLOC:
+		trace_simpleaes_alloc(InstancePtr->id, ns);
+		break;
+	case ORG_SIMPLE_PHASE_COPY_IN:
+		trace_simpleaes_copy_in(InstancePtr->id, ns);
+		break;
+	case ORG_SIMPLE_PHASE_QUEUE:
+		trace_simpleaes_queue(InstancePtr->id, ns);
+		break;
+	case ORG_SIMPLE_PHASE_MMIO:
+		trace_simpleaes_mmio(InstancePtr->id, ns);
+		break;
+	case ORG_SIMPLE_PHASE_ENGINE:
+		trace_simpleaes_engine(InstancePtr->id, ns);
+		break;
+	case ORG_SIMPLE_PHASE_WAKEUP:
+		trace_simpleaes_wakeup(InstancePtr->id, ns);
+		break;
+	case ORG_SIMPLE_PHASE_COPY_OUT:
+		trace_simpleaes_copy_out(InstancePtr->id, ns);
+		break;
+	}
+}
+
+// Accounts one engine completion (every decoded IRQ status)
+static void SimpleAES_StatsComplete(SimpleAES *InstancePtr,
+				    ORG_SIMPLE_Error err)
+{
+	this_cpu_inc(InstancePtr->stats->ops);
+	this_cpu_add(InstancePtr->stats->bytes, ORG_SIMPLE_BLOCK_SIZE);
+	this_cpu_inc(InstancePtr->stats->errors[err]);
+}
+
+// Accounts one request run in software instead of on the engine
+static void SimpleAES_StatsCpu(SimpleAES *InstancePtr,
+			       unsigned int num_blocks)
+{
+	atomic64_inc(&InstancePtr->cpu_requests);
+	this_cpu_inc(InstancePtr->stats->cpu_ops);
+	this_cpu_add(InstancePtr->stats->cpu_bytes,
+		     (u64)num_blocks * ORG_SIMPLE_BLOCK_SIZE);
+}
+
+static void SimpleAES_StatsSum(SimpleAES *InstancePtr, SimpleAESStats *SumPtr)
+{
+	SimpleAESStats *cpu_stats_ptr;
+	unsigned int i, j;
+	int cpu;
+
+	memset(SumPtr, 0, sizeof(*SumPtr));
+	for_each_possible_cpu(cpu) {
+		cpu_stats_ptr = per_cpu_ptr(InstancePtr->stats, cpu);
+
+		SumPtr->ops += cpu_stats_ptr->ops;
+		SumPtr->bytes += cpu_stats_ptr->bytes;
+		for (i = 0; i < ORG_SIMPLE_ERRORS; i++) {
+			SumPtr->errors[i] += cpu_stats_ptr->errors[i];
+		}
+		SumPtr->cpu_ops += cpu_stats_ptr->cpu_ops;
+		SumPtr->cpu_bytes += cpu_stats_ptr->cpu_bytes;
+		SumPtr->busy += cpu_stats_ptr->busy;
+		SumPtr->lock_contended += cpu_stats_ptr->lock_contended;
+		SumPtr->timeouts += cpu_stats_ptr->timeouts;
+		SumPtr->resets += cpu_stats_ptr->resets;
+		SumPtr->requeues += cpu_stats_ptr->requeues;
+		SumPtr->reset_ns += cpu_stats_ptr->reset_ns;
+		for (i = 0; i < ORG_SIMPLE_HISTS; i++) {
+			for (j = 0; j < ORG_SIMPLE_HIST_BUCKETS; j++) {
+				SumPtr->hist[i][j] +=
+					cpu_stats_ptr->hist[i][j];
+			}
+		}
+	}
+}
+
+#ifdef SIMPLEAES_MMIO_PROFILE
+static void SimpleAES_MmioProfile(SimpleAESMmioSite *SitePtr)
+{
+	unsigned long lock_irq_flags;
+
+	atomic64_inc(&SitePtr->count);
+	if (likely(atomic_read(&SitePtr->listed)) ||
+	    atomic_xchg(&SitePtr->listed, 1)) {
+		return;
+	}
+
+	spin_lock_irqsave(&simpleaes_mmio_sites_lock, lock_irq_flags);
+	list_add_tail(&SitePtr->node, &simpleaes_mmio_sites);
+	spin_unlock_irqrestore(&simpleaes_mmio_sites_lock, lock_irq_flags);
+}
+#endif
+
+// std.Pool<HwBuffer>
+
+static int HwBufferPool_Init(HwBufferPool *InstancePtr, struct device *dev_ptr,
+			     bool streaming, unsigned int depth,
+			     unsigned int max_depth)
+{
+	HwBuffer *buf_ptr;
+	unsigned int slot;
+
+	if (max_depth < depth) {
+		max_depth = depth;
+	}
+
+	InstancePtr->dev_ptr   = dev_ptr;
+	InstancePtr->max_depth = max_depth;
+	InstancePtr->streaming = streaming;
+	atomic_set(&InstancePtr->depth, 0);
+	atomic64_set(&InstancePtr->hits, 0);
+	atomic64_set(&InstancePtr->misses, 0);
+
+	// Coherent records are packed into shared pages, one cache line each,
+	// instead of taking a coherent page (and IOMMU entry) per buffer
+	InstancePtr->dma_pool_ptr = NULL;
+	if (!streaming) {
+		InstancePtr->dma_pool_ptr = dma_pool_create(
+			SIMPLEAES_DEVICE_NAME "_op", dev_ptr,
+			sizeof(HwOpRecord), SMP_CACHE_BYTES, 0);
+		if (!InstancePtr->dma_pool_ptr) {
+			return -ENOMEM;
+		}
+	}
+
+	InstancePtr->slots = kcalloc(max_depth, sizeof(HwBuffer), GFP_KERNEL);
+	if (!InstancePtr->slots) {
+		dma_pool_destroy(InstancePtr->dma_pool_ptr);
+		return -ENOMEM;
+	}
+
+	// Unpopulated slots are marked busy, so only the caller that grows the
+	// pool into a slot can own it before it is first put back
+	InstancePtr->busy_map = bitmap_zalloc(max_depth, GFP_KERNEL);
+	if (!InstancePtr->busy_map) {
+		kfree(InstancePtr->slots);
+		dma_pool_destroy(InstancePtr->dma_pool_ptr);
+		return -ENOMEM;
+	}
+	bitmap_fill(InstancePtr->busy_map, max_depth);
+
+	for (slot = 0; slot < depth; slot++) {
+		buf_ptr	      = &InstancePtr->slots[slot];
+		buf_ptr->slot = slot;
+		if (HwBufferPool_Alloc(InstancePtr, buf_ptr)) {
+			HwBufferPool_DeInit(InstancePtr);
+			return -ENOMEM;
+		}
+
+		atomic_inc(&InstancePtr->depth);
+		clear_bit(slot, InstancePtr->busy_map);
+	}
+
+	return 0;
+}
+
+// Allocates the record of BufPtr (its slot is set by the caller)
+static int HwBufferPool_Alloc(HwBufferPool *InstancePtr, HwBuffer *BufPtr)
+{
+	BufPtr->streaming = InstancePtr->streaming;
+
+	if (!InstancePtr->streaming) {
+		BufPtr->cpu_addr = dma_pool_zalloc(InstancePtr->dma_pool_ptr,
+						   GFP_KERNEL,
+						   &BufPtr->bus_addr);
+		return BufPtr->cpu_addr ? 0 : -ENOMEM;
+	}
+
+	// kmalloc memory is DMA-safe and cacheable. The record stays mapped
+	// for its lifetime; each operation only syncs it.
+	BufPtr->cpu_addr = kzalloc(sizeof(HwOpRecord), GFP_KERNEL);
+	if (!BufPtr->cpu_addr) {
+		return -ENOMEM;
+	}
+
+	BufPtr->bus_addr = dma_map_single(InstancePtr->dev_ptr,
+					  BufPtr->cpu_addr, sizeof(HwOpRecord),
+					  DMA_BIDIRECTIONAL);
+	if (dma_mapping_error(InstancePtr->dev_ptr, BufPtr->bus_addr)) {
+		kfree(BufPtr->cpu_addr);
+		BufPtr->cpu_addr = NULL;
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static void HwBufferPool_Free(HwBufferPool *InstancePtr, HwBuffer *BufPtr)
+{
+	if (!BufPtr->streaming) {
+		memzero_explicit(BufPtr->cpu_addr, sizeof(HwOpRecord));
+		dma_pool_free(InstancePtr->dma_pool_ptr, BufPtr->cpu_addr,
+			      BufPtr->bus_addr);
+		return;
+	}
+
+	dma_unmap_single(InstancePtr->dev_ptr, BufPtr->bus_addr,
+			 sizeof(HwOpRecord), DMA_BIDIRECTIONAL);
+	kfree_sensitive(BufPtr->cpu_addr);
+}
+
+static int HwBufferPool_Get(HwBufferPool *InstancePtr, HwBuffer *BufPtr)
+{
+	unsigned int depth = atomic_read(&InstancePtr->depth);
+	unsigned int slot;
+	HwBuffer *buf_ptr;
+
+	// Fast path: claim a free pre-allocated slot
+	for (slot = find_first_zero_bit(InstancePtr->busy_map, depth);
+	     slot < depth;
+	     slot = find_next_zero_bit(InstancePtr->busy_map, depth, slot + 1)) {
+		if (test_and_set_bit_lock(slot, InstancePtr->busy_map)) {
+			continue;
+		}
+
+		// A failed grow leaves its slot free but without a record
+		buf_ptr = &InstancePtr->slots[slot];
+		if (buf_ptr->cpu_addr) {
+			atomic64_inc(&InstancePtr->hits);
+		} else {
+			atomic64_inc(&InstancePtr->misses);
+			if (HwBufferPool_Alloc(InstancePtr, buf_ptr)) {
+				clear_bit_unlock(slot, InstancePtr->busy_map);
+				return -ENOMEM;
+			}
+		}
+
+		*BufPtr = *buf_ptr;
+		return 0;
+	}
+
+	atomic64_inc(&InstancePtr->misses);
+
+	// Slow path: grow the pool by one slot, owned by this caller
+	slot = atomic_fetch_add_unless(&InstancePtr->depth, 1,
+				       InstancePtr->max_depth);
+	if (slot < InstancePtr->max_depth) {
+		buf_ptr	      = &InstancePtr->slots[slot];
+		buf_ptr->slot = slot;
+		if (HwBufferPool_Alloc(InstancePtr, buf_ptr)) {
+			// depth cannot go back down under concurrent growers,
+			// so free the slot for the next Get to populate
+			clear_bit_unlock(slot, InstancePtr->busy_map);
+			return -ENOMEM;
+		}
+
+		*BufPtr = *buf_ptr;
+		return 0;
+	}
+
+	// Pool is at its maximum depth: fall back to a one-shot record
+	BufPtr->slot = -1;
+
+	return HwBufferPool_Alloc(InstancePtr, BufPtr);
+}
+
+static void HwBufferPool_Put(HwBufferPool *InstancePtr, HwBuffer *BufPtr)
+{
+	// Pooled records outlive the operation: the next caller must not find
+	// this one's key or data in it
+	memzero_explicit(BufPtr->cpu_addr, sizeof(HwOpRecord));
+
+	if (BufPtr->slot < 0) {
+		HwBufferPool_Free(InstancePtr, BufPtr);
+		return;
+	}
+
+	clear_bit_unlock(BufPtr->slot, InstancePtr->busy_map);
+}
+
+static void HwBufferPool_DeInit(HwBufferPool *InstancePtr)
+{
+	unsigned int depth = atomic_read(&InstancePtr->depth);
+	HwBuffer *buf_ptr;
+	unsigned int slot;
+
+	for (slot = 0; slot < depth; slot++) {
+		buf_ptr = &InstancePtr->slots[slot];
+		if (buf_ptr->cpu_addr) {
+			HwBufferPool_Free(InstancePtr, buf_ptr);
+		}
+	}
+
+	dma_pool_destroy(InstancePtr->dma_pool_ptr);
+	bitmap_free(InstancePtr->busy_map);
+	kfree(InstancePtr->slots);
+}
+
+// Key, input and output of the record in OpBufPtr. The views share the
+// record's storage and are never put back themselves. KeyBufPtr is NULL
+// when the key comes from elsewhere (key table, ring data area).
+static void HwOpRecord_Split(const HwBuffer *OpBufPtr, HwBuffer *KeyBufPtr,
+			     HwBuffer *InputBufPtr, HwBuffer *OutputBufPtr)
+{
+	HwOpRecord *record_ptr = OpBufPtr->cpu_addr;
+
+	if (KeyBufPtr) {
+		KeyBufPtr->slot	     = -1;
+		KeyBufPtr->streaming = OpBufPtr->streaming;
+		KeyBufPtr->cpu_addr  = record_ptr->key;
+		KeyBufPtr->bus_addr =
+			OpBufPtr->bus_addr + offsetof(HwOpRecord, key);
+	}
+
+	InputBufPtr->slot      = -1;
+	InputBufPtr->streaming = OpBufPtr->streaming;
+	InputBufPtr->cpu_addr  = record_ptr->input;
+	InputBufPtr->bus_addr =
+		OpBufPtr->bus_addr + offsetof(HwOpRecord, input);
+
+	OutputBufPtr->slot	= -1;
+	OutputBufPtr->streaming = OpBufPtr->streaming;
+	OutputBufPtr->cpu_addr	= record_ptr->output;
+	OutputBufPtr->bus_addr =
+		OpBufPtr->bus_addr + offsetof(HwOpRecord, output);
+}
+
+// A streaming buffer is written back before the engine reads it and
+// invalidated before the CPU reads what the engine wrote. Coherent buffers
+// need neither.
+static void HwBuffer_SyncForDevice(struct device *dev_ptr, HwBuffer *BufPtr,
+				   size_t len)
+{
+	if (BufPtr->streaming) {
+		dma_sync_single_for_device(dev_ptr, BufPtr->bus_addr, len,
+					   DMA_BIDIRECTIONAL);
+	}
+}
+
+static void HwBuffer_SyncForCpu(struct device *dev_ptr, HwBuffer *BufPtr,
+				size_t len)
+{
+	if (BufPtr->streaming) {
+		dma_sync_single_for_cpu(dev_ptr, BufPtr->bus_addr, len,
+					DMA_BIDIRECTIONAL);
+	}
+}
+
+// Time to copy ORG_SIMPLE_DMA_BENCH_BYTES into a len-byte DMA buffer and
+// out of it again, len bytes at a time, each copy synced like an operation
+// record. Measures what dma_records chooses between on this platform.
+static int HwBuffer_CopyBench(struct device *dev_ptr, bool streaming,
+			      size_t len, u64 *InNsPtr, u64 *OutNsPtr)
+{
+	unsigned int loops = max_t(size_t, ORG_SIMPLE_DMA_BENCH_BYTES / len, 1);
+	HwBuffer buf	   = { .slot = -1, .streaming = streaming };
+	unsigned int i;
+	u8 *src, *dst;
+	u64 start_ns;
+	int ret = 0;
+
+	src = kmalloc(len, GFP_KERNEL);
+	dst = kmalloc(len, GFP_KERNEL);
+	if (!src || !dst) {
+		ret = -ENOMEM;
+		goto __hwbuffer_copybench_undo_res1;
+	}
+	memset(src, 0xa5, len);
+
+	if (streaming) {
+		buf.cpu_addr = kmalloc(len, GFP_KERNEL);
+		if (buf.cpu_addr) {
+			buf.bus_addr = dma_map_single(dev_ptr, buf.cpu_addr,
+						      len, DMA_BIDIRECTIONAL);
+			if (dma_mapping_error(dev_ptr, buf.bus_addr)) {
+				kfree(buf.cpu_addr);
+				buf.cpu_addr = NULL;
+			}
+		}
+	} else {
+		buf.cpu_addr = dma_alloc_coherent(dev_ptr, len, &buf.bus_addr,
+						  GFP_KERNEL);
+	}
+	if (!buf.cpu_addr) {
+		ret = -ENOMEM;
+		goto __hwbuffer_copybench_undo_res1;
+	}
+
+	start_ns = ktime_get_ns();
+	for (i = 0; i < loops; i++) {
+		memcpy(buf.cpu_addr, src, len);
+		HwBuffer_SyncForDevice(dev_ptr, &buf, len);
+	}
+	*InNsPtr = ktime_get_ns() - start_ns;
+
+	start_ns = ktime_get_ns();
+	for (i = 0; i < loops; i++) {
+		HwBuffer_SyncForCpu(dev_ptr, &buf, len);
+		memcpy(dst, buf.cpu_addr, len);
+	}
+	*OutNsPtr = ktime_get_ns() - start_ns;
+
+	if (streaming) {
+		dma_unmap_single(dev_ptr, buf.bus_addr, len,
+				 DMA_BIDIRECTIONAL);
+		kfree(buf.cpu_addr);
+	} else {
+		dma_free_coherent(dev_ptr, len, buf.cpu_addr, buf.bus_addr);
+	}
+
+__hwbuffer_copybench_undo_res1:
+	kfree(dst);
+	kfree(src);
+	return ret;
+}
+
+// Pinned user buffers
+
+// Each page is mapped on its own, for only the part the buffer covers, so
+// that a block is synced with dma_sync_single_range_*() on its page's
+// mapping, and swiotlb can bounce any page the device cannot reach (the
+// device mask keeps every address within the 32-bit address registers).
+// Blocks never straddle two pages: every caller requires aligned blocks or
+// checks.
+static int UserDmaMap_Init(UserDmaMap *InstancePtr, struct device *dev_ptr,
+			   void __user *uaddr, size_t len,
+			   enum dma_data_direction dir, bool fixed)
+{
+	unsigned long start = (unsigned long)uaddr;
+	unsigned int gup_flags = dir != DMA_TO_DEVICE ? FOLL_WRITE : 0;
+	unsigned int page_idx;
+	size_t page_off, page_len;
+	int pinned;
+	int ret;
+
+	if (fixed) {
+		gup_flags |= FOLL_LONGTERM;
+	}
+
+	InstancePtr->dir	  = dir;
+	InstancePtr->len	  = len;
+	InstancePtr->first_offset = offset_in_page(start);
+	InstancePtr->num_pages	  = DIV_ROUND_UP(offset_in_page(start) + len,
+						 PAGE_SIZE);
+
+	InstancePtr->pages = kvmalloc_array(InstancePtr->num_pages,
+					    sizeof(struct page *), GFP_KERNEL);
+	if (!InstancePtr->pages) {
+		return -ENOMEM;
+	}
+
+	InstancePtr->page_bus = kvmalloc_array(InstancePtr->num_pages,
+					       sizeof(dma_addr_t), GFP_KERNEL);
+	if (!InstancePtr->page_bus) {
+		ret = -ENOMEM;
+		goto __userdmamap_init_undo_res1;
+	}
+
+	pinned = pin_user_pages_fast(start & PAGE_MASK, InstancePtr->num_pages,
+				     gup_flags, InstancePtr->pages);
+	if (pinned < 0) {
+		ret = pinned;
+		goto __userdmamap_init_undo_res2;
+	}
+	if (pinned != InstancePtr->num_pages) {
+		unpin_user_pages(InstancePtr->pages, pinned);
+		ret = -EFAULT;
+		goto __userdmamap_init_undo_res2;
+	}
+
+	for (page_idx = 0; page_idx < InstancePtr->num_pages; page_idx++) {
+		UserDmaMap_PageRange(InstancePtr, page_idx, &page_off,
+				     &page_len);
+		InstancePtr->page_bus[page_idx] =
+			dma_map_page(dev_ptr, InstancePtr->pages[page_idx],
+				     page_off, page_len, dir);
+		if (dma_mapping_error(dev_ptr,
+				      InstancePtr->page_bus[page_idx])) {
+			// Registration fails here, not on the first op
+			if (fixed) {
+				dev_err(dev_ptr,
+					"cannot map page %u of a %zu-byte buffer\n",
+					page_idx, len);
+			}
+			ret = -ENOMEM;
+			goto __userdmamap_init_undo_res3;
+		}
+	}
+
+	return 0;
+
+__userdmamap_init_undo_res3:
+	while (page_idx--) {
+		UserDmaMap_PageRange(InstancePtr, page_idx, &page_off,
+				     &page_len);
+		dma_unmap_page(dev_ptr, InstancePtr->page_bus[page_idx],
+			       page_len, dir);
+	}
+	unpin_user_pages(InstancePtr->pages, InstancePtr->num_pages);
+
+__userdmamap_init_undo_res2:
+	kvfree(InstancePtr->page_bus);
+
+__userdmamap_init_undo_res1:
+	kvfree(InstancePtr->pages);
+	return ret;
+}
+
+// The part of page page_idx that the buffer covers
+static void UserDmaMap_PageRange(UserDmaMap *InstancePtr,
+				 unsigned int page_idx, size_t *OffsetPtr,
+				 size_t *LenPtr)
+{
+	size_t first = page_idx ? (size_t)page_idx * PAGE_SIZE -
+					  InstancePtr->first_offset :
+				  0;
+
+	*OffsetPtr = page_idx ? 0 : InstancePtr->first_offset;
+	*LenPtr	   = min_t(size_t, PAGE_SIZE - *OffsetPtr,
+			   InstancePtr->len - first);
+}
+
+// Page of the block at offset, and the block's offset in that page's
+// mapping
+static unsigned int UserDmaMap_Locate(UserDmaMap *InstancePtr, size_t offset,
+				      size_t *MapOffsetPtr)
+{
+	size_t pos = InstancePtr->first_offset + offset;
+	unsigned int page_idx = pos >> PAGE_SHIFT;
+
+	*MapOffsetPtr = offset_in_page(pos) -
+			(page_idx ? 0 : InstancePtr->first_offset);
+	return page_idx;
+}
+
+static int UserDmaMap_BusAddr(UserDmaMap *InstancePtr, size_t offset,
+			      size_t len, dma_addr_t *AddrPtr)
+{
+	unsigned int page_idx;
+	size_t map_offset;
+
+	if (offset > InstancePtr->len || len > InstancePtr->len - offset ||
+	    offset_in_page(InstancePtr->first_offset + offset) + len >
+		    PAGE_SIZE) {
+		return -EINVAL;
+	}
+
+	page_idx = UserDmaMap_Locate(InstancePtr, offset, &map_offset);
+	*AddrPtr = InstancePtr->page_bus[page_idx] + map_offset;
+	return 0;
+}
+
+// For mappings that outlive one op (fixed buffers): hand len bytes at
+// offset, within one page, to the device or back to the CPU
+static void UserDmaMap_SyncForDevice(UserDmaMap *InstancePtr,
+				     struct device *dev_ptr, size_t offset,
+				     size_t len)
+{
+	unsigned int page_idx;
+	size_t map_offset;
+
+	page_idx = UserDmaMap_Locate(InstancePtr, offset, &map_offset);
+	dma_sync_single_range_for_device(dev_ptr,
+					 InstancePtr->page_bus[page_idx],
+					 map_offset, len, InstancePtr->dir);
+}
+
+static void UserDmaMap_SyncForCpu(UserDmaMap *InstancePtr,
+				  struct device *dev_ptr, size_t offset,
+				  size_t len)
+{
+	unsigned int page_idx;
+	size_t map_offset;
+
+	page_idx = UserDmaMap_Locate(InstancePtr, offset, &map_offset);
+	dma_sync_single_range_for_cpu(dev_ptr, InstancePtr->page_bus[page_idx],
+				      map_offset, len, InstancePtr->dir);
+}
+
+// Kernel address of the block at offset, for a faulted engine's blocks run
+// in software. The block is synced for the CPU here and back for the device
+// by UserDmaMap_Unmap.
+static void *UserDmaMap_Map(UserDmaMap *InstancePtr, struct device *dev_ptr,
+			    size_t offset)
+{
+	size_t pos = InstancePtr->first_offset + offset;
+
+	UserDmaMap_SyncForCpu(InstancePtr, dev_ptr, offset,
+			      ORG_SIMPLE_KD_SIZE);
+	return kmap_local_page(InstancePtr->pages[pos >> PAGE_SHIFT]) +
+	       offset_in_page(pos);
+}
+
+static void UserDmaMap_Unmap(UserDmaMap *InstancePtr, struct device *dev_ptr,
+			     void *cpu_addr, size_t offset)
+{
+	kunmap_local(cpu_addr);
+	UserDmaMap_SyncForDevice(InstancePtr, dev_ptr, offset,
+				 ORG_SIMPLE_KD_SIZE);
+}
+
+static void UserDmaMap_DeInit(UserDmaMap *InstancePtr, struct device *dev_ptr)
+{
+	unsigned int page_idx;
+	size_t page_off, page_len;
+
+	for (page_idx = 0; page_idx < InstancePtr->num_pages; page_idx++) {
+		UserDmaMap_PageRange(InstancePtr, page_idx, &page_off,
+				     &page_len);
+		dma_unmap_page(dev_ptr, InstancePtr->page_bus[page_idx],
+			       page_len, InstancePtr->dir);
+	}
+	unpin_user_pages_dirty_lock(InstancePtr->pages, InstancePtr->num_pages,
+				    InstancePtr->dir != DMA_TO_DEVICE);
+	kvfree(InstancePtr->page_bus);
+	kvfree(InstancePtr->pages);
+}
+
+// Registered (fixed) buffers
+
+static int FixedBuffer_Init(FixedBuffer *InstancePtr, struct device *dev_ptr,
+			    IOCTL_BufferRegion *RegionPtr)
+{
+	int ret;
+
+	if (!RegionPtr->len || RegionPtr->len > ORG_SIMPLE_FIXED_BUF_MAX_LEN) {
+		return -EINVAL;
+	}
+
+	ret = UserDmaMap_Init(&InstancePtr->map, dev_ptr, RegionPtr->addr,
+			      RegionPtr->len, DMA_BIDIRECTIONAL, true);
+	if (ret) {
+		return ret;
+	}
+
+	InstancePtr->len = RegionPtr->len;
+	return 0;
+}
+
+static int FixedBuffer_BusAddr(FixedBuffer *InstancePtr, size_t offset,
+			       size_t len, dma_addr_t *AddrPtr)
+{
+	return UserDmaMap_BusAddr(&InstancePtr->map, offset, len, AddrPtr);
+}
+
+static void FixedBuffer_DeInit(FixedBuffer *InstancePtr,
+			       struct device *dev_ptr)
+{
+	UserDmaMap_DeInit(&InstancePtr->map, dev_ptr);
+}
+
+// Key table
+
+static int KeyTable_Init(KeyTable *InstancePtr, struct device *dev_ptr,
+			 unsigned int num_slots)
+{
+	unsigned int slot;
+
+	mutex_init(&InstancePtr->lock);
+	INIT_LIST_HEAD(&InstancePtr->lru);
+	InstancePtr->num_slots = num_slots;
+	atomic64_set(&InstancePtr->hits, 0);
+	atomic64_set(&InstancePtr->misses, 0);
+	atomic64_set(&InstancePtr->evictions, 0);
+
+	InstancePtr->slots =
+		kcalloc(num_slots, sizeof(KeyTableSlot), GFP_KERNEL);
+	if (!InstancePtr->slots) {
+		return -ENOMEM;
+	}
+
+	InstancePtr->table.slot	     = -1;
+	InstancePtr->table.streaming = false;
+	InstancePtr->table.cpu_addr  = dma_alloc_coherent(
+		dev_ptr, num_slots * ORG_SIMPLE_KD_SIZE,
+		&InstancePtr->table.bus_addr, GFP_KERNEL);
+	if (!InstancePtr->table.cpu_addr) {
+		kfree(InstancePtr->slots);
+		return -ENOMEM;
+	}
+
+	for (slot = 0; slot < num_slots; slot++) {
+		list_add_tail(&InstancePtr->slots[slot].lru,
+			      &InstancePtr->lru);
+	}
+
+	return 0;
+}
+
+static int KeyTable_Acquire(KeyTable *InstancePtr, KeyEntry *KeyPtr,
+			    HwBuffer *SlotBufPtr)
+{
+	KeyTableSlot *slot_ptr = NULL;
+	KeyTableSlot *iter_ptr;
+	unsigned int slot;
+	u8 *slot_addr;
+
+	mutex_lock(&InstancePtr->lock);
+
+	if (KeyPtr->slot >= 0) {
+		atomic64_inc(&InstancePtr->hits);
+		slot_ptr = &InstancePtr->slots[KeyPtr->slot];
+		slot	 = KeyPtr->slot;
+	} else {
+		atomic64_inc(&InstancePtr->misses);
+
+		// Free slots are kept at the tail, behind the LRU victim
+		list_for_each_entry_reverse(iter_ptr, &InstancePtr->lru, lru) {
+			if (iter_ptr->pin_count == 0) {
+				slot_ptr = iter_ptr;
+				break;
+			}
+		}
+		if (!slot_ptr) {
+			mutex_unlock(&InstancePtr->lock);
+			return -EBUSY;
+		}
+
+		if (slot_ptr->key_ptr) {
+			slot_ptr->key_ptr->slot = -1;
+			atomic64_inc(&InstancePtr->evictions);
+		}
+
+		slot	  = slot_ptr - InstancePtr->slots;
+		slot_addr = (u8 *)InstancePtr->table.cpu_addr +
+			    slot * ORG_SIMPLE_KD_SIZE;
+		memcpy(slot_addr, KeyPtr->material, ORG_SIMPLE_KD_SIZE);
+		slot_ptr->key_ptr = KeyPtr;
+		KeyPtr->slot	  = slot;
+	}
+
+	slot_ptr->pin_count++;
+	list_move(&slot_ptr->lru, &InstancePtr->lru);
+
+	SlotBufPtr->slot      = slot;
+	SlotBufPtr->streaming = false;
+	SlotBufPtr->cpu_addr  = (u8 *)InstancePtr->table.cpu_addr +
+				slot * ORG_SIMPLE_KD_SIZE;
+	SlotBufPtr->bus_addr =
+		InstancePtr->table.bus_addr + slot * ORG_SIMPLE_KD_SIZE;
+
+	mutex_unlock(&InstancePtr->lock);
+	return 0;
+}
+
+static void KeyTable_Release(KeyTable *InstancePtr, HwBuffer *SlotBufPtr)
+{
+	KeyTableSlot *slot_ptr = &InstancePtr->slots[SlotBufPtr->slot];
+
+	mutex_lock(&InstancePtr->lock);
+	slot_ptr->pin_count--;
+	if (slot_ptr->pin_count == 0 && !slot_ptr->key_ptr) {
+		memzero_explicit(SlotBufPtr->cpu_addr, ORG_SIMPLE_KD_SIZE);
+	}
+	mutex_unlock(&InstancePtr->lock);
+}
+
+static void KeyTable_Drop(KeyTable *InstancePtr, KeyEntry *KeyPtr)
+{
+	KeyTableSlot *slot_ptr;
+
+	mutex_lock(&InstancePtr->lock);
+	if (KeyPtr->slot >= 0) {
+		slot_ptr	  = &InstancePtr->slots[KeyPtr->slot];
+		slot_ptr->key_ptr = NULL;
+
+		// A pinned slot is wiped by the last KeyTable_Release
+		if (slot_ptr->pin_count == 0) {
+			memzero_explicit((u8 *)InstancePtr->table.cpu_addr +
+						 KeyPtr->slot *
+							 ORG_SIMPLE_KD_SIZE,
+					 ORG_SIMPLE_KD_SIZE);
+		}
+		list_move_tail(&slot_ptr->lru, &InstancePtr->lru);
+		KeyPtr->slot = -1;
+	}
+	mutex_unlock(&InstancePtr->lock);
+}
+
+static void KeyTable_DeInit(KeyTable *InstancePtr, struct device *dev_ptr)
+{
+	size_t size = InstancePtr->num_slots * ORG_SIMPLE_KD_SIZE;
+
+	memzero_explicit(InstancePtr->table.cpu_addr, size);
+	dma_free_coherent(dev_ptr, size, InstancePtr->table.cpu_addr,
+			  InstancePtr->table.bus_addr);
+	kfree(InstancePtr->slots);
+	mutex_destroy(&InstancePtr->lock);
+}
+
+// Descriptor ring
+
+static int DescRing_Init(DescRing *InstancePtr, struct device *dev_ptr)
+{
+	init_waitqueue_head(&InstancePtr->wq);
+	InstancePtr->head = 0;
+	InstancePtr->tail = 0;
+	atomic64_set(&InstancePtr->blocks, 0);
+	atomic64_set(&InstancePtr->descs, 0);
+	atomic64_set(&InstancePtr->doorbells, 0);
+	atomic64_set(&InstancePtr->wakeups, 0);
+
+	// Zeroed: no descriptor is done before the engine has run it
+	InstancePtr->area = dma_alloc_coherent(dev_ptr, sizeof(HwRingArea),
+					       &InstancePtr->bus_addr,
+					       GFP_KERNEL);
+	if (!InstancePtr->area) {
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+// Bus address of a location in the ring area
+static u32 DescRing_BusAddr(DescRing *InstancePtr, const void *cpu_ptr)
+{
+	return (u32)(InstancePtr->bus_addr +
+		     ((const u8 *)cpu_ptr - (const u8 *)InstancePtr->area));
+}
+
+// Entry of free-running descriptor index idx
+static HwDesc *DescRing_Desc(DescRing *InstancePtr, u32 idx)
+{
+	return &InstancePtr->area->descs[idx % ORG_SIMPLE_RING_ENTRIES];
+}
+
+static RingSlot *DescRing_Slot(DescRing *InstancePtr, u32 idx)
+{
+	return &InstancePtr->slots[idx % ORG_SIMPLE_RING_ENTRIES];
+}
+
+static void DescRing_DeInit(DescRing *InstancePtr, struct device *dev_ptr)
+{
+	dma_free_coherent(dev_ptr, sizeof(HwRingArea), InstancePtr->area,
+			  InstancePtr->bus_addr);
+}
+
+// Per-open-file state
+
+static int FileContext_SetKey(FileContext *InstancePtr, void *key,
+			      unsigned int *HandlePtr)
+{
+	KeyEntry *key_ptr;
+	int id;
+
+	key_ptr = kzalloc(struct_size(key_ptr, material, ORG_SIMPLE_KD_SIZE),
+			  GFP_KERNEL);
+	if (!key_ptr) {
+		return -ENOMEM;
+	}
+
+	if (copy_from_user(key_ptr->material, key, ORG_SIMPLE_KD_SIZE)) {
+		kfree_sensitive(key_ptr);
+		return -EFAULT;
+	}
+	key_ptr->slot = -1;
+
+	mutex_lock(&InstancePtr->lock);
+	id = idr_alloc(&InstancePtr->keys, key_ptr, 1,
+		       ORG_SIMPLE_MAX_KEYS_PER_FILE + 1, GFP_KERNEL);
+	if (id >= 0) {
+		key_ptr->handle = id;
+	}
+	mutex_unlock(&InstancePtr->lock);
+
+	if (id < 0) {
+		kfree_sensitive(key_ptr);
+		return id;
+	}
+
+	*HandlePtr = id;
+	return 0;
+}
+
+static int FileContext_ClearKey(FileContext *InstancePtr, unsigned int handle)
+{
+	KeyTable *table_ptr = &InstancePtr->simpleaes_ptr->key_table;
+	KeyEntry *key_ptr;
+
+	mutex_lock(&InstancePtr->lock);
+	key_ptr = idr_remove(&InstancePtr->keys, handle);
+	mutex_unlock(&InstancePtr->lock);
+
+	if (!key_ptr) {
+		return -ENOENT;
+	}
+
+	KeyTable_Drop(table_ptr, key_ptr);
+	kfree_sensitive(key_ptr);
+	return 0;
+}
+
+static ORG_SIMPLE_Error FileContext_AcquireKey(FileContext *InstancePtr,
+					       unsigned int handle,
+					       HwBuffer *KeyBufPtr)
+{
+	SimpleAES *simpleaes_ptr = InstancePtr->simpleaes_ptr;
+	KeyEntry *key_ptr;
+	int ret;
+
+	// The file lock keeps the key registered until its slot is pinned
+	mutex_lock(&InstancePtr->lock);
+	key_ptr = idr_find(&InstancePtr->keys, handle);
+	if (!key_ptr) {
+		mutex_unlock(&InstancePtr->lock);
+		return ERROR_KEY;
+	}
+	ret = KeyTable_Acquire(&simpleaes_ptr->key_table, key_ptr, KeyBufPtr);
+	mutex_unlock(&InstancePtr->lock);
+	if (ret) {
+		// Every slot is pinned by an operation in flight: the caller
+		// gets -EBUSY and may retry
+		dev_dbg(&simpleaes_ptr->pdev_ptr->dev,
+			"no unpinned key table slot");
+		return ERROR_BUSY;
+	}
+
+	return ERROR_OK;
+}
+
+static int FileContext_RegisterBuffers(FileContext *InstancePtr,
+				       IOCTL_BufferSet *SetPtr)
+{
+	struct device *dev_ptr = &InstancePtr->simpleaes_ptr->pdev_ptr->dev;
+	IOCTL_BufferRegion *regions;
+	FixedBuffer *bufs;
+	unsigned int idx;
+	int ret = 0;
+
+	if (!SetPtr->num_regions ||
+	    SetPtr->num_regions > ORG_SIMPLE_MAX_FIXED_BUFS) {
+		return -EINVAL;
+	}
+
+	regions = memdup_user(SetPtr->regions_ptr,
+			      SetPtr->num_regions * sizeof(*regions));
+	if (IS_ERR(regions)) {
+		return PTR_ERR(regions);
+	}
+
+	bufs = kcalloc(SetPtr->num_regions, sizeof(*bufs), GFP_KERNEL);
+	if (!bufs) {
+		ret = -ENOMEM;
+		goto __filecontext_registerbuffers_ret;
+	}
+
+	for (idx = 0; idx < SetPtr->num_regions; idx++) {
+		ret = FixedBuffer_Init(&bufs[idx], dev_ptr, &regions[idx]);
+		if (ret) {
+			while (idx--) {
+				FixedBuffer_DeInit(&bufs[idx], dev_ptr);
+			}
+			kfree(bufs);
+			goto __filecontext_registerbuffers_ret;
+		}
+	}
+
+	down_write(&InstancePtr->bufs_lock);
+	if (InstancePtr->bufs) {
+		up_write(&InstancePtr->bufs_lock);
+		for (idx = 0; idx < SetPtr->num_regions; idx++) {
+			FixedBuffer_DeInit(&bufs[idx], dev_ptr);
+		}
+		kfree(bufs);
+		ret = -EBUSY;
+		goto __filecontext_registerbuffers_ret;
+	}
+	InstancePtr->bufs     = bufs;
+	InstancePtr->num_bufs = SetPtr->num_regions;
+	up_write(&InstancePtr->bufs_lock);
+
+__filecontext_registerbuffers_ret:
+	kfree(regions);
+	return ret;
+}
+
+static void FileContext_UnregisterBuffers(FileContext *InstancePtr)
+{
+	struct device *dev_ptr = &InstancePtr->simpleaes_ptr->pdev_ptr->dev;
+	unsigned int idx;
+
+	// Waits for in-flight ops on the buffers to finish
+	down_write(&InstancePtr->bufs_lock);
+	for (idx = 0; idx < InstancePtr->num_bufs; idx++) {
+		FixedBuffer_DeInit(&InstancePtr->bufs[idx], dev_ptr);
+	}
+	kfree(InstancePtr->bufs);
+	InstancePtr->bufs     = NULL;
+	InstancePtr->num_bufs = 0;
+	up_write(&InstancePtr->bufs_lock);
+}
+
+static int FileContext_SetEventfd(FileContext *InstancePtr, int fd)
+{
+	struct eventfd_ctx *new_ctx = NULL;
+	struct eventfd_ctx *old_ctx;
+	unsigned long lock_irq_flags;
+
+	if (fd >= 0) {
+		new_ctx = eventfd_ctx_fdget(fd);
+		if (IS_ERR(new_ctx)) {
+			return PTR_ERR(new_ctx);
+		}
+	}
+
+	spin_lock_irqsave(&InstancePtr->async_lock, lock_irq_flags);
+	old_ctx		     = InstancePtr->eventfd;
+	InstancePtr->eventfd = new_ctx;
+	spin_unlock_irqrestore(&InstancePtr->async_lock, lock_irq_flags);
+
+	if (old_ctx) {
+		eventfd_ctx_put(old_ctx);
+	}
+	return 0;
+}
+
+// Returns the engine for an operation, with its queue depth raised. Files
+// opened through the aggregate node spread stateless operations over the
+// least loaded engine; anything tied to registered state stays at home.
+static SimpleAES *FileContext_Engine(FileContext *InstancePtr, bool stateless)
+{
+	if (InstancePtr->aggregate && stateless) {
+		return SimpleAES_AcquireIdle();
+	}
+
+	SimpleAES_Hold(InstancePtr->simpleaes_ptr);
+	return InstancePtr->simpleaes_ptr;
+}
+
+static SchedClient *FileContext_Client(FileContext *InstancePtr,
+				       SimpleAES *SimpleAESPtr)
+{
+	return &InstancePtr->sched[SimpleAESPtr->id];
+}
+
+static bool FileContext_TryAdmit(FileContext *InstancePtr)
+{
+	int limit = max(READ_ONCE(sched_queue_limit), 1U);
+	int queued = atomic_read(&InstancePtr->sched_queued);
+
+	do {
+		if (queued >= limit) {
+			return false;
+		}
+	} while (!atomic_try_cmpxchg(&InstancePtr->sched_queued, &queued,
+				     queued + 1));
+
+	return true;
+}
+
+// Bounds the synchronous operations a file has queued: callers beyond the
+// limit wait for a slot, or get -EAGAIN on a non-blocking file
+static int FileContext_Admit(FileContext *InstancePtr, bool nonblock)
+{
+	if (FileContext_TryAdmit(InstancePtr)) {
+		return 0;
+	}
+	if (nonblock) {
+		return -EAGAIN;
+	}
+
+	return wait_event_interruptible(InstancePtr->sched_wq,
+					FileContext_TryAdmit(InstancePtr));
+}
+
+static void FileContext_Retire(FileContext *InstancePtr)
+{
+	atomic_dec(&InstancePtr->sched_queued);
+	wake_up(&InstancePtr->sched_wq);
+}
+
+// Asynchronous requests
+
+static int AsyncRequest_Submit(FileContext *FilePtr,
+			       IOCTL_AsyncSubmit *SubmitPtr)
+{
+	size_t span = (size_t)SubmitPtr->num_blocks * ORG_SIMPLE_KD_SIZE;
+	unsigned long i_addr = (unsigned long)SubmitPtr->i_data_ptr;
+	unsigned long o_addr = (unsigned long)SubmitPtr->o_data_ptr;
+
+	unsigned long lock_irq_flags;
+	SimpleAES *simpleaes_ptr;
+	struct device *dev_ptr;
+	ORG_SIMPLE_Error key_err;
+	AsyncRequest *req_ptr;
+	int ret;
+
+	if (SubmitPtr->opcode > ORG_SIMPLE_OPMODE_DECRYPT ||
+	    !SubmitPtr->num_blocks ||
+	    SubmitPtr->num_blocks > ORG_SIMPLE_BATCH_MAX_BLOCKS) {
+		return -EINVAL;
+	}
+
+	// Blocks are DMAed straight from the pinned pages, so none may
+	// straddle a page, and partial overlap cannot be expressed
+	if (!IS_ALIGNED(i_addr, ORG_SIMPLE_KD_SIZE) ||
+	    !IS_ALIGNED(o_addr, ORG_SIMPLE_KD_SIZE)) {
+		return -EINVAL;
+	}
+	if (i_addr != o_addr && i_addr < o_addr + span &&
+	    o_addr < i_addr + span) {
+		return -EINVAL;
+	}
+
+	// Reserve an outstanding slot up front; read() gives it back
+	spin_lock_irqsave(&FilePtr->async_lock, lock_irq_flags);
+	if (FilePtr->async_outstanding >= ORG_SIMPLE_ASYNC_MAX_OUTSTANDING) {
+		spin_unlock_irqrestore(&FilePtr->async_lock, lock_irq_flags);
+		return -EAGAIN;
+	}
+	FilePtr->async_outstanding++;
+	spin_unlock_irqrestore(&FilePtr->async_lock, lock_irq_flags);
+
+	req_ptr = kzalloc(sizeof(AsyncRequest), GFP_KERNEL);
+	if (!req_ptr) {
+		ret = -ENOMEM;
+		goto __asyncrequest_submit_undo_res1;
+	}
+
+	// Registered keys live in the home engine's key table
+	simpleaes_ptr = FileContext_Engine(
+		FilePtr, !(SubmitPtr->flags & SIMPLEAES_SUBMIT_KEY_HANDLE));
+	if (!simpleaes_ptr) {
+		ret = -ENODEV;
+		goto __asyncrequest_submit_undo_res2;
+	}
+	dev_ptr = &simpleaes_ptr->pdev_ptr->dev;
+
+	req_ptr->file_ptr	= FilePtr;
+	req_ptr->simpleaes_ptr	= simpleaes_ptr;
+	req_ptr->mode		= SubmitPtr->opcode;
+	req_ptr->completion	= READ_ONCE(FilePtr->completion);
+	req_ptr->num_blocks	= SubmitPtr->num_blocks;
+	req_ptr->cqe.user_data	= SubmitPtr->user_data;
+	INIT_WORK(&req_ptr->work, AsyncRequest_Work);
+
+	if (SubmitPtr->flags & SIMPLEAES_SUBMIT_KEY_HANDLE) {
+		key_err = FileContext_AcquireKey(FilePtr, SubmitPtr->handle,
+						 &req_ptr->key_buf);
+		if (key_err != ERROR_OK) {
+			ret = key_err == ERROR_KEY ? -ENOENT : -EBUSY;
+			goto __asyncrequest_submit_undo_res2a;
+		}
+		req_ptr->key_registered = true;
+	} else {
+		// The key comes first in a record: its address is the key's
+		if (HwBufferPool_Get(&simpleaes_ptr->buf_pool,
+				     &req_ptr->key_buf)) {
+			ret = -ENOMEM;
+			goto __asyncrequest_submit_undo_res2a;
+		}
+		if (copy_from_user(req_ptr->key_buf.cpu_addr,
+				   SubmitPtr->key_ptr, ORG_SIMPLE_KEY_SIZE)) {
+			ret = -EFAULT;
+			goto __asyncrequest_submit_undo_res3;
+		}
+	}
+
+	// The worker runs outside the caller's address space, so both
+	// buffers are pinned and mapped here
+	req_ptr->in_place = i_addr == o_addr;
+	ret = UserDmaMap_Init(&req_ptr->input_map, dev_ptr,
+			      SubmitPtr->i_data_ptr, span,
+			      req_ptr->in_place ? DMA_BIDIRECTIONAL :
+						  DMA_TO_DEVICE,
+			      false);
+	if (ret) {
+		goto __asyncrequest_submit_undo_res3;
+	}
+	if (!req_ptr->in_place) {
+		// Bidirectional, so that outputs written by the CPU for a
+		// faulted engine survive swiotlb bouncing
+		ret = UserDmaMap_Init(&req_ptr->output_map, dev_ptr,
+				      SubmitPtr->o_data_ptr, span,
+				      DMA_BIDIRECTIONAL, false);
+		if (ret) {
+			goto __asyncrequest_submit_undo_res4;
+		}
+	}
+
+	spin_lock_irqsave(&FilePtr->async_lock, lock_irq_flags);
+	req_ptr->cqe.tag = ++FilePtr->async_next_tag;
+	FilePtr->async_running++;
+	spin_unlock_irqrestore(&FilePtr->async_lock, lock_irq_flags);
+
+	SubmitPtr->tag = req_ptr->cqe.tag;
+	queue_work(simpleaes_ptr->async_wq, &req_ptr->work);
+	return 0;
+
+__asyncrequest_submit_undo_res4:
+	UserDmaMap_DeInit(&req_ptr->input_map, dev_ptr);
+
+__asyncrequest_submit_undo_res3:
+	if (req_ptr->key_registered) {
+		KeyTable_Release(&simpleaes_ptr->key_table, &req_ptr->key_buf);
+	} else {
+		HwBufferPool_Put(&simpleaes_ptr->buf_pool, &req_ptr->key_buf);
+	}
+
+__asyncrequest_submit_undo_res2a:
+	SimpleAES_Release(simpleaes_ptr);
+
+__asyncrequest_submit_undo_res2:
+	kfree(req_ptr);
+
+__asyncrequest_submit_undo_res1:
+	spin_lock_irqsave(&FilePtr->async_lock, lock_irq_flags);
+	FilePtr->async_outstanding--;
+	spin_unlock_irqrestore(&FilePtr->async_lock, lock_irq_flags);
+	return ret;
+}
+
+static void AsyncRequest_Work(struct work_struct *work_ptr)
+{
+	AsyncRequest *req_ptr = container_of(work_ptr, AsyncRequest, work);
+	SimpleAES *simpleaes_ptr = req_ptr->simpleaes_ptr;
+	UserDmaMap *out_map_ptr	 = req_ptr->in_place ? &req_ptr->input_map :
+						       &req_ptr->output_map;
+
+	HwBuffer input_buf  = { .cpu_addr = NULL, .slot = -1 };
+	HwBuffer output_buf = { .cpu_addr = NULL, .slot = -1 };
+	Result_BoolError err_boolerror;
+	size_t offset;
+	unsigned int blk;
+
+	req_ptr->cqe.result = ERROR_OK;
+	for (blk = 0; blk < req_ptr->num_blocks; blk++) {
+		offset = (size_t)blk * ORG_SIMPLE_KD_SIZE;
+		if (UserDmaMap_BusAddr(&req_ptr->input_map, offset,
+				       ORG_SIMPLE_KD_SIZE,
+				       &input_buf.bus_addr)) {
+			req_ptr->cqe.result = ERROR_INPUT;
+			break;
+		}
+		if (UserDmaMap_BusAddr(out_map_ptr, offset, ORG_SIMPLE_KD_SIZE,
+				       &output_buf.bus_addr)) {
+			req_ptr->cqe.result = ERROR_OUTPUT;
+			break;
+		}
+
+		// Requests from every file interleave block by block in the
+		// engine scheduler
+		err_boolerror = SimpleAES_RunBlock(
+			simpleaes_ptr, req_ptr->mode, req_ptr->completion,
+			FileContext_Client(req_ptr->file_ptr, simpleaes_ptr),
+			&req_ptr->key_buf, &input_buf, &output_buf);
+
+		// A faulted engine does not take the block, even when it was
+		// lost while the block waited for it: it runs in software on
+		// the pages
+		if (err_boolerror.variant == RESULT_ERR &&
+		    err_boolerror.value.err == ERROR_FAULTED) {
+			err_boolerror = SimpleAES_SoftRunMapped(
+				simpleaes_ptr, req_ptr->mode,
+				&req_ptr->key_buf, &req_ptr->input_map,
+				offset, out_map_ptr, offset);
+		}
+
+		if (err_boolerror.variant == RESULT_ERR) {
+			req_ptr->cqe.result = err_boolerror.value.err;
+			break;
+		}
+
+		req_ptr->cqe.num_done++;
+		cond_resched();
+	}
+
+	AsyncRequest_Complete(req_ptr);
+}
+
+static void AsyncRequest_Complete(AsyncRequest *InstancePtr)
+{
+	FileContext *file_ctx	 = InstancePtr->file_ptr;
+	SimpleAES *simpleaes_ptr = InstancePtr->simpleaes_ptr;
+	struct device *dev_ptr	 = &simpleaes_ptr->pdev_ptr->dev;
+	unsigned long lock_irq_flags;
+
+	// Pins and key slots go back as soon as the engine is done
+	if (!InstancePtr->in_place) {
+		UserDmaMap_DeInit(&InstancePtr->output_map, dev_ptr);
+	}
+	UserDmaMap_DeInit(&InstancePtr->input_map, dev_ptr);
+	if (InstancePtr->key_registered) {
+		KeyTable_Release(&simpleaes_ptr->key_table,
+				 &InstancePtr->key_buf);
+	} else {
+		HwBufferPool_Put(&simpleaes_ptr->buf_pool,
+				 &InstancePtr->key_buf);
+	}
+	SimpleAES_Release(simpleaes_ptr);
+
+	// Everything is done under the lock: once async_running drops to zero
+	// release may free the file context as soon as it gets the lock
+	spin_lock_irqsave(&file_ctx->async_lock, lock_irq_flags);
+	list_add_tail(&InstancePtr->node, &file_ctx->async_done);
+	file_ctx->async_running--;
+	if (file_ctx->eventfd) {
+		eventfd_signal(file_ctx->eventfd, 1);
+	}
+	wake_up_poll(&file_ctx->async_wq, EPOLLIN | EPOLLRDNORM);
+	spin_unlock_irqrestore(&file_ctx->async_lock, lock_irq_flags);
+}
+
+static void AsyncRequest_Free(AsyncRequest *InstancePtr)
+{
+	kfree(InstancePtr);
+}
+
+// Shared-memory ring
+
+static int Ring_Init(Ring *InstancePtr, FileContext *FilePtr,
+		     IOCTL_RingSetup *SetupPtr)
+{
+	struct device *dev_ptr = &FilePtr->simpleaes_ptr->pdev_ptr->dev;
+	size_t sq_off, cq_off, data_off;
+
+	if (!is_power_of_2(SetupPtr->sq_entries) ||
+	    !is_power_of_2(SetupPtr->cq_entries) ||
+	    SetupPtr->sq_entries > ORG_SIMPLE_RING_MAX_ENTRIES ||
+	    SetupPtr->cq_entries > ORG_SIMPLE_RING_MAX_ENTRIES ||
+	    SetupPtr->data_size > ORG_SIMPLE_RING_MAX_DATA ||
+	    SetupPtr->sq_idle_ms > ORG_SIMPLE_RING_MAX_SQ_IDLE_MS) {
+		return -EINVAL;
+	}
+
+	// An SQPOLL thread spins on a CPU for up to sq_idle_ms after each
+	// entry, on behalf of whoever opened the node
+	if ((SetupPtr->flags & SIMPLEAES_RING_SQPOLL) &&
+	    !READ_ONCE(ring_sqpoll) && !capable(CAP_SYS_NICE)) {
+		return -EPERM;
+	}
+
+	sq_off	 = ALIGN(sizeof(RingHeader), SMP_CACHE_BYTES);
+	cq_off	 = ALIGN(sq_off + SetupPtr->sq_entries * sizeof(RingSqe),
+			 SMP_CACHE_BYTES);
+	data_off = PAGE_ALIGN(cq_off + SetupPtr->cq_entries * sizeof(RingCqe));
+
+	InstancePtr->file_ptr	 = FilePtr;
+	InstancePtr->sq_entries	 = SetupPtr->sq_entries;
+	InstancePtr->cq_entries	 = SetupPtr->cq_entries;
+	InstancePtr->data_size	 = SetupPtr->data_size;
+	InstancePtr->sq_idle_ms	 = SetupPtr->sq_idle_ms;
+	InstancePtr->sq_head	 = 0;
+	InstancePtr->cq_tail	 = 0;
+	InstancePtr->region_size = PAGE_ALIGN(data_off + SetupPtr->data_size);
+
+	// Each file may hold one ring of up to ORG_SIMPLE_RING_MAX_DATA, so the
+	// total is capped across files
+	if (atomic64_add_return(InstancePtr->region_size, &simpleaes_ring_mem) >
+	    READ_ONCE(ring_mem_max)) {
+		atomic64_sub(InstancePtr->region_size, &simpleaes_ring_mem);
+		return -ENOMEM;
+	}
+
+	// The engine reaches the data area directly, so the whole ring is one
+	// coherent allocation that is also mapped into the caller
+	InstancePtr->region.slot      = -1;
+	InstancePtr->region.streaming = false;
+	InstancePtr->region.cpu_addr  = dma_alloc_coherent(
+		dev_ptr, InstancePtr->region_size,
+		&InstancePtr->region.bus_addr, GFP_KERNEL | __GFP_ZERO);
+	if (!InstancePtr->region.cpu_addr) {
+		atomic64_sub(InstancePtr->region_size, &simpleaes_ring_mem);
+		return -ENOMEM;
+	}
+
+	InstancePtr->hdr_ptr  = InstancePtr->region.cpu_addr;
+	InstancePtr->sq_ptr   = (RingSqe *)((u8 *)InstancePtr->hdr_ptr + sq_off);
+	InstancePtr->cq_ptr   = (RingCqe *)((u8 *)InstancePtr->hdr_ptr + cq_off);
+	InstancePtr->data_ptr = (u8 *)InstancePtr->hdr_ptr + data_off;
+	InstancePtr->data_bus_addr = InstancePtr->region.bus_addr + data_off;
+
+	mutex_init(&InstancePtr->lock);
+	init_waitqueue_head(&InstancePtr->sqpoll_wq);
+	init_waitqueue_head(&InstancePtr->cq_wq);
+
+	SetupPtr->sq_off    = sq_off;
+	SetupPtr->cq_off    = cq_off;
+	SetupPtr->data_off  = data_off;
+	SetupPtr->mmap_size = InstancePtr->region_size;
+
+	if (SetupPtr->flags & SIMPLEAES_RING_SQPOLL) {
+		InstancePtr->sqpoll_task =
+			kthread_run(Ring_SqPollThread, InstancePtr,
+				    SIMPLEAES_DEVICE_NAME "-sqpoll");
+		if (IS_ERR(InstancePtr->sqpoll_task)) {
+			dma_free_coherent(dev_ptr, InstancePtr->region_size,
+					  InstancePtr->region.cpu_addr,
+					  InstancePtr->region.bus_addr);
+			atomic64_sub(InstancePtr->region_size,
+				     &simpleaes_ring_mem);
+			return PTR_ERR(InstancePtr->sqpoll_task);
+		}
+	}
+
+	return 0;
+}
+
+static bool Ring_InDataArea(Ring *InstancePtr, u32 offset, size_t len)
+{
+	return offset <= InstancePtr->data_size &&
+	       len <= InstancePtr->data_size - offset && IS_ALIGNED(offset, 4);
+}
+
+static ORG_SIMPLE_Error Ring_RunSqe(Ring *InstancePtr, const RingSqe *SqePtr)
+{
+	FileContext *file_ctx	 = InstancePtr->file_ptr;
+	SimpleAES *simpleaes_ptr = file_ctx->simpleaes_ptr;
+	size_t span = (size_t)SqePtr->num_blocks * ORG_SIMPLE_KD_SIZE;
+
+	HwBuffer key_buf, input_buf, output_buf;
+	Result_BoolError err_boolerror = RESULT_BOOLERROR_OK(1);
+	ORG_SIMPLE_Error key_err;
+	unsigned int blk;
+
+	if (SqePtr->opcode > ORG_SIMPLE_OPMODE_DECRYPT) {
+		return ERROR_OTHER;
+	}
+	if (!Ring_InDataArea(InstancePtr, SqePtr->in_offset, span)) {
+		return ERROR_INPUT;
+	}
+	if (!Ring_InDataArea(InstancePtr, SqePtr->out_offset, span)) {
+		return ERROR_OUTPUT;
+	}
+
+	if (SqePtr->flags & SIMPLEAES_SQE_KEY_HANDLE) {
+		key_err = FileContext_AcquireKey(file_ctx, SqePtr->key,
+						 &key_buf);
+		if (key_err != ERROR_OK) {
+			return key_err;
+		}
+	} else {
+		if (!Ring_InDataArea(InstancePtr, SqePtr->key,
+				     ORG_SIMPLE_KD_SIZE)) {
+			return ERROR_KEY;
+		}
+		key_buf.slot	  = -1;
+		key_buf.streaming = false;
+		key_buf.cpu_addr  = InstancePtr->data_ptr + SqePtr->key;
+		key_buf.bus_addr = InstancePtr->data_bus_addr + SqePtr->key;
+	}
+
+	// Blocks are processed in place: no copies to or from the caller
+	input_buf.slot	     = -1;
+	input_buf.streaming  = false;
+	output_buf.slot	     = -1;
+	output_buf.streaming = false;
+	for (blk = 0; blk < SqePtr->num_blocks; blk++) {
+		input_buf.cpu_addr  = InstancePtr->data_ptr +
+				      SqePtr->in_offset +
+				      blk * ORG_SIMPLE_KD_SIZE;
+		input_buf.bus_addr  = InstancePtr->data_bus_addr +
+				      SqePtr->in_offset +
+				      blk * ORG_SIMPLE_KD_SIZE;
+		output_buf.cpu_addr = InstancePtr->data_ptr +
+				      SqePtr->out_offset +
+				      blk * ORG_SIMPLE_KD_SIZE;
+		output_buf.bus_addr = InstancePtr->data_bus_addr +
+				      SqePtr->out_offset +
+				      blk * ORG_SIMPLE_KD_SIZE;
+
+		err_boolerror = SimpleAES_RunBlock(
+			simpleaes_ptr, SqePtr->opcode, file_ctx->completion,
+			FileContext_Client(file_ctx, simpleaes_ptr), &key_buf,
+			&input_buf, &output_buf);
+		if (err_boolerror.variant == RESULT_ERR) {
+			break;
+		}
+	}
+
+	if (SqePtr->flags & SIMPLEAES_SQE_KEY_HANDLE) {
+		KeyTable_Release(&simpleaes_ptr->key_table, &key_buf);
+	}
+
+	if (err_boolerror.variant == RESULT_ERR) {
+		return err_boolerror.value.err;
+	}
+	return ERROR_OK;
+}
+
+static unsigned int Ring_Submit(Ring *InstancePtr, unsigned int to_submit)
+{
+	RingHeader *hdr_ptr	 = InstancePtr->hdr_ptr;
+	unsigned int submitted = 0;
+	u32 sq_tail, cq_head;
+	RingSqe sqe;
+	RingCqe cqe;
+
+	mutex_lock(&InstancePtr->lock);
+
+	sq_tail = smp_load_acquire(&hdr_ptr->sq_tail);
+	while (submitted < to_submit && InstancePtr->sq_head != sq_tail) {
+		// Leave entries queued while the completion queue is full
+		cq_head = smp_load_acquire(&hdr_ptr->cq_head);
+		if (InstancePtr->cq_tail - cq_head >= InstancePtr->cq_entries) {
+			break;
+		}
+
+		// Snapshot the entry: userspace may reuse the slot right away
+		sqe = InstancePtr->sq_ptr[InstancePtr->sq_head &
+					  (InstancePtr->sq_entries - 1)];
+		InstancePtr->sq_head++;
+		smp_store_release(&hdr_ptr->sq_head, InstancePtr->sq_head);
+
+		cqe.user_data = sqe.user_data;
+		cqe.result    = Ring_RunSqe(InstancePtr, &sqe);
+		cqe.reserved  = 0;
+
+		InstancePtr->cq_ptr[InstancePtr->cq_tail &
+				    (InstancePtr->cq_entries - 1)] = cqe;
+		InstancePtr->cq_tail++;
+		smp_store_release(&hdr_ptr->cq_tail, InstancePtr->cq_tail);
+
+		submitted++;
+		cond_resched();
+	}
+
+	mutex_unlock(&InstancePtr->lock);
+
+	if (submitted) {
+		wake_up_interruptible(&InstancePtr->cq_wq);
+	}
+
+	return submitted;
+}
+
+static bool Ring_SqReady(Ring *InstancePtr)
+{
+	RingHeader *hdr_ptr = InstancePtr->hdr_ptr;
+
+	return InstancePtr->sq_head != smp_load_acquire(&hdr_ptr->sq_tail) &&
+	       InstancePtr->cq_tail - smp_load_acquire(&hdr_ptr->cq_head) <
+		       InstancePtr->cq_entries;
+}
+
+static unsigned int Ring_CqReady(Ring *InstancePtr)
+{
+	RingHeader *hdr_ptr = InstancePtr->hdr_ptr;
+
+	return smp_load_acquire(&hdr_ptr->cq_tail) -
+	       READ_ONCE(hdr_ptr->cq_head);
+}
+
+static int Ring_SqPollThread(void *data)
+{
+	Ring *ring_ptr	    = data;
+	RingHeader *hdr_ptr = ring_ptr->hdr_ptr;
+	unsigned long idle_end;
+
+	idle_end = jiffies + msecs_to_jiffies(ring_ptr->sq_idle_ms);
+	while (!kthread_should_stop()) {
+		if (Ring_Submit(ring_ptr, UINT_MAX)) {
+			idle_end = jiffies +
+				   msecs_to_jiffies(ring_ptr->sq_idle_ms);
+			continue;
+		}
+
+		if (time_before(jiffies, idle_end)) {
+			cond_resched();
+			continue;
+		}
+
+		// Idle: ask for a doorbell, then re-check before sleeping
+		WRITE_ONCE(hdr_ptr->sq_flags,
+			   hdr_ptr->sq_flags | SIMPLEAES_RING_NEED_WAKEUP);
+		smp_mb();
+
+		// Entries left queued behind a full completion queue go as
+		// soon as userspace reaps: it only moves cq_head, so look at it
+		// every tick until then
+		if (ring_ptr->sq_head != smp_load_acquire(&hdr_ptr->sq_tail)) {
+			wait_event_interruptible_timeout(
+				ring_ptr->sqpoll_wq,
+				kthread_should_stop() || Ring_SqReady(ring_ptr),
+				1);
+		} else {
+			wait_event_interruptible(ring_ptr->sqpoll_wq,
+						 kthread_should_stop() ||
+							 Ring_SqReady(ring_ptr));
+		}
+
+		WRITE_ONCE(hdr_ptr->sq_flags,
+			   hdr_ptr->sq_flags & ~SIMPLEAES_RING_NEED_WAKEUP);
+		idle_end = jiffies + msecs_to_jiffies(ring_ptr->sq_idle_ms);
+	}
+
+	return 0;
+}
+
+static int Ring_Enter(Ring *InstancePtr, IOCTL_RingEnter *EnterPtr)
+{
+	int ret;
+
+	// The wait could never end: at most cq_entries completions are posted
+	// before userspace reaps
+	if ((EnterPtr->flags & SIMPLEAES_ENTER_GETEVENTS) &&
+	    EnterPtr->min_complete > InstancePtr->cq_entries) {
+		EnterPtr->submitted = 0;
+		return -EINVAL;
+	}
+
+	if (InstancePtr->sqpoll_task) {
+		EnterPtr->submitted = 0;
+		// Reaping may have made room for entries the thread left queued
+		if ((EnterPtr->flags & SIMPLEAES_ENTER_SQ_WAKEUP) ||
+		    Ring_SqReady(InstancePtr)) {
+			wake_up_interruptible(&InstancePtr->sqpoll_wq);
+		}
+	} else {
+		EnterPtr->submitted =
+			Ring_Submit(InstancePtr, EnterPtr->to_submit);
+	}
+
+	if (EnterPtr->flags & SIMPLEAES_ENTER_GETEVENTS) {
+		ret = wait_event_interruptible(
+			InstancePtr->cq_wq,
+			Ring_CqReady(InstancePtr) >= EnterPtr->min_complete);
+		if (ret) {
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+static void Ring_DeInit(Ring *InstancePtr)
+{
+	struct device *dev_ptr =
+		&InstancePtr->file_ptr->simpleaes_ptr->pdev_ptr->dev;
+
+	if (InstancePtr->sqpoll_task) {
+		kthread_stop(InstancePtr->sqpoll_task);
+	}
+
+	dma_free_coherent(dev_ptr, InstancePtr->region_size,
+			  InstancePtr->region.cpu_addr,
+			  InstancePtr->region.bus_addr);
+	atomic64_sub(InstancePtr->region_size, &simpleaes_ring_mem);
+	mutex_destroy(&InstancePtr->lock);
+}
+
+// Crypto API (skcipher) provider
+
+// The algorithms are global: requests are spread over the attached engines.
+// Called with simpleaes_devices_mutex held.
+static int SimpleAES_RegisterAlgs(void)
+{
+	unsigned int i;
+	int ret = 0;
+
+	for (i = 0; i < ARRAY_SIZE(simpleaes_algs); i++) {
+		struct skcipher_alg *alg_ptr = &simpleaes_algs[i].alg;
+
+		alg_ptr->base.cra_priority  = crypto_priority;
+		alg_ptr->base.cra_flags	    = CRYPTO_ALG_ASYNC |
+					      CRYPTO_ALG_KERN_DRIVER_ONLY |
+					      CRYPTO_ALG_NEED_FALLBACK;
+		alg_ptr->base.cra_ctxsize   = sizeof(SkcipherCtx);
+		alg_ptr->base.cra_alignmask = 0;
+		alg_ptr->base.cra_module    = THIS_MODULE;
+		alg_ptr->init		    = simpleaes_skcipher_init;
+		alg_ptr->exit		    = simpleaes_skcipher_exit;
+		alg_ptr->setkey		    = simpleaes_skcipher_setkey;
+		alg_ptr->encrypt	    = simpleaes_skcipher_encrypt;
+		alg_ptr->decrypt	    = simpleaes_skcipher_decrypt;
+
+		// Runs the crypto manager self-tests against the engine
+		ret = crypto_register_skcipher(alg_ptr);
+		if (ret) {
+			goto __simpleaes_registeralgs_undo_res1;
+		}
+	}
+
+	simpleaes_algs_registered = true;
+	return 0;
+
+__simpleaes_registeralgs_undo_res1:
+	while (i--) {
+		crypto_unregister_skcipher(&simpleaes_algs[i].alg);
+	}
+
+	return ret;
+}
+
+// Called with simpleaes_devices_mutex held
+static void SimpleAES_UnregisterAlgs(void)
+{
+	unsigned int i;
+
+	if (!simpleaes_algs_registered) {
+		return;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(simpleaes_algs); i++) {
+		crypto_unregister_skcipher(&simpleaes_algs[i].alg);
+	}
+	simpleaes_algs_registered = false;
+}
+
+static int simpleaes_skcipher_init(struct crypto_skcipher *tfm)
+{
+	SkcipherCtx *ctx = crypto_skcipher_ctx(tfm);
+	const char *name = crypto_tfm_alg_name(crypto_skcipher_tfm(tfm));
+
+	// Software implementation for the key lengths the engine lacks
+	ctx->fallback = crypto_alloc_skcipher(name, 0,
+					      CRYPTO_ALG_NEED_FALLBACK);
+	if (IS_ERR(ctx->fallback)) {
+		return PTR_ERR(ctx->fallback);
+	}
+
+	crypto_skcipher_set_reqsize(tfm, sizeof(SkcipherReqCtx) +
+		crypto_skcipher_reqsize(ctx->fallback));
+
+	ctx->enginectx.op.prepare_request   = NULL;
+	ctx->enginectx.op.unprepare_request = NULL;
+	ctx->enginectx.op.do_one_request    = simpleaes_skcipher_do_one_request;
+
+	return 0;
+}
+
+static void simpleaes_skcipher_exit(struct crypto_skcipher *tfm)
+{
+	SkcipherCtx *ctx = crypto_skcipher_ctx(tfm);
+
+	memzero_explicit(ctx->key, sizeof(ctx->key));
+	crypto_free_skcipher(ctx->fallback);
+}
+
+static int simpleaes_skcipher_setkey(struct crypto_skcipher *tfm,
+				     const u8 *key, unsigned int keylen)
+{
+	SkcipherCtx *ctx = crypto_skcipher_ctx(tfm);
+	int ret;
+
+	ret = aes_check_keylen(keylen);
+	if (ret) {
+		return ret;
+	}
+
+	// The engine implements AES-128 only
+	ctx->use_fallback = keylen != AES_KEYSIZE_128;
+	if (!ctx->use_fallback) {
+		memcpy(ctx->key, key, AES_KEYSIZE_128);
+	}
+
+	crypto_skcipher_clear_flags(ctx->fallback, CRYPTO_TFM_REQ_MASK);
+	crypto_skcipher_set_flags(ctx->fallback,
+				  crypto_skcipher_get_flags(tfm) &
+					  CRYPTO_TFM_REQ_MASK);
+	return crypto_skcipher_setkey(ctx->fallback, key, keylen);
+}
+
+static int simpleaes_skcipher_queue(struct skcipher_request *req,
+				    ORG_SIMPLE_OpMode mode)
+{
+	struct crypto_skcipher *tfm = crypto_skcipher_reqtfm(req);
+	SkcipherCtx *ctx	    = crypto_skcipher_ctx(tfm);
+	SkcipherReqCtx *rctx	    = skcipher_request_ctx(req);
+	SkcipherAlg *alg_ptr =
+		container_of(crypto_skcipher_alg(tfm), SkcipherAlg, alg);
+	int ret;
+
+	if (!req->cryptlen) {
+		return 0;
+	}
+
+	if (alg_ptr->chain != ORG_SIMPLE_CHAIN_CTR &&
+	    !IS_ALIGNED(req->cryptlen, AES_BLOCK_SIZE)) {
+		return -EINVAL;
+	}
+
+	if (ctx->use_fallback) {
+		return simpleaes_skcipher_fallback(req, mode);
+	}
+
+	// The engine keeps its queue depth until the request is finished
+	rctx->mode	    = mode;
+	rctx->simpleaes_ptr = SimpleAES_AcquireIdle();
+	if (!rctx->simpleaes_ptr) {
+		return simpleaes_skcipher_fallback(req, mode);
+	}
+
+	if (SimpleAES_PreferCpu(rctx->simpleaes_ptr,
+				DIV_ROUND_UP(req->cryptlen, AES_BLOCK_SIZE))) {
+		SimpleAES_StatsCpu(rctx->simpleaes_ptr,
+				   DIV_ROUND_UP(req->cryptlen, AES_BLOCK_SIZE));
+		SimpleAES_Release(rctx->simpleaes_ptr);
+		return simpleaes_skcipher_fallback(req, mode);
+	}
+
+	ret = crypto_transfer_skcipher_request_to_engine(
+		rctx->simpleaes_ptr->crypto_engine, req);
+	if (ret != -EINPROGRESS && ret != -EBUSY) {
+		SimpleAES_Release(rctx->simpleaes_ptr);
+	}
+	return ret;
+}
+
+// The software skcipher is keyed alongside the engine key on every setkey.
+// It is the best CPU implementation the Crypto API has, usually SIMD.
+static int simpleaes_skcipher_fallback(struct skcipher_request *req,
+				       ORG_SIMPLE_OpMode mode)
+{
+	struct crypto_skcipher *tfm = crypto_skcipher_reqtfm(req);
+	SkcipherCtx *ctx	    = crypto_skcipher_ctx(tfm);
+	SkcipherReqCtx *rctx	    = skcipher_request_ctx(req);
+
+	skcipher_request_set_tfm(&rctx->fallback_req, ctx->fallback);
+	skcipher_request_set_callback(&rctx->fallback_req, req->base.flags,
+				      req->base.complete, req->base.data);
+	skcipher_request_set_crypt(&rctx->fallback_req, req->src, req->dst,
+				   req->cryptlen, req->iv);
+	return mode == ORG_SIMPLE_OPMODE_ENCRYPT ?
+		       crypto_skcipher_encrypt(&rctx->fallback_req) :
+		       crypto_skcipher_decrypt(&rctx->fallback_req);
+}
+
+static int simpleaes_skcipher_encrypt(struct skcipher_request *req)
+{
+	return simpleaes_skcipher_queue(req, ORG_SIMPLE_OPMODE_ENCRYPT);
+}
+
+static int simpleaes_skcipher_decrypt(struct skcipher_request *req)
+{
+	return simpleaes_skcipher_queue(req, ORG_SIMPLE_OPMODE_DECRYPT);
+}
+
+// Runs in the crypto engine's kthread, one request at a time per device
+static int simpleaes_skcipher_do_one_request(struct crypto_engine *engine,
+					     void *areq)
+{
+	struct skcipher_request *req =
+		container_of(areq, struct skcipher_request, base);
+	struct crypto_skcipher *tfm = crypto_skcipher_reqtfm(req);
+	SkcipherCtx *ctx	    = crypto_skcipher_ctx(tfm);
+	SkcipherReqCtx *rctx	    = skcipher_request_ctx(req);
+	SkcipherAlg *alg_ptr =
+		container_of(crypto_skcipher_alg(tfm), SkcipherAlg, alg);
+
+	Result_BoolError err_boolerror;
+	int ret = 0;
+
+	err_boolerror = SimpleAES_RunChainSg(
+		rctx->simpleaes_ptr, rctx->mode,
+		min_t(unsigned int, completion_mode,
+		      ORG_SIMPLE_COMPLETION_HYBRID),
+		&rctx->simpleaes_ptr->crypto_client, alg_ptr->chain, ctx->key,
+		req->iv, req->src, req->dst, req->cryptlen);
+	if (err_boolerror.variant == RESULT_ERR) {
+		ret = -EIO;
+	}
+	SimpleAES_Release(rctx->simpleaes_ptr);
+
+	crypto_finalize_skcipher_request(engine, req, ret);
+	return 0;
+}
+
+// Sysfs attributes
+
+static ssize_t pool_hits_show(struct device *dev, struct device_attribute *attr,
+			      char *buf)
+{
+	SimpleAES *simpleaes_ptr = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%lld\n",
+			  atomic64_read(&simpleaes_ptr->buf_pool.hits));
+}
+static DEVICE_ATTR_RO(pool_hits);
+
+static ssize_t pool_misses_show(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	SimpleAES *simpleaes_ptr = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%lld\n",
+			  atomic64_read(&simpleaes_ptr->buf_pool.misses));
+}
+static DEVICE_ATTR_RO(pool_misses);
+
+static ssize_t pool_size_show(struct device *dev,
+			      struct device_attribute *attr, char *buf)
+{
+	SimpleAES *simpleaes_ptr = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%d\n",
+			  atomic_read(&simpleaes_ptr->buf_pool.depth));
+}
+static DEVICE_ATTR_RO(pool_size);
+
+static ssize_t pool_dma_show(struct device *dev, struct device_attribute *attr,
+			     char *buf)
+{
+	SimpleAES *simpleaes_ptr = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%s\n",
+			  simpleaes_ptr->buf_pool.streaming ? "streaming" :
+							      "coherent");
+}
+static DEVICE_ATTR_RO(pool_dma);
+
+static ssize_t zerocopy_batches_show(struct device *dev,
+				     struct device_attribute *attr, char *buf)
+{
+	SimpleAES *simpleaes_ptr = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%lld\n",
+			  atomic64_read(&simpleaes_ptr->zerocopy_batches));
+}
+static DEVICE_ATTR_RO(zerocopy_batches);
+
+static ssize_t queue_depth_show(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	SimpleAES *simpleaes_ptr = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%d\n",
+			  atomic_read(&simpleaes_ptr->queue_depth));
+}
+static DEVICE_ATTR_RO(queue_depth);
+
+static ssize_t pipeline_blocks_show(struct device *dev,
+				    struct device_attribute *attr, char *buf)
+{
+	SimpleAES *simpleaes_ptr = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%lld\n",
+			  atomic64_read(&simpleaes_ptr->pipeline_blocks));
+}
+static DEVICE_ATTR_RO(pipeline_blocks);
+
+// Percentage of the time pipelined batches held the engine that a block was
+// in flight, from its issue until the interrupt handler took it. Interrupt
+// latency counts as in flight, so this is only an upper bound on how busy the
+// engine was and can read far above it when interrupts are slow.
+static ssize_t pipeline_inflight_pct_show(struct device *dev,
+					  struct device_attribute *attr,
+					  char *buf)
+{
+	SimpleAES *simpleaes_ptr = dev_get_drvdata(dev);
+	u64 busy_ns = atomic64_read(&simpleaes_ptr->pipeline_busy_ns);
+	u64 span_ns = atomic64_read(&simpleaes_ptr->pipeline_span_ns);
+
+	return sysfs_emit(buf, "%llu\n",
+			  span_ns ? div64_u64(busy_ns * 100, span_ns) : 0);
+}
+static DEVICE_ATTR_RO(pipeline_inflight_pct);
+
+// Descriptor ring totals: "<blocks> <descriptors> <doorbells> <interrupts>"
+static ssize_t ring_stats_show(struct device *dev,
+			       struct device_attribute *attr, char *buf)
+{
+	SimpleAES *simpleaes_ptr = dev_get_drvdata(dev);
+	DescRing *ring_ptr	 = simpleaes_ptr->ring_ptr;
+
+	if (!ring_ptr) {
+		return sysfs_emit(buf, "0 0 0 0\n");
+	}
+
+	return sysfs_emit(buf, "%lld %lld %lld %lld\n",
+			  atomic64_read(&ring_ptr->blocks),
+			  atomic64_read(&ring_ptr->descs),
+			  atomic64_read(&ring_ptr->doorbells),
+			  atomic64_read(&ring_ptr->wakeups));
+}
+static DEVICE_ATTR_RO(ring_stats);
+
+// Each latency file reports "<p50> <p99>" in nanoseconds
+static ssize_t SimpleAES_ShowLatency(struct device *dev, char *buf,
+				     ORG_SIMPLE_CompletionMode completion)
+{
+	SimpleAES *simpleaes_ptr = dev_get_drvdata(dev);
+	u64 p50, p99;
+
+	LatencyStats_Percentiles(&simpleaes_ptr->latency[completion], &p50,
+				 &p99);
+	return sysfs_emit(buf, "%llu %llu\n", p50, p99);
+}
+
+static ssize_t latency_irq_show(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	return SimpleAES_ShowLatency(dev, buf, ORG_SIMPLE_COMPLETION_IRQ);
+}
+static DEVICE_ATTR_RO(latency_irq);
+
+static ssize_t latency_poll_show(struct device *dev,
+				 struct device_attribute *attr, char *buf)
+{
+	return SimpleAES_ShowLatency(dev, buf, ORG_SIMPLE_COMPLETION_POLL);
+}
+static DEVICE_ATTR_RO(latency_poll);
+
+static ssize_t latency_hybrid_show(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	return SimpleAES_ShowLatency(dev, buf, ORG_SIMPLE_COMPLETION_HYBRID);
+}
+static DEVICE_ATTR_RO(latency_hybrid);
+
+// "<ops> <alloc> <copy_in> <queue> <mmio> <engine> <wakeup> <copy_out>": the
+// number of single-block engine operations and the total nanoseconds they
+// spent in each phase (ORG_SIMPLE_OpPhase order)
+static ssize_t op_phases_show(struct device *dev, struct device_attribute *attr,
+			      char *buf)
+{
+	SimpleAES *simpleaes_ptr = dev_get_drvdata(dev);
+	OpPhaseStats *phases_ptr = &simpleaes_ptr->op_phases;
+	unsigned int i;
+	int len;
+
+	len = sysfs_emit(buf, "%lld", atomic64_read(&phases_ptr->ops));
+	for (i = 0; i < ORG_SIMPLE_OP_PHASES; i++) {
+		len += sysfs_emit_at(buf, len, " %lld",
+				     atomic64_read(&phases_ptr->phase_ns[i]));
+	}
+	len += sysfs_emit_at(buf, len, "\n");
+	return len;
+}
+static DEVICE_ATTR_RO(op_phases);
+
+static ssize_t poll_average_ns_show(struct device *dev,
+				    struct device_attribute *attr, char *buf)
+{
+	SimpleAES *simpleaes_ptr = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%llu\n",
+			  READ_ONCE(simpleaes_ptr->poll_ewma_ns));
+}
+static DEVICE_ATTR_RO(poll_average_ns);
+
+static ssize_t cpu_requests_show(struct device *dev,
+				 struct device_attribute *attr, char *buf)
+{
+	SimpleAES *simpleaes_ptr = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%lld\n",
+			  atomic64_read(&simpleaes_ptr->cpu_requests));
+}
+static DEVICE_ATTR_RO(cpu_requests);
+
+static ssize_t engine_faulted_show(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	SimpleAES *simpleaes_ptr = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%d\n",
+			  READ_ONCE(simpleaes_ptr->engine_faulted));
+}
+static DEVICE_ATTR_RO(engine_faulted);
+
+static ssize_t irq_wakeups_show(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	SimpleAES *simpleaes_ptr = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%lld\n",
+			  atomic64_read(&simpleaes_ptr->irq_wakeups));
+}
+static DEVICE_ATTR_RO(irq_wakeups);
+
+static ssize_t irq_completions_show(struct device *dev,
+				    struct device_attribute *attr, char *buf)
+{
+	SimpleAES *simpleaes_ptr = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%lld\n",
+			  atomic64_read(&simpleaes_ptr->irq_completions));
+}
+static DEVICE_ATTR_RO(irq_completions);
+
+// Coalescing tunables take effect at the next interrupt thread wakeup
+static ssize_t SimpleAES_StoreTunable(const char *buf, size_t count,
+				      unsigned int *ValPtr, unsigned int min,
+				      unsigned int max)
+{
+	unsigned int val;
+	int ret;
+
+	ret = kstrtouint(buf, 0, &val);
+	if (ret) {
+		return ret;
+	}
+	if (val < min || val > max) {
+		return -EINVAL;
+	}
+
+	WRITE_ONCE(*ValPtr, val);
+	return count;
+}
+
+static ssize_t irq_budget_show(struct device *dev,
+			       struct device_attribute *attr, char *buf)
+{
+	SimpleAES *simpleaes_ptr = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%u\n",
+			  READ_ONCE(simpleaes_ptr->irq_coalesce.budget));
+}
+
+static ssize_t irq_budget_store(struct device *dev,
+				struct device_attribute *attr,
+				const char *buf, size_t count)
+{
+	SimpleAES *simpleaes_ptr = dev_get_drvdata(dev);
+
+	return SimpleAES_StoreTunable(buf, count,
+				      &simpleaes_ptr->irq_coalesce.budget, 1,
+				      UINT_MAX);
+}
+static DEVICE_ATTR_RW(irq_budget);
+
+static ssize_t irq_coalesce_frames_show(struct device *dev,
+					struct device_attribute *attr,
+					char *buf)
+{
+	SimpleAES *simpleaes_ptr = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%u\n",
+			  READ_ONCE(simpleaes_ptr->irq_coalesce.frames));
+}
+
+static ssize_t irq_coalesce_frames_store(struct device *dev,
+					 struct device_attribute *attr,
+					 const char *buf, size_t count)
+{
+	SimpleAES *simpleaes_ptr = dev_get_drvdata(dev);
+
+	return SimpleAES_StoreTunable(buf, count,
+				      &simpleaes_ptr->irq_coalesce.frames, 0,
+				      UINT_MAX);
+}
+static DEVICE_ATTR_RW(irq_coalesce_frames);
+
+static ssize_t irq_coalesce_usecs_show(struct device *dev,
+				       struct device_attribute *attr,
+				       char *buf)
+{
+	SimpleAES *simpleaes_ptr = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%u\n",
+			  READ_ONCE(simpleaes_ptr->irq_coalesce.usecs));
+}
+
+// 0 turns polling off: every wakeup re-arms the interrupt right away
+static ssize_t irq_coalesce_usecs_store(struct device *dev,
+					struct device_attribute *attr,
+					const char *buf, size_t count)
+{
+	SimpleAES *simpleaes_ptr = dev_get_drvdata(dev);
+
+	return SimpleAES_StoreTunable(buf, count,
+				      &simpleaes_ptr->irq_coalesce.usecs, 0,
+				      ORG_SIMPLE_IRQ_COALESCE_MAX_USECS);
+}
+static DEVICE_ATTR_RW(irq_coalesce_usecs);
+
+static ssize_t key_hits_show(struct device *dev, struct device_attribute *attr,
+			     char *buf)
+{
+	SimpleAES *simpleaes_ptr = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%lld\n",
+			  atomic64_read(&simpleaes_ptr->key_table.hits));
+}
+static DEVICE_ATTR_RO(key_hits);
+
+static ssize_t key_misses_show(struct device *dev,
+			       struct device_attribute *attr, char *buf)
+{
+	SimpleAES *simpleaes_ptr = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%lld\n",
+			  atomic64_read(&simpleaes_ptr->key_table.misses));
+}
+static DEVICE_ATTR_RO(key_misses);
+
+static ssize_t key_evictions_show(struct device *dev,
+				  struct device_attribute *attr, char *buf)
+{
+	SimpleAES *simpleaes_ptr = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%lld\n",
+			  atomic64_read(&simpleaes_ptr->key_table.evictions));
+}
+static DEVICE_ATTR_RO(key_evictions);
+
+static struct attribute *simpleaes_attrs[] = {
+	&dev_attr_pool_hits.attr,
+	&dev_attr_pool_misses.attr,
+	&dev_attr_pool_size.attr,
+	&dev_attr_pool_dma.attr,
+	&dev_attr_zerocopy_batches.attr,
+	&dev_attr_queue_depth.attr,
+	&dev_attr_pipeline_blocks.attr,
+	&dev_attr_pipeline_inflight_pct.attr,
+	&dev_attr_ring_stats.attr,
+	&dev_attr_latency_irq.attr,
+	&dev_attr_latency_poll.attr,
+	&dev_attr_latency_hybrid.attr,
+	&dev_attr_op_phases.attr,
+	&dev_attr_poll_average_ns.attr,
+	&dev_attr_cpu_requests.attr,
+	&dev_attr_engine_faulted.attr,
+	&dev_attr_irq_wakeups.attr,
+	&dev_attr_irq_completions.attr,
+	&dev_attr_irq_budget.attr,
+	&dev_attr_irq_coalesce_frames.attr,
+	&dev_attr_irq_coalesce_usecs.attr,
+	&dev_attr_key_hits.attr,
+	&dev_attr_key_misses.attr,
+	&dev_attr_key_evictions.attr,
+	NULL,
+};
+ATTRIBUTE_GROUPS(simpleaes);
+
+// debugfs files (per-CPU statistics summed on read)
+
+static const char *const simpleaes_error_names[ORG_SIMPLE_ERRORS] = {
+	"ok", "key", "input", "output", "busy", "other", "timeout",
+};
+
+static const char *const simpleaes_hist_names[ORG_SIMPLE_HISTS] = {
+	"alloc",    "copy_in", "queue",	       "mmio",	      "engine", "wakeup",
+	"copy_out", "op",      "regfile_wait", "queue_depth", "reset",
+};
+
+static int simpleaes_stats_show(struct seq_file *seq_ptr, void *data)
+{
+	SimpleAES *simpleaes_ptr = seq_ptr->private;
+	SimpleAESStats *sum_ptr;
+	unsigned int i;
+
+	sum_ptr = kmalloc(sizeof(*sum_ptr), GFP_KERNEL);
+	if (!sum_ptr) {
+		return -ENOMEM;
+	}
+	SimpleAES_StatsSum(simpleaes_ptr, sum_ptr);
+
+	seq_printf(seq_ptr, "ops %llu\n", sum_ptr->ops);
+	seq_printf(seq_ptr, "bytes %llu\n", sum_ptr->bytes);
+	for (i = 0; i < ORG_SIMPLE_ERRORS; i++) {
+		seq_printf(seq_ptr, "errors_%s %llu\n",
+			   simpleaes_error_names[i], sum_ptr->errors[i]);
+	}
+	seq_printf(seq_ptr, "cpu_ops %llu\n", sum_ptr->cpu_ops);
+	seq_printf(seq_ptr, "cpu_bytes %llu\n", sum_ptr->cpu_bytes);
+	seq_printf(seq_ptr, "busy %llu\n", sum_ptr->busy);
+	seq_printf(seq_ptr, "regfile_contended %llu\n",
+		   sum_ptr->lock_contended);
+	seq_printf(seq_ptr, "timeouts %llu\n", sum_ptr->timeouts);
+	seq_printf(seq_ptr, "resets %llu\n", sum_ptr->resets);
+	seq_printf(seq_ptr, "requeues %llu\n", sum_ptr->requeues);
+	seq_printf(seq_ptr, "reset_ns %llu\n", sum_ptr->reset_ns);
+	seq_printf(seq_ptr, "queue_depth %d\n",
+		   atomic_read(&simpleaes_ptr->queue_depth));
+	seq_printf(seq_ptr, "sched_waits %llu\n",
+		   READ_ONCE(simpleaes_ptr->sched.waits));
+	seq_printf(seq_ptr, "sched_idle_holds %llu\n",
+		   READ_ONCE(simpleaes_ptr->sched.idle_holds));
+	seq_printf(seq_ptr, "sched_idle_hits %llu\n",
+		   READ_ONCE(simpleaes_ptr->sched.idle_hits));
+
+	kfree(sum_ptr);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(simpleaes_stats);
+
+// One line per histogram: its name, then the count of each log2 bucket
+static int simpleaes_histograms_show(struct seq_file *seq_ptr, void *data)
+{
+	SimpleAES *simpleaes_ptr = seq_ptr->private;
+	SimpleAESStats *sum_ptr;
+	unsigned int i, j;
+
+	sum_ptr = kmalloc(sizeof(*sum_ptr), GFP_KERNEL);
+	if (!sum_ptr) {
+		return -ENOMEM;
+	}
+	SimpleAES_StatsSum(simpleaes_ptr, sum_ptr);
+
+	seq_puts(seq_ptr, "# bucket b: values in [2^(b-1), 2^b), ns or ops\n");
+	for (i = 0; i < ORG_SIMPLE_HISTS; i++) {
+		seq_puts(seq_ptr, simpleaes_hist_names[i]);
+		for (j = 0; j < ORG_SIMPLE_HIST_BUCKETS; j++) {
+			seq_printf(seq_ptr, " %llu", sum_ptr->hist[i][j]);
+		}
+		seq_putc(seq_ptr, '\n');
+	}
+
+	kfree(sum_ptr);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(simpleaes_histograms);
+
+// Copy bandwidth into (copy-in) and out of (copy-out) coherent and
+// streaming DMA buffers, for the sizes the driver copies. Runs on read.
+static int simpleaes_dma_bench_show(struct seq_file *seq_ptr, void *data)
+{
+	static const size_t sizes[] = {
+		ORG_SIMPLE_BLOCK_SIZE, sizeof(HwOpRecord), 1024, PAGE_SIZE,
+		16 * PAGE_SIZE,
+	};
+	SimpleAES *simpleaes_ptr = seq_ptr->private;
+	struct device *dev_ptr	 = &simpleaes_ptr->pdev_ptr->dev;
+	u64 in_ns, out_ns, bytes;
+	unsigned int i, mode;
+	int ret;
+
+	seq_printf(seq_ptr, "# records %s\n",
+		   simpleaes_ptr->buf_pool.streaming ? "streaming" :
+						       "coherent");
+	seq_puts(seq_ptr, "# memory bytes copy_in_mb_s copy_out_mb_s\n");
+	for (mode = 0; mode < 2; mode++) {
+		for (i = 0; i < ARRAY_SIZE(sizes); i++) {
+			ret = HwBuffer_CopyBench(dev_ptr, mode, sizes[i],
+						 &in_ns, &out_ns);
+			if (ret) {
+				return ret;
+			}
+
+			// bytes per ns * 1000 is MB/s
+			bytes = max_t(size_t,
+				      ORG_SIMPLE_DMA_BENCH_BYTES / sizes[i],
+				      1) *
+				sizes[i] * 1000;
+			seq_printf(seq_ptr, "%s %zu %llu %llu\n",
+				   mode ? "streaming" : "coherent", sizes[i],
+				   div64_u64(bytes, max(in_ns, 1ULL)),
+				   div64_u64(bytes, max(out_ns, 1ULL)));
+			cond_resched();
+		}
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(simpleaes_dma_bench);
+
+#ifdef SIMPLEAES_MMIO_PROFILE
+// Totals, then one line per call site: function:line register r|w count
+static int simpleaes_mmio_profile_show(struct seq_file *seq_ptr, void *data)
+{
+	SimpleAESMmioSite *site_ptr;
+	unsigned long lock_irq_flags;
+	u64 reads = 0, writes = 0;
+
+	spin_lock_irqsave(&simpleaes_mmio_sites_lock, lock_irq_flags);
+	list_for_each_entry(site_ptr, &simpleaes_mmio_sites, node) {
+		if (site_ptr->write) {
+			writes += atomic64_read(&site_ptr->count);
+		} else {
+			reads += atomic64_read(&site_ptr->count);
+		}
+	}
+	seq_printf(seq_ptr, "reads %llu\nwrites %llu\n", reads, writes);
+	list_for_each_entry(site_ptr, &simpleaes_mmio_sites, node) {
+		seq_printf(seq_ptr, "%s:%u %s %c %lld\n", site_ptr->func,
+			   site_ptr->line, site_ptr->reg,
+			   site_ptr->write ? 'w' : 'r',
+			   atomic64_read(&site_ptr->count));
+	}
+	spin_unlock_irqrestore(&simpleaes_mmio_sites_lock, lock_irq_flags);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(simpleaes_mmio_profile);
+#endif
+
+// Character device (cdev) callbacks
+
+static int simpleaes_cdev_open(struct inode *inode_ptr, struct file *file_ptr)
+{
+	FileContext *file_ctx;
+	unsigned int i;
+
+	file_ctx = kzalloc(sizeof(FileContext), GFP_KERNEL);
+	if (!file_ctx) {
+		return -ENOMEM;
+	}
+
+	// The aggregate node homes the file on the least loaded engine
+	if (inode_ptr->i_cdev == &simpleaes_aggregate_cdev) {
+		file_ctx->simpleaes_ptr = SimpleAES_AcquireIdle();
+		if (!file_ctx->simpleaes_ptr) {
+			kfree(file_ctx);
+			return -ENODEV;
+		}
+		// Counted before the queue slot goes, so Detach covers the gap
+		atomic_inc(&file_ctx->simpleaes_ptr->open_files);
+		SimpleAES_Release(file_ctx->simpleaes_ptr);
+		file_ctx->aggregate = true;
+	} else {
+		file_ctx->simpleaes_ptr =
+			container_of(inode_ptr->i_cdev, SimpleAES, cdev.cdev);
+		atomic_inc(&file_ctx->simpleaes_ptr->open_files);
+	}
+	mutex_init(&file_ctx->lock);
+	idr_init(&file_ctx->keys);
+	init_rwsem(&file_ctx->bufs_lock);
+	file_ctx->completion = min_t(unsigned int, completion_mode,
+				     ORG_SIMPLE_COMPLETION_HYBRID);
+	for (i = 0; i < ORG_SIMPLE_MAX_DEVICES; i++) {
+		SchedClient_Init(&file_ctx->sched[i], 1);
+	}
+	atomic_set(&file_ctx->sched_queued, 0);
+	init_waitqueue_head(&file_ctx->sched_wq);
+	spin_lock_init(&file_ctx->async_lock);
+	INIT_LIST_HEAD(&file_ctx->async_done);
+	init_waitqueue_head(&file_ctx->async_wq);
+
+	file_ptr->private_data = file_ctx;
+	return 0;
+}
+
+static int simpleaes_cdev_release(struct inode *inode_ptr,
+				  struct file *file_ptr)
+{
+	FileContext *file_ctx	 = file_ptr->private_data;
+	SimpleAES *simpleaes_ptr = file_ctx->simpleaes_ptr;
+	KeyTable *table_ptr	 = &simpleaes_ptr->key_table;
+	AsyncRequest *req_ptr, *tmp_ptr;
+	SimpleAES *engine_ptr;
+	LIST_HEAD(done_list);
+	KeyEntry *key_ptr;
+	int id;
+
+	// In-flight asynchronous requests hold keys and pinned pages
+	wait_event(file_ctx->async_wq, !READ_ONCE(file_ctx->async_running));
+	spin_lock_irq(&file_ctx->async_lock);
+	list_splice_init(&file_ctx->async_done, &done_list);
+	spin_unlock_irq(&file_ctx->async_lock);
+	list_for_each_entry_safe(req_ptr, tmp_ptr, &done_list, node) {
+		list_del(&req_ptr->node);
+		AsyncRequest_Free(req_ptr);
+	}
+	FileContext_SetEventfd(file_ctx, -1);
+
+	// The ring goes first: its SQPOLL thread may still use the keys
+	if (file_ctx->ring_ptr) {
+		Ring_DeInit(file_ctx->ring_ptr);
+		kfree(file_ctx->ring_ptr);
+	}
+
+	// Registered buffers are unmapped and unpinned
+	FileContext_UnregisterBuffers(file_ctx);
+
+	// Registered keys are wiped from both the key table and memory
+	idr_for_each_entry(&file_ctx->keys, key_ptr, id) {
+		KeyTable_Drop(table_ptr, key_ptr);
+		kfree_sensitive(key_ptr);
+	}
+	idr_destroy(&file_ctx->keys);
+
+	// No engine may stay idle waiting for this file's next operation. An
+	// aggregate file can have run on any engine.
+	Scheduler_Detach(&simpleaes_ptr->sched,
+			 &file_ctx->sched[simpleaes_ptr->id]);
+	if (file_ctx->aggregate) {
+		spin_lock(&simpleaes_devices_lock);
+		list_for_each_entry(engine_ptr, &simpleaes_devices, node) {
+			Scheduler_Detach(&engine_ptr->sched,
+					 &file_ctx->sched[engine_ptr->id]);
+		}
+		spin_unlock(&simpleaes_devices_lock);
+	}
+
+	mutex_destroy(&file_ctx->lock);
+	kfree(file_ctx);
+
+	// The engine may be waiting in SimpleAES_remove for its last file
+	if (atomic_dec_and_test(&simpleaes_ptr->open_files)) {
+		wake_up_var(&simpleaes_ptr->open_files);
+	}
+	return 0;
+}
+
+static long simpleaes_cdev_ioctl(struct file *file_ptr, unsigned int cmd,
+				 unsigned long arg)
+{
+	FileContext *file_ctx = file_ptr->private_data;
+	SimpleAES *simpleaes_ptr;
+	bool stateless;
+	long ret;
+
+	// Operations carrying their own key and data can run on any engine
+	stateless = cmd == IOCTL_ENCRYPT || cmd == IOCTL_DECRYPT ||
+		    cmd == IOCTL_ENCRYPT_BATCH || cmd == IOCTL_DECRYPT_BATCH ||
+		    cmd == IOCTL_ENCRYPT_CHAIN || cmd == IOCTL_DECRYPT_CHAIN;
+
+	// Only synchronous engine work counts towards the queue depth
+	if (!stateless && cmd != IOCTL_ENCRYPT_KEYED &&
+	    cmd != IOCTL_DECRYPT_KEYED && cmd != IOCTL_ENCRYPT_FIXED &&
+	    cmd != IOCTL_DECRYPT_FIXED) {
+		return SimpleAES_Ioctl(file_ctx->simpleaes_ptr, file_ctx, cmd,
+				       arg);
+	}
+
+	ret = FileContext_Admit(file_ctx, file_ptr->f_flags & O_NONBLOCK);
+	if (ret) {
+		return ret;
+	}
+
+	simpleaes_ptr = FileContext_Engine(file_ctx, stateless);
+	if (!simpleaes_ptr) {
+		FileContext_Retire(file_ctx);
+		return -ENODEV;
+	}
+
+	ret = SimpleAES_Ioctl(simpleaes_ptr, file_ctx, cmd, arg);
+
+	SimpleAES_Release(simpleaes_ptr);
+	FileContext_Retire(file_ctx);
+	return ret;
+}
+
+static long SimpleAES_Ioctl(SimpleAES *InstancePtr, FileContext *FilePtr,
+			    unsigned int cmd, unsigned long arg)
+{
+	IOCTL_Data data;
+	IOCTL_BatchData batch;
+	IOCTL_ChainData chain;
+	IOCTL_KeyData key;
+	IOCTL_KeyedData keyed;
+	IOCTL_RingSetup ring_setup;
+	IOCTL_RingEnter ring_enter;
+	IOCTL_BufferSet buf_set;
+	IOCTL_FixedData fixed;
+	IOCTL_CompletionData completion;
+	IOCTL_AsyncSubmit submit;
+	IOCTL_EventfdData efd;
+	IOCTL_WeightData weight;
+	Result_BoolError err_boolerror;
+	Ring *ring_ptr;
+	unsigned int i;
+	int ret;
+	FileContext *file_ctx	 = FilePtr;
+	SimpleAES *simpleaes_ptr = InstancePtr;
+
+	switch (cmd) {
+	case IOCTL_ENCRYPT:
+		if (copy_from_user((void *)&data, (void *)arg, sizeof(data))) {
+			return -EFAULT;
+		}
+		err_boolerror = SimpleAES_Encrypt(simpleaes_ptr, file_ctx,
+						  data.key_ptr, data.i_data_ptr,
+						  data.o_data_ptr);
+		if (err_boolerror.variant == RESULT_ERR) {
+			return -EIO;
+		}
+		break;
+	case IOCTL_DECRYPT:
+		if (copy_from_user((void *)&data, (void *)arg, sizeof(data))) {
+			return -EFAULT;
+		}
+		err_boolerror = SimpleAES_Decrypt(simpleaes_ptr, file_ctx,
+						  data.key_ptr, data.i_data_ptr,
+						  data.o_data_ptr);
+		if (err_boolerror.variant == RESULT_ERR) {
+			return -EIO;
+		}
+		break;
+	case IOCTL_ENCRYPT_BATCH:
+	case IOCTL_DECRYPT_BATCH:
+		if (copy_from_user((void *)&batch, (void *)arg,
+				   sizeof(batch))) {
+			return -EFAULT;
+		}
+		if (batch.num_blocks > ORG_SIMPLE_BATCH_MAX_BLOCKS) {
+			return -E2BIG;
+		}
+		if (cmd == IOCTL_ENCRYPT_BATCH) {
+			ret = SimpleAES_EncryptBatch(simpleaes_ptr, file_ctx,
+						     &batch);
+		} else {
+			ret = SimpleAES_DecryptBatch(simpleaes_ptr, file_ctx,
+						     &batch);
+		}
+		// Progress is reported even when the batch stopped early
+		if (copy_to_user((void *)arg, (void *)&batch, sizeof(batch))) {
+			return -EFAULT;
+		}
+		return ret;
+	case IOCTL_ENCRYPT_CHAIN:
+	case IOCTL_DECRYPT_CHAIN:
+		if (copy_from_user((void *)&chain, (void *)arg,
+				   sizeof(chain))) {
+			return -EFAULT;
+		}
+		if (chain.chain > ORG_SIMPLE_CHAIN_XTS ||
+		    chain.length > ORG_SIMPLE_CHAIN_MAX_LEN) {
+			return -EINVAL;
+		}
+		if (chain.chain != ORG_SIMPLE_CHAIN_CTR &&
+		    !IS_ALIGNED(chain.length, ORG_SIMPLE_BLOCK_SIZE)) {
+			return -EINVAL;
+		}
+		if (cmd == IOCTL_ENCRYPT_CHAIN) {
+			err_boolerror = SimpleAES_EncryptChain(
+				simpleaes_ptr, file_ctx, &chain);
+		} else {
+			err_boolerror = SimpleAES_DecryptChain(
+				simpleaes_ptr, file_ctx, &chain);
+		}
+		if (err_boolerror.variant == RESULT_ERR) {
+			return -EIO;
+		}
+		if (copy_to_user((void *)arg, (void *)&chain, sizeof(chain))) {
+			return -EFAULT;
+		}
+		break;
+	case IOCTL_SET_KEY:
+		if (copy_from_user((void *)&key, (void *)arg, sizeof(key))) {
+			return -EFAULT;
+		}
+		ret = FileContext_SetKey(file_ctx, key.key_ptr, &key.handle);
+		if (ret) {
+			return ret;
+		}
+		if (copy_to_user((void *)arg, (void *)&key, sizeof(key))) {
+			FileContext_ClearKey(file_ctx, key.handle);
+			return -EFAULT;
+		}
+		break;
+	case IOCTL_CLEAR_KEY:
+		if (copy_from_user((void *)&key, (void *)arg, sizeof(key))) {
+			return -EFAULT;
+		}
+		return FileContext_ClearKey(file_ctx, key.handle);
+	case IOCTL_ENCRYPT_KEYED:
+	case IOCTL_DECRYPT_KEYED:
+		if (copy_from_user((void *)&keyed, (void *)arg,
+				   sizeof(keyed))) {
+			return -EFAULT;
+		}
+		if (cmd == IOCTL_ENCRYPT_KEYED) {
+			err_boolerror = SimpleAES_EncryptKeyed(
+				simpleaes_ptr, file_ctx, &keyed);
+		} else {
+			err_boolerror = SimpleAES_DecryptKeyed(
+				simpleaes_ptr, file_ctx, &keyed);
+		}
+		if (err_boolerror.variant == RESULT_ERR) {
+			switch (err_boolerror.value.err) {
+			case ERROR_KEY:
+				return -ENOENT;
+			case ERROR_BUSY:
+				return -EBUSY;
+			default:
+				return -EIO;
+			}
+		}
+		break;
+	case IOCTL_RING_SETUP:
+		if (copy_from_user((void *)&ring_setup, (void *)arg,
+				   sizeof(ring_setup))) {
+			return -EFAULT;
+		}
+		ring_ptr = kzalloc(sizeof(Ring), GFP_KERNEL);
+		if (!ring_ptr) {
+			return -ENOMEM;
+		}
+		mutex_lock(&file_ctx->lock);
+		if (file_ctx->ring_ptr) {
+			ret = -EBUSY;
+		} else {
+			ret = Ring_Init(ring_ptr, file_ctx, &ring_setup);
+		}
+		if (ret) {
+			mutex_unlock(&file_ctx->lock);
+			kfree(ring_ptr);
+			return ret;
+		}
+		file_ctx->ring_ptr = ring_ptr;
+		mutex_unlock(&file_ctx->lock);
+		if (copy_to_user((void *)arg, (void *)&ring_setup,
+				 sizeof(ring_setup))) {
+			return -EFAULT;
+		}
+		break;
+	case IOCTL_RING_ENTER:
+		ring_ptr = READ_ONCE(file_ctx->ring_ptr);
+		if (!ring_ptr) {
+			return -ENXIO;
+		}
+		if (copy_from_user((void *)&ring_enter, (void *)arg,
+				   sizeof(ring_enter))) {
+			return -EFAULT;
+		}
+		ret = Ring_Enter(ring_ptr, &ring_enter);
+		if (copy_to_user((void *)arg, (void *)&ring_enter,
+				 sizeof(ring_enter))) {
+			return -EFAULT;
+		}
+		return ret;
+	case IOCTL_REGISTER_BUFFERS:
+		if (copy_from_user((void *)&buf_set, (void *)arg,
+				   sizeof(buf_set))) {
+			return -EFAULT;
+		}
+		return FileContext_RegisterBuffers(file_ctx, &buf_set);
+	case IOCTL_UNREGISTER_BUFFERS:
+		FileContext_UnregisterBuffers(file_ctx);
+		break;
+	case IOCTL_ENCRYPT_FIXED:
+	case IOCTL_DECRYPT_FIXED:
+		if (copy_from_user((void *)&fixed, (void *)arg,
+				   sizeof(fixed))) {
+			return -EFAULT;
+		}
+		if (cmd == IOCTL_ENCRYPT_FIXED) {
+			ret = SimpleAES_EncryptFixed(simpleaes_ptr, file_ctx,
+						     &fixed);
+		} else {
+			ret = SimpleAES_DecryptFixed(simpleaes_ptr, file_ctx,
+						     &fixed);
+		}
+		if (put_user(fixed.num_done,
+			     &((IOCTL_FixedData *)arg)->num_done)) {
+			return -EFAULT;
+		}
+		return ret;
+	case IOCTL_SET_COMPLETION:
+		if (copy_from_user((void *)&completion, (void *)arg,
+				   sizeof(completion))) {
+			return -EFAULT;
+		}
+		if (completion.mode > ORG_SIMPLE_COMPLETION_HYBRID) {
+			return -EINVAL;
+		}
+		WRITE_ONCE(file_ctx->completion, completion.mode);
+		break;
+	case IOCTL_SUBMIT:
+		if (copy_from_user((void *)&submit, (void *)arg,
+				   sizeof(submit))) {
+			return -EFAULT;
+		}
+		ret = AsyncRequest_Submit(file_ctx, &submit);
+		if (ret) {
+			return ret;
+		}
+		// The request is queued; the tag is the caller's only handle
+		if (put_user(submit.tag, &((IOCTL_AsyncSubmit *)arg)->tag)) {
+			return -EFAULT;
+		}
+		break;
+	case IOCTL_SET_EVENTFD:
+		if (copy_from_user((void *)&efd, (void *)arg, sizeof(efd))) {
+			return -EFAULT;
+		}
+		return FileContext_SetEventfd(file_ctx, efd.fd);
+	case IOCTL_SET_WEIGHT:
+		if (copy_from_user((void *)&weight, (void *)arg,
+				   sizeof(weight))) {
+			return -EFAULT;
+		}
+		if (!weight.weight ||
+		    weight.weight > ORG_SIMPLE_SCHED_MAX_WEIGHT) {
+			return -EINVAL;
+		}
+		for (i = 0; i < ORG_SIMPLE_MAX_DEVICES; i++) {
+			WRITE_ONCE(file_ctx->sched[i].weight, weight.weight);
+		}
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return 0;
 }
 
-static Result_BoolError SimpleAES_SetMode(SimpleAES *InstancePtr,
-					  ORG_SIMPLE_OpMode mode)
+static int simpleaes_cdev_mmap(struct file *file_ptr,
+			       struct vm_area_struct *vma_ptr)
 {
-	void __iomem *ptr	    = InstancePtr->regfile.ptr;
-	struct spinlock_t *lock_ptr = &InstancePtr->regfile.lock;
-	unsigned long lock_irq_flags;
+	FileContext *file_ctx = file_ptr->private_data;
+	Ring *ring_ptr	      = READ_ONCE(file_ctx->ring_ptr);
+	struct device *dev_ptr = &file_ctx->simpleaes_ptr->pdev_ptr->dev;
+	size_t size	       = vma_ptr->vm_end - vma_ptr->vm_start;
 
-	if (SimpleAES_Busy(InstancePtr)) {
-		return RESULT_BOOLERROR_ERROR(ERROR_BUSY);
+	if (!ring_ptr) {
+		return -ENXIO;
+	}
+	if (vma_ptr->vm_pgoff != 0 || size > ring_ptr->region_size) {
+		return -EINVAL;
 	}
 
-	spin_lock_irqsave(lock_ptr, lock_irq_flags);
-	SIMPLEAES_FIELD_WRITE((u32)mode, OP, CTRL, ptr);
-	SIMPLEAES_FIELD_WRITE(1, IE, CTRL, ptr);
-	spin_unlock_irqrestore(lock_ptr, lock_irq_flags);
-
-	return RESULT_BOOLERROR_BOOL(1);
+	return dma_mmap_coherent(dev_ptr, vma_ptr, ring_ptr->region.cpu_addr,
+				 ring_ptr->region.bus_addr, size);
 }
 
-static Result_BoolError SimpleAES_SetKeyAddr(SimpleAES *InstancePtr, u32 addr)
+static ssize_t simpleaes_cdev_read(struct file *file_ptr, char __user *buf,
+				   size_t count, loff_t *offset)
 {
-	void __iomem *ptr	    = InstancePtr->regfile.ptr;
-	struct spinlock_t *lock_ptr = &InstancePtr->regfile.lock;
-	unsigned long lock_irq_flags;
-
-	spin_lock_irqsave(lock_ptr, lock_irq_flags);
-	SIMPLEAES_REG_WRITE(addr, KAR, ptr);
-	spin_unlock_irqrestore(lock_ptr, lock_irq_flags);
-
-	return RESULT_BOOLERROR_BOOL(1);
-}
+	FileContext *file_ctx = file_ptr->private_data;
+	const size_t cqe_size = sizeof(IOCTL_AsyncCompletion);
 
-static Result_BoolError SimpleAES_SetInputAddr(SimpleAES *InstancePtr, u32 addr)
-{
-	void __iomem *ptr	    = InstancePtr->regfile.ptr;
-	struct spinlock_t *lock_ptr = &InstancePtr->regfile.lock;
 	unsigned long lock_irq_flags;
+	AsyncRequest *req_ptr;
+	ssize_t copied = 0;
+	int ret;
 
-	spin_lock_irqsave(lock_ptr, lock_irq_flags);
-	SIMPLEAES_REG_WRITE(addr, IAR, ptr);
-	spin_unlock_irqrestore(lock_ptr, lock_irq_flags);
+	if (count < cqe_size) {
+		return -EINVAL;
+	}
 
-	return RESULT_BOOLERROR_BOOL(1);
-}
+	// Returns as many completions as fit, waiting only for the first
+	while (copied + cqe_size <= count) {
+		spin_lock_irqsave(&file_ctx->async_lock, lock_irq_flags);
+		req_ptr = list_first_entry_or_null(&file_ctx->async_done,
+						   AsyncRequest, node);
+		if (req_ptr) {
+			list_del(&req_ptr->node);
+			file_ctx->async_outstanding--;
+		}
+		spin_unlock_irqrestore(&file_ctx->async_lock, lock_irq_flags);
 
-static Result_BoolError SimpleAES_SetOutputAddr(SimpleAES *InstancePtr,
-						u32 addr)
-{
-	void __iomem *ptr	    = InstancePtr->regfile.ptr;
-	struct spinlock_t *lock_ptr = &InstancePtr->regfile.lock;
-	unsigned long lock_irq_flags;
+		if (!req_ptr) {
+			if (copied) {
+				break;
+			}
+			if (file_ptr->f_flags & O_NONBLOCK) {
+				return -EAGAIN;
+			}
+			ret = wait_event_interruptible(
+				file_ctx->async_wq,
+				!list_empty(&file_ctx->async_done));
+			if (ret) {
+				return ret;
+			}
+			continue;
+		}
 
-	spin_lock_irqsave(lock_ptr, lock_irq_flags);
-	SIMPLEAES_REG_WRITE(addr, OAR, ptr);
-	spin_unlock_irqrestore(lock_ptr, lock_irq_flags);
+		ret = copy_to_user(buf + copied, &req_ptr->cqe, cqe_size);
+		AsyncRequest_Free(req_ptr);
+		if (ret) {
+			return copied ? copied : -EFAULT;
+		}
+		copied += cqe_size;
+	}
 
-	return RESULT_BOOLERROR_BOOL(1);
+	// Room for another submission
+	wake_up_interruptible_poll(&file_ctx->async_wq, EPOLLOUT | EPOLLWRNORM);
+	return copied;
 }
 
-static Result_BoolError SimpleAES_RunOp(SimpleAES *InstancePtr,
-					ORG_SIMPLE_OpMode mode, u8 key[],
-					u8 i_data[], u8 o_data[])
+static __poll_t simpleaes_cdev_poll(struct file *file_ptr,
+				    poll_table *wait_ptr)
 {
-	struct device *dev_ptr = &InstancePtr->pdev.dev;
-
-	HwBuffer key_buf, in_buffer, out_buffer;
-	Result_BoolError ret_err_boolerror = RESULT_BOOLERROR_OK(1);
-	Result_BoolError err_boolerror;
-	ORG_SIMPLE_Error notif_val;
-	unsigned long ret_copy;
-
-	key_buf.cpu_addr = dma_alloc_coherent(dev_ptr, ORG_SIMPLE_KD_SIZE,
-					      &key_buf.bus_addr, GFP_KERNEL);
-	if (IS_ERR(key_buf.cpu_addr)) {
-		dev_err(dev_ptr, "failed to allocate buffer for key");
-		ret_err_boolerror = RESULT_BOOLERROR_ERROR(ERROR_KEY);
-		goto __simpleaes_runop_ret;
-	}
-
-	input_buf.cpu_addr = dma_alloc_coherent(
-		dev_ptr, ORG_SIMPLE_KD_SIZE, &input_buf.bus_addr, GFP_KERNEL);
-	if (IS_ERR(input_buf.cpu_addr)) {
-		dev_err(dev_ptr, "failed to allocate buffer for input data");
-		ret_err_boolerror = RESULT_BOOLERROR_ERROR(ERROR_INPUT);
-		goto __simpleaes_runop_undo_res1;
-	}
+	FileContext *file_ctx = file_ptr->private_data;
+	unsigned long lock_irq_flags;
+	__poll_t mask = 0;
 
-	output_buf.cpu_addr = dma_alloc_coherent(
-		dev_ptr, ORG_SIMPLE_KD_SIZE, &output_buf.bus_addr, GFP_KERNEL);
-	if (IS_ERR(output_buf.cpu_addr)) {
-		dev_err(dev_ptr, "failed to allocate buffer for output data");
-		ret_err_boolerror = RESULT_BOOLERROR_ERROR(ERROR_OUTPUT);
-		goto __simpleaes_runop_undo_res2;
-	}
+	poll_wait(file_ptr, &file_ctx->async_wq, wait_ptr);
 
-	err_boolerror = SimpleAES_SetMode(InstancePtr, mode);
-	if (err_boolerror.variant == RESULT_ERR) {
-		dev_err(dev_ptr, "failed to set operation mode");
-		ret_err_boolerror = err_boolerror;
-		goto __simpleaes_runop_undo_res3;
+	spin_lock_irqsave(&file_ctx->async_lock, lock_irq_flags);
+	if (!list_empty(&file_ctx->async_done)) {
+		mask |= EPOLLIN | EPOLLRDNORM;
 	}
-
-	ret_copy = copy_from_user(key_buf.cpu_addr, key, ORG_SIMPLE_KD_SIZE);
-	if (ret_copy) {
-		dev_err("failed to copy key");
-		ret_err_boolerror = RESULT_BOOLERROR_ERROR(ERROR_KEY);
-		goto __simpleaes_runop_undo_res3;
+	if (file_ctx->async_outstanding < ORG_SIMPLE_ASYNC_MAX_OUTSTANDING) {
+		mask |= EPOLLOUT | EPOLLWRNORM;
 	}
+	spin_unlock_irqrestore(&file_ctx->async_lock, lock_irq_flags);
 
-	ret_copy =
-		copy_from_user(input_buf.cpu_addr, i_data, ORG_SIMPLE_KD_SIZE);
-	if (ret_copy) {
-		dev_err("failed to copy input data");
-		ret_err_boolerror = RESULT_BOOLERROR_ERROR(ERROR_INPUT);
-		goto __simpleaes_runop_undo_res3;
-	}
+	return mask;
+}
 
-	err_boolerror =
-		SimpleAES_SetKeyAddr(InstancePtr, (u32)key_buf.bus_addr);
-	if (err_boolerror.variant == RESULT_ERR) {
-		dev_err(dev_ptr, "failed to set key address");
-		ret_err_boolerror = err_boolerror;
-		goto __simpleaes_runop_undo_res3;
-	}
+// Device management
 
-	err_boolerror =
-		SimpleAES_SetInputAddr(InstancePtr, (u32)input_buf.bus_addr);
-	if (err_boolerror.variant == RESULT_ERR) {
-		dev_err(dev_ptr, "failed to set input data address");
-		ret_err_boolerror = err_boolerror;
-		goto __simpleaes_runop_undo_res3;
-	}
+static void SimpleAES_Attach(SimpleAES *InstancePtr)
+{
+	struct device *dev_ptr = &InstancePtr->pdev_ptr->dev;
+	bool first;
 
-	err_boolerror =
-		SimpleAES_SetOutputAddr(InstancePtr, (u32)output_buf.bus_addr);
-	if (err_boolerror.variant == RESULT_ERR) {
-		dev_err(dev_ptr, "failed to set output data address");
-		ret_err_boolerror = err_boolerror;
-		goto __simpleaes_runop_undo_res3;
-	}
+	mutex_lock(&simpleaes_devices_mutex);
 
-	if (Notification_Error_Receive(&InstancePtr->notif, &notif_val)) {
-		dev_err(dev_ptr, "Operation failed");
-		ret_err_boolerror = RESULT_BOOLERROR_ERROR(ERROR_OTHER);
-		goto __simpleaes_runop_undo_res3;
-	}
+	spin_lock(&simpleaes_devices_lock);
+	list_add_tail(&InstancePtr->node, &simpleaes_devices);
+	first = list_is_singular(&simpleaes_devices);
+	spin_unlock(&simpleaes_devices_lock);
 
-	ret_copy =
-		copy_to_user(o_data, output_buf.cpu_addr, ORG_SIMPLE_KD_SIZE);
-	if (ret_copy) {
-		dev_err("failed to copy output data");
-		ret_err_boolerror = RESULT_BOOLERROR_ERROR(ERROR_OUTPUT);
-		goto __simpleaes_runop_undo_res3;
+	// Not fatal: the cdev interface works without the Crypto API
+	if (first && SimpleAES_RegisterAlgs()) {
+		dev_warn(dev_ptr, "Failed to register skcipher algorithms");
 	}
 
-	goto __simpleaes_runop_ret;
+	mutex_unlock(&simpleaes_devices_mutex);
+}
 
-__simpleaes_runop_undo_res3:
-	dma_free_coherent(dev_ptr, ORG_SIMPLE_KD_SIZE, output_buf.cpu_addr,
-			  output_buf.bus_addr);
+// Returns once no operation is queued or running on the engine
+static void SimpleAES_Detach(SimpleAES *InstancePtr)
+{
+	bool last;
 
-__simpleaes_runop_undo_res2:
-	dma_free_coherent(dev_ptr, ORG_SIMPLE_KD_SIZE, input_buf.cpu_addr,
-			  input_buf.bus_addr);
+	mutex_lock(&simpleaes_devices_mutex);
 
-__simpleaes_runop_undo_res1:
-	dma_free_coherent(dev_ptr, ORG_SIMPLE_KD_SIZE, key_buf.cpu_addr,
-			  key_buf.bus_addr);
+	spin_lock(&simpleaes_devices_lock);
+	list_del(&InstancePtr->node);
+	last = list_empty(&simpleaes_devices);
+	spin_unlock(&simpleaes_devices_lock);
 
-__simpleaes_runop_ret:
-	return ret_err_boolerror;
-}
+	if (last) {
+		SimpleAES_UnregisterAlgs();
+	}
 
-// std.Notification<Error>
+	mutex_unlock(&simpleaes_devices_mutex);
 
-static int Notification_Error_Init(Notification_Error *InstancePtr)
-{
-	init_waitqueue_head(&InstancePtr->wq);
-	InstancePtr->flag = 0;
-	return 0;
+	wait_var_event(&InstancePtr->queue_depth,
+		       !atomic_read(&InstancePtr->queue_depth));
 }
 
-static void Notification_Error_Send(Notification_Error *InstancePtr,
-				    ORG_SIMPLE_Error data)
+// Picks the engine with the fewest queued operations and raises its queue
+// depth. The pick moves to the back of the list so that ties rotate.
+static SimpleAES *SimpleAES_AcquireIdle(void)
 {
-	InstancePtr->flag = 1;
-	InstancePtr->data = data;
-	wake_up_interruptible(&InstancePtr->wq);
-}
+	SimpleAES *simpleaes_ptr, *best_ptr = NULL;
+	int depth, best_depth = INT_MAX;
 
-static int Notification_Error_Receive(Notification_Error *InstancePtr,
-				      ORG_SIMPLE_Error *DataPtr)
-{
-	int ret = wait_event_interruptible(InstancePtr->wq,
-					   InstancePtr->flag == 1);
-	if (InstancePtr->flag != 1) {
-		return -EAGAIN;
+	spin_lock(&simpleaes_devices_lock);
+	list_for_each_entry(simpleaes_ptr, &simpleaes_devices, node) {
+		depth = atomic_read(&simpleaes_ptr->queue_depth);
+		if (depth < best_depth) {
+			best_ptr   = simpleaes_ptr;
+			best_depth = depth;
+		}
 	}
+	if (best_ptr) {
+		atomic_inc(&best_ptr->queue_depth);
+		list_move_tail(&best_ptr->node, &simpleaes_devices);
+	}
+	spin_unlock(&simpleaes_devices_lock);
 
-	InstancePtr->flag = 0;
-	*DataPtr	  = InstancePtr->data;
-	return ret;
-}
-
-static void Notification_Error_DeInit(Notification_Error *InstancePtr)
-{
+	if (best_ptr) {
+		SimpleAES_StatsHist(best_ptr, ORG_SIMPLE_HIST_DEPTH,
+				    best_depth + 1);
+	}
+	return best_ptr;
 }
 
-// Character device (cdev) callbacks
-
-static int simpleaes_cdev_open(struct inode *inode_ptr, struct file *file_ptr)
+static void SimpleAES_Hold(SimpleAES *InstancePtr)
 {
-	return 0;
+	SimpleAES_StatsHist(InstancePtr, ORG_SIMPLE_HIST_DEPTH,
+			    atomic_inc_return(&InstancePtr->queue_depth));
 }
 
-static int simpleaes_cdev_release(struct inode *inode_ptr,
-				  struct file *file_ptr)
+static void SimpleAES_Release(SimpleAES *InstancePtr)
 {
-	return 0;
+	if (atomic_dec_and_test(&InstancePtr->queue_depth)) {
+		wake_up_var(&InstancePtr->queue_depth);
+	}
 }
 
-static long simpleaes_cdev_ioctl(struct file *file_ptr, unsigned int cmd,
-				 unsigned long arg)
+// <debugfs>/simpleaes/simpleaes<id>/{stats,histograms,dma_bench}. Like the
+// rest of debugfs, failures only cost the files.
+static void SimpleAES_DebugfsInit(SimpleAES *InstancePtr)
 {
-	IOCTL_Data data;
-	Result_BoolError err_boolerror;
-	SimpleAES *simpleaes_ptr =
-		(SimpleAES *)container_of(file_ptr->f_op, SimpleAES, f_ops);
-
-	switch (cmd) {
-	case IOCTL_ENCRYPT:
-		if (copy_from_user((void *)&data, (void *)arg, sizeof(data))) {
-			return -EFAULT;
-		}
-		err_boolerror = SimpleAES_Encrypt(simpleaes_ptr, data.key_ptr,
-						  data.i_data_ptr,
-						  data.o_data_ptr);
-		if (err_boolerror.variant == RESULT_ERR) {
-			return -EIO;
-		}
-	case IOCTL_DECRYPT:
-		if (copy_from_user((void *)&data, (void *)arg, sizeof(data))) {
-			return -EFAULT;
-		}
-		err_boolerror = SimpleAES_Decrypt(simpleaes_ptr, data.key_ptr,
-						  data.i_data_ptr,
-						  data.o_data_ptr);
-		if (err_boolerror.variant == RESULT_ERR) {
-			return -EIO;
-		}
-	default:
-		return -EINVAL;
-	}
+	char name[sizeof(SIMPLEAES_DEVICE_NAME) + 8];
 
-	return 0;
+	snprintf(name, sizeof(name), SIMPLEAES_DEVICE_NAME "%d",
+		 InstancePtr->id);
+	InstancePtr->debugfs_dir =
+		debugfs_create_dir(name, simpleaes_debugfs_root);
+	debugfs_create_file("stats", 0444, InstancePtr->debugfs_dir,
+			    InstancePtr, &simpleaes_stats_fops);
+	debugfs_create_file("histograms", 0444, InstancePtr->debugfs_dir,
+			    InstancePtr, &simpleaes_histograms_fops);
+	debugfs_create_file("dma_bench", 0400, InstancePtr->debugfs_dir,
+			    InstancePtr, &simpleaes_dma_bench_fops);
 }
 
-// Device management
-
 static int SimpleAES_probe(struct platform_device *pdev)
 {
+	void __iomem *regs_ptr;
+	unsigned int i;
+	u32 *shadow;
 	int ret = 0;
 
 	//--------------------------------------------------------------------------
@@ -471,62 +7081,170 @@ static int SimpleAES_probe(struct platform_device *pdev)
 	// Notification (notif)
 	Notification_Error_Init(&simpleaes_ptr->notif);
 
-	// Interrupt (irq_line)
-	ret = request_irq(simpleaes_ptr->irq_line, SimpleAES_IrqHandler,
-			  IRQF_SHARED, "simpleaes-irq", pdev);
-	if (ret) {
-		dev_err(&pdev->dev,
-			"Failed to request and set up interrupt handler");
-		goto SimpleAES_probe_ret;
+	// Completion latency (latency)
+	for (i = 0; i < ORG_SIMPLE_COMPLETION_MODES; i++) {
+		LatencyStats_Init(&simpleaes_ptr->latency[i]);
+	}
+
+	// Operation phase statistics (op_phases)
+	OpPhaseStats_Init(&simpleaes_ptr->op_phases);
+
+	// Per-CPU statistics (stats), updated from the interrupt handler
+	simpleaes_ptr->stats = devm_alloc_percpu(&pdev->dev, SimpleAESStats);
+	if (!simpleaes_ptr->stats) {
+		dev_err(&pdev->dev, "Failed to allocate statistics");
+		ret = -ENOMEM;
+		goto SimpleAES_probe_error_notif_deinit;
 	}
 
 	// Clock (axi_clock)
 	ret = clk_prepare_enable(simpleaes_ptr->axi_clock);
 	if (ret) {
 		dev_err(&pdev->dev, "Failed to enable clock");
-		goto SimpleAES_probe_ret;
+		goto SimpleAES_probe_error_notif_deinit;
 	}
 
 	// Lock (regfile)
 	spin_lock_init(&simpleaes_ptr->regfile.lock);
 
+	// Shadow registers (regfile): a previous driver instance may have left
+	// the engine programmed
+	regs_ptr		       = simpleaes_ptr->regfile.ptr;
+	shadow			       = simpleaes_ptr->regfile.shadow;
+	SIMPLEAES_SHADOW(CTRL, shadow) = SIMPLEAES_REG_READ(CTRL, regs_ptr);
+	SIMPLEAES_SHADOW(KAR, shadow)  = SIMPLEAES_REG_READ(KAR, regs_ptr);
+	SIMPLEAES_SHADOW(IAR, shadow)  = SIMPLEAES_REG_READ(IAR, regs_ptr);
+	SIMPLEAES_SHADOW(OAR, shadow)  = SIMPLEAES_REG_READ(OAR, regs_ptr);
+
+	// Interrupt (irq_line). The line is shared, so the handler may run as
+	// soon as it is requested: the clock and regfile lock come first.
+	simpleaes_ptr->irq_coalesce.budget = ORG_SIMPLE_IRQ_BUDGET;
+	simpleaes_ptr->irq_coalesce.frames = ORG_SIMPLE_IRQ_COALESCE_FRAMES;
+	simpleaes_ptr->irq_coalesce.usecs  = ORG_SIMPLE_IRQ_COALESCE_USECS;
+	ret = request_threaded_irq(simpleaes_ptr->irq_line,
+				   SimpleAES_IrqHandler, SimpleAES_IrqThread,
+				   IRQF_SHARED, "simpleaes-irq", simpleaes_ptr);
+	if (ret) {
+		dev_err(&pdev->dev,
+			"Failed to request and set up interrupt handler");
+		goto SimpleAES_probe_error_clk_deinit;
+	}
+
+	// DMA addressing: KAR/IAR/OAR hold 32-bit bus addresses
+	ret = dma_set_mask_and_coherent(&pdev->dev, DMA_BIT_MASK(32));
+	if (ret) {
+		dev_err(&pdev->dev, "No suitable 32-bit DMA addressing");
+		goto SimpleAES_probe_error_free_irq;
+	}
+
+	// DMA record pool (buf_pool). Coherent memory is uncached where the
+	// device does not snoop CPU caches, so records are streaming there.
+	ret = HwBufferPool_Init(&simpleaes_ptr->buf_pool, &pdev->dev,
+				dma_records == ORG_SIMPLE_DMA_STREAMING ||
+					(dma_records == ORG_SIMPLE_DMA_AUTO &&
+					 !dev_is_dma_coherent(&pdev->dev)),
+				pool_depth, pool_max_depth);
+	if (ret) {
+		dev_err(&pdev->dev, "Failed to allocate DMA buffer pool");
+		goto SimpleAES_probe_error_free_irq;
+	}
+
+	// Key table (key_table)
+	ret = KeyTable_Init(&simpleaes_ptr->key_table, &pdev->dev,
+			    key_slots);
+	if (ret) {
+		dev_err(&pdev->dev, "Failed to allocate key table");
+		goto SimpleAES_probe_error_pool_deinit;
+	}
+
+	// Descriptor ring (ring_ptr), on ver3 engines only. Enabling it makes
+	// the engine start at descriptor 0.
+	if ((uintptr_t)of_device_get_match_data(&pdev->dev) ==
+	    ORG_SIMPLE_HW_VER3) {
+		simpleaes_ptr->ring_ptr = devm_kzalloc(
+			&pdev->dev, sizeof(DescRing), GFP_KERNEL);
+		if (!simpleaes_ptr->ring_ptr ||
+		    DescRing_Init(simpleaes_ptr->ring_ptr, &pdev->dev)) {
+			dev_err(&pdev->dev, "Failed to allocate descriptor ring");
+			simpleaes_ptr->ring_ptr = NULL;
+			ret = -ENOMEM;
+			goto SimpleAES_probe_error_key_table_deinit;
+		}
+
+		spin_lock_irq(&simpleaes_ptr->regfile.lock);
+		SIMPLEAES_SHADOW_WRITE(0, RCFG, regs_ptr, shadow);
+		SimpleAES_RingStart(simpleaes_ptr, 0);
+		spin_unlock_irq(&simpleaes_ptr->regfile.lock);
+	}
+
+	// Engine scheduler (sched)
+	Scheduler_Init(&simpleaes_ptr->sched);
+	SchedClient_Init(&simpleaes_ptr->crypto_client, 1);
+
+	// Software batch transforms (soft_pool), filled by the self-test
+	SoftCipherPool_Init(&simpleaes_ptr->soft_pool);
+
+	// Asynchronous request executor (async_wq)
+	simpleaes_ptr->async_wq = alloc_workqueue("simpleaes-async",
+						  WQ_UNBOUND, 0);
+	if (!simpleaes_ptr->async_wq) {
+		dev_err(&pdev->dev, "Failed to allocate async workqueue");
+		ret = -ENOMEM;
+		goto SimpleAES_probe_error_ring_deinit;
+	}
+
+	// Crypto API request queue (crypto_engine)
+	simpleaes_ptr->crypto_engine = crypto_engine_alloc_init(&pdev->dev,
+								true);
+	if (!simpleaes_ptr->crypto_engine) {
+		dev_err(&pdev->dev, "Failed to allocate crypto engine");
+		ret = -ENOMEM;
+		goto SimpleAES_probe_error_destroy_workqueue;
+	}
+
+	ret = crypto_engine_start(simpleaes_ptr->crypto_engine);
+	if (ret) {
+		dev_err(&pdev->dev, "Failed to start crypto engine");
+		goto SimpleAES_probe_error_crypto_engine_exit;
+	}
+
 	//--------------------------------------------------------------------------
 	// 6. Create 'character device' (cdev) user interface
 	//--------------------------------------------------------------------------
 
+	simpleaes_ptr->f_ops.owner	    = THIS_MODULE;
 	simpleaes_ptr->f_ops.open	    = simpleaes_cdev_open;
 	simpleaes_ptr->f_ops.release	    = simpleaes_cdev_release;
 	simpleaes_ptr->f_ops.unlocked_ioctl = simpleaes_cdev_ioctl;
+	simpleaes_ptr->f_ops.mmap	    = simpleaes_cdev_mmap;
+	simpleaes_ptr->f_ops.read	    = simpleaes_cdev_read;
+	simpleaes_ptr->f_ops.poll	    = simpleaes_cdev_poll;
 
-	ret = alloc_chrdev_region(&simpleaes_ptr->cdev.devno, 0, 1,
-				  SIMPLEAES_DEVICE_NAME);
+	// Instance number (id), minor id + 1 of the shared region
+	ret = ida_alloc_max(&simpleaes_ida, ORG_SIMPLE_MAX_DEVICES - 1,
+			    GFP_KERNEL);
 	if (ret < 0) {
-		dev_err(&pdev->dev, "Failed to allocate major number");
-		goto SimpleAES_probe_error_free_irq;
+		dev_err(&pdev->dev, "Too many SimpleAES instances");
+		goto SimpleAES_probe_error_crypto_engine_exit;
 	}
+	simpleaes_ptr->id	  = ret;
+	simpleaes_ptr->cdev.devno = MKDEV(MAJOR(simpleaes_devno),
+					  simpleaes_ptr->id + 1);
 
 	cdev_init(&simpleaes_ptr->cdev.cdev, &simpleaes_ptr->f_ops);
 	ret = cdev_add(&simpleaes_ptr->cdev.cdev, simpleaes_ptr->cdev.devno, 1);
 	if (ret < 0) {
 		dev_err(&pdev->dev, "Failed to add character device");
-		goto SimpleAES_probe_error_unregister_chrdev_region;
-	}
-
-	simpleaes_ptr->cdev.class_ptr =
-		class_create(THIS_MODULE, SIMPLEAES_DEVICE_NAME);
-	if (IR_ERR(simpleaes_ptr->cdev.class_ptr)) {
-		dev_err(&pdev->dev, "Failed to create device class");
-		ret = PTR_ERR(simpleaes_ptr->cdev.class_ptr);
-		goto SimpleAES_probe_error_cdev_del;
+		goto SimpleAES_probe_error_ida_free;
 	}
 
 	simpleaes_ptr->cdev.device_ptr = device_create(
-		simpleaes_ptr->cdev.class_ptr, NULL, simpleaes_ptr->cdev.devno,
-		NULL, SIMPLEAES_DEVICE_NAME);
+		simpleaes_class, &pdev->dev, simpleaes_ptr->cdev.devno, NULL,
+		SIMPLEAES_DEVICE_NAME "%d", simpleaes_ptr->id);
 	if (IS_ERR(simpleaes_ptr->cdev.device_ptr)) {
 		dev_err(&pdev->dev, "Failed to create cdev");
 		ret = PTR_ERR(simpleaes_ptr->cdev.device_ptr);
-		goto SimpleAES_probe_error_class_destroy;
+		goto SimpleAES_probe_error_cdev_del;
 	}
 
 	//--------------------------------------------------------------------------
@@ -536,26 +7254,69 @@ static int SimpleAES_probe(struct platform_device *pdev)
 	simpleaes_ptr->pdev_ptr = pdev;
 	platform_set_drvdata(pdev, simpleaes_ptr);
 
+	//--------------------------------------------------------------------------
+	// 8. Check software AES and the engine against known answers
+	//--------------------------------------------------------------------------
+
+	ret = SimpleAES_SelfTest(simpleaes_ptr);
+	if (ret) {
+		dev_err(&pdev->dev, "Self-test failed");
+		goto SimpleAES_probe_error_device_destroy;
+	}
+
+	//--------------------------------------------------------------------------
+	// 9. Join the engine list (aggregate node and Crypto API)
+	//--------------------------------------------------------------------------
+
+	SimpleAES_DebugfsInit(simpleaes_ptr);
+	SimpleAES_Attach(simpleaes_ptr);
+
 	return 0;
 
 	//--------------------------------------------------------------------------
 	// Return path
 	//--------------------------------------------------------------------------
 
-SimpleAES_probe_error_class_destroy:
-	class_destroy(simpleaes_ptr->cdev.class_ptr);
+SimpleAES_probe_error_device_destroy:
+	device_destroy(simpleaes_class, simpleaes_ptr->cdev.devno);
 
 SimpleAES_probe_error_cdev_del:
 	cdev_del(&simpleaes_ptr->cdev.cdev);
 
-SimpleAES_probe_error_unregister_chrdev_region:
-	unregister_chrdev_region(simpleaes_ptr->cdev.devno, 1);
+SimpleAES_probe_error_ida_free:
+	ida_free(&simpleaes_ida, simpleaes_ptr->id);
+
+SimpleAES_probe_error_crypto_engine_exit:
+	crypto_engine_exit(simpleaes_ptr->crypto_engine);
+
+SimpleAES_probe_error_destroy_workqueue:
+	destroy_workqueue(simpleaes_ptr->async_wq);
+	SoftCipherPool_DeInit(&simpleaes_ptr->soft_pool);
+
+SimpleAES_probe_error_ring_deinit:
+	if (simpleaes_ptr->ring_ptr) {
+		if (!simpleaes_ptr->regfile.gated) {
+			SIMPLEAES_REG_WRITE(0, RCFG, regs_ptr);
+		}
+		DescRing_DeInit(simpleaes_ptr->ring_ptr, &pdev->dev);
+	}
+
+SimpleAES_probe_error_key_table_deinit:
+	KeyTable_DeInit(&simpleaes_ptr->key_table, &pdev->dev);
+
+SimpleAES_probe_error_pool_deinit:
+	HwBufferPool_DeInit(&simpleaes_ptr->buf_pool);
 
 SimpleAES_probe_error_free_irq:
-	free_irq(simpleaes_ptr->irq_line, pdev);
+	free_irq(simpleaes_ptr->irq_line, simpleaes_ptr);
 
 SimpleAES_probe_error_clk_deinit:
-	clk_disable_unprepare(simpleaes_ptr->axi_clock);
+	if (!simpleaes_ptr->regfile.gated) {
+		clk_disable_unprepare(simpleaes_ptr->axi_clock);
+	}
+
+SimpleAES_probe_error_notif_deinit:
+	Notification_Error_DeInit(&simpleaes_ptr->notif);
 
 SimpleAES_probe_ret:
 	return ret;
@@ -563,20 +7324,70 @@ SimpleAES_probe_ret:
 
 static int SimpleAES_remove(struct platform_device *pdev)
 {
-	SimpleAES *simpleaes_ptr = pdev->private_data;
+	SimpleAES *simpleaes_ptr = platform_get_drvdata(pdev);
+
+	// Engine list: no new work is routed here once this returns
+	SimpleAES_Detach(simpleaes_ptr);
+
+	// Scheduler: an engine kept idle for a file goes back to idle now
+	Scheduler_Detach(&simpleaes_ptr->sched, NULL);
+
+	// debugfs
+	debugfs_remove_recursive(simpleaes_ptr->debugfs_dir);
 
 	// CDEV
-	device_destroy(simpleaes_ptr->cdev.class_ptr,
-		       simpleaes_ptr->cdev.devno);
-	class_destroy(simpleaes_ptr->cdev.class_ptr);
+	device_destroy(simpleaes_class, simpleaes_ptr->cdev.devno);
 	cdev_del(&simpleaes_ptr->cdev.cdev);
-	unregister_chrdev_region(simpleaes_ptr->cdev.devno, 1);
 
-	// Clock
-	clk_disable_unprepare(simpleaes_ptr->axi_clock);
+	// Open files (on either node) keep keys, buffers and rings on this
+	// engine and point at its instance data, so they must all be closed.
+	// They pin the module, so only an unbind can get here with files open.
+	if (atomic_read(&simpleaes_ptr->open_files)) {
+		dev_warn(&pdev->dev, "Waiting for %d open files to close",
+			 atomic_read(&simpleaes_ptr->open_files));
+	}
+	wait_var_event(&simpleaes_ptr->open_files,
+		       !atomic_read(&simpleaes_ptr->open_files));
+	hrtimer_cancel(&simpleaes_ptr->sched.idle_timer);
+	ida_free(&simpleaes_ida, simpleaes_ptr->id);
+
+	// Crypto API request queue
+	crypto_engine_exit(simpleaes_ptr->crypto_engine);
+
+	// Asynchronous request executor
+	destroy_workqueue(simpleaes_ptr->async_wq);
+
+	// Software batch transforms
+	SoftCipherPool_DeInit(&simpleaes_ptr->soft_pool);
+
+	// Descriptor ring: the engine stops fetching before it is freed. An
+	// engine whose clock could not be re-enabled fetches nothing.
+	if (simpleaes_ptr->ring_ptr) {
+		if (!simpleaes_ptr->regfile.gated) {
+			SIMPLEAES_REG_WRITE(0, RCFG,
+					    simpleaes_ptr->regfile.ptr);
+		}
+		DescRing_DeInit(simpleaes_ptr->ring_ptr, &pdev->dev);
+	}
+
+	// Key table
+	KeyTable_DeInit(&simpleaes_ptr->key_table, &pdev->dev);
+
+	// DMA buffer pool
+	HwBufferPool_DeInit(&simpleaes_ptr->buf_pool);
+
+	// Interrupt: the handler reads the registers, so it goes first
+	free_irq(simpleaes_ptr->irq_line, simpleaes_ptr);
+
+	// Notification: the interrupt handler was its last poster
+	Notification_Error_DeInit(&simpleaes_ptr->notif);
 
-	// Interrupt
-	free_irq(simpleaes_ptr->irq_line, pdev);
+	// Clock, unless a failed reset already left it off
+	if (!simpleaes_ptr->regfile.gated) {
+		clk_disable_unprepare(simpleaes_ptr->axi_clock);
+	}
+
+	return 0;
 }
 
 // =============================================================================
@@ -586,6 +7397,8 @@ static int SimpleAES_remove(struct platform_device *pdev)
 // OF match ID table
 static const struct of_device_id simpleaes_match_ids[] = {
 	{ .compatible = "org-simple-simpleaes" },
+	{ .compatible = "org-simple-simpleaes-v3",
+	  .data	      = (const void *)ORG_SIMPLE_HW_VER3 },
 	{}
 };
 MODULE_DEVICE_TABLE(of, simpleaes_match_ids);
@@ -598,7 +7411,87 @@ static struct platform_driver simpleaes_driver = {
         {
             .name = SIMPLEAES_DEVICE_NAME,
             .of_match_table = simpleaes_match_ids,
+            .dev_groups = simpleaes_groups,
         },
 };
 
-module_platform_driver(simpleaes_driver);
+// The chrdev region, class and aggregate node are shared by all instances
+static int __init SimpleAES_init(void)
+{
+	struct device *device_ptr;
+	int ret;
+
+	ret = alloc_chrdev_region(&simpleaes_devno, 0,
+				  ORG_SIMPLE_MAX_DEVICES + 1,
+				  SIMPLEAES_DEVICE_NAME);
+	if (ret < 0) {
+		pr_err("simpleaes: failed to allocate chrdev region\n");
+		goto __simpleaes_init_ret;
+	}
+
+	simpleaes_class = class_create(THIS_MODULE, SIMPLEAES_DEVICE_NAME);
+	if (IS_ERR(simpleaes_class)) {
+		pr_err("simpleaes: failed to create device class\n");
+		ret = PTR_ERR(simpleaes_class);
+		goto __simpleaes_init_undo_res1;
+	}
+
+	cdev_init(&simpleaes_aggregate_cdev, &simpleaes_cdev_fops);
+	ret = cdev_add(&simpleaes_aggregate_cdev, simpleaes_devno, 1);
+	if (ret < 0) {
+		pr_err("simpleaes: failed to add aggregate cdev\n");
+		goto __simpleaes_init_undo_res2;
+	}
+
+	device_ptr = device_create(simpleaes_class, NULL, simpleaes_devno,
+				   NULL, SIMPLEAES_DEVICE_NAME);
+	if (IS_ERR(device_ptr)) {
+		pr_err("simpleaes: failed to create aggregate device\n");
+		ret = PTR_ERR(device_ptr);
+		goto __simpleaes_init_undo_res3;
+	}
+
+	simpleaes_debugfs_root =
+		debugfs_create_dir(SIMPLEAES_DEVICE_NAME, NULL);
+#ifdef SIMPLEAES_MMIO_PROFILE
+	debugfs_create_file("mmio_profile", 0444, simpleaes_debugfs_root, NULL,
+			    &simpleaes_mmio_profile_fops);
+#endif
+
+	ret = platform_driver_register(&simpleaes_driver);
+	if (ret) {
+		goto __simpleaes_init_undo_res5;
+	}
+
+	return 0;
+
+__simpleaes_init_undo_res5:
+	debugfs_remove_recursive(simpleaes_debugfs_root);
+	device_destroy(simpleaes_class, simpleaes_devno);
+
+__simpleaes_init_undo_res3:
+	cdev_del(&simpleaes_aggregate_cdev);
+
+__simpleaes_init_undo_res2:
+	class_destroy(simpleaes_class);
+
+__simpleaes_init_undo_res1:
+	unregister_chrdev_region(simpleaes_devno, ORG_SIMPLE_MAX_DEVICES + 1);
+
+__simpleaes_init_ret:
+	return ret;
+}
+
+static void __exit SimpleAES_exit(void)
+{
+	platform_driver_unregister(&simpleaes_driver);
+	debugfs_remove_recursive(simpleaes_debugfs_root);
+	device_destroy(simpleaes_class, simpleaes_devno);
+	cdev_del(&simpleaes_aggregate_cdev);
+	class_destroy(simpleaes_class);
+	unregister_chrdev_region(simpleaes_devno, ORG_SIMPLE_MAX_DEVICES + 1);
+	ida_destroy(&simpleaes_ida);
+}
+
+module_init(SimpleAES_init);
+module_exit(SimpleAES_exit);
@@ -70,6 +70,9 @@
 #define SIMPLEAES_IRQ_ERR_Pos  1 // error field
 #define SIMPLEAES_IRQ_ERR_Mask (0x1ul << SIMPLEAES_IRQ_ERR_Pos)
 
+#define SIMPLEAES_IRQ_RING_Pos	2 // ring field (ver3)
+#define SIMPLEAES_IRQ_RING_Mask (0x1ul << SIMPLEAES_IRQ_RING_Pos)
+
 // KAR (key address register)
 #define SIMPLEAES_KAR_OFFSET 0x0C
 
@@ -88,6 +91,63 @@
 #define SIMPLEAES_OAR_ADDR_Pos	0 // error field
 #define SIMPLEAES_OAR_ADDR_Mask (0xFFFFFFFFul << SIMPLEAES_OAR_ADDR_Pos)
 
+// Descriptor ring registers (SimpleAES_ver3.rseq engines only)
+
+// RBAR (ring base address register)
+#define SIMPLEAES_RBAR_OFFSET 0x18
+
+#define SIMPLEAES_RBAR_ADDR_Pos	 0 // address field
+#define SIMPLEAES_RBAR_ADDR_Mask (0xFFFFFFFFul << SIMPLEAES_RBAR_ADDR_Pos)
+
+// RCFG (ring configuration register)
+#define SIMPLEAES_RCFG_OFFSET 0x1C
+
+#define SIMPLEAES_RCFG_EN_Pos  0 // ring enable field
+#define SIMPLEAES_RCFG_EN_Mask (0x1ul << SIMPLEAES_RCFG_EN_Pos)
+
+#define SIMPLEAES_RCFG_SIZE_Pos	 8 // log2 ring entries field
+#define SIMPLEAES_RCFG_SIZE_Mask (0xFul << SIMPLEAES_RCFG_SIZE_Pos)
+
+// RHEAD (ring head register): next descriptor the engine fetches
+#define SIMPLEAES_RHEAD_OFFSET 0x20
+
+#define SIMPLEAES_RHEAD_IDX_Pos	 0 // index field
+#define SIMPLEAES_RHEAD_IDX_Mask (0xFFFFul << SIMPLEAES_RHEAD_IDX_Pos)
+
+// RTAIL (ring tail register): next descriptor software posts (doorbell)
+#define SIMPLEAES_RTAIL_OFFSET 0x24
+
+#define SIMPLEAES_RTAIL_IDX_Pos	 0 // index field
+#define SIMPLEAES_RTAIL_IDX_Mask (0xFFFFul << SIMPLEAES_RTAIL_IDX_Pos)
+
+// RCIDX (ring completion index register): descriptors completed
+#define SIMPLEAES_RCIDX_OFFSET 0x28
+
+#define SIMPLEAES_RCIDX_IDX_Pos	 0 // index field
+#define SIMPLEAES_RCIDX_IDX_Mask (0xFFFFul << SIMPLEAES_RCIDX_IDX_Pos)
+
+// Ring descriptor words (HwDesc), written like registers held in memory
+
+// DCTRL (descriptor control word)
+#define SIMPLEAES_DCTRL_OP_Pos	0 // Operation field
+#define SIMPLEAES_DCTRL_OP_Mask (0x1ul << SIMPLEAES_DCTRL_OP_Pos)
+
+#define SIMPLEAES_DCTRL_IRQ_Pos	 1 // Raise IRQ.RING on completion field
+#define SIMPLEAES_DCTRL_IRQ_Mask (0x1ul << SIMPLEAES_DCTRL_IRQ_Pos)
+
+#define SIMPLEAES_DCTRL_COUNT_Pos  16 // Block count field
+#define SIMPLEAES_DCTRL_COUNT_Mask (0xFFFFul << SIMPLEAES_DCTRL_COUNT_Pos)
+
+// DSTAT (descriptor status word, written back by the engine)
+#define SIMPLEAES_DSTAT_DONE_Pos  0 // Completed field
+#define SIMPLEAES_DSTAT_DONE_Mask (0x1ul << SIMPLEAES_DSTAT_DONE_Pos)
+
+#define SIMPLEAES_DSTAT_ERR_Pos	 2 // Error code field (as STAT.ERR)
+#define SIMPLEAES_DSTAT_ERR_Mask (0x3ul << SIMPLEAES_DSTAT_ERR_Pos)
+
+#define SIMPLEAES_DSTAT_COUNT_Pos  16 // Blocks done before an error field
+#define SIMPLEAES_DSTAT_COUNT_Mask (0xFFFFul << SIMPLEAES_DSTAT_COUNT_Pos)
+
 //==============================================================================
 //  SimpleAES Register File Macros
 //==============================================================================
@@ -106,15 +166,17 @@
 	CONCAT(SIMPLEAES_MAKE_FIELD(reg, field), _Mask)
 
 #define SIMPLEAES_REG_WRITE(val, reg, base) \
-	iowrite32(val, (base) + SIMPLEAES_MAKE_REG_OFFSET(reg))
+	(SIMPLEAES_MMIO_COUNT(reg, true), \
+	 iowrite32(val, (base) + SIMPLEAES_MAKE_REG_OFFSET(reg)))
 
 #define SIMPLEAES_REG_READ(reg, base) \
-	ioread32((base) + SIMPLEAES_MAKE_REG_OFFSET(reg))
+	(SIMPLEAES_MMIO_COUNT(reg, false), \
+	 ioread32((base) + SIMPLEAES_MAKE_REG_OFFSET(reg)))
 
 #define SIMPLEAES_FIELD_WRITE(val, field, reg, base) \
 	SIMPLEAES_REG_WRITE((SIMPLEAES_REG_READ(reg, base) & \
 			     ~SIMPLEAES_MAKE_FIELD_MASK(reg, field)) | \
-				    (val \
+				    ((val) \
 				     << SIMPLEAES_MAKE_FIELD_POS(reg, field)), \
 			    reg, base)
 
@@ -123,6 +185,196 @@
 	 SIMPLEAES_MAKE_FIELD_MASK(reg, field)) >> \
 		SIMPLEAES_MAKE_FIELD_POS(reg, field)
 
+// Sets field in a register value held in memory
+#define SIMPLEAES_FIELD_SET(val, field, reg, word) \
+	(((word) & ~SIMPLEAES_MAKE_FIELD_MASK(reg, field)) | \
+	 (((u32)(val) << SIMPLEAES_MAKE_FIELD_POS(reg, field)) & \
+	  SIMPLEAES_MAKE_FIELD_MASK(reg, field)))
+
+// Gets field from a register value held in memory
+#define SIMPLEAES_FIELD_GET(field, reg, word) \
+	(((word) & SIMPLEAES_MAKE_FIELD_MASK(reg, field)) >> \
+	 SIMPLEAES_MAKE_FIELD_POS(reg, field))
+
+//==============================================================================
+//  SimpleAES Shadow Registers
+//==============================================================================
+
+// Software owns CTRL, KAR, IAR and OAR, and RBAR, RCFG and RTAIL on ver3
+// engines: the engine never changes them. The last value written to each is
+// kept in a shadow array (indexed by register offset, guarded by the regfile
+// lock), so field writes need no read-back and writes that would not change
+// a register are skipped. OAR starts the operation and RTAIL rings the
+// doorbell, so they are always written (SIMPLEAES_SHADOW_WRITE).
+
+#define SIMPLEAES_REGS (SIMPLEAES_RCIDX_OFFSET / sizeof(u32) + 1)
+
+#define SIMPLEAES_SHADOW(reg, shadow) \
+	((shadow)[SIMPLEAES_MAKE_REG_OFFSET(reg) / sizeof(u32)])
+
+#define SIMPLEAES_SHADOW_WRITE(val, reg, base, shadow) \
+	do { \
+		SIMPLEAES_SHADOW(reg, shadow) = (val); \
+		SIMPLEAES_REG_WRITE(SIMPLEAES_SHADOW(reg, shadow), reg, base); \
+	} while (0)
+
+#define SIMPLEAES_SHADOW_UPDATE(val, reg, base, shadow) \
+	do { \
+		u32 __shadow_val = (val); \
+		if (SIMPLEAES_SHADOW(reg, shadow) != __shadow_val) { \
+			SIMPLEAES_SHADOW_WRITE(__shadow_val, reg, base, \
+					       shadow); \
+		} \
+	} while (0)
+
+#define SIMPLEAES_SHADOW_FIELD_WRITE(val, field, reg, base, shadow) \
+	SIMPLEAES_SHADOW_UPDATE(SIMPLEAES_FIELD_SET(val, field, reg, \
+						    SIMPLEAES_SHADOW(reg, \
+								     shadow)), \
+				reg, base, shadow)
+
+#define SIMPLEAES_SHADOW_FIELD_READ(field, reg, shadow) \
+	((SIMPLEAES_SHADOW(reg, shadow) & \
+	  SIMPLEAES_MAKE_FIELD_MASK(reg, field)) >> \
+	 SIMPLEAES_MAKE_FIELD_POS(reg, field))
+
+//==============================================================================
+//  SimpleAES MMIO Profiling
+//==============================================================================
+
+// Built with -DSIMPLEAES_MMIO_PROFILE, every SIMPLEAES_REG_READ and
+// SIMPLEAES_REG_WRITE call site counts its bus accesses. Sites join the
+// profile (<debugfs>/simpleaes/mmio_profile) on their first access.
+typedef struct {
+	const char *func;
+	unsigned int line;
+	const char *reg;
+	bool write;
+	atomic64_t count;
+	atomic_t listed;
+	struct list_head node;
+} SimpleAESMmioSite;
+
+#ifdef SIMPLEAES_MMIO_PROFILE
+#define SIMPLEAES_MMIO_COUNT(reg_name, is_write) \
+	({ \
+		static SimpleAESMmioSite __mmio_site = { \
+			.func  = __func__, \
+			.line  = __LINE__, \
+			.reg   = #reg_name, \
+			.write = is_write, \
+		}; \
+		SimpleAES_MmioProfile(&__mmio_site); \
+	})
+#else
+#define SIMPLEAES_MMIO_COUNT(reg_name, is_write) ((void)0)
+#endif
+
+//==============================================================================
+// std.Notification<T> Materialization
+//==============================================================================
+
+// Bounded completion ring shared by the interrupt handler and process
+// context. Every operation has a tag; its completion goes to slot
+// tag % NOTIFICATION_DEPTH, so up to NOTIFICATION_DEPTH operations may be in
+// flight. Producers publish without locks and owe a wakeup only to the one
+// receiver sleeping on that slot. Wakeups are batched: Post only marks the
+// slot, Flush wakes every marked receiver at once.
+#define NOTIFICATION_DEPTH 16 // Power of two, at most BITS_PER_LONG
+
+#define NOTIFICATION_DECLARE_TYPE(Name, T) \
+	typedef struct { \
+		u64 tag; /* Tag of the completion in the slot, 0 if none */ \
+		T data; \
+		struct rcuwait wait; /* Receiver waiting for the slot */ \
+	} CONCAT(NotificationSlot_, Name); \
+	typedef struct { \
+		CONCAT(NotificationSlot_, Name) slots[NOTIFICATION_DEPTH]; \
+		unsigned long pending; /* Slots posted but not flushed */ \
+	} CONCAT(Notification_, Name)
+
+#define NOTIFICATION_DECLARE_FUNCS(Name, T) \
+	static int CONCAT(CONCAT(Notification_, Name), _Init)( \
+		CONCAT(Notification_, Name) * InstancePtr); \
+	static void CONCAT(CONCAT(Notification_, Name), _Post)( \
+		CONCAT(Notification_, Name) * InstancePtr, T data, u64 tag); \
+	static void CONCAT(CONCAT(Notification_, Name), _Flush)( \
+		CONCAT(Notification_, Name) * InstancePtr); \
+	static int CONCAT(CONCAT(Notification_, Name), _Receive)( \
+		CONCAT(Notification_, Name) * InstancePtr, u64 tag, \
+		T * DataPtr, long timeout); \
+	static void CONCAT(CONCAT(Notification_, Name), _DeInit)( \
+		CONCAT(Notification_, Name) * InstancePtr)
+
+// Receive waits up to timeout jiffies (MAX_SCHEDULE_TIMEOUT: no limit) for
+// the completion of its tag and returns -ETIMEDOUT if it was not posted. The
+// wait is not interruptible: the engine belongs to the caller until its op
+// completes or the watchdog takes it back.
+#define NOTIFICATION_DEFINE_FUNCS(Name, T) \
+	static int CONCAT(CONCAT(Notification_, Name), _Init)( \
+		CONCAT(Notification_, Name) * InstancePtr) \
+	{ \
+		unsigned int idx; \
+\
+		for (idx = 0; idx < NOTIFICATION_DEPTH; idx++) { \
+			InstancePtr->slots[idx].tag = 0; \
+			rcuwait_init(&InstancePtr->slots[idx].wait); \
+		} \
+		InstancePtr->pending = 0; \
+		return 0; \
+	} \
+\
+	static void CONCAT(CONCAT(Notification_, Name), _Post)( \
+		CONCAT(Notification_, Name) * InstancePtr, T data, u64 tag) \
+	{ \
+		unsigned int idx = tag % NOTIFICATION_DEPTH; \
+\
+		InstancePtr->slots[idx].data = data; \
+		smp_store_release(&InstancePtr->slots[idx].tag, tag); \
+		set_bit(idx, &InstancePtr->pending); \
+	} \
+\
+	static void CONCAT(CONCAT(Notification_, Name), _Flush)( \
+		CONCAT(Notification_, Name) * InstancePtr) \
+	{ \
+		unsigned long pending = xchg(&InstancePtr->pending, 0); \
+		unsigned int idx; \
+\
+		for_each_set_bit(idx, &pending, NOTIFICATION_DEPTH) { \
+			rcuwait_wake_up(&InstancePtr->slots[idx].wait); \
+		} \
+	} \
+\
+	static int CONCAT(CONCAT(Notification_, Name), _Receive)( \
+		CONCAT(Notification_, Name) * InstancePtr, u64 tag, \
+		T * DataPtr, long timeout) \
+	{ \
+		CONCAT(NotificationSlot_, Name) *slot_ptr = \
+			&InstancePtr->slots[tag % NOTIFICATION_DEPTH]; \
+\
+		/* rcuwait_wait_event() with a timeout */ \
+		prepare_to_rcuwait(&slot_ptr->wait); \
+		for (;;) { \
+			set_current_state(TASK_UNINTERRUPTIBLE); \
+			if (smp_load_acquire(&slot_ptr->tag) == tag) { \
+				break; \
+			} \
+			if (!timeout) { \
+				finish_rcuwait(&slot_ptr->wait); \
+				return -ETIMEDOUT; \
+			} \
+			timeout = schedule_timeout(timeout); \
+		} \
+		finish_rcuwait(&slot_ptr->wait); \
+		*DataPtr = slot_ptr->data; \
+		return 0; \
+	} \
+\
+	static void CONCAT(CONCAT(Notification_, Name), _DeInit)( \
+		CONCAT(Notification_, Name) * InstancePtr) \
+	{ \
+	}
+
 //==============================================================================
 // Type Definitions
 //==============================================================================
@@ -134,7 +386,9 @@ typedef enum {
 	ERROR_INPUT,  // Input read error
 	ERROR_OUTPUT, // Output write error
 	ERROR_BUSY,   // Device is busy with previous operation
-	ERROR_OTHER   // Other errors
+	ERROR_OTHER,   // Other errors
+	ERROR_TIMEOUT, // Engine did not complete, even after resets
+	ERROR_FAULTED  // Not run: engine faulted, block has no kernel address
 } ORG_SIMPLE_Error;
 
 // Operation Mode
@@ -143,6 +397,61 @@ typedef enum {
 	ORG_SIMPLE_OPMODE_DECRYPT = 1  // Decryption mode
 } ORG_SIMPLE_OpMode;
 
+// Cipher Block Size (128-bit)
+#define ORG_SIMPLE_BLOCK_SIZE 16
+
+// Cipher Key Size (128-bit)
+#define ORG_SIMPLE_KEY_SIZE 16
+
+// Block Chaining Mode
+typedef enum {
+	ORG_SIMPLE_CHAIN_ECB = 0, // Electronic codebook (no chaining)
+	ORG_SIMPLE_CHAIN_CBC = 1, // Cipher block chaining
+	ORG_SIMPLE_CHAIN_CTR = 2, // Counter mode
+	ORG_SIMPLE_CHAIN_XTS = 3  // XEX tweakable mode with two keys
+} ORG_SIMPLE_ChainMode;
+
+// How the driver waits for an operation to complete
+typedef enum {
+	ORG_SIMPLE_COMPLETION_IRQ    = 0, // Sleep until the interrupt fires
+	ORG_SIMPLE_COMPLETION_POLL   = 1, // Spin for the full poll budget
+	ORG_SIMPLE_COMPLETION_HYBRID = 2  // Spin for an adaptive budget
+} ORG_SIMPLE_CompletionMode;
+
+#define ORG_SIMPLE_COMPLETION_MODES 3
+
+// Phases of a single-block ioctl operation on the engine (op_phases)
+typedef enum {
+	ORG_SIMPLE_PHASE_ALLOC	  = 0, // Bounce buffers from the pool
+	ORG_SIMPLE_PHASE_COPY_IN  = 1, // Key and input from userspace
+	ORG_SIMPLE_PHASE_QUEUE	  = 2, // Waiting for the engine
+	ORG_SIMPLE_PHASE_MMIO	  = 3, // Programming the registers
+	ORG_SIMPLE_PHASE_ENGINE	  = 4, // OAR write until seen done
+	ORG_SIMPLE_PHASE_WAKEUP	  = 5, // Seen done until the caller runs
+	ORG_SIMPLE_PHASE_COPY_OUT = 6  // Output to userspace
+} ORG_SIMPLE_OpPhase;
+
+#define ORG_SIMPLE_OP_PHASES 7
+
+// Where engine-or-CPU requests run (cpu_dispatch module parameter)
+typedef enum {
+	ORG_SIMPLE_DISPATCH_ENGINE = 0, // Always on the engine
+	ORG_SIMPLE_DISPATCH_AUTO   = 1, // By size, queue depth and throughput
+	ORG_SIMPLE_DISPATCH_CPU	   = 2	// Always in software
+} ORG_SIMPLE_Dispatch;
+
+// Every ORG_SIMPLE_DISPATCH_PROBE-th automatic choice for a request of at
+// most ORG_SIMPLE_SOFT_CHUNK blocks takes the other path, so that the cost
+// of the path that keeps losing is still measured
+#define ORG_SIMPLE_DISPATCH_PROBE 64
+
+// How operation records are mapped for the engine (dma_records parameter)
+typedef enum {
+	ORG_SIMPLE_DMA_AUTO	 = 0, // Streaming unless the device is coherent
+	ORG_SIMPLE_DMA_COHERENT	 = 1, // Coherent (uncached on non-coherent ARM)
+	ORG_SIMPLE_DMA_STREAMING = 2  // Cacheable, synced around each operation
+} ORG_SIMPLE_DmaRecords;
+
 // std.Result Variant Type
 typedef enum { RESULT_OK, RESULT_ERR } ResultVariant;
 
@@ -155,38 +464,356 @@ typedef struct {
 	} value;
 } Result_BoolError;
 
-#define RESULT_BOOLERROR_OK(ok) \
-	Result_BoolError \
+#define RESULT_BOOLERROR_OK(val) \
+	(Result_BoolError) \
 	{ \
-		.variant = RESULT_OK, .value.ok = (ok) \
+		.variant = RESULT_OK, .value.ok = (val) \
 	}
 
 #define RESULT_BOOLERROR_ERR(e) \
-	Result_BoolError \
+	(Result_BoolError) \
 	{ \
 		.variant = RESULT_ERR, .value.err = (e) \
 	}
 
 // HwBuffer
 typedef struct {
-	void *virt_addr;
-	void *bus_addr;
+	void *cpu_addr;
+	dma_addr_t bus_addr;
+	int slot;	// Pool slot index, or -1 if not pool-backed
+	bool streaming; // Cacheable: synced for the engine around each use
 } HwBuffer;
 
-// std.Notification<Error>
+// Per-operation DMA record: everything the engine reads and writes for one
+// block, in one cache line. KAR, IAR and OAR are programmed with the record's
+// bus address plus these offsets.
 typedef struct {
+	u8 key[ORG_SIMPLE_KEY_SIZE]; // First: a record can stand for its key
+	u8 input[ORG_SIMPLE_BLOCK_SIZE];
+	u8 output[ORG_SIMPLE_BLOCK_SIZE];
+} __aligned(SMP_CACHE_BYTES) HwOpRecord;
+
+// Register interface of an engine (OF match data)
+typedef enum {
+	ORG_SIMPLE_HW_VER2 = 0, // SimpleAES_ver2.rseq
+	ORG_SIMPLE_HW_VER3 = 1	// SimpleAES_ver3.rseq: ver2 and a descriptor ring
+} ORG_SIMPLE_HwVersion;
+
+// Descriptor ring (ver3 engines): the engine fetches descriptors from RHEAD
+// up to RTAIL, runs COUNT consecutive blocks of each with one key and writes
+// DSTAT back. Indices are free-running; descriptor i is in entry
+// i % ORG_SIMPLE_RING_ENTRIES.
+#define ORG_SIMPLE_RING_ORDER	    5 // RCFG.SIZE
+#define ORG_SIMPLE_RING_ENTRIES	    (1U << ORG_SIMPLE_RING_ORDER)
+#define ORG_SIMPLE_RING_DESC_BLOCKS 8 // Blocks per descriptor
+
+typedef struct {
+	__le32 ctrl; // DCTRL: OP, IRQ and COUNT
+	__le32 kar;  // Key address
+	__le32 iar;  // Address of the first input block
+	__le32 oar;  // Address of the first output block
+	__le32 stat; // DSTAT: written by the engine, last
+	__le32 reserved[3];
+} HwDesc;
+
+// Everything the engine reads and writes for a burst of ring descriptors,
+// in one coherent allocation: the descriptors, the burst's key and bounce
+// blocks for each entry
+typedef struct {
+	HwDesc descs[ORG_SIMPLE_RING_ENTRIES];
+	u8 key[ORG_SIMPLE_KEY_SIZE] __aligned(SMP_CACHE_BYTES);
+	struct {
+		u8 input[ORG_SIMPLE_RING_DESC_BLOCKS * ORG_SIMPLE_BLOCK_SIZE];
+		u8 output[ORG_SIMPLE_RING_DESC_BLOCKS * ORG_SIMPLE_BLOCK_SIZE];
+	} __aligned(SMP_CACHE_BYTES) data[ORG_SIMPLE_RING_ENTRIES];
+} HwRingArea;
+
+// Software side of a posted descriptor
+typedef struct {
+	unsigned int first;   // First batch block
+	unsigned int count;   // Blocks (DCTRL.COUNT)
+	bool bounce;	      // Output is copied out of the ring area
+	ORG_SIMPLE_Error err; // Staging error (posted with COUNT 0)
+} RingSlot;
+
+// Descriptor ring. head and tail are only used by the scheduler ticket
+// holder; the interrupt thread wakes wq on IRQ.RING.
+typedef struct {
+	HwRingArea *area;
+	dma_addr_t bus_addr;
+	RingSlot slots[ORG_SIMPLE_RING_ENTRIES];
+	u32 head; // Next descriptor to drain
+	u32 tail; // Next descriptor to post (RTAIL)
 	wait_queue_head_t wq;
-	ORG_SIMPLE_Error data;
-	bool flag;
-} Notification_Error;
+	atomic64_t blocks;
+	atomic64_t descs;
+	atomic64_t doorbells;
+	atomic64_t wakeups; // IRQ.RING interrupts
+} DescRing;
+
+// std.Pool<HwBuffer> of HwOpRecord
+typedef struct {
+	struct device *dev_ptr;
+	struct dma_pool *dma_pool_ptr; // Cache-line-aligned record allocator
+	bool streaming;		       // kmalloc-ed records, mapped once
+	unsigned int max_depth;
+	atomic_t depth;		 // Grown slots (failed grows leave no record)
+	HwBuffer *slots;	 // Slot storage (max_depth entries)
+	unsigned long *busy_map; // Slot ownership bitmap
+	atomic64_t hits;	 // Requests served from a free slot
+	atomic64_t misses;	 // Requests that had to allocate
+} HwBufferPool;
+
+// Pinned user buffer, DMA-mapped page by page
+typedef struct {
+	struct page **pages;
+	dma_addr_t *page_bus; // Bus address of the buffer's part of each page
+	unsigned int num_pages;
+	unsigned int first_offset; // Offset of the buffer in its first page
+	size_t len;
+	enum dma_data_direction dir;
+} UserDmaMap;
+
+// Registered (fixed) user buffer
+typedef struct {
+	UserDmaMap map;
+	size_t len;
+} FixedBuffer;
+
+// Registered key (owned by an open file)
+typedef struct {
+	u32 handle;
+	int slot;      // Key table slot caching this key, or -1
+	u8 material[]; // ORG_SIMPLE_KEY_SIZE bytes
+} KeyEntry;
+
+// Key table slot
+typedef struct {
+	KeyEntry *key_ptr;	// Cached key, or NULL if the slot is free
+	struct list_head lru;	// Link in the key table LRU list
+	unsigned int pin_count; // Operations currently using this slot
+} KeyTableSlot;
+
+// DMA-resident key table caching registered keys
+typedef struct {
+	struct mutex lock;
+	HwBuffer table;		// One coherent buffer holding all slots
+	KeyTableSlot *slots;
+	unsigned int num_slots;
+	struct list_head lru;	// Most recently used slot first
+	atomic64_t hits;	// Key found in a slot
+	atomic64_t misses;	// Key had to be loaded into a slot
+	atomic64_t evictions;	// Loads that displaced another key
+} KeyTable;
+
+// Recent completion latencies (ns) of one completion mode
+#define ORG_SIMPLE_LATENCY_SAMPLES 1024
+
+typedef struct {
+	spinlock_t lock;
+	u32 samples[ORG_SIMPLE_LATENCY_SAMPLES];
+	unsigned int count; // Valid samples (saturates at the array size)
+	unsigned int next;  // Next sample to overwrite
+} LatencyStats;
+
+// Time spent per phase by the single-block operations of one engine
+typedef struct {
+	atomic64_t ops;				 // Operations recorded
+	atomic64_t phase_ns[ORG_SIMPLE_OP_PHASES]; // Total time per phase
+} OpPhaseStats;
+
+// Always-on per-CPU statistics (debugfs). Histograms are log2: bucket i
+// counts values v with fls64(v) == i, the last bucket everything above.
+#define ORG_SIMPLE_HIST_BUCKETS 32
+#define ORG_SIMPLE_HIST_OP	(ORG_SIMPLE_OP_PHASES + 0) // Whole op (ns)
+#define ORG_SIMPLE_HIST_LOCK	(ORG_SIMPLE_OP_PHASES + 1) // Lock wait (ns)
+#define ORG_SIMPLE_HIST_DEPTH	(ORG_SIMPLE_OP_PHASES + 2) // Queue depth
+#define ORG_SIMPLE_HIST_RESET	(ORG_SIMPLE_OP_PHASES + 3) // Recovery (ns)
+#define ORG_SIMPLE_HISTS	(ORG_SIMPLE_OP_PHASES + 4)
+
+#define ORG_SIMPLE_ERRORS (ERROR_TIMEOUT + 1)
+
+typedef struct {
+	u64 ops;			// Engine completions
+	u64 bytes;			// Bytes they carried
+	u64 errors[ORG_SIMPLE_ERRORS];	// Completions by error code
+	u64 cpu_ops;			// Requests run in software
+	u64 cpu_bytes;			// Bytes they carried
+	u64 busy;			// Operations refused: engine busy
+	u64 lock_contended;		// Regfile lock waits
+	u64 timeouts;			// Waits past the operation deadline
+	u64 resets;			// Engine resets (STAT.BUSY stuck)
+	u64 requeues;			// Operations restarted after a reset
+	u64 reset_ns;			// Time spent resetting the engine
+	u64 hist[ORG_SIMPLE_HISTS][ORG_SIMPLE_HIST_BUCKETS];
+} SimpleAESStats;
+
+// Maximum number of engine instances (minor 0 is the aggregate node)
+#define ORG_SIMPLE_MAX_DEVICES 16
+
+// Engine scheduler client: one per open file and engine, plus one for the
+// Crypto API. Tickets of a client run in order; clients share the engine in
+// proportion to their weights.
+typedef struct {
+	struct list_head node;	// Link in the scheduler's active list
+	struct list_head queue;	// Waiting tickets (SchedTicket)
+	unsigned int weight;	// Relative share of the engine
+	u64 vtime;		// Virtual time: blocks charged, over weight
+} SchedClient;
+
+// One engine hold waiting for (or holding) the engine
+typedef struct {
+	struct list_head node;	  // Link in the client's queue
+	u64 tag;		  // Matches the operation's completion
+	unsigned int cost;	  // Blocks run while holding the engine
+	struct completion grant;  // Completed when the engine is handed over
+} SchedTicket;
+
+// Engine scheduler (one per device)
+typedef struct {
+	spinlock_t lock;
+	struct list_head active;   // Clients with waiting tickets, in turn order
+	bool busy;		   // A ticket holds the engine
+	u64 next_tag;
+	u64 current_tag;	   // Tag of the ticket holding the engine
+	unsigned int current_cost; // Blocks of the ticket holding the engine
+	unsigned int queued;	   // Blocks of the holding and waiting tickets
+	u64 waits;		   // Tickets that had to wait for the engine
+	u64 vclock;		   // Virtual start time of the holding ticket
+	SchedClient *current_client; // Client of the ticket holding the engine
+	SchedClient *idle_client;    // Client the idle engine is kept for
+	struct hrtimer idle_timer;   // Ends the wait for idle_client
+	u64 idle_holds;		     // Times the engine was kept idle
+	u64 idle_hits;		     // ... and the client came back in time
+} Scheduler;
+
+// Pipelined batch: up to ORG_SIMPLE_PIPELINE_DEPTH blocks are staged ahead
+// of the engine. The interrupt handler starts the next staged block, so the
+// caller copies data in and out while the engine runs.
+#define ORG_SIMPLE_PIPELINE_DEPTH 3
+
+typedef struct {
+	HwBuffer op_buf;     // HwOpRecord holding the three below
+	HwBuffer key_buf;
+	HwBuffer input_buf;  // Bounce buffers only
+	HwBuffer output_buf;
+	void *loaded_key;    // User key held in key_buf
+	u32 input_addr;	     // Addresses programmed for the staged block
+	u32 output_addr;
+	void *o_data_ptr;    // Where the drained output goes (bounce only)
+	ORG_SIMPLE_Error err; // Staging error, then the engine's result
+	u64 done_ns;	     // When the interrupt handler took the result
+} PipeSlot;
+
+// Block counters only grow; block n uses slot n % ORG_SIMPLE_PIPELINE_DEPTH.
+// started and completed are updated under the regfile lock.
+typedef struct {
+	PipeSlot slots[ORG_SIMPLE_PIPELINE_DEPTH];
+	unsigned int staged;	// Blocks ready for the engine
+	unsigned int started;	// Blocks whose OAR write has been issued
+	unsigned int completed; // Blocks the engine has finished
+	unsigned int drained;	// Blocks whose results were handed back
+	u64 issue_ns;		// Start of the running block
+	u64 busy_ns;		// Engine time spent on the batch's blocks
+	wait_queue_head_t wq;	// Woken on every completion
+} Pipeline;
+
+// std.Notification<Error> (tags are scheduler tags)
+NOTIFICATION_DECLARE_TYPE(Error, ORG_SIMPLE_Error);
+
+// AES known-answer vector (the engine only checks the 128-bit ones)
+typedef struct {
+	unsigned int key_len;
+	u8 key[AES_MAX_KEY_SIZE];
+	u8 plain[ORG_SIMPLE_BLOCK_SIZE];
+	u8 cipher[ORG_SIMPLE_BLOCK_SIZE];
+} KnownAnswer;
+
+// Software ecb(aes) transforms for batches run on the CPU. Each is keyed by
+// one batch at a time; idle ones are kept for the next batch.
+#define ORG_SIMPLE_SOFT_TFMS 8
+
+// Blocks a software batch loads, runs and stores at a time
+#define ORG_SIMPLE_SOFT_CHUNK 256
+
+typedef struct {
+	spinlock_t lock;
+	unsigned int count; // Idle transforms at the bottom of tfms
+	struct crypto_skcipher *tfms[ORG_SIMPLE_SOFT_TFMS];
+} SoftCipherPool;
 
 // SimpleAES Instance Data
 typedef struct {
+	// Engine instances (global list, see SimpleAES_AcquireIdle)
+	struct list_head node;
+	int id;			// Instance number: /dev/simpleaes<id>
+	atomic_t queue_depth;	// Operations queued or running here
+	atomic_t open_files;	// Files homed here (see SimpleAES_remove)
+
 	// Notification ("irq notifications")
 	Notification_Error notif;
 
-	// Interrupt("simpleaes-irq")
+	// DMA buffer pool
+	HwBufferPool buf_pool;
+
+	// Registered key cache
+	KeyTable key_table;
+
+	// Batches that bypassed the bounce buffers
+	atomic64_t zerocopy_batches;
+
+	// Pipelined batch holding the engine (regfile lock), and its totals
+	Pipeline *pipe_ptr;
+	atomic64_t pipeline_blocks;
+	atomic64_t pipeline_busy_ns; // Engine busy time
+	atomic64_t pipeline_span_ns; // Time the pipeline held the engine
+
+	// Descriptor ring, NULL unless the engine has one (ver3)
+	DescRing *ring_ptr;
+
+	// Hands the engine to one operation at a time (sync and async callers)
+	Scheduler sched;
+	SchedClient crypto_client; // Crypto API requests
+
+	// Executor for asynchronous requests
+	struct workqueue_struct *async_wq;
+
+	// Request queue for the Crypto API (skcipher) provider
+	struct crypto_engine *crypto_engine;
+
+	// Completion latency per completion mode
+	LatencyStats latency[ORG_SIMPLE_COMPLETION_MODES];
+	u64 poll_ewma_ns; // Moving average of polled completion times
+
+	// Per-phase cost of single-block operations
+	OpPhaseStats op_phases;
+	u64 reap_ns; // When the last completion was seen (regfile lock)
+
+	// Per-CPU counters and histograms, and their debugfs directory
+	SimpleAESStats __percpu *stats;
+	struct dentry *debugfs_dir;
+
+	// Software AES path (see SimpleAES_PreferCpu). Request costs are per
+	// block, copies included, for single blocks [0] and batches [1].
+	bool engine_faulted;	  // Engine failed the known-answer test
+	u64 engine_ewma_ns;	  // Moving average engine time per block
+	u64 engine_cost_ns[2];	  // Engine requests, without queueing
+	u64 cpu_ewma_ns[2];	  // Software requests
+	atomic64_t cpu_requests;  // Requests served in software
+	atomic_t dispatch_seq;	  // Automatic choices (probing)
+	SoftCipherPool soft_pool; // ecb(aes) for software batches
+
+	// Interrupt("simpleaes-irq"): the top half masks IE and the thread
+	// drains completions, then re-arms it
 	int irq_line;
+	bool irq_rearm; // IE masked by the top half (regfile lock)
+	struct {
+		unsigned int budget; // Completions reaped before yielding
+		unsigned int frames; // Wakeup size from which the thread polls
+		unsigned int usecs;  // How long to poll for the next completion
+	} irq_coalesce;
+	atomic64_t irq_wakeups;
+	atomic64_t irq_completions;
 
 	// Clock("simpleaes-clock")
 	struct clock *axi_clock;
@@ -195,6 +822,9 @@ typedef struct {
 	struct {
 		void __iomem *ptr;
 		struct spinlock_t lock;
+		u32 shadow[SIMPLEAES_REGS]; // Software-owned registers
+		bool gated; // Clock off: the registers must not be accessed
+		bool inflight; // OAR written, completion not reaped yet
 	} regfile;
 
 	// CDEV Interface
@@ -202,7 +832,6 @@ typedef struct {
 	struct {
 		dev_t devno;
         struct cdev cdev;
-		struct class *class_ptr;
 		struct device *device_ptr;
 	} cdev;
 
@@ -210,6 +839,135 @@ typedef struct {
 	struct platform_device *pdev_ptr;
 } SimpleAES;
 
+// Ring submission queue entry (shared with userspace)
+typedef struct {
+	u8 opcode;	 // ORG_SIMPLE_OpMode
+	u8 flags;	 // SIMPLEAES_SQE_* flags
+	u16 reserved;
+	u32 key;	 // Key offset in the data area, or registered key handle
+	u32 in_offset;	 // Offset of the first input block in the data area
+	u32 out_offset;	 // Offset of the first output block in the data area
+	u32 num_blocks;
+	u64 user_data;	 // Echoed back in the completion
+} RingSqe;
+
+// Ring completion queue entry (shared with userspace)
+typedef struct {
+	u64 user_data;
+	s32 result; // ORG_SIMPLE_Error
+	u32 reserved;
+} RingCqe;
+
+// Ring indices and flags (shared with userspace)
+typedef struct {
+	u32 sq_head;  // Written by the driver
+	u32 sq_tail;  // Written by userspace
+	u32 cq_head;  // Written by userspace
+	u32 cq_tail;  // Written by the driver
+	u32 sq_flags; // SIMPLEAES_RING_NEED_WAKEUP
+} RingHeader;
+
+struct FileContext;
+
+// Shared-memory submission/completion ring
+typedef struct {
+	struct FileContext *file_ptr;
+	struct mutex lock;  // Serializes submission queue consumption
+	HwBuffer region;    // Header, SQ, CQ and data area (mmap-ed)
+	size_t region_size;
+	RingHeader *hdr_ptr;
+	RingSqe *sq_ptr;
+	RingCqe *cq_ptr;
+	u8 *data_ptr;
+	dma_addr_t data_bus_addr;
+	unsigned int sq_entries;
+	unsigned int cq_entries;
+	unsigned int data_size;
+	u32 sq_head; // Private copies, userspace cannot move them back
+	u32 cq_tail;
+
+	// Kernel-side submission polling
+	struct task_struct *sqpoll_task;
+	unsigned int sq_idle_ms;
+	wait_queue_head_t sqpoll_wq;
+
+	// Waiters for completions
+	wait_queue_head_t cq_wq;
+} Ring;
+
+// Per-open-file state
+typedef struct FileContext {
+	SimpleAES *simpleaes_ptr; // Home engine (keys, buffers, ring)
+	bool aggregate;		  // Opened through the aggregate node
+	struct mutex lock;
+	struct idr keys; // Registered keys (KeyEntry) by handle
+	Ring *ring_ptr;	 // Submission/completion ring, if set up
+	struct rw_semaphore bufs_lock; // Held for reading while in use
+	FixedBuffer *bufs;	       // Registered buffers
+	unsigned int num_bufs;
+	ORG_SIMPLE_CompletionMode completion; // Used by every op on this file
+
+	// Engine scheduling
+	SchedClient sched[ORG_SIMPLE_MAX_DEVICES]; // Indexed by engine id
+	atomic_t sched_queued;	// Synchronous operations admitted
+	wait_queue_head_t sched_wq; // Waiters for an admission slot
+
+	// Asynchronous requests
+	spinlock_t async_lock;
+	struct list_head async_done;	 // Completed, not yet read (AsyncRequest)
+	unsigned int async_running;	 // Submitted, not yet completed
+	unsigned int async_outstanding; // Submitted, not yet read
+	u64 async_next_tag;
+	wait_queue_head_t async_wq;	 // Completions and drain on release
+	struct eventfd_ctx *eventfd;	 // Signalled on every completion
+} FileContext;
+
+// IOCTL Asynchronous Completion (returned by read() on the device)
+typedef struct {
+	u64 tag;	       // Tag returned by IOCTL_SUBMIT
+	u64 user_data;	       // Copied from the submission
+	s32 result;	       // ORG_SIMPLE_Error
+	unsigned int num_done; // Blocks processed
+} IOCTL_AsyncCompletion;
+
+// Asynchronous request (owned by the driver until read)
+typedef struct {
+	struct work_struct work;
+	struct list_head node; // Link in the file's async_done list
+	FileContext *file_ptr;
+	SimpleAES *simpleaes_ptr; // Engine running the request
+	ORG_SIMPLE_OpMode mode;
+	ORG_SIMPLE_CompletionMode completion;
+	bool key_registered;	// key_buf is a key table slot
+	HwBuffer key_buf;	// Otherwise an HwOpRecord (key first)
+	bool in_place;		// output_map is input_map
+	UserDmaMap input_map;
+	UserDmaMap output_map;
+	unsigned int num_blocks;
+	IOCTL_AsyncCompletion cqe;
+} AsyncRequest;
+
+// Crypto API transform context (one per skcipher tfm)
+typedef struct {
+	struct crypto_engine_ctx enginectx; // Must be first (crypto_engine)
+	u8 key[AES_KEYSIZE_128];
+	bool use_fallback; // Key length the engine does not implement
+	struct crypto_skcipher *fallback;
+} SkcipherCtx;
+
+// Crypto API request context (one per skcipher_request)
+typedef struct {
+	ORG_SIMPLE_OpMode mode;
+	SimpleAES *simpleaes_ptr; // Engine the request was queued on
+	struct skcipher_request fallback_req; // Must be last (variable size)
+} SkcipherReqCtx;
+
+// Crypto API algorithm (skcipher_alg tagged with its chaining mode)
+typedef struct {
+	ORG_SIMPLE_ChainMode chain;
+	struct skcipher_alg alg;
+} SkcipherAlg;
+
 // IOCTL Encrypt/Decrypt Data
 typedef struct {
 	void *key_ptr;
@@ -217,14 +975,209 @@ typedef struct {
 	void *o_data_ptr;
 } IOCTL_Data;
 
+// IOCTL Batch Block Descriptor
+typedef struct {
+	void *key_ptr;
+	void *i_data_ptr;
+	void *o_data_ptr;
+	ORG_SIMPLE_Error err; // Per-block result (written by the driver)
+} IOCTL_Block;
+
+// IOCTL Batch Encrypt/Decrypt Data
+//
+// Descriptor mode: blocks_ptr points to num_blocks IOCTL_Block entries.
+// Contiguous mode: blocks_ptr is NULL, key_ptr is used for every block,
+// i_data_ptr/o_data_ptr point to num_blocks consecutive blocks and the
+// per-block results are written to err_ptr (optional).
+typedef struct {
+	IOCTL_Block *blocks_ptr;
+	void *key_ptr;
+	void *i_data_ptr;
+	void *o_data_ptr;
+	ORG_SIMPLE_Error *err_ptr;
+	unsigned int num_blocks;
+	unsigned int num_done;	 // Blocks processed (written by the driver)
+	unsigned int num_failed; // Blocks that failed (written by the driver)
+} IOCTL_BatchData;
+
+// IOCTL Key Registration Data
+typedef struct {
+	void *key_ptr;	     // Key to register (IOCTL_SET_KEY)
+	unsigned int handle; // Key handle (returned by IOCTL_SET_KEY)
+} IOCTL_KeyData;
+
+// IOCTL Encrypt/Decrypt Data with a registered key
+//
+// Fails with -EBUSY while every key table slot is pinned by operations in
+// flight, and with -ENOENT for an unknown handle.
+typedef struct {
+	unsigned int handle;
+	void *i_data_ptr;
+	void *o_data_ptr;
+} IOCTL_KeyedData;
+
+// IOCTL Buffer Registration Data
+typedef struct {
+	void *addr;
+	size_t len;
+} IOCTL_BufferRegion;
+
+typedef struct {
+	IOCTL_BufferRegion *regions_ptr;
+	unsigned int num_regions;
+} IOCTL_BufferSet;
+
+// IOCTL Encrypt/Decrypt Data on registered buffers
+//
+// Blocks are read from buffer in_index at in_offset and written to buffer
+// out_index at out_offset, using the registered key handle.
+typedef struct {
+	unsigned int handle;
+	unsigned int in_index;
+	unsigned int in_offset;
+	unsigned int out_index;
+	unsigned int out_offset;
+	unsigned int num_blocks;
+	unsigned int num_done; // Blocks processed (written by the driver)
+} IOCTL_FixedData;
+
+// IOCTL Asynchronous Submission Data
+//
+// Input and output must be block-aligned; they are pinned for the
+// lifetime of the request. Completions are read() from the device.
+typedef struct {
+	unsigned int opcode; // ORG_SIMPLE_OpMode
+	unsigned int flags;  // SIMPLEAES_SUBMIT_* flags
+	void *key_ptr;	     // Key (unless SIMPLEAES_SUBMIT_KEY_HANDLE)
+	unsigned int handle; // Registered key handle
+	void *i_data_ptr;
+	void *o_data_ptr;
+	unsigned int num_blocks;
+	u64 user_data;
+	u64 tag; // Request tag (written by the driver)
+} IOCTL_AsyncSubmit;
+
+// IOCTL Eventfd Binding Data
+typedef struct {
+	int fd; // eventfd to signal on completion, or -1 to unbind
+} IOCTL_EventfdData;
+
+// IOCTL Completion Mode Data
+typedef struct {
+	unsigned int mode; // ORG_SIMPLE_CompletionMode
+} IOCTL_CompletionData;
+
+// IOCTL Scheduling Weight Data
+typedef struct {
+	unsigned int weight; // Engine share relative to other files
+} IOCTL_WeightData;
+
+// IOCTL Ring Setup Data
+//
+// The ring is mapped with mmap(fd, 0, mmap_size). sq_off, cq_off and
+// data_off locate the SQE array, the CQE array and the data area inside
+// the mapping; the RingHeader sits at offset 0. The rings of all files
+// share module parameter ring_mem_max bytes; setup fails with -ENOMEM past it.
+// SIMPLEAES_RING_SQPOLL needs CAP_SYS_NICE unless module parameter
+// ring_sqpoll is set, and fails with -EPERM otherwise.
+typedef struct {
+	unsigned int sq_entries; // Power of two
+	unsigned int cq_entries; // Power of two
+	unsigned int data_size;
+	unsigned int flags;	 // SIMPLEAES_RING_SQPOLL
+	unsigned int sq_idle_ms; // SQPOLL idle time before sleeping (<= 1000)
+	unsigned int sq_off;	 // Written by the driver
+	unsigned int cq_off;	 // Written by the driver
+	unsigned int data_off;	 // Written by the driver
+	unsigned int mmap_size;	 // Written by the driver
+} IOCTL_RingSetup;
+
+// IOCTL Ring Doorbell Data
+//
+// min_complete may not exceed cq_entries. With SQPOLL, any enter wakes the
+// thread if reaping made room for queued entries; asleep, it also looks at
+// cq_head every tick while entries wait for room.
+typedef struct {
+	unsigned int to_submit;
+	unsigned int min_complete;
+	unsigned int flags;	// SIMPLEAES_ENTER_* flags
+	unsigned int submitted; // Written by the driver
+} IOCTL_RingEnter;
+
+// IOCTL Chained Encrypt/Decrypt Data
+//
+// iv holds the CBC IV, the CTR initial counter block or the XTS tweak. For
+// CBC and CTR it is updated on return so that a stream can be continued
+// with another request. length must be a multiple of ORG_SIMPLE_BLOCK_SIZE,
+// except for CTR where the last block may be partial.
+typedef struct {
+	ORG_SIMPLE_ChainMode chain;
+	void *key_ptr;
+	void *tweak_key_ptr; // XTS only
+	void *i_data_ptr;
+	void *o_data_ptr;
+	unsigned int length;
+	u8 iv[ORG_SIMPLE_BLOCK_SIZE];
+} IOCTL_ChainData;
+
 // =============================================================================
 // Constant Definitions
 // =============================================================================
 
 #define SIMPLEAES_DEVICE_NAME "simpleaes"
 
-// Key and Data Size
-static const unsigned int ORG_SIMPLE_KD_SIZE = 128;
+// Key and Data Size (bytes of one key or block, and the stride of blocks in
+// batch and ring buffers)
+static const unsigned int ORG_SIMPLE_KD_SIZE = ORG_SIMPLE_BLOCK_SIZE;
+
+// Maximum number of blocks in a single batch request
+static const unsigned int ORG_SIMPLE_BATCH_MAX_BLOCKS = 65536;
+
+// Maximum number of keys registered through one open file
+static const unsigned int ORG_SIMPLE_MAX_KEYS_PER_FILE = 1024;
+
+// Registered buffer limits (per open file)
+static const unsigned int ORG_SIMPLE_MAX_FIXED_BUFS    = 64;
+static const size_t ORG_SIMPLE_FIXED_BUF_MAX_LEN = 64 * 1024 * 1024;
+
+// Ring limits
+static const unsigned int ORG_SIMPLE_RING_MAX_ENTRIES = 4096;
+static const unsigned int ORG_SIMPLE_RING_MAX_DATA    = 4 * 1024 * 1024;
+
+// Longest time an SQPOLL thread may poll an idle ring before it sleeps
+static const unsigned int ORG_SIMPLE_RING_MAX_SQ_IDLE_MS = 1000;
+
+// Maximum number of submitted but unread asynchronous requests per file
+static const unsigned int ORG_SIMPLE_ASYNC_MAX_OUTSTANDING = 256;
+
+#define SIMPLEAES_SUBMIT_KEY_HANDLE 0x1 // Submission uses a registered key
+
+// Largest scheduling weight a file can ask for
+static const unsigned int ORG_SIMPLE_SCHED_MAX_WEIGHT = 64;
+
+// Virtual time one block costs a client of weight 1
+#define ORG_SIMPLE_SCHED_BLOCK_VTIME (1u << 16)
+
+// Interrupt coalescing defaults (tunable per device through sysfs)
+static const unsigned int ORG_SIMPLE_IRQ_BUDGET	    = 64;
+static const unsigned int ORG_SIMPLE_IRQ_COALESCE_FRAMES    = 4;
+static const unsigned int ORG_SIMPLE_IRQ_COALESCE_USECS	    = 20;
+static const unsigned int ORG_SIMPLE_IRQ_COALESCE_MAX_USECS = 1000;
+
+// Ring flags
+#define SIMPLEAES_RING_SQPOLL	   0x1 // Setup: kernel thread polls the SQ
+#define SIMPLEAES_RING_NEED_WAKEUP 0x1 // sq_flags: SQPOLL thread is asleep
+#define SIMPLEAES_SQE_KEY_HANDLE   0x1 // SQE key is a registered key handle
+#define SIMPLEAES_ENTER_GETEVENTS  0x1 // Wait for min_complete completions
+#define SIMPLEAES_ENTER_SQ_WAKEUP  0x2 // Wake up the SQPOLL thread
+
+// Maximum length of a chained request, and the bounce chunk it is
+// streamed through
+static const unsigned int ORG_SIMPLE_CHAIN_MAX_LEN    = 1024 * 1024;
+static const unsigned int ORG_SIMPLE_CHAIN_CHUNK_SIZE = 4096;
+
+// Bytes copied each way per buffer size by the debugfs dma_bench
+#define ORG_SIMPLE_DMA_BENCH_BYTES (4 * 1024 * 1024)
 
 //==============================================================================
 // IOCTL
@@ -232,7 +1185,25 @@ static const unsigned int ORG_SIMPLE_KD_SIZE = 128;
 
 #define IOCTL_MAGIC 'z'
 
-#define IOCTL_ENCRYPT __IOWR(IOCTL_MAGIC, 1, IOCTL_Data *);
-#define IOCTL_DECRYPT __IOWR(IOCTL_MAGIC, 2, IOCTL_Data *);
+#define IOCTL_ENCRYPT	    __IOWR(IOCTL_MAGIC, 1, IOCTL_Data *)
+#define IOCTL_DECRYPT	    __IOWR(IOCTL_MAGIC, 2, IOCTL_Data *)
+#define IOCTL_ENCRYPT_BATCH __IOWR(IOCTL_MAGIC, 3, IOCTL_BatchData *)
+#define IOCTL_DECRYPT_BATCH __IOWR(IOCTL_MAGIC, 4, IOCTL_BatchData *)
+#define IOCTL_ENCRYPT_CHAIN __IOWR(IOCTL_MAGIC, 5, IOCTL_ChainData *)
+#define IOCTL_DECRYPT_CHAIN __IOWR(IOCTL_MAGIC, 6, IOCTL_ChainData *)
+#define IOCTL_SET_KEY	    __IOWR(IOCTL_MAGIC, 7, IOCTL_KeyData *)
+#define IOCTL_CLEAR_KEY	    __IOWR(IOCTL_MAGIC, 8, IOCTL_KeyData *)
+#define IOCTL_ENCRYPT_KEYED __IOWR(IOCTL_MAGIC, 9, IOCTL_KeyedData *)
+#define IOCTL_DECRYPT_KEYED __IOWR(IOCTL_MAGIC, 10, IOCTL_KeyedData *)
+#define IOCTL_RING_SETUP    __IOWR(IOCTL_MAGIC, 11, IOCTL_RingSetup *)
+#define IOCTL_RING_ENTER    __IOWR(IOCTL_MAGIC, 12, IOCTL_RingEnter *)
+#define IOCTL_REGISTER_BUFFERS	 __IOWR(IOCTL_MAGIC, 13, IOCTL_BufferSet *)
+#define IOCTL_UNREGISTER_BUFFERS __IOWR(IOCTL_MAGIC, 14, IOCTL_BufferSet *)
+#define IOCTL_ENCRYPT_FIXED	 __IOWR(IOCTL_MAGIC, 15, IOCTL_FixedData *)
+#define IOCTL_DECRYPT_FIXED	 __IOWR(IOCTL_MAGIC, 16, IOCTL_FixedData *)
+#define IOCTL_SET_COMPLETION	 __IOWR(IOCTL_MAGIC, 17, IOCTL_CompletionData *)
+#define IOCTL_SUBMIT		 __IOWR(IOCTL_MAGIC, 18, IOCTL_AsyncSubmit *)
+#define IOCTL_SET_EVENTFD	 __IOWR(IOCTL_MAGIC, 19, IOCTL_EventfdData *)
+#define IOCTL_SET_WEIGHT	 __IOWR(IOCTL_MAGIC, 20, IOCTL_WeightData *)
 
 #endif // ORG_SIMPLE_SIMPLEAES_H
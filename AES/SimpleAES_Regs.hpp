@@ -0,0 +1,349 @@
+#ifndef ORG_SIMPLE_SIMPLEAES_REGS_HPP
+#define ORG_SIMPLE_SIMPLEAES_REGS_HPP
+
+// Typed register accessors for the SimpleAES register file (C++20,
+// header-only).
+//
+// A materialization of the SystemRDL block in SimpleAES.md, like the
+// SIMPLEAES_* macros in SimpleAES_Linux.h, for userspace programs, tests and
+// models. Registers are types (CTRL, STAT, ...) and their fields constexpr
+// objects (CTRL::OP, CTRL::IE, ...) carrying position, mask and software
+// access at compile time:
+//
+//	Reg<CTRL>::modify(bus, CTRL::OP = 1, CTRL::IE = 1); // 1 read, 1 write
+//	Reg<CTRL>::modify(bus, ctrl_shadow, CTRL::OP = 0);  // 1 write
+//	Reg<IRQ>::write(bus, IRQ::COMPLETE = 1);           // clears COMPLETE
+//	if (Field<STAT::BUSY>::read(bus)) { ... }
+//
+// Field values of another register, writes to read-only fields and shadows
+// of registers the engine changes do not compile. Any number of field
+// updates to one register merge into a single store.
+//
+// A bus (RegisterBus) is any type with
+//
+//	u32 read(u32 offset);
+//	void write(u32 offset, u32 val);
+//
+// IoMemBus maps them onto a mapped register window (e.g. a UIO mapping).
+
+#include <concepts>
+#include <cstdint>
+#include <type_traits>
+
+namespace org::simple::simpleaes
+{
+
+using u32 = std::uint32_t;
+
+template <typename Bus>
+concept RegisterBus = requires(Bus &bus, u32 offset, u32 val) {
+	{ bus.read(offset) } -> std::convertible_to<u32>;
+	bus.write(offset, val);
+};
+
+//==============================================================================
+// Register File Model
+//==============================================================================
+
+// Software access of a field (SystemRDL sw property)
+enum class Access {
+	RW,  // sw = rw
+	RO,  // sw = r
+	W1C, // sw = woclr
+};
+
+// A value for one field, bound to the field's register
+template <typename R> struct FieldValue {
+	u32 mask;
+	u32 bits;
+};
+
+template <typename R, unsigned Msb, unsigned Lsb, Access A = Access::RW,
+	  u32 Reset = 0>
+struct FieldSpec {
+	static_assert(Msb >= Lsb && Msb < 32,
+		      "field outside a 32-bit register");
+
+	using reg = R;
+
+	static constexpr unsigned pos	= Lsb;
+	static constexpr unsigned width = Msb - Lsb + 1;
+	static constexpr u32 mask =
+		static_cast<u32>(((1ull << width) - 1) << Lsb);
+	static constexpr Access access = A;
+	static constexpr u32 reset     = Reset;
+
+	// CTRL::OP = 1 builds a value for modify() and write()
+	constexpr FieldValue<R> operator=(u32 val) const
+	{
+		static_assert(A != Access::RO, "read-only field");
+		return { mask, (val << pos) & mask };
+	}
+
+	static constexpr u32 get(u32 word)
+	{
+		return (word & mask) >> pos;
+	}
+
+	static constexpr u32 set(u32 word, u32 val)
+	{
+		return (word & ~mask) | ((val << pos) & mask);
+	}
+};
+
+//==============================================================================
+// SimpleAES Register File
+//==============================================================================
+
+// Software owns every register but STAT, IRQ, RHEAD and RCIDX: the engine
+// never changes them, so their last written value (Shadow) is their content.
+// RBAR to RCIDX and IRQ::RING exist on ver3 (descriptor ring) engines only.
+
+struct CTRL {
+	static constexpr u32 offset	    = 0x00;
+	static constexpr bool software_owned = true;
+
+	static constexpr FieldSpec<CTRL, 0, 0> OP{}; // Operation field
+	static constexpr FieldSpec<CTRL, 1, 1> IE{}; // Interrupt enable field
+
+	static constexpr u32 reset    = 0x00;
+	static constexpr u32 w1c_mask = 0;
+};
+
+struct STAT {
+	static constexpr u32 offset	    = 0x04;
+	static constexpr bool software_owned = false;
+
+	static constexpr FieldSpec<STAT, 0, 0, Access::RO> BUSY{}; // Busy
+	static constexpr FieldSpec<STAT, 1, 1, Access::RO> IRQ{}; // Pending
+	static constexpr FieldSpec<STAT, 3, 2, Access::RO> ERR{}; // Error code
+
+	static constexpr u32 reset    = 0x00;
+	static constexpr u32 w1c_mask = 0;
+};
+
+struct IRQ {
+	static constexpr u32 offset	    = 0x08;
+	static constexpr bool software_owned = false;
+
+	static constexpr FieldSpec<IRQ, 0, 0, Access::W1C> COMPLETE{};
+	static constexpr FieldSpec<IRQ, 1, 1, Access::W1C> ERR{};
+	static constexpr FieldSpec<IRQ, 2, 2, Access::W1C> RING{};
+
+	static constexpr u32 reset    = 0x00;
+	static constexpr u32 w1c_mask = COMPLETE.mask | ERR.mask | RING.mask;
+};
+
+struct KAR {
+	static constexpr u32 offset	    = 0x0C;
+	static constexpr bool software_owned = true;
+
+	static constexpr FieldSpec<KAR, 31, 0> ADDR{}; // Key address
+
+	static constexpr u32 reset    = 0x00;
+	static constexpr u32 w1c_mask = 0;
+};
+
+struct IAR {
+	static constexpr u32 offset	    = 0x10;
+	static constexpr bool software_owned = true;
+
+	static constexpr FieldSpec<IAR, 31, 0> ADDR{}; // Input data address
+
+	static constexpr u32 reset    = 0x00;
+	static constexpr u32 w1c_mask = 0;
+};
+
+// Writing OAR starts the operation: it must be the last register written
+struct OAR {
+	static constexpr u32 offset	    = 0x14;
+	static constexpr bool software_owned = true;
+
+	static constexpr FieldSpec<OAR, 31, 0> ADDR{}; // Output data address
+
+	static constexpr u32 reset    = 0x00;
+	static constexpr u32 w1c_mask = 0;
+};
+
+struct RBAR {
+	static constexpr u32 offset	    = 0x18;
+	static constexpr bool software_owned = true;
+
+	static constexpr FieldSpec<RBAR, 31, 0> ADDR{}; // Ring base address
+
+	static constexpr u32 reset    = 0x00;
+	static constexpr u32 w1c_mask = 0;
+};
+
+struct RCFG {
+	static constexpr u32 offset	    = 0x1C;
+	static constexpr bool software_owned = true;
+
+	static constexpr FieldSpec<RCFG, 0, 0> EN{};	 // Ring enable
+	static constexpr FieldSpec<RCFG, 11, 8> SIZE{}; // log2 ring entries
+
+	static constexpr u32 reset    = 0x00;
+	static constexpr u32 w1c_mask = 0;
+};
+
+struct RHEAD {
+	static constexpr u32 offset	    = 0x20;
+	static constexpr bool software_owned = false;
+
+	static constexpr FieldSpec<RHEAD, 15, 0, Access::RO> IDX{}; // Next fetch
+
+	static constexpr u32 reset    = 0x00;
+	static constexpr u32 w1c_mask = 0;
+};
+
+// Writing RTAIL rings the doorbell, even when the index repeats
+struct RTAIL {
+	static constexpr u32 offset	    = 0x24;
+	static constexpr bool software_owned = true;
+
+	static constexpr FieldSpec<RTAIL, 15, 0> IDX{}; // Next descriptor posted
+
+	static constexpr u32 reset    = 0x00;
+	static constexpr u32 w1c_mask = 0;
+};
+
+struct RCIDX {
+	static constexpr u32 offset	    = 0x28;
+	static constexpr bool software_owned = false;
+
+	static constexpr FieldSpec<RCIDX, 15, 0, Access::RO> IDX{}; // Completed
+
+	static constexpr u32 reset    = 0x00;
+	static constexpr u32 w1c_mask = 0;
+};
+
+//==============================================================================
+// Accessors
+//==============================================================================
+
+// Last value written to a software-owned register
+template <typename R> struct Shadow {
+	u32 value = R::reset;
+};
+
+template <typename R> class Reg
+{
+public:
+	template <RegisterBus Bus> static u32 read(Bus &bus)
+	{
+		return bus.read(R::offset);
+	}
+
+	// Writes the given fields and the reset value of all others
+	template <RegisterBus Bus, typename... V>
+	static void write(Bus &bus, FieldValue<R> first, V... rest)
+	{
+		bus.write(R::offset, merge(R::reset, first, rest...));
+	}
+
+	// One read, one write. Write-one-to-clear bits read back as 1 are
+	// written as 0, so pending events other than the named ones survive.
+	template <RegisterBus Bus, typename... V>
+	static void modify(Bus &bus, FieldValue<R> first, V... rest)
+	{
+		bus.write(R::offset, merge(bus.read(R::offset) & ~R::w1c_mask,
+					   first, rest...));
+	}
+
+	// No read; the write is skipped when the register already holds the
+	// result
+	template <RegisterBus Bus, typename... V>
+	static void modify(Bus &bus, Shadow<R> &shadow, FieldValue<R> first,
+			   V... rest)
+	{
+		static_assert(R::software_owned,
+			      "register changed by the engine");
+
+		u32 word = merge(shadow.value, first, rest...);
+
+		if (word != shadow.value) {
+			shadow.value = word;
+			bus.write(R::offset, word);
+		}
+	}
+
+	// Whole-register write through the shadow, always reaching the bus
+	// (OAR starts the engine and RTAIL rings the doorbell even when the
+	// value repeats)
+	template <RegisterBus Bus>
+	static void write(Bus &bus, Shadow<R> &shadow, u32 word)
+	{
+		static_assert(R::software_owned,
+			      "register changed by the engine");
+
+		shadow.value = word;
+		bus.write(R::offset, word);
+	}
+
+private:
+	template <typename... V>
+	static constexpr u32 merge(u32 word, FieldValue<R> first, V... rest)
+	{
+		static_assert((std::is_same_v<V, FieldValue<R>> && ...),
+			      "field of another register");
+
+		word = (word & ~first.mask) | first.bits;
+		((word = (word & ~rest.mask) | rest.bits), ...);
+
+		return word;
+	}
+};
+
+template <auto F> class Field
+{
+	using Spec = std::remove_cvref_t<decltype(F)>;
+	using R	   = typename Spec::reg;
+
+public:
+	template <RegisterBus Bus> static u32 read(Bus &bus)
+	{
+		return Spec::get(bus.read(R::offset));
+	}
+
+	static u32 read(const Shadow<R> &shadow)
+	{
+		return Spec::get(shadow.value);
+	}
+
+	// Read-modify-write of this field alone
+	template <RegisterBus Bus> static void write(Bus &bus, u32 val)
+	{
+		Reg<R>::modify(bus, F = val);
+	}
+};
+
+//==============================================================================
+// Buses
+//==============================================================================
+
+// A mapped register window
+class IoMemBus
+{
+public:
+	explicit IoMemBus(volatile void *base)
+		: base_(static_cast<volatile u32 *>(base))
+	{
+	}
+
+	u32 read(u32 offset)
+	{
+		return base_[offset / sizeof(u32)];
+	}
+
+	void write(u32 offset, u32 val)
+	{
+		base_[offset / sizeof(u32)] = val;
+	}
+
+private:
+	volatile u32 *base_;
+};
+
+} // namespace org::simple::simpleaes
+
+#endif // ORG_SIMPLE_SIMPLEAES_REGS_HPP
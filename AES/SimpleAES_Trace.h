@@ -0,0 +1,148 @@
+// SimpleAES tracepoints (events/simpleaes in tracefs)
+//
+// The start and end of a single-block ioctl operation (SimpleAES_RunOp), one
+// event per stage of every path (SimpleAES_StatsStage), each carrying the
+// time spent in that stage, plus the interrupt top half, the completion reap
+// and contended regfile lock acquisitions. Disabled tracepoints cost a
+// patched-out branch.
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM simpleaes
+
+#if !defined(ORG_SIMPLE_SIMPLEAES_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define ORG_SIMPLE_SIMPLEAES_TRACE_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(simpleaes_op_begin,
+	TP_PROTO(int id, int mode, int completion),
+	TP_ARGS(id, mode, completion),
+	TP_STRUCT__entry(
+		__field(int, id)
+		__field(int, mode)
+		__field(int, completion)
+	),
+	TP_fast_assign(
+		__entry->id	    = id;
+		__entry->mode	    = mode;
+		__entry->completion = completion;
+	),
+	TP_printk("simpleaes%d mode=%d completion=%d", __entry->id,
+		  __entry->mode, __entry->completion)
+);
+
+TRACE_EVENT(simpleaes_op_end,
+	TP_PROTO(int id, int err, u64 ns),
+	TP_ARGS(id, err, ns),
+	TP_STRUCT__entry(
+		__field(int, id)
+		__field(int, err)
+		__field(u64, ns)
+	),
+	TP_fast_assign(
+		__entry->id  = id;
+		__entry->err = err;
+		__entry->ns  = ns;
+	),
+	TP_printk("simpleaes%d err=%d ns=%llu", __entry->id, __entry->err,
+		  __entry->ns)
+);
+
+// Stages, in ORG_SIMPLE_OpPhase order. ns is the time the stage took.
+DECLARE_EVENT_CLASS(simpleaes_stage,
+	TP_PROTO(int id, u64 ns),
+	TP_ARGS(id, ns),
+	TP_STRUCT__entry(
+		__field(int, id)
+		__field(u64, ns)
+	),
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->ns = ns;
+	),
+	TP_printk("simpleaes%d ns=%llu", __entry->id, __entry->ns)
+);
+
+DEFINE_EVENT(simpleaes_stage, simpleaes_alloc,
+	TP_PROTO(int id, u64 ns),
+	TP_ARGS(id, ns)
+);
+
+DEFINE_EVENT(simpleaes_stage, simpleaes_copy_in,
+	TP_PROTO(int id, u64 ns),
+	TP_ARGS(id, ns)
+);
+
+DEFINE_EVENT(simpleaes_stage, simpleaes_queue,
+	TP_PROTO(int id, u64 ns),
+	TP_ARGS(id, ns)
+);
+
+DEFINE_EVENT(simpleaes_stage, simpleaes_mmio,
+	TP_PROTO(int id, u64 ns),
+	TP_ARGS(id, ns)
+);
+
+DEFINE_EVENT(simpleaes_stage, simpleaes_engine,
+	TP_PROTO(int id, u64 ns),
+	TP_ARGS(id, ns)
+);
+
+DEFINE_EVENT(simpleaes_stage, simpleaes_wakeup,
+	TP_PROTO(int id, u64 ns),
+	TP_ARGS(id, ns)
+);
+
+DEFINE_EVENT(simpleaes_stage, simpleaes_copy_out,
+	TP_PROTO(int id, u64 ns),
+	TP_ARGS(id, ns)
+);
+
+// Waiting for a regfile lock held by another CPU
+DEFINE_EVENT(simpleaes_stage, simpleaes_regfile_contended,
+	TP_PROTO(int id, u64 ns),
+	TP_ARGS(id, ns)
+);
+
+TRACE_EVENT(simpleaes_irq,
+	TP_PROTO(int id, u32 irq_stat, bool handled),
+	TP_ARGS(id, irq_stat, handled),
+	TP_STRUCT__entry(
+		__field(int, id)
+		__field(u32, irq_stat)
+		__field(bool, handled)
+	),
+	TP_fast_assign(
+		__entry->id	  = id;
+		__entry->irq_stat = irq_stat;
+		__entry->handled  = handled;
+	),
+	TP_printk("simpleaes%d irq=0x%x handled=%d", __entry->id,
+		  __entry->irq_stat, __entry->handled)
+);
+
+TRACE_EVENT(simpleaes_reap,
+	TP_PROTO(int id, u64 tag, int err),
+	TP_ARGS(id, tag, err),
+	TP_STRUCT__entry(
+		__field(int, id)
+		__field(u64, tag)
+		__field(int, err)
+	),
+	TP_fast_assign(
+		__entry->id  = id;
+		__entry->tag = tag;
+		__entry->err = err;
+	),
+	TP_printk("simpleaes%d tag=%llu err=%d", __entry->id, __entry->tag,
+		  __entry->err)
+);
+
+#endif // ORG_SIMPLE_SIMPLEAES_TRACE_H
+
+// Built out of tree: the trace header is found next to the driver
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE SimpleAES_Trace
+#include <trace/define_trace.h>
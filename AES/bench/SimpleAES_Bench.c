@@ -0,0 +1,1218 @@
+// simpleaes-bench: throughput and tail-latency benchmark for the SimpleAES
+// driver.
+//
+// Drives IOCTL_ENCRYPT/IOCTL_DECRYPT (single blocks) and
+// IOCTL_ENCRYPT_BATCH/IOCTL_DECRYPT_BATCH (larger requests) from a number of
+// threads, each with its own open file. It sweeps thread count, request
+// size, key reuse ratio and encrypt/decrypt mix, and reports ops/s, MB/s and
+// p50/p99/p99.9 latency for every point. The driver's op_phases attribute
+// splits the cost of single-block engine operations into alloc, copy-in,
+// queue, MMIO programming, engine, wakeup and copy-out time. --dma-bench
+// prints each engine's debugfs dma_bench instead: copy bandwidth into and
+// out of coherent and streaming DMA buffers.
+//
+// Backends: "device" uses /dev/simpleaes and the platform devices' sysfs
+// attributes; "model" loads the driver in-process against SimpleAESModel
+// engines (see model/SimpleAES_Host.h). "auto" (default) picks the device
+// when it exists. --hw selects the model engines' register interface:
+// ver2 (one block per register sequence) or ver3 (descriptor ring).
+//
+// Build (from AES/):
+//
+//	cc -O2 -pthread -I model/include -I model bench/SimpleAES_Bench.c
+//	   model/SimpleAES_Host.c model/SimpleAES_Shim.c
+//	   model/SimpleAES_Model.c -o simpleaes-bench
+//
+// Results go to stdout as text, CSV or JSON Lines (one object per point);
+// run "simpleaes-bench --help" for the options.
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <glob.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "SimpleAES_Host.h"
+
+//==============================================================================
+// Constant Definitions
+//==============================================================================
+
+#define SIMPLEAES_BENCH_VERSION 1
+
+#define SIMPLEAES_BENCH_DEVICE	  "/dev/" SIMPLEAES_DEVICE_NAME
+#define SIMPLEAES_BENCH_SYSFS_GLOB \
+	"/sys/bus/platform/drivers/" SIMPLEAES_DEVICE_NAME "/*/op_phases"
+#define SIMPLEAES_BENCH_DEBUGFS_GLOB                               \
+	"/sys/kernel/debug/" SIMPLEAES_DEVICE_NAME "/" SIMPLEAES_DEVICE_NAME \
+	"*"
+
+// Upper bound of every sweep list, and of a thread count
+#define SIMPLEAES_BENCH_MAX_POINTS  32
+#define SIMPLEAES_BENCH_MAX_THREADS 1024
+
+// Distinct keys each thread cycles through when a request does not reuse
+// the previous key
+#define SIMPLEAES_BENCH_KEYS 64
+
+// Latency histogram: exact below 64 ns, then 32 buckets per power of two
+// (about 3% resolution) up to 2^40 ns
+#define SIMPLEAES_BENCH_HIST_LINEAR 64
+#define SIMPLEAES_BENCH_HIST_SUB    32
+#define SIMPLEAES_BENCH_HIST_BUCKETS \
+	(SIMPLEAES_BENCH_HIST_LINEAR + (40 - 6) * SIMPLEAES_BENCH_HIST_SUB)
+
+//==============================================================================
+// Type Definitions
+//==============================================================================
+
+typedef enum {
+	SIMPLEAES_BENCH_FORMAT_TEXT,
+	SIMPLEAES_BENCH_FORMAT_CSV,
+	SIMPLEAES_BENCH_FORMAT_JSON
+} SimpleAESBench_Format;
+
+// Where requests go: the real character device or the in-process model
+typedef struct {
+	const char *name;
+	int (*open)(void **FilePtr);
+	void (*close)(void *FilePtr);
+	long (*ioctl)(void *FilePtr, unsigned int cmd, void *arg);
+	unsigned int (*num_engines)(void);
+	int (*read_attr)(unsigned int engine, const char *name, char *buf);
+	int (*read_debugfs)(unsigned int engine, const char *name, char *buf);
+} SimpleAESBench_Backend;
+
+typedef struct {
+	u64 counts[SIMPLEAES_BENCH_HIST_BUCKETS];
+	u64 total;
+	u64 max_ns;
+} SimpleAESBench_Hist;
+
+// Totals of the op_phases and cpu_requests attributes over all engines
+typedef struct {
+	u64 ops;
+	u64 phase_ns[ORG_SIMPLE_OP_PHASES];
+	u64 cpu_requests;
+} SimpleAESBench_Counters;
+
+// One point of the sweep
+typedef struct {
+	unsigned int threads;
+	unsigned int blocks;
+	double key_reuse;
+	double decrypt_ratio;
+} SimpleAESBench_Point;
+
+struct SimpleAESBench;
+
+// Per-thread state (buffers are ORG_SIMPLE_KD_SIZE-strided)
+typedef struct {
+	struct SimpleAESBench *bench;
+	pthread_t thread;
+	unsigned int index;
+	void *file;
+	u8 *keys;
+	u8 *in;
+	u8 *out;
+	u64 rng;
+	u64 ops;
+	u64 errors;
+	SimpleAESBench_Hist hist;
+} SimpleAESBench_Worker;
+
+typedef struct SimpleAESBench {
+	// Options
+	const SimpleAESBench_Backend *backend;
+	SimpleAESBench_Format format;
+	const char *label;
+	unsigned int engines;
+	bool ring; // Model engines are ver3 (descriptor ring)
+	int completion; // ORG_SIMPLE_CompletionMode, -1 for the driver default
+	unsigned int duration_ms;
+	unsigned int warmup_ms;
+	unsigned int threads[SIMPLEAES_BENCH_MAX_POINTS];
+	unsigned int num_threads;
+	unsigned int blocks[SIMPLEAES_BENCH_MAX_POINTS];
+	unsigned int num_blocks;
+	double key_reuse[SIMPLEAES_BENCH_MAX_POINTS];
+	unsigned int num_key_reuse;
+	double decrypt_ratio[SIMPLEAES_BENCH_MAX_POINTS];
+	unsigned int num_decrypt_ratio;
+
+	// Current point
+	SimpleAESBench_Point point;
+	pthread_barrier_t start;
+	u64 measure_ns; // Samples before this are warmup
+	u64 stop_ns;
+	int stop;
+} SimpleAESBench;
+
+//==============================================================================
+// Function Prototypes
+//==============================================================================
+
+// Backends
+
+static int SimpleAESBench_DeviceOpen(void **FilePtr);
+static void SimpleAESBench_DeviceClose(void *FilePtr);
+static long SimpleAESBench_DeviceIoctl(void *FilePtr, unsigned int cmd,
+				       void *arg);
+static unsigned int SimpleAESBench_DeviceEngines(void);
+static int SimpleAESBench_DeviceReadAttr(unsigned int engine, const char *name,
+					 char *buf);
+static int SimpleAESBench_DeviceReadDebugfs(unsigned int engine,
+					    const char *name, char *buf);
+static int SimpleAESBench_ModelOpen(void **FilePtr);
+static void SimpleAESBench_ModelClose(void *FilePtr);
+static long SimpleAESBench_ModelIoctl(void *FilePtr, unsigned int cmd,
+				      void *arg);
+static unsigned int SimpleAESBench_ModelEngines(void);
+static int SimpleAESBench_ModelReadAttr(unsigned int engine, const char *name,
+					char *buf);
+static int SimpleAESBench_ModelReadDebugfs(unsigned int engine,
+					   const char *name, char *buf);
+
+// Latency histogram
+
+static unsigned int SimpleAESBench_HistBucket(u64 ns);
+static u64 SimpleAESBench_HistValue(unsigned int bucket);
+static void SimpleAESBench_HistAdd(SimpleAESBench_Hist *HistPtr, u64 ns);
+static void SimpleAESBench_HistMerge(SimpleAESBench_Hist *HistPtr,
+				     const SimpleAESBench_Hist *OtherPtr);
+static u64 SimpleAESBench_HistPercentile(const SimpleAESBench_Hist *HistPtr,
+					 double pct);
+
+// Benchmark
+
+static u64 SimpleAESBench_Now(void);
+static u64 SimpleAESBench_Random(u64 *StatePtr);
+static void SimpleAESBench_ReadCounters(SimpleAESBench *BenchPtr,
+					SimpleAESBench_Counters *CountersPtr);
+static int SimpleAESBench_WorkerInit(SimpleAESBench *BenchPtr,
+				     SimpleAESBench_Worker *WorkerPtr,
+				     unsigned int index);
+static void SimpleAESBench_WorkerDeInit(SimpleAESBench *BenchPtr,
+					SimpleAESBench_Worker *WorkerPtr);
+static void *SimpleAESBench_WorkerMain(void *arg);
+static int SimpleAESBench_RunPoint(SimpleAESBench *BenchPtr);
+static void SimpleAESBench_Report(SimpleAESBench *BenchPtr,
+				  const SimpleAESBench_Hist *HistPtr, u64 ops,
+				  u64 errors, u64 elapsed_ns,
+				  const SimpleAESBench_Counters *DeltaPtr);
+static int SimpleAESBench_DmaBench(SimpleAESBench *BenchPtr);
+
+// Command line
+
+static int SimpleAESBench_ParseUintList(const char *arg, unsigned int *vals,
+					unsigned int *CountPtr,
+					unsigned int max_val);
+static int SimpleAESBench_ParseRatioList(const char *arg, double *vals,
+					 unsigned int *CountPtr);
+static void SimpleAESBench_Usage(FILE *stream);
+
+//==============================================================================
+// Global Variables
+//==============================================================================
+
+static const char *const simpleaes_bench_phase_names[ORG_SIMPLE_OP_PHASES] = {
+	"alloc", "copy_in", "queue", "mmio", "engine", "wakeup", "copy_out",
+};
+
+static const char *const simpleaes_bench_completion_names[] = {
+	"irq",
+	"poll",
+	"hybrid",
+};
+
+static char simpleaes_bench_sysfs[ORG_SIMPLE_MAX_DEVICES][PATH_MAX];
+static unsigned int simpleaes_bench_sysfs_count;
+
+static const SimpleAESBench_Backend simpleaes_bench_device = {
+	.name	     = "device",
+	.open	     = SimpleAESBench_DeviceOpen,
+	.close	     = SimpleAESBench_DeviceClose,
+	.ioctl	     = SimpleAESBench_DeviceIoctl,
+	.num_engines = SimpleAESBench_DeviceEngines,
+	.read_attr   = SimpleAESBench_DeviceReadAttr,
+	.read_debugfs = SimpleAESBench_DeviceReadDebugfs,
+};
+
+static const SimpleAESBench_Backend simpleaes_bench_model = {
+	.name	     = "model",
+	.open	     = SimpleAESBench_ModelOpen,
+	.close	     = SimpleAESBench_ModelClose,
+	.ioctl	     = SimpleAESBench_ModelIoctl,
+	.num_engines = SimpleAESBench_ModelEngines,
+	.read_attr   = SimpleAESBench_ModelReadAttr,
+	.read_debugfs = SimpleAESBench_ModelReadDebugfs,
+};
+
+//==============================================================================
+// Backends
+//==============================================================================
+
+static int SimpleAESBench_DeviceOpen(void **FilePtr)
+{
+	int fd = open(SIMPLEAES_BENCH_DEVICE, O_RDWR | O_CLOEXEC);
+
+	if (fd < 0) {
+		return -errno;
+	}
+	*FilePtr = (void *)(intptr_t)fd;
+	return 0;
+}
+
+static void SimpleAESBench_DeviceClose(void *FilePtr)
+{
+	close((int)(intptr_t)FilePtr);
+}
+
+static long SimpleAESBench_DeviceIoctl(void *FilePtr, unsigned int cmd,
+				       void *arg)
+{
+	return ioctl((int)(intptr_t)FilePtr, cmd, arg) < 0 ? -errno : 0;
+}
+
+// Engines are the platform devices bound to the driver; their attribute
+// directories are found once, through op_phases
+static unsigned int SimpleAESBench_DeviceEngines(void)
+{
+	glob_t paths;
+	size_t i;
+
+	if (simpleaes_bench_sysfs_count) {
+		return simpleaes_bench_sysfs_count;
+	}
+	if (glob(SIMPLEAES_BENCH_SYSFS_GLOB, 0, NULL, &paths)) {
+		return 0;
+	}
+	for (i = 0; i < paths.gl_pathc && i < ORG_SIMPLE_MAX_DEVICES; i++) {
+		snprintf(simpleaes_bench_sysfs[i], PATH_MAX, "%s",
+			 paths.gl_pathv[i]);
+		*strrchr(simpleaes_bench_sysfs[i], '/') = '\0';
+	}
+	simpleaes_bench_sysfs_count = i;
+	globfree(&paths);
+
+	return simpleaes_bench_sysfs_count;
+}
+
+static int SimpleAESBench_DeviceReadAttr(unsigned int engine, const char *name,
+					 char *buf)
+{
+	char path[PATH_MAX + 64];
+	ssize_t len;
+	int fd;
+
+	if (engine >= SimpleAESBench_DeviceEngines()) {
+		return -ENOENT;
+	}
+	snprintf(path, sizeof(path), "%s/%s", simpleaes_bench_sysfs[engine],
+		 name);
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return -errno;
+	}
+	len = read(fd, buf, PAGE_SIZE - 1);
+	close(fd);
+	if (len < 0) {
+		return -errno;
+	}
+	buf[len] = '\0';
+
+	return 0;
+}
+
+// debugfs directories of the engines, in id order
+static int SimpleAESBench_DeviceReadDebugfs(unsigned int engine,
+					    const char *name, char *buf)
+{
+	char path[PATH_MAX + 64];
+	glob_t paths;
+	ssize_t len;
+	int fd;
+
+	if (glob(SIMPLEAES_BENCH_DEBUGFS_GLOB, 0, NULL, &paths)) {
+		return -ENOENT;
+	}
+	if (engine >= paths.gl_pathc) {
+		globfree(&paths);
+		return -ENOENT;
+	}
+	snprintf(path, sizeof(path), "%s/%s", paths.gl_pathv[engine], name);
+	globfree(&paths);
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return -errno;
+	}
+	len = read(fd, buf, PAGE_SIZE - 1);
+	close(fd);
+	if (len < 0) {
+		return -errno;
+	}
+	buf[len] = '\0';
+
+	return 0;
+}
+
+static int SimpleAESBench_ModelOpen(void **FilePtr)
+{
+	return SimpleAESHost_Open(0, 0, (SimpleAESHost_File **)FilePtr);
+}
+
+static void SimpleAESBench_ModelClose(void *FilePtr)
+{
+	SimpleAESHost_Close(FilePtr);
+}
+
+static long SimpleAESBench_ModelIoctl(void *FilePtr, unsigned int cmd,
+				      void *arg)
+{
+	return SimpleAESHost_Ioctl(FilePtr, cmd, arg);
+}
+
+static unsigned int SimpleAESBench_ModelEngines(void)
+{
+	unsigned int engines = 0;
+
+	while (SimpleAESHost_Model(engines)) {
+		engines++;
+	}
+	return engines;
+}
+
+static int SimpleAESBench_ModelReadAttr(unsigned int engine, const char *name,
+					char *buf)
+{
+	ssize_t len = SimpleAESHost_ReadAttr(engine, name, buf);
+
+	return len < 0 ? (int)len : 0;
+}
+
+static int SimpleAESBench_ModelReadDebugfs(unsigned int engine,
+					   const char *name, char *buf)
+{
+	char path[64 + NAME_MAX];
+	ssize_t len;
+
+	snprintf(path, sizeof(path), "%s/%s%u/%s", SIMPLEAES_DEVICE_NAME,
+		 SIMPLEAES_DEVICE_NAME, engine, name);
+	len = SimpleAESHost_ReadDebugfs(path, buf, PAGE_SIZE - 1);
+	if (len < 0) {
+		return (int)len;
+	}
+	buf[len] = '\0';
+
+	return 0;
+}
+
+//==============================================================================
+// Latency Histogram
+//==============================================================================
+
+static unsigned int SimpleAESBench_HistBucket(u64 ns)
+{
+	unsigned int msb;
+
+	if (ns < SIMPLEAES_BENCH_HIST_LINEAR) {
+		return (unsigned int)ns;
+	}
+
+	// 2^msb <= ns < 2^(msb + 1), split into SUB buckets
+	msb = 63 - __builtin_clzll(ns);
+	if (msb >= 40) {
+		return SIMPLEAES_BENCH_HIST_BUCKETS - 1;
+	}
+	return SIMPLEAES_BENCH_HIST_LINEAR +
+	       (msb - 6) * SIMPLEAES_BENCH_HIST_SUB +
+	       (unsigned int)(ns >> (msb - 5)) % SIMPLEAES_BENCH_HIST_SUB;
+}
+
+// Upper bound of the values counted in bucket
+static u64 SimpleAESBench_HistValue(unsigned int bucket)
+{
+	unsigned int msb, sub;
+
+	if (bucket < SIMPLEAES_BENCH_HIST_LINEAR) {
+		return bucket;
+	}
+	msb = (bucket - SIMPLEAES_BENCH_HIST_LINEAR) /
+		      SIMPLEAES_BENCH_HIST_SUB +
+	      6;
+	sub = (bucket - SIMPLEAES_BENCH_HIST_LINEAR) %
+	      SIMPLEAES_BENCH_HIST_SUB;
+
+	return ((u64)(SIMPLEAES_BENCH_HIST_SUB + sub + 1) << (msb - 5)) - 1;
+}
+
+static void SimpleAESBench_HistAdd(SimpleAESBench_Hist *HistPtr, u64 ns)
+{
+	HistPtr->counts[SimpleAESBench_HistBucket(ns)]++;
+	HistPtr->total++;
+	HistPtr->max_ns = max(HistPtr->max_ns, ns);
+}
+
+static void SimpleAESBench_HistMerge(SimpleAESBench_Hist *HistPtr,
+				     const SimpleAESBench_Hist *OtherPtr)
+{
+	unsigned int i;
+
+	for (i = 0; i < SIMPLEAES_BENCH_HIST_BUCKETS; i++) {
+		HistPtr->counts[i] += OtherPtr->counts[i];
+	}
+	HistPtr->total += OtherPtr->total;
+	HistPtr->max_ns = max(HistPtr->max_ns, OtherPtr->max_ns);
+}
+
+static u64 SimpleAESBench_HistPercentile(const SimpleAESBench_Hist *HistPtr,
+					 double pct)
+{
+	u64 rank, seen = 0;
+	unsigned int i;
+
+	if (!HistPtr->total) {
+		return 0;
+	}
+
+	rank = (u64)(pct / 100.0 * (double)HistPtr->total);
+	rank = clamp(rank, 1ull, HistPtr->total);
+	for (i = 0; i < SIMPLEAES_BENCH_HIST_BUCKETS; i++) {
+		seen += HistPtr->counts[i];
+		if (seen >= rank) {
+			return min(SimpleAESBench_HistValue(i),
+				   HistPtr->max_ns);
+		}
+	}
+	return HistPtr->max_ns;
+}
+
+//==============================================================================
+// Benchmark
+//==============================================================================
+
+static u64 SimpleAESBench_Now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec * NSEC_PER_SEC + (u64)ts.tv_nsec;
+}
+
+// xorshift64*
+static u64 SimpleAESBench_Random(u64 *StatePtr)
+{
+	*StatePtr ^= *StatePtr >> 12;
+	*StatePtr ^= *StatePtr << 25;
+	*StatePtr ^= *StatePtr >> 27;
+	return *StatePtr * 0x2545f4914f6cdd1dull;
+}
+
+static void SimpleAESBench_ReadCounters(SimpleAESBench *BenchPtr,
+					SimpleAESBench_Counters *CountersPtr)
+{
+	const SimpleAESBench_Backend *backend = BenchPtr->backend;
+	unsigned long long vals[1 + ORG_SIMPLE_OP_PHASES];
+	char buf[PAGE_SIZE];
+	unsigned int engine, i;
+
+	memset(CountersPtr, 0, sizeof(*CountersPtr));
+	for (engine = 0; engine < backend->num_engines(); engine++) {
+		if (!backend->read_attr(engine, "op_phases", buf) &&
+		    sscanf(buf, "%llu %llu %llu %llu %llu %llu %llu %llu",
+			   &vals[0], &vals[1], &vals[2], &vals[3], &vals[4],
+			   &vals[5], &vals[6], &vals[7]) == 8) {
+			CountersPtr->ops += vals[0];
+			for (i = 0; i < ORG_SIMPLE_OP_PHASES; i++) {
+				CountersPtr->phase_ns[i] += vals[i + 1];
+			}
+		}
+		if (!backend->read_attr(engine, "cpu_requests", buf)) {
+			CountersPtr->cpu_requests += strtoull(buf, NULL, 10);
+		}
+	}
+}
+
+static int SimpleAESBench_WorkerInit(SimpleAESBench *BenchPtr,
+				     SimpleAESBench_Worker *WorkerPtr,
+				     unsigned int index)
+{
+	size_t data_len = (size_t)BenchPtr->point.blocks * ORG_SIMPLE_KD_SIZE;
+	IOCTL_CompletionData completion;
+	unsigned int i;
+	int ret;
+
+	memset(WorkerPtr, 0, sizeof(*WorkerPtr));
+	WorkerPtr->bench = BenchPtr;
+	WorkerPtr->index = index;
+	WorkerPtr->rng	 = 0x9e3779b97f4a7c15ull * (index + 1);
+
+	WorkerPtr->keys = aligned_alloc(PAGE_SIZE,
+					SIMPLEAES_BENCH_KEYS *
+						ORG_SIMPLE_KD_SIZE);
+	WorkerPtr->in	= aligned_alloc(PAGE_SIZE, PAGE_ALIGN(data_len));
+	WorkerPtr->out	= aligned_alloc(PAGE_SIZE, PAGE_ALIGN(data_len));
+	if (!WorkerPtr->keys || !WorkerPtr->in || !WorkerPtr->out) {
+		ret = -ENOMEM;
+		goto __simpleaesbench_workerinit_undo_res1;
+	}
+	for (i = 0; i < SIMPLEAES_BENCH_KEYS * ORG_SIMPLE_KD_SIZE; i++) {
+		WorkerPtr->keys[i] = (u8)SimpleAESBench_Random(&WorkerPtr->rng);
+	}
+	for (i = 0; i < data_len; i++) {
+		WorkerPtr->in[i] = (u8)SimpleAESBench_Random(&WorkerPtr->rng);
+	}
+	memset(WorkerPtr->out, 0, data_len);
+
+	ret = BenchPtr->backend->open(&WorkerPtr->file);
+	if (ret) {
+		goto __simpleaesbench_workerinit_undo_res1;
+	}
+
+	if (BenchPtr->completion >= 0) {
+		completion.mode = (unsigned int)BenchPtr->completion;
+		ret = BenchPtr->backend->ioctl(WorkerPtr->file,
+					       IOCTL_SET_COMPLETION,
+					       &completion);
+		if (ret) {
+			goto __simpleaesbench_workerinit_undo_res2;
+		}
+	}
+
+	return 0;
+
+__simpleaesbench_workerinit_undo_res2:
+	BenchPtr->backend->close(WorkerPtr->file);
+
+__simpleaesbench_workerinit_undo_res1:
+	free(WorkerPtr->out);
+	free(WorkerPtr->in);
+	free(WorkerPtr->keys);
+	return ret;
+}
+
+static void SimpleAESBench_WorkerDeInit(SimpleAESBench *BenchPtr,
+					SimpleAESBench_Worker *WorkerPtr)
+{
+	BenchPtr->backend->close(WorkerPtr->file);
+	free(WorkerPtr->out);
+	free(WorkerPtr->in);
+	free(WorkerPtr->keys);
+}
+
+// Issues requests back to back until the stop time. A request keeps the
+// previous key with probability key_reuse, otherwise it moves on to the
+// next key buffer (new address and contents).
+static void *SimpleAESBench_WorkerMain(void *arg)
+{
+	SimpleAESBench_Worker *WorkerPtr = arg;
+	SimpleAESBench *BenchPtr	 = WorkerPtr->bench;
+	const SimpleAESBench_Backend *backend = BenchPtr->backend;
+	const SimpleAESBench_Point *point_ptr = &BenchPtr->point;
+	u64 reuse_cut, decrypt_cut, start_ns, end_ns;
+	unsigned int key = 0;
+	IOCTL_BatchData batch;
+	IOCTL_Data data;
+	unsigned int cmd;
+	bool decrypt;
+	long ret;
+
+	reuse_cut   = (u64)(point_ptr->key_reuse * (double)UINT32_MAX);
+	decrypt_cut = (u64)(point_ptr->decrypt_ratio * (double)UINT32_MAX);
+
+	pthread_barrier_wait(&BenchPtr->start);
+
+	while (!__atomic_load_n(&BenchPtr->stop, __ATOMIC_RELAXED)) {
+		if ((SimpleAESBench_Random(&WorkerPtr->rng) >> 32) >=
+		    reuse_cut) {
+			key = (key + 1) % SIMPLEAES_BENCH_KEYS;
+		}
+		decrypt = (SimpleAESBench_Random(&WorkerPtr->rng) >> 32) <
+			  decrypt_cut;
+
+		start_ns = SimpleAESBench_Now();
+		if (point_ptr->blocks == 1) {
+			data.key_ptr	= WorkerPtr->keys +
+					  key * ORG_SIMPLE_KD_SIZE;
+			data.i_data_ptr = WorkerPtr->in;
+			data.o_data_ptr = WorkerPtr->out;
+			cmd = decrypt ? IOCTL_DECRYPT : IOCTL_ENCRYPT;
+			ret = backend->ioctl(WorkerPtr->file, cmd, &data);
+		} else {
+			memset(&batch, 0, sizeof(batch));
+			batch.key_ptr	 = WorkerPtr->keys +
+					   key * ORG_SIMPLE_KD_SIZE;
+			batch.i_data_ptr = WorkerPtr->in;
+			batch.o_data_ptr = WorkerPtr->out;
+			batch.num_blocks = point_ptr->blocks;
+			cmd = decrypt ? IOCTL_DECRYPT_BATCH :
+					IOCTL_ENCRYPT_BATCH;
+			ret = backend->ioctl(WorkerPtr->file, cmd, &batch);
+			if (!ret && batch.num_failed) {
+				ret = -EIO;
+			}
+		}
+		end_ns = SimpleAESBench_Now();
+
+		if (start_ns < BenchPtr->measure_ns) {
+			continue;
+		}
+		if (end_ns >= BenchPtr->stop_ns) {
+			__atomic_store_n(&BenchPtr->stop, 1, __ATOMIC_RELAXED);
+			if (start_ns >= BenchPtr->stop_ns) {
+				break;
+			}
+		}
+		if (ret) {
+			WorkerPtr->errors++;
+			continue;
+		}
+		WorkerPtr->ops++;
+		SimpleAESBench_HistAdd(&WorkerPtr->hist, end_ns - start_ns);
+	}
+
+	return NULL;
+}
+
+static int SimpleAESBench_RunPoint(SimpleAESBench *BenchPtr)
+{
+	unsigned int threads = BenchPtr->point.threads;
+	SimpleAESBench_Counters before, after, delta;
+	SimpleAESBench_Worker *workers;
+	static SimpleAESBench_Hist hist;
+	u64 ops = 0, errors = 0;
+	unsigned int i, started;
+	int ret = 0;
+
+	workers = calloc(threads, sizeof(*workers));
+	if (!workers) {
+		return -ENOMEM;
+	}
+	for (i = 0; i < threads; i++) {
+		ret = SimpleAESBench_WorkerInit(BenchPtr, &workers[i], i);
+		if (ret) {
+			fprintf(stderr, "simpleaes-bench: open: %s\n",
+				strerror(-ret));
+			goto __simpleaesbench_runpoint_undo_res1;
+		}
+	}
+
+	pthread_barrier_init(&BenchPtr->start, NULL, threads + 1);
+	BenchPtr->stop = 0;
+
+	for (started = 0; started < threads; started++) {
+		if (pthread_create(&workers[started].thread, NULL,
+				   SimpleAESBench_WorkerMain,
+				   &workers[started])) {
+			ret = -EAGAIN;
+			break;
+		}
+	}
+	if (ret) {
+		// Let the started threads through the barrier, then stop them
+		BenchPtr->stop = 1;
+		for (i = started; i < threads; i++) {
+			pthread_barrier_wait(&BenchPtr->start);
+		}
+	}
+
+	BenchPtr->measure_ns = SimpleAESBench_Now() +
+			       (u64)BenchPtr->warmup_ms * NSEC_PER_MSEC;
+	BenchPtr->stop_ns    = BenchPtr->measure_ns +
+			    (u64)BenchPtr->duration_ms * NSEC_PER_MSEC;
+	if (!ret) {
+		pthread_barrier_wait(&BenchPtr->start);
+	}
+
+	// Phase counters cover the warmup too; they are averaged per op
+	SimpleAESBench_ReadCounters(BenchPtr, &before);
+	for (i = 0; i < started; i++) {
+		pthread_join(workers[i].thread, NULL);
+	}
+	SimpleAESBench_ReadCounters(BenchPtr, &after);
+	pthread_barrier_destroy(&BenchPtr->start);
+
+	if (!ret) {
+		memset(&hist, 0, sizeof(hist));
+		for (i = 0; i < threads; i++) {
+			SimpleAESBench_HistMerge(&hist, &workers[i].hist);
+			ops += workers[i].ops;
+			errors += workers[i].errors;
+		}
+		delta.ops	   = after.ops - before.ops;
+		delta.cpu_requests = after.cpu_requests - before.cpu_requests;
+		for (i = 0; i < ORG_SIMPLE_OP_PHASES; i++) {
+			delta.phase_ns[i] =
+				after.phase_ns[i] - before.phase_ns[i];
+		}
+		SimpleAESBench_Report(BenchPtr, &hist, ops, errors,
+				      (u64)BenchPtr->duration_ms *
+					      NSEC_PER_MSEC,
+				      &delta);
+	}
+
+	i = threads;
+
+__simpleaesbench_runpoint_undo_res1:
+	while (i--) {
+		SimpleAESBench_WorkerDeInit(BenchPtr, &workers[i]);
+	}
+	free(workers);
+	return ret;
+}
+
+static void SimpleAESBench_Report(SimpleAESBench *BenchPtr,
+				  const SimpleAESBench_Hist *HistPtr, u64 ops,
+				  u64 errors, u64 elapsed_ns,
+				  const SimpleAESBench_Counters *DeltaPtr)
+{
+	const SimpleAESBench_Point *point_ptr = &BenchPtr->point;
+	double secs    = (double)elapsed_ns / NSEC_PER_SEC;
+	double ops_s   = (double)ops / secs;
+	double mb_s    = ops_s * point_ptr->blocks * ORG_SIMPLE_KD_SIZE / 1e6;
+	u64 p50	       = SimpleAESBench_HistPercentile(HistPtr, 50.0);
+	u64 p99	       = SimpleAESBench_HistPercentile(HistPtr, 99.0);
+	u64 p999       = SimpleAESBench_HistPercentile(HistPtr, 99.9);
+	const char *completion =
+		BenchPtr->completion < 0 ?
+			"default" :
+			simpleaes_bench_completion_names[BenchPtr->completion];
+	u64 phase_ops = max(DeltaPtr->ops, 1ull);
+	unsigned int i;
+
+	switch (BenchPtr->format) {
+	case SIMPLEAES_BENCH_FORMAT_JSON:
+		printf("{\"tool\":\"simpleaes-bench\",\"version\":%d,"
+		       "\"label\":\"%s\",\"backend\":\"%s\",\"engines\":%u,"
+		       "\"completion\":\"%s\",\"threads\":%u,\"blocks\":%u,"
+		       "\"key_reuse\":%.3f,\"decrypt_ratio\":%.3f,"
+		       "\"duration_ns\":%llu,\"ops\":%llu,\"errors\":%llu,"
+		       "\"ops_per_s\":%.1f,\"mb_per_s\":%.3f,"
+		       "\"latency_ns\":{\"p50\":%llu,\"p99\":%llu,"
+		       "\"p99_9\":%llu,\"max\":%llu},"
+		       "\"cpu_requests\":%llu,\"phase_ops\":%llu,"
+		       "\"phase_ns\":{",
+		       SIMPLEAES_BENCH_VERSION, BenchPtr->label,
+		       BenchPtr->backend->name, BenchPtr->engines, completion,
+		       point_ptr->threads, point_ptr->blocks,
+		       point_ptr->key_reuse, point_ptr->decrypt_ratio,
+		       elapsed_ns, ops, errors, ops_s, mb_s, p50, p99, p999,
+		       HistPtr->max_ns, DeltaPtr->cpu_requests, DeltaPtr->ops);
+		for (i = 0; i < ORG_SIMPLE_OP_PHASES; i++) {
+			printf("%s\"%s\":%llu", i ? "," : "",
+			       simpleaes_bench_phase_names[i],
+			       DeltaPtr->phase_ns[i] / phase_ops);
+		}
+		printf("}}\n");
+		break;
+	case SIMPLEAES_BENCH_FORMAT_CSV:
+		printf("%s,%s,%u,%s,%u,%u,%.3f,%.3f,%llu,%llu,%llu,%.1f,%.3f,"
+		       "%llu,%llu,%llu,%llu,%llu,%llu",
+		       BenchPtr->label, BenchPtr->backend->name,
+		       BenchPtr->engines, completion, point_ptr->threads,
+		       point_ptr->blocks, point_ptr->key_reuse,
+		       point_ptr->decrypt_ratio, elapsed_ns, ops, errors,
+		       ops_s, mb_s, p50, p99, p999, HistPtr->max_ns,
+		       DeltaPtr->cpu_requests, DeltaPtr->ops);
+		for (i = 0; i < ORG_SIMPLE_OP_PHASES; i++) {
+			printf(",%llu", DeltaPtr->phase_ns[i] / phase_ops);
+		}
+		printf("\n");
+		break;
+	default:
+		printf("%7u %6u %5.2f %5.2f %11.0f %9.2f %9llu %9llu %9llu "
+		       "%6llu",
+		       point_ptr->threads, point_ptr->blocks,
+		       point_ptr->key_reuse, point_ptr->decrypt_ratio, ops_s,
+		       mb_s, p50, p99, p999, errors);
+		if (DeltaPtr->ops) {
+			for (i = 0; i < ORG_SIMPLE_OP_PHASES; i++) {
+				printf(" %8llu",
+				       DeltaPtr->phase_ns[i] / phase_ops);
+			}
+		}
+		printf("\n");
+		break;
+	}
+	fflush(stdout);
+}
+
+// One row per engine, buffer memory and size of the driver's dma_bench
+static int SimpleAESBench_DmaBench(SimpleAESBench *BenchPtr)
+{
+	unsigned long long in_mb_s, out_mb_s;
+	char buf[PAGE_SIZE], memory[16];
+	unsigned int engine;
+	char *line, *save;
+	size_t bytes;
+	int ret;
+
+	switch (BenchPtr->format) {
+	case SIMPLEAES_BENCH_FORMAT_CSV:
+		printf("label,backend,engine,memory,bytes,copy_in_mb_s,"
+		       "copy_out_mb_s\n");
+		break;
+	case SIMPLEAES_BENCH_FORMAT_TEXT:
+		printf("%6s %9s %6s %12s %13s\n", "engine", "memory", "bytes",
+		       "copy_in_MB/s", "copy_out_MB/s");
+		break;
+	default:
+		break;
+	}
+
+	for (engine = 0; engine < BenchPtr->engines; engine++) {
+		ret = BenchPtr->backend->read_debugfs(engine, "dma_bench", buf);
+		if (ret) {
+			fprintf(stderr, "simpleaes-bench: dma_bench: %s\n",
+				strerror(-ret));
+			return ret;
+		}
+
+		for (line = strtok_r(buf, "\n", &save); line;
+		     line = strtok_r(NULL, "\n", &save)) {
+			if (sscanf(line, "%15s %zu %llu %llu", memory, &bytes,
+				   &in_mb_s, &out_mb_s) != 4) {
+				continue;
+			}
+
+			switch (BenchPtr->format) {
+			case SIMPLEAES_BENCH_FORMAT_CSV:
+				printf("%s,%s,%u,%s,%zu,%llu,%llu\n",
+				       BenchPtr->label, BenchPtr->backend->name,
+				       engine, memory, bytes, in_mb_s,
+				       out_mb_s);
+				break;
+			case SIMPLEAES_BENCH_FORMAT_JSON:
+				printf("{\"label\":\"%s\",\"backend\":\"%s\","
+				       "\"engine\":%u,\"memory\":\"%s\","
+				       "\"bytes\":%zu,\"copy_in_mb_s\":%llu,"
+				       "\"copy_out_mb_s\":%llu}\n",
+				       BenchPtr->label, BenchPtr->backend->name,
+				       engine, memory, bytes, in_mb_s,
+				       out_mb_s);
+				break;
+			default:
+				printf("%6u %9s %6zu %12llu %13llu\n", engine,
+				       memory, bytes, in_mb_s, out_mb_s);
+				break;
+			}
+		}
+	}
+	fflush(stdout);
+
+	return 0;
+}
+
+//==============================================================================
+// Command Line
+//==============================================================================
+
+static int SimpleAESBench_ParseUintList(const char *arg, unsigned int *vals,
+					unsigned int *CountPtr,
+					unsigned int max_val)
+{
+	unsigned long val;
+	char *end_ptr;
+
+	*CountPtr = 0;
+	do {
+		errno = 0;
+		val   = strtoul(arg, &end_ptr, 0);
+		if (errno || end_ptr == arg || !val || val > max_val ||
+		    *CountPtr == SIMPLEAES_BENCH_MAX_POINTS) {
+			return -EINVAL;
+		}
+		vals[(*CountPtr)++] = (unsigned int)val;
+		arg = end_ptr + 1;
+	} while (*end_ptr == ',');
+
+	return *end_ptr ? -EINVAL : 0;
+}
+
+static int SimpleAESBench_ParseRatioList(const char *arg, double *vals,
+					 unsigned int *CountPtr)
+{
+	char *end_ptr;
+	double val;
+
+	*CountPtr = 0;
+	do {
+		val = strtod(arg, &end_ptr);
+		if (end_ptr == arg || !(val >= 0.0 && val <= 1.0) ||
+		    *CountPtr == SIMPLEAES_BENCH_MAX_POINTS) {
+			return -EINVAL;
+		}
+		vals[(*CountPtr)++] = val;
+		arg = end_ptr + 1;
+	} while (*end_ptr == ',');
+
+	return *end_ptr ? -EINVAL : 0;
+}
+
+static void SimpleAESBench_Usage(FILE *stream)
+{
+	fprintf(stream,
+		"usage: simpleaes-bench [options]\n"
+		"\n"
+		"  -b, --backend=auto|device|model  request path (auto)\n"
+		"  -e, --engines=N           model engines (2)\n"
+		"  -p, --param=NAME=VAL      model driver module parameter\n"
+		"  -H, --hw=ver2|ver3        model engine register interface "
+		"(ver2)\n"
+		"  -c, --completion=irq|poll|hybrid  per-file completion mode\n"
+		"  -t, --threads=LIST        thread counts (1,2,4,8)\n"
+		"  -s, --blocks=LIST         blocks per request (1,16,256)\n"
+		"  -k, --key-reuse=LIST      key reuse ratios (1,0.5,0)\n"
+		"  -x, --decrypt=LIST        decrypt ratios (0,0.5)\n"
+		"  -d, --duration=MS         measured time per point (1000)\n"
+		"  -w, --warmup=MS           warmup per point (200)\n"
+		"  -f, --format=text|csv|json  output format (text)\n"
+		"  -l, --label=STR           tag for the results (driver "
+		"release)\n"
+		"  -D, --dma-bench           print the engines' DMA copy "
+		"bandwidth and exit\n"
+		"  -h, --help\n"
+		"\n"
+		"Requests of 1 block use IOCTL_ENCRYPT/IOCTL_DECRYPT, larger "
+		"ones the\n"
+		"batch ioctls. MB/s counts %u bytes per block. Phase columns "
+		"are mean\n"
+		"ns per single-block engine operation, from op_phases.\n",
+		ORG_SIMPLE_KD_SIZE);
+}
+
+int main(int argc, char **argv)
+{
+	static const struct option options[] = {
+		{ "backend", required_argument, NULL, 'b' },
+		{ "engines", required_argument, NULL, 'e' },
+		{ "param", required_argument, NULL, 'p' },
+		{ "hw", required_argument, NULL, 'H' },
+		{ "completion", required_argument, NULL, 'c' },
+		{ "threads", required_argument, NULL, 't' },
+		{ "blocks", required_argument, NULL, 's' },
+		{ "key-reuse", required_argument, NULL, 'k' },
+		{ "decrypt", required_argument, NULL, 'x' },
+		{ "duration", required_argument, NULL, 'd' },
+		{ "warmup", required_argument, NULL, 'w' },
+		{ "format", required_argument, NULL, 'f' },
+		{ "label", required_argument, NULL, 'l' },
+		{ "dma-bench", no_argument, NULL, 'D' },
+		{ "help", no_argument, NULL, 'h' },
+		{ NULL, 0, NULL, 0 },
+	};
+	static SimpleAESBench bench = {
+		.format		   = SIMPLEAES_BENCH_FORMAT_TEXT,
+		.label		   = "",
+		.engines	   = 2,
+		.completion	   = -1,
+		.duration_ms	   = 1000,
+		.warmup_ms	   = 200,
+		.threads	   = { 1, 2, 4, 8 },
+		.num_threads	   = 4,
+		.blocks		   = { 1, 16, 256 },
+		.num_blocks	   = 3,
+		.key_reuse	   = { 1.0, 0.5, 0.0 },
+		.num_key_reuse	   = 3,
+		.decrypt_ratio	   = { 0.0, 0.5 },
+		.num_decrypt_ratio = 2,
+	};
+	const char *const *completion_names = simpleaes_bench_completion_names;
+	const char *backend = "auto";
+	bool dma_bench	    = false;
+	SimpleAESModel_Config model_config;
+	unsigned int num_points, point, idx, i;
+	char *val_ptr;
+	int opt, ret;
+
+	while ((opt = getopt_long(argc, argv, "b:e:p:H:c:t:s:k:x:d:w:f:l:Dh",
+				  options, NULL)) != -1) {
+		ret = 0;
+		switch (opt) {
+		case 'b':
+			backend = optarg;
+			break;
+		case 'e':
+			ret = SimpleAESBench_ParseUintList(
+				optarg, &bench.engines, &i,
+				ORG_SIMPLE_MAX_DEVICES);
+			ret = ret ?: (i == 1 ? 0 : -EINVAL);
+			break;
+		case 'p':
+			val_ptr = strchr(optarg, '=');
+			if (!val_ptr) {
+				ret = -EINVAL;
+				break;
+			}
+			*val_ptr++ = '\0';
+			ret = SimpleAESHost_SetParam(optarg,
+						     strtoul(val_ptr, NULL, 0));
+			break;
+		case 'H':
+			if (!strcmp(optarg, "ver2")) {
+				bench.ring = false;
+			} else if (!strcmp(optarg, "ver3")) {
+				bench.ring = true;
+			} else {
+				ret = -EINVAL;
+			}
+			break;
+		case 'c':
+			bench.completion = -1;
+			for (i = 0; i < ORG_SIMPLE_COMPLETION_MODES; i++) {
+				if (!strcmp(optarg, completion_names[i])) {
+					bench.completion = (int)i;
+				}
+			}
+			ret = bench.completion < 0 ? -EINVAL : 0;
+			break;
+		case 't':
+			ret = SimpleAESBench_ParseUintList(
+				optarg, bench.threads, &bench.num_threads,
+				SIMPLEAES_BENCH_MAX_THREADS);
+			break;
+		case 's':
+			ret = SimpleAESBench_ParseUintList(
+				optarg, bench.blocks, &bench.num_blocks,
+				ORG_SIMPLE_BATCH_MAX_BLOCKS);
+			break;
+		case 'k':
+			ret = SimpleAESBench_ParseRatioList(
+				optarg, bench.key_reuse, &bench.num_key_reuse);
+			break;
+		case 'x':
+			ret = SimpleAESBench_ParseRatioList(
+				optarg, bench.decrypt_ratio,
+				&bench.num_decrypt_ratio);
+			break;
+		case 'd':
+			bench.duration_ms = strtoul(optarg, NULL, 0);
+			ret = bench.duration_ms ? 0 : -EINVAL;
+			break;
+		case 'w':
+			bench.warmup_ms = strtoul(optarg, NULL, 0);
+			break;
+		case 'f':
+			if (!strcmp(optarg, "text")) {
+				bench.format = SIMPLEAES_BENCH_FORMAT_TEXT;
+			} else if (!strcmp(optarg, "csv")) {
+				bench.format = SIMPLEAES_BENCH_FORMAT_CSV;
+			} else if (!strcmp(optarg, "json")) {
+				bench.format = SIMPLEAES_BENCH_FORMAT_JSON;
+			} else {
+				ret = -EINVAL;
+			}
+			break;
+		case 'l':
+			bench.label = optarg;
+			break;
+		case 'D':
+			dma_bench = true;
+			break;
+		case 'h':
+			SimpleAESBench_Usage(stdout);
+			return 0;
+		default:
+			SimpleAESBench_Usage(stderr);
+			return 2;
+		}
+		if (ret) {
+			fprintf(stderr, "simpleaes-bench: bad -%c argument\n",
+				opt);
+			return 2;
+		}
+	}
+
+	if (!strcmp(backend, "auto")) {
+		backend = access(SIMPLEAES_BENCH_DEVICE, R_OK | W_OK) ?
+				  "model" :
+				  "device";
+	}
+	if (!strcmp(backend, "device")) {
+		if (access(SIMPLEAES_BENCH_DEVICE, R_OK | W_OK)) {
+			fprintf(stderr, "simpleaes-bench: %s: %s\n",
+				SIMPLEAES_BENCH_DEVICE, strerror(errno));
+			return 1;
+		}
+		bench.backend = &simpleaes_bench_device;
+		bench.engines = SimpleAESBench_DeviceEngines();
+	} else if (!strcmp(backend, "model")) {
+		bench.backend = &simpleaes_bench_model;
+		SimpleAESModel_DefaultConfig(&model_config);
+		model_config.ring = bench.ring;
+		ret = SimpleAESHost_Init(bench.engines, &model_config);
+		if (ret) {
+			fprintf(stderr, "simpleaes-bench: model: %s\n",
+				strerror(-ret));
+			return 1;
+		}
+	} else {
+		SimpleAESBench_Usage(stderr);
+		return 2;
+	}
+
+	if (dma_bench) {
+		ret = SimpleAESBench_DmaBench(&bench);
+		goto __main_deinit;
+	}
+
+	switch (bench.format) {
+	case SIMPLEAES_BENCH_FORMAT_CSV:
+		printf("label,backend,engines,completion,threads,blocks,"
+		       "key_reuse,decrypt_ratio,duration_ns,ops,errors,"
+		       "ops_per_s,mb_per_s,p50_ns,p99_ns,p99_9_ns,max_ns,"
+		       "cpu_requests,phase_ops");
+		for (i = 0; i < ORG_SIMPLE_OP_PHASES; i++) {
+			printf(",%s_ns", simpleaes_bench_phase_names[i]);
+		}
+		printf("\n");
+		break;
+	case SIMPLEAES_BENCH_FORMAT_TEXT:
+		printf("# backend %s, %u engine(s), completion %s",
+		       bench.backend->name, bench.engines,
+		       bench.completion < 0 ?
+			       "default" :
+			       completion_names[bench.completion]);
+		if (bench.backend == &simpleaes_bench_model) {
+			printf(", hw %s", bench.ring ? "ver3" : "ver2");
+		}
+		printf("\n");
+		printf("%7s %6s %5s %5s %11s %9s %9s %9s %9s %6s", "threads",
+		       "blocks", "reuse", "decr", "ops/s", "MB/s", "p50_ns",
+		       "p99_ns", "p99.9_ns", "errors");
+		for (i = 0; i < ORG_SIMPLE_OP_PHASES; i++) {
+			printf(" %8s", simpleaes_bench_phase_names[i]);
+		}
+		printf("\n");
+		break;
+	default:
+		break;
+	}
+
+	// Sweep order: threads, then blocks, key reuse and decrypt ratio
+	num_points = bench.num_threads * bench.num_blocks *
+		     bench.num_key_reuse * bench.num_decrypt_ratio;
+	ret	   = 0;
+	for (point = 0; point < num_points && !ret; point++) {
+		idx = point;
+		bench.point.decrypt_ratio =
+			bench.decrypt_ratio[idx % bench.num_decrypt_ratio];
+		idx /= bench.num_decrypt_ratio;
+		bench.point.key_reuse =
+			bench.key_reuse[idx % bench.num_key_reuse];
+		idx /= bench.num_key_reuse;
+		bench.point.blocks = bench.blocks[idx % bench.num_blocks];
+		idx /= bench.num_blocks;
+		bench.point.threads = bench.threads[idx];
+
+		ret = SimpleAESBench_RunPoint(&bench);
+	}
+
+__main_deinit:
+	if (bench.backend == &simpleaes_bench_model) {
+		SimpleAESHost_DeInit();
+	}
+	return ret ? 1 : 0;
+}
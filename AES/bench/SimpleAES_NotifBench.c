@@ -0,0 +1,254 @@
+// simpleaes-notifbench: wakeup latency of the driver's completion channel,
+// before and after std.Notification<T> became a tag-indexed ring.
+//
+// A receiver thread sleeps in Receive for one tag; once it is asleep the
+// producer stamps the time and posts the completion. The latency is the
+// time from the stamp until Receive has returned in the receiver. Two
+// channels are measured:
+//
+//	flag        the previous Notification_Error: one flag, data and tag
+//		    behind one wait queue, every Send waking every waiter
+//	ring        NOTIFICATION_* from SimpleAES_Linux.h: one slot per
+//		    tag % NOTIFICATION_DEPTH, Post then Flush waking only the
+//		    receivers of the posted slots
+//
+// each with 0 and SIMPLEAES_NOTIFBENCH_BYSTANDERS other threads waiting on
+// the channel for tags that are only posted at the end, as operations of
+// other files would be in flight on a ring engine.
+//
+// Runs on the userspace shim (wait queues and rcuwait are condition
+// variables there), so the numbers compare the two channels rather than
+// predict kernel latencies.
+//
+// Build and run (from AES/):
+//
+//	cc -O2 -pthread -I model/include -I model bench/SimpleAES_NotifBench.c
+//	   model/SimpleAES_Host.c model/SimpleAES_Shim.c
+//	   model/SimpleAES_Model.c -o simpleaes-notifbench
+//	./simpleaes-notifbench
+//
+// Prints one line per channel and bystander count: p50, p99 and mean
+// latency in ns.
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "SimpleAES_Host.h"
+
+//==============================================================================
+// Constant Definitions
+//==============================================================================
+
+#define SIMPLEAES_NOTIFBENCH_SAMPLES	5000
+#define SIMPLEAES_NOTIFBENCH_BYSTANDERS 8
+
+// The producer waits this long after the receiver announced its tag, so
+// that the receiver is asleep when the completion is posted
+#define SIMPLEAES_NOTIFBENCH_SETTLE_NS 20000
+
+//==============================================================================
+// Type Definitions
+//==============================================================================
+
+// Notification_Error before the completion ring
+typedef struct {
+	wait_queue_head_t wq;
+	u64 data;
+	u64 tag;
+	bool flag;
+} SimpleAESNotifBench_Flag;
+
+NOTIFICATION_DECLARE_TYPE(Bench, u64);
+NOTIFICATION_DECLARE_FUNCS(Bench, u64);
+
+typedef struct {
+	const char *name;
+	void (*init)(void);
+	void (*send)(u64 tag);
+	void (*receive)(u64 tag);
+} SimpleAESNotifBench_Channel;
+
+//==============================================================================
+// Variable Definitions
+//==============================================================================
+
+static SimpleAESNotifBench_Flag simpleaes_notifbench_flag;
+static Notification_Bench simpleaes_notifbench_ring;
+static const SimpleAESNotifBench_Channel *simpleaes_notifbench_channel;
+
+// Receiver handshake: the sample it waits for, and the last one it got
+static volatile long simpleaes_notifbench_armed;
+static volatile long simpleaes_notifbench_done;
+static volatile u64 simpleaes_notifbench_sent_ns;
+static u64 simpleaes_notifbench_samples[SIMPLEAES_NOTIFBENCH_SAMPLES];
+
+//==============================================================================
+// Function Definitions
+//==============================================================================
+
+NOTIFICATION_DEFINE_FUNCS(Bench, u64)
+
+static u64 SimpleAESNotifBench_NowNs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void SimpleAESNotifBench_FlagInit(void)
+{
+	init_waitqueue_head(&simpleaes_notifbench_flag.wq);
+	simpleaes_notifbench_flag.flag = 0;
+}
+
+static void SimpleAESNotifBench_FlagSend(u64 tag)
+{
+	SimpleAESNotifBench_Flag *notif_ptr = &simpleaes_notifbench_flag;
+
+	notif_ptr->data = tag;
+	notif_ptr->tag	= tag;
+	smp_wmb();
+	WRITE_ONCE(notif_ptr->flag, 1);
+	wake_up(&notif_ptr->wq);
+}
+
+static void SimpleAESNotifBench_FlagReceive(u64 tag)
+{
+	SimpleAESNotifBench_Flag *notif_ptr = &simpleaes_notifbench_flag;
+
+	wait_event(notif_ptr->wq, READ_ONCE(notif_ptr->flag) == 1 &&
+					  READ_ONCE(notif_ptr->tag) == tag);
+	smp_rmb();
+	notif_ptr->flag = 0;
+}
+
+static void SimpleAESNotifBench_RingInit(void)
+{
+	Notification_Bench_Init(&simpleaes_notifbench_ring);
+}
+
+static void SimpleAESNotifBench_RingSend(u64 tag)
+{
+	Notification_Bench_Post(&simpleaes_notifbench_ring, tag, tag);
+	Notification_Bench_Flush(&simpleaes_notifbench_ring);
+}
+
+static void SimpleAESNotifBench_RingReceive(u64 tag)
+{
+	u64 data;
+
+	Notification_Bench_Receive(&simpleaes_notifbench_ring, tag, &data,
+				   MAX_SCHEDULE_TIMEOUT);
+}
+
+static const SimpleAESNotifBench_Channel simpleaes_notifbench_channels[] = {
+	{ "flag", SimpleAESNotifBench_FlagInit, SimpleAESNotifBench_FlagSend,
+	  SimpleAESNotifBench_FlagReceive },
+	{ "ring", SimpleAESNotifBench_RingInit, SimpleAESNotifBench_RingSend,
+	  SimpleAESNotifBench_RingReceive },
+};
+
+// Sample k waits for tag (k + 1) * NOTIFICATION_DEPTH (slot 0); bystander b
+// for tag b + 1, which is only sent to release it
+static void *SimpleAESNotifBench_Receiver(void *arg)
+{
+	long k;
+
+	(void)arg;
+	for (k = 0; k < SIMPLEAES_NOTIFBENCH_SAMPLES; k++) {
+		simpleaes_notifbench_armed = k;
+		simpleaes_notifbench_channel->receive((u64)(k + 1) *
+						      NOTIFICATION_DEPTH);
+		simpleaes_notifbench_samples[k] =
+			SimpleAESNotifBench_NowNs() -
+			simpleaes_notifbench_sent_ns;
+		simpleaes_notifbench_done = k;
+	}
+	return NULL;
+}
+
+static void *SimpleAESNotifBench_Bystander(void *arg)
+{
+	simpleaes_notifbench_channel->receive((uintptr_t)arg + 1);
+	return NULL;
+}
+
+static int SimpleAESNotifBench_Compare(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void SimpleAESNotifBench_Run(const SimpleAESNotifBench_Channel *ChanPtr,
+				    unsigned int bystanders)
+{
+	struct timespec settle = { 0, SIMPLEAES_NOTIFBENCH_SETTLE_NS };
+	pthread_t receiver, others[SIMPLEAES_NOTIFBENCH_BYSTANDERS];
+	u64 sum = 0;
+	uintptr_t b;
+	long k;
+
+	simpleaes_notifbench_channel = ChanPtr;
+	simpleaes_notifbench_armed   = -1;
+	simpleaes_notifbench_done    = -1;
+	ChanPtr->init();
+
+	for (b = 0; b < bystanders; b++) {
+		pthread_create(&others[b], NULL, SimpleAESNotifBench_Bystander,
+			       (void *)b);
+	}
+	nanosleep(&settle, NULL);
+	pthread_create(&receiver, NULL, SimpleAESNotifBench_Receiver, NULL);
+
+	for (k = 0; k < SIMPLEAES_NOTIFBENCH_SAMPLES; k++) {
+		while (simpleaes_notifbench_armed != k) {
+			sched_yield();
+		}
+		nanosleep(&settle, NULL);
+
+		simpleaes_notifbench_sent_ns = SimpleAESNotifBench_NowNs();
+		ChanPtr->send((u64)(k + 1) * NOTIFICATION_DEPTH);
+
+		while (simpleaes_notifbench_done != k) {
+			sched_yield();
+		}
+	}
+	pthread_join(receiver, NULL);
+
+	// One at a time: the flag channel holds one completion
+	for (b = 0; b < bystanders; b++) {
+		ChanPtr->send(b + 1);
+		pthread_join(others[b], NULL);
+	}
+
+	qsort(simpleaes_notifbench_samples, SIMPLEAES_NOTIFBENCH_SAMPLES,
+	      sizeof(u64), SimpleAESNotifBench_Compare);
+	for (k = 0; k < SIMPLEAES_NOTIFBENCH_SAMPLES; k++) {
+		sum += simpleaes_notifbench_samples[k];
+	}
+	printf("%s bystanders %u p50 %llu p99 %llu mean %llu\n", ChanPtr->name,
+	       bystanders,
+	       simpleaes_notifbench_samples[SIMPLEAES_NOTIFBENCH_SAMPLES / 2],
+	       simpleaes_notifbench_samples[SIMPLEAES_NOTIFBENCH_SAMPLES * 99 /
+					    100],
+	       sum / SIMPLEAES_NOTIFBENCH_SAMPLES);
+}
+
+int main(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(simpleaes_notifbench_channels); i++) {
+		SimpleAESNotifBench_Run(&simpleaes_notifbench_channels[i], 0);
+		SimpleAESNotifBench_Run(&simpleaes_notifbench_channels[i],
+					SIMPLEAES_NOTIFBENCH_BYSTANDERS);
+	}
+	Notification_Bench_DeInit(&simpleaes_notifbench_ring);
+
+	return 0;
+}
@@ -0,0 +1,227 @@
+// simpleaes-regs-bench: SimpleAES_Regs.hpp against the SIMPLEAES_* register
+// macros.
+//
+// Runs the register sequences of the driver's hot path (programming CTRL,
+// submitting an operation, polling STAT.BUSY) with both accessor families
+// on a software register file. It reports the time and the number of
+// register reads and writes per sequence, so the cost of each access style
+// and the accesses merged by typed field updates and shadows are visible
+// without hardware.
+//
+// Build (from AES/):
+//
+//	cc -O2 -I model/include -I model -c bench/SimpleAES_RegsBenchMacros.c
+//	c++ -std=c++20 -O2 -I . bench/SimpleAES_RegsBench.cpp
+//	    SimpleAES_RegsBenchMacros.o -o simpleaes-regs-bench
+//
+// Usage: simpleaes-regs-bench [iterations] (default 10000000)
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+#include "SimpleAES_Regs.hpp"
+#include "SimpleAES_RegsBench.h"
+
+using namespace org::simple::simpleaes;
+
+//==============================================================================
+// Constant Definitions
+//==============================================================================
+
+#define SIMPLEAES_REGSBENCH_ITERATIONS 10000000ul
+
+// The same addresses as the macro side
+#define SIMPLEAES_REGSBENCH_KEY 0x10000000u
+#define SIMPLEAES_REGSBENCH_IN	0x20000000u
+#define SIMPLEAES_REGSBENCH_OUT 0x30000000u
+
+//==============================================================================
+// Type Definitions
+//==============================================================================
+
+// The software register file of the macro side, as a RegisterBus
+struct SoftBus {
+	u32 read(u32 offset)
+	{
+		simpleaes_regsbench_reads++;
+		return simpleaes_regsbench_regs[offset / sizeof(u32)];
+	}
+
+	void write(u32 offset, u32 val)
+	{
+		simpleaes_regsbench_writes++;
+		simpleaes_regsbench_regs[offset / sizeof(u32)] = val;
+	}
+};
+
+typedef struct {
+	const char *sequence;
+	const char *accessor;
+	unsigned long (*run)(unsigned long iterations);
+} SimpleAESRegsBench_Case;
+
+//==============================================================================
+// Function Definitions
+//==============================================================================
+
+static unsigned long
+SimpleAESRegsBench_TemplateSetMode(unsigned long iterations)
+{
+	SoftBus bus;
+
+	for (unsigned long i = 0; i < iterations; i++) {
+		Reg<CTRL>::modify(bus, CTRL::OP = u32(i & 1), CTRL::IE = 1);
+	}
+
+	return 0;
+}
+
+static unsigned long
+SimpleAESRegsBench_TemplateShadowSetMode(unsigned long iterations)
+{
+	Shadow<CTRL> ctrl;
+	SoftBus bus;
+
+	for (unsigned long i = 0; i < iterations; i++) {
+		Reg<CTRL>::modify(bus, ctrl, CTRL::OP = u32(i & 1),
+				  CTRL::IE = 1);
+	}
+
+	return 0;
+}
+
+static unsigned long
+SimpleAESRegsBench_TemplateSubmit(unsigned long iterations)
+{
+	SoftBus bus;
+
+	for (unsigned long i = 0; i < iterations; i++) {
+		Reg<CTRL>::modify(bus, CTRL::OP = u32(i & 1), CTRL::IE = 1);
+		Reg<KAR>::write(bus, KAR::ADDR = SIMPLEAES_REGSBENCH_KEY);
+		Reg<IAR>::write(bus,
+				IAR::ADDR = SIMPLEAES_REGSBENCH_IN + u32(i));
+		Reg<OAR>::write(bus,
+				OAR::ADDR = SIMPLEAES_REGSBENCH_OUT + u32(i));
+	}
+
+	return 0;
+}
+
+static unsigned long
+SimpleAESRegsBench_TemplateShadowSubmit(unsigned long iterations)
+{
+	Shadow<CTRL> ctrl;
+	Shadow<KAR> kar;
+	Shadow<IAR> iar;
+	Shadow<OAR> oar;
+	SoftBus bus;
+
+	for (unsigned long i = 0; i < iterations; i++) {
+		Reg<CTRL>::modify(bus, ctrl, CTRL::OP = u32(i & 1),
+				  CTRL::IE = 1);
+		Reg<KAR>::modify(bus, kar, KAR::ADDR = SIMPLEAES_REGSBENCH_KEY);
+		Reg<IAR>::modify(bus, iar,
+				 IAR::ADDR = SIMPLEAES_REGSBENCH_IN + u32(i));
+		Reg<OAR>::write(bus, oar, SIMPLEAES_REGSBENCH_OUT + u32(i));
+	}
+
+	return 0;
+}
+
+static unsigned long
+SimpleAESRegsBench_TemplateBusy(unsigned long iterations)
+{
+	unsigned long busy = 0;
+	SoftBus bus;
+
+	for (unsigned long i = 0; i < iterations; i++) {
+		busy += Field<STAT::BUSY>::read(bus);
+	}
+
+	return busy;
+}
+
+static unsigned long SimpleAESRegsBench_MacroSetModeCase(unsigned long n)
+{
+	SimpleAESRegsBench_MacroSetMode(n);
+	return 0;
+}
+
+static unsigned long SimpleAESRegsBench_MacroShadowSetModeCase(unsigned long n)
+{
+	SimpleAESRegsBench_MacroShadowSetMode(n);
+	return 0;
+}
+
+static unsigned long SimpleAESRegsBench_MacroSubmitCase(unsigned long n)
+{
+	SimpleAESRegsBench_MacroSubmit(n);
+	return 0;
+}
+
+static unsigned long SimpleAESRegsBench_MacroShadowSubmitCase(unsigned long n)
+{
+	SimpleAESRegsBench_MacroShadowSubmit(n);
+	return 0;
+}
+
+static const SimpleAESRegsBench_Case simpleaes_regsbench_cases[] = {
+	{ "set-mode", "macro", SimpleAESRegsBench_MacroSetModeCase },
+	{ "set-mode", "macro-shadow",
+	  SimpleAESRegsBench_MacroShadowSetModeCase },
+	{ "set-mode", "template", SimpleAESRegsBench_TemplateSetMode },
+	{ "set-mode", "template-shadow",
+	  SimpleAESRegsBench_TemplateShadowSetMode },
+	{ "submit", "macro", SimpleAESRegsBench_MacroSubmitCase },
+	{ "submit", "macro-shadow", SimpleAESRegsBench_MacroShadowSubmitCase },
+	{ "submit", "template", SimpleAESRegsBench_TemplateSubmit },
+	{ "submit", "template-shadow",
+	  SimpleAESRegsBench_TemplateShadowSubmit },
+	{ "stat-busy", "macro", SimpleAESRegsBench_MacroBusy },
+	{ "stat-busy", "template", SimpleAESRegsBench_TemplateBusy },
+};
+
+static double SimpleAESRegsBench_Now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long iterations = SIMPLEAES_REGSBENCH_ITERATIONS;
+	double start_ns, ns;
+
+	if (argc > 1) {
+		iterations = strtoul(argv[1], NULL, 0);
+		if (!iterations) {
+			fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	printf("%-10s %-16s %8s %8s %8s\n", "sequence", "accessor", "ns/seq",
+	       "reads", "writes");
+	for (const SimpleAESRegsBench_Case &test : simpleaes_regsbench_cases) {
+		// Start from reset, as a probed engine would
+		for (volatile uint32_t &reg : simpleaes_regsbench_regs) {
+			reg = 0;
+		}
+		simpleaes_regsbench_reads  = 0;
+		simpleaes_regsbench_writes = 0;
+
+		start_ns = SimpleAESRegsBench_Now();
+		test.run(iterations);
+		ns = SimpleAESRegsBench_Now() - start_ns;
+
+		printf("%-10s %-16s %8.2f %8.2f %8.2f\n", test.sequence,
+		       test.accessor, ns / iterations,
+		       double(simpleaes_regsbench_reads) / iterations,
+		       double(simpleaes_regsbench_writes) / iterations);
+	}
+
+	return 0;
+}
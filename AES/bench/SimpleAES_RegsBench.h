@@ -0,0 +1,42 @@
+#ifndef ORG_SIMPLE_SIMPLEAES_REGSBENCH_H
+#define ORG_SIMPLE_SIMPLEAES_REGSBENCH_H
+
+// Shared by the two halves of simpleaes-regs-bench: the C kernels built on the
+// SIMPLEAES_* macros (SimpleAES_RegsBenchMacros.c) and the C++ driver built on
+// SimpleAES_Regs.hpp (SimpleAES_RegsBench.cpp). Both access the same software
+// register file, which counts every read and write.
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//==============================================================================
+// Variable Declarations
+//==============================================================================
+
+// Software register file (CTRL ... OAR) and its access counters
+extern volatile uint32_t simpleaes_regsbench_regs[6];
+extern uint64_t simpleaes_regsbench_reads;
+extern uint64_t simpleaes_regsbench_writes;
+
+//==============================================================================
+// Function Prototypes
+//==============================================================================
+
+// Each runs its sequence iterations times. Operation i alternates OP with
+// i & 1 and takes its input and output addresses from i; the key stays. The
+// STAT.BUSY reader returns how many reads saw the engine busy.
+
+void SimpleAESRegsBench_MacroSetMode(unsigned long iterations);
+void SimpleAESRegsBench_MacroShadowSetMode(unsigned long iterations);
+void SimpleAESRegsBench_MacroSubmit(unsigned long iterations);
+void SimpleAESRegsBench_MacroShadowSubmit(unsigned long iterations);
+unsigned long SimpleAESRegsBench_MacroBusy(unsigned long iterations);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ORG_SIMPLE_SIMPLEAES_REGSBENCH_H
@@ -0,0 +1,115 @@
+// simpleaes-regs-bench: the SIMPLEAES_* macro side (see
+// SimpleAES_RegsBench.cpp)
+
+#include "SimpleAES_Shim.h"
+
+#include "../SimpleAES_Linux.h"
+#include "SimpleAES_RegsBench.h"
+
+//==============================================================================
+// Software Register Backend
+//==============================================================================
+
+// The register macros reach the software register file instead of the shim's
+// MMIO dispatch
+#undef ioread32
+#undef iowrite32
+#define ioread32(addr) \
+	(simpleaes_regsbench_reads++, *(volatile u32 *)(addr))
+#define iowrite32(val, addr) \
+	(simpleaes_regsbench_writes++, *(volatile u32 *)(addr) = (val))
+
+#define SIMPLEAES_REGSBENCH_BASE ((void __iomem *)simpleaes_regsbench_regs)
+#define SIMPLEAES_REGSBENCH_KEY	 0x10000000u
+#define SIMPLEAES_REGSBENCH_IN	 0x20000000u
+#define SIMPLEAES_REGSBENCH_OUT	 0x30000000u
+
+//==============================================================================
+// Variable Definitions
+//==============================================================================
+
+volatile uint32_t simpleaes_regsbench_regs[6];
+uint64_t simpleaes_regsbench_reads;
+uint64_t simpleaes_regsbench_writes;
+
+static u32 simpleaes_regsbench_shadow[SIMPLEAES_REGS];
+
+//==============================================================================
+// Function Definitions
+//==============================================================================
+
+// As the driver before shadowing: one read-modify-write per field
+void SimpleAESRegsBench_MacroSetMode(unsigned long iterations)
+{
+	void __iomem *ptr = SIMPLEAES_REGSBENCH_BASE;
+	unsigned long i;
+
+	for (i = 0; i < iterations; i++) {
+		SIMPLEAES_FIELD_WRITE((u32)(i & 1), OP, CTRL, ptr);
+		SIMPLEAES_FIELD_WRITE(1, IE, CTRL, ptr);
+	}
+}
+
+// As SimpleAES_ProgramMode: both fields in one write, from the shadow
+void SimpleAESRegsBench_MacroShadowSetMode(unsigned long iterations)
+{
+	void __iomem *ptr = SIMPLEAES_REGSBENCH_BASE;
+	u32 *shadow	  = simpleaes_regsbench_shadow;
+	unsigned long i;
+	u32 ctrl;
+
+	for (i = 0; i < iterations; i++) {
+		ctrl = SIMPLEAES_FIELD_SET((u32)(i & 1), OP, CTRL,
+					   SIMPLEAES_SHADOW(CTRL, shadow));
+		ctrl = SIMPLEAES_FIELD_SET(1, IE, CTRL, ctrl);
+		SIMPLEAES_SHADOW_UPDATE(ctrl, CTRL, ptr, shadow);
+	}
+}
+
+void SimpleAESRegsBench_MacroSubmit(unsigned long iterations)
+{
+	void __iomem *ptr = SIMPLEAES_REGSBENCH_BASE;
+	unsigned long i;
+
+	for (i = 0; i < iterations; i++) {
+		SIMPLEAES_FIELD_WRITE((u32)(i & 1), OP, CTRL, ptr);
+		SIMPLEAES_FIELD_WRITE(1, IE, CTRL, ptr);
+		SIMPLEAES_REG_WRITE(SIMPLEAES_REGSBENCH_KEY, KAR, ptr);
+		SIMPLEAES_REG_WRITE(SIMPLEAES_REGSBENCH_IN + (u32)i, IAR, ptr);
+		SIMPLEAES_REG_WRITE(SIMPLEAES_REGSBENCH_OUT + (u32)i, OAR, ptr);
+	}
+}
+
+// As SimpleAES_Submit, less the STAT.BUSY check
+void SimpleAESRegsBench_MacroShadowSubmit(unsigned long iterations)
+{
+	void __iomem *ptr = SIMPLEAES_REGSBENCH_BASE;
+	u32 *shadow	  = simpleaes_regsbench_shadow;
+	unsigned long i;
+	u32 ctrl;
+
+	for (i = 0; i < iterations; i++) {
+		ctrl = SIMPLEAES_FIELD_SET((u32)(i & 1), OP, CTRL,
+					   SIMPLEAES_SHADOW(CTRL, shadow));
+		ctrl = SIMPLEAES_FIELD_SET(1, IE, CTRL, ctrl);
+		SIMPLEAES_SHADOW_UPDATE(ctrl, CTRL, ptr, shadow);
+		SIMPLEAES_SHADOW_UPDATE(SIMPLEAES_REGSBENCH_KEY, KAR, ptr,
+					shadow);
+		SIMPLEAES_SHADOW_UPDATE(SIMPLEAES_REGSBENCH_IN + (u32)i, IAR,
+					ptr, shadow);
+		SIMPLEAES_SHADOW_WRITE(SIMPLEAES_REGSBENCH_OUT + (u32)i, OAR,
+				       ptr, shadow);
+	}
+}
+
+unsigned long SimpleAESRegsBench_MacroBusy(unsigned long iterations)
+{
+	void __iomem *ptr = SIMPLEAES_REGSBENCH_BASE;
+	unsigned long i, busy = 0;
+
+	for (i = 0; i < iterations; i++) {
+		busy += SIMPLEAES_FIELD_READ(BUSY, STAT, ptr);
+	}
+
+	return busy;
+}
@@ -0,0 +1,457 @@
+// The driver is compiled into this translation unit: the host reaches its
+// static registration data (devno, platform driver) directly.
+#include "../SimpleAES_Linux.c"
+
+#include <stdio.h>
+
+#include "SimpleAES_Host.h"
+
+//==============================================================================
+// Type Definitions
+//==============================================================================
+
+#define SIMPLEAES_HOST_IRQ_BASE 32
+#define SIMPLEAES_HOST_REGS_SIZE 0x1000
+
+typedef struct {
+	SimpleAESModel model;
+	struct platform_device pdev;
+	char name[32];
+	bool probed;
+} SimpleAESHost_Engine;
+
+struct SimpleAESHost_File {
+	struct inode inode;
+	struct file file;
+};
+
+static SimpleAESHost_Engine *simpleaes_host_engines;
+static unsigned int simpleaes_host_num_engines;
+
+//==============================================================================
+// Device Model Glue
+//==============================================================================
+
+static void *SimpleAESHost_Translate(void *ctx, uint32_t addr, size_t len)
+{
+	(void)ctx;
+	return SimpleAESShim_DmaTranslate(addr, len);
+}
+
+static void SimpleAESHost_Irq(void *ctx, bool level)
+{
+	SimpleAESShim_SetIrqLevel((uintptr_t)ctx, level);
+}
+
+// Gating the engine clock resets the engine
+static void SimpleAESHost_ClockGate(void *ctx, bool enabled)
+{
+	SimpleAESModel_Gate(ctx, !enabled);
+}
+
+//==============================================================================
+// Driver Lifetime
+//==============================================================================
+
+int SimpleAESHost_SetParam(const char *name, unsigned int val)
+{
+	return SimpleAESShim_SetParam(name, val);
+}
+
+int SimpleAESHost_Init(unsigned int num_engines,
+		       const SimpleAESModel_Config *ConfigPtr)
+{
+	SimpleAESModel_Config config;
+	SimpleAESHost_Engine *engine_ptr;
+	unsigned int i;
+	int ret;
+
+	if (!num_engines || num_engines > ORG_SIMPLE_MAX_DEVICES) {
+		return -EINVAL;
+	}
+	simpleaes_host_engines = calloc(num_engines, sizeof(*engine_ptr));
+	if (!simpleaes_host_engines) {
+		return -ENOMEM;
+	}
+	simpleaes_host_num_engines = num_engines;
+
+	ret = SimpleAESShim_ModuleInit();
+	if (ret) {
+		goto __simpleaes_host_init_undo_res1;
+	}
+
+	for (i = 0; i < num_engines; i++) {
+		engine_ptr = &simpleaes_host_engines[i];
+		if (ConfigPtr) {
+			config = *ConfigPtr;
+		} else {
+			SimpleAESModel_DefaultConfig(&config);
+		}
+		config.translate = SimpleAESHost_Translate;
+		config.irq	 = SimpleAESHost_Irq;
+		config.ctx = (void *)(uintptr_t)(SIMPLEAES_HOST_IRQ_BASE + i);
+		ret = SimpleAESModel_Init(&engine_ptr->model, &config);
+		if (ret) {
+			goto __simpleaes_host_init_undo_res2;
+		}
+
+		snprintf(engine_ptr->name, sizeof(engine_ptr->name),
+			 "simpleaes.%u", i);
+		SimpleAESShim_DeviceInit(&engine_ptr->pdev.dev,
+					 engine_ptr->name);
+		engine_ptr->pdev.name	  = SIMPLEAES_DEVICE_NAME;
+		engine_ptr->pdev.id	  = i;
+		// The device tree names the engine's register interface
+		engine_ptr->pdev.compatible = config.ring ?
+						      "org-simple-simpleaes-v3" :
+						      "org-simple-simpleaes";
+		engine_ptr->pdev.irq	  = SIMPLEAES_HOST_IRQ_BASE + i;
+		engine_ptr->pdev.clk.gate = SimpleAESHost_ClockGate;
+		engine_ptr->pdev.clk.ctx  = &engine_ptr->model;
+		engine_ptr->pdev.regs	  = SimpleAESShim_MapMmio(
+			SIMPLEAES_HOST_REGS_SIZE, SimpleAESModel_Read,
+			SimpleAESModel_Write, &engine_ptr->model);
+		if (!engine_ptr->pdev.regs) {
+			SimpleAESModel_DeInit(&engine_ptr->model);
+			ret = -ENOMEM;
+			goto __simpleaes_host_init_undo_res2;
+		}
+
+		ret = SimpleAESShim_PlatformDriver->probe(&engine_ptr->pdev);
+		if (ret) {
+			SimpleAESShim_DevresRelease(&engine_ptr->pdev.dev);
+			SimpleAESShim_UnmapMmio(engine_ptr->pdev.regs);
+			SimpleAESModel_DeInit(&engine_ptr->model);
+			goto __simpleaes_host_init_undo_res2;
+		}
+		engine_ptr->probed = true;
+	}
+
+	return 0;
+
+__simpleaes_host_init_undo_res2:
+	SimpleAESHost_DeInit();
+	return ret;
+
+__simpleaes_host_init_undo_res1:
+	free(simpleaes_host_engines);
+	simpleaes_host_engines = NULL;
+	return ret;
+}
+
+void SimpleAESHost_DeInit(void)
+{
+	SimpleAESHost_Engine *engine_ptr;
+	unsigned int i;
+
+	if (!simpleaes_host_engines) {
+		return;
+	}
+
+	for (i = simpleaes_host_num_engines; i-- > 0;) {
+		engine_ptr = &simpleaes_host_engines[i];
+		if (!engine_ptr->probed) {
+			continue;
+		}
+		SimpleAESShim_PlatformDriver->remove(&engine_ptr->pdev);
+		SimpleAESShim_DevresRelease(&engine_ptr->pdev.dev);
+		SimpleAESShim_UnmapMmio(engine_ptr->pdev.regs);
+		SimpleAESModel_DeInit(&engine_ptr->model);
+	}
+	SimpleAESShim_ModuleExit();
+
+	free(simpleaes_host_engines);
+	simpleaes_host_engines	   = NULL;
+	simpleaes_host_num_engines = 0;
+}
+
+SimpleAESModel *SimpleAESHost_Model(unsigned int engine)
+{
+	if (engine >= simpleaes_host_num_engines) {
+		return NULL;
+	}
+
+	return &simpleaes_host_engines[engine].model;
+}
+
+// The next count clk_prepare_enable calls on the engine's clock fail
+int SimpleAESHost_FailClock(unsigned int engine, unsigned int count)
+{
+	if (engine >= simpleaes_host_num_engines) {
+		return -ENODEV;
+	}
+
+	simpleaes_host_engines[engine].pdev.clk.fail_count = count;
+	return 0;
+}
+
+//==============================================================================
+// sysfs Attributes
+//==============================================================================
+
+static struct device_attribute *SimpleAESHost_FindAttr(const char *name)
+{
+	const struct attribute_group **groups =
+		SimpleAESShim_PlatformDriver->driver.dev_groups;
+	struct attribute **attrs;
+
+	for (; groups && *groups; groups++) {
+		for (attrs = (*groups)->attrs; *attrs; attrs++) {
+			if (!strcmp((*attrs)->name, name)) {
+				return container_of(*attrs,
+						    struct device_attribute,
+						    attr);
+			}
+		}
+	}
+
+	return NULL;
+}
+
+ssize_t SimpleAESHost_ReadAttr(unsigned int engine, const char *name,
+			       char *buf)
+{
+	struct device_attribute *attr_ptr = SimpleAESHost_FindAttr(name);
+
+	if (engine >= simpleaes_host_num_engines || !attr_ptr) {
+		return -ENOENT;
+	}
+	if (!attr_ptr->show) {
+		return -EPERM;
+	}
+
+	return attr_ptr->show(&simpleaes_host_engines[engine].pdev.dev,
+			      attr_ptr, buf);
+}
+
+ssize_t SimpleAESHost_WriteAttr(unsigned int engine, const char *name,
+				const char *buf)
+{
+	struct device_attribute *attr_ptr = SimpleAESHost_FindAttr(name);
+
+	if (engine >= simpleaes_host_num_engines || !attr_ptr) {
+		return -ENOENT;
+	}
+	if (!attr_ptr->store) {
+		return -EPERM;
+	}
+
+	return attr_ptr->store(&simpleaes_host_engines[engine].pdev.dev,
+			       attr_ptr, buf, strlen(buf));
+}
+
+ssize_t SimpleAESHost_ReadDebugfs(const char *path, char *buf, size_t len)
+{
+	return SimpleAESShim_DebugfsRead(path, buf, len);
+}
+
+//==============================================================================
+// Character Device
+//==============================================================================
+
+int SimpleAESHost_Open(unsigned int minor, unsigned int flags,
+		       SimpleAESHost_File **FilePtr)
+{
+	dev_t devt = MKDEV(MAJOR(simpleaes_devno), minor);
+	struct cdev *cdev_ptr = SimpleAESShim_CdevLookup(devt);
+	SimpleAESHost_File *file_ptr;
+	int ret;
+
+	if (!cdev_ptr) {
+		return -ENODEV;
+	}
+	file_ptr = calloc(1, sizeof(*file_ptr));
+	if (!file_ptr) {
+		return -ENOMEM;
+	}
+	file_ptr->inode.i_rdev	 = devt;
+	file_ptr->inode.i_cdev	 = cdev_ptr;
+	file_ptr->file.f_op	 = cdev_ptr->ops;
+	file_ptr->file.f_inode	 = &file_ptr->inode;
+	file_ptr->file.f_flags	 = flags;
+
+	ret = file_ptr->file.f_op->open(&file_ptr->inode, &file_ptr->file);
+	if (ret) {
+		free(file_ptr);
+		return ret;
+	}
+	*FilePtr = file_ptr;
+
+	return 0;
+}
+
+int SimpleAESHost_Close(SimpleAESHost_File *FilePtr)
+{
+	int ret = FilePtr->file.f_op->release(&FilePtr->inode,
+					      &FilePtr->file);
+
+	free(FilePtr);
+	return ret;
+}
+
+long SimpleAESHost_Ioctl(SimpleAESHost_File *FilePtr, unsigned int cmd,
+			 void *arg)
+{
+	return FilePtr->file.f_op->unlocked_ioctl(&FilePtr->file, cmd,
+						  (unsigned long)arg);
+}
+
+ssize_t SimpleAESHost_Read(SimpleAESHost_File *FilePtr, void *buf,
+			   size_t count)
+{
+	loff_t pos = 0;
+
+	return FilePtr->file.f_op->read(&FilePtr->file, buf, count, &pos);
+}
+
+// The ring is shared memory already: "mapping" hands out its address
+int SimpleAESHost_Mmap(SimpleAESHost_File *FilePtr, size_t size,
+		       void **AddrPtr)
+{
+	struct vm_area_struct vma = {
+		.vm_start = 0,
+		.vm_end	  = PAGE_ALIGN(size),
+	};
+	int ret = FilePtr->file.f_op->mmap(&FilePtr->file, &vma);
+
+	if (ret) {
+		return ret;
+	}
+	*AddrPtr = vma.host_addr;
+
+	return 0;
+}
+
+// Returns the ready events, 0 on timeout (timeout_ms < 0: no timeout)
+unsigned int SimpleAESHost_Poll(SimpleAESHost_File *FilePtr,
+				unsigned int events, int timeout_ms)
+{
+	u64 deadline = (timeout_ms > 0) ?
+			       ktime_get_ns() + timeout_ms * NSEC_PER_MSEC :
+			       0;
+	unsigned int mask;
+	poll_table pt;
+
+	events |= EPOLLERR | EPOLLHUP;
+	for (;;) {
+		memset(&pt, 0, sizeof(pt));
+		mask = FilePtr->file.f_op->poll(&FilePtr->file, &pt) & events;
+		if (mask || !timeout_ms || !pt.wq) {
+			return mask;
+		}
+		if (!SimpleAESShim_WaitSleep(pt.wq, &pt.token, deadline)) {
+			return FilePtr->file.f_op->poll(&FilePtr->file, NULL) &
+			       events;
+		}
+	}
+}
+
+//==============================================================================
+// Kernel Crypto API
+//==============================================================================
+
+typedef struct {
+	struct completion done;
+	int err;
+} SimpleAESHost_Wait;
+
+static void SimpleAESHost_SkcipherDone(void *data, int err)
+{
+	SimpleAESHost_Wait *wait_ptr = data;
+
+	if (err == -EINPROGRESS) {
+		return;
+	}
+	wait_ptr->err = err;
+	complete(&wait_ptr->done);
+}
+
+int SimpleAESHost_Skcipher(const char *alg_name, bool encrypt, const u8 *key,
+			   unsigned int keylen, u8 *iv, const void *src,
+			   void *dst, unsigned int len)
+{
+	return SimpleAESHost_SkcipherSg(alg_name, encrypt, key, keylen, iv,
+					src, dst, len, NULL, 0);
+}
+
+// Splits buf into num_segs entries (at least one) of sgl
+static void SimpleAESHost_SgInit(struct scatterlist *sgl, const void *buf,
+				 unsigned int len,
+				 const unsigned int *seg_lens,
+				 unsigned int num_segs)
+{
+	unsigned int i, seg_len, offset = 0;
+
+	sg_init_table(sgl, num_segs ? num_segs : 1);
+	for (i = 0; i + 1 < num_segs; i++) {
+		seg_len = min(seg_lens[i], len - offset);
+		sg_set_buf(&sgl[i], (const u8 *)buf + offset, seg_len);
+		offset += seg_len;
+	}
+	sg_set_buf(&sgl[i], (const u8 *)buf + offset, len - offset);
+}
+
+int SimpleAESHost_SkcipherSg(const char *alg_name, bool encrypt,
+			     const u8 *key, unsigned int keylen, u8 *iv,
+			     const void *src, void *dst, unsigned int len,
+			     const unsigned int *seg_lens,
+			     unsigned int num_segs)
+{
+	unsigned int nents = num_segs ? num_segs : 1;
+	struct crypto_skcipher *tfm;
+	struct skcipher_request *req;
+	struct scatterlist *sg_src, *sg_dst;
+	SimpleAESHost_Wait wait;
+	int ret;
+
+	sg_src = calloc(2 * nents, sizeof(*sg_src));
+	if (!sg_src) {
+		return -ENOMEM;
+	}
+	sg_dst = src == dst ? sg_src : sg_src + nents;
+	SimpleAESHost_SgInit(sg_src, src, len, seg_lens, num_segs);
+	if (sg_dst != sg_src) {
+		SimpleAESHost_SgInit(sg_dst, dst, len, seg_lens, num_segs);
+	}
+
+	tfm = crypto_alloc_skcipher(alg_name, 0, 0);
+	if (IS_ERR(tfm)) {
+		ret = PTR_ERR(tfm);
+		goto __simpleaes_host_skcipher_undo_res1;
+	}
+	ret = crypto_skcipher_setkey(tfm, key, keylen);
+	if (ret) {
+		goto __simpleaes_host_skcipher_undo_res2;
+	}
+
+	req = aligned_alloc(16, ALIGN(sizeof(*req) +
+					      crypto_skcipher_reqsize(tfm),
+				      16));
+	if (!req) {
+		ret = -ENOMEM;
+		goto __simpleaes_host_skcipher_undo_res2;
+	}
+	memset(req, 0, sizeof(*req) + crypto_skcipher_reqsize(tfm));
+	init_completion(&wait.done);
+	wait.err = 0;
+	skcipher_request_set_tfm(req, tfm);
+	skcipher_request_set_callback(req, CRYPTO_TFM_REQ_MAY_SLEEP |
+						   CRYPTO_TFM_REQ_MAY_BACKLOG,
+				      SimpleAESHost_SkcipherDone, &wait);
+	skcipher_request_set_crypt(req, sg_src, sg_dst, len, iv);
+
+	ret = encrypt ? crypto_skcipher_encrypt(req) :
+			crypto_skcipher_decrypt(req);
+	if (ret == -EINPROGRESS || ret == -EBUSY) {
+		wait_for_completion(&wait.done);
+		ret = wait.err;
+	}
+	free(req);
+
+__simpleaes_host_skcipher_undo_res2:
+	crypto_free_skcipher(tfm);
+
+__simpleaes_host_skcipher_undo_res1:
+	free(sg_src);
+	return ret;
+}
@@ -0,0 +1,80 @@
+#ifndef ORG_SIMPLE_SIMPLEAES_HOST_H
+#define ORG_SIMPLE_SIMPLEAES_HOST_H
+
+// In-process host for SimpleAES_Linux.c: loads the unmodified driver on top
+// of SimpleAES_Shim, probes it against SimpleAESModel engines and exposes its
+// file, sysfs and crypto API entry points to a test or benchmark program.
+//
+// Build (from AES/):
+//
+//	cc -O2 -pthread -I model/include prog.c model/SimpleAES_Host.c
+//	   model/SimpleAES_Shim.c model/SimpleAES_Model.c
+//
+// Programs include this header for the driver UAPI (IOCTL_*) as well. User
+// buffers are plain process memory; the DMA window gives them bus addresses
+// on demand. Minor 0 is the aggregate node, minor N + 1 is engine N.
+
+#include "SimpleAES_Shim.h"
+
+#include "SimpleAES_Model.h"
+#include "../SimpleAES_Linux.h"
+
+//==============================================================================
+// Type Definitions
+//==============================================================================
+
+typedef struct SimpleAESHost_File SimpleAESHost_File;
+
+//==============================================================================
+// Function Prototypes
+//==============================================================================
+
+// Driver lifetime (module parameters are set before SimpleAESHost_Init)
+
+int SimpleAESHost_SetParam(const char *name, unsigned int val);
+int SimpleAESHost_Init(unsigned int num_engines,
+		       const SimpleAESModel_Config *ConfigPtr);
+void SimpleAESHost_DeInit(void);
+SimpleAESModel *SimpleAESHost_Model(unsigned int engine);
+int SimpleAESHost_FailClock(unsigned int engine, unsigned int count);
+
+// sysfs attributes (buf holds PAGE_SIZE bytes)
+
+ssize_t SimpleAESHost_ReadAttr(unsigned int engine, const char *name,
+			       char *buf);
+ssize_t SimpleAESHost_WriteAttr(unsigned int engine, const char *name,
+				const char *buf);
+
+// debugfs files, by path below the debugfs root ("simpleaes/simpleaes0/stats")
+
+ssize_t SimpleAESHost_ReadDebugfs(const char *path, char *buf, size_t len);
+
+// Character device
+
+int SimpleAESHost_Open(unsigned int minor, unsigned int flags,
+		       SimpleAESHost_File **FilePtr);
+int SimpleAESHost_Close(SimpleAESHost_File *FilePtr);
+long SimpleAESHost_Ioctl(SimpleAESHost_File *FilePtr, unsigned int cmd,
+			 void *arg);
+ssize_t SimpleAESHost_Read(SimpleAESHost_File *FilePtr, void *buf,
+			   size_t count);
+int SimpleAESHost_Mmap(SimpleAESHost_File *FilePtr, size_t size,
+		       void **AddrPtr);
+unsigned int SimpleAESHost_Poll(SimpleAESHost_File *FilePtr,
+				unsigned int events, int timeout_ms);
+
+// Kernel crypto API (synchronous wrapper around one skcipher request)
+
+int SimpleAESHost_Skcipher(const char *alg_name, bool encrypt, const u8 *key,
+			   unsigned int keylen, u8 *iv, const void *src,
+			   void *dst, unsigned int len);
+
+// Same, with src and dst each split into num_segs scatterlist entries of
+// seg_lens bytes (the last one takes the rest); src == dst runs in place
+int SimpleAESHost_SkcipherSg(const char *alg_name, bool encrypt,
+			     const u8 *key, unsigned int keylen, u8 *iv,
+			     const void *src, void *dst, unsigned int len,
+			     const unsigned int *seg_lens,
+			     unsigned int num_segs);
+
+#endif // ORG_SIMPLE_SIMPLEAES_HOST_H
@@ -0,0 +1,962 @@
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+#include "SimpleAES_Model.h"
+
+//==============================================================================
+// Register File (SimpleAES.md)
+//==============================================================================
+
+#define MODEL_CTRL 0x00
+#define MODEL_STAT 0x04
+#define MODEL_IRQ  0x08
+#define MODEL_KAR  0x0C
+#define MODEL_IAR  0x10
+#define MODEL_OAR  0x14
+#define MODEL_RBAR  0x18 // ver3 from here on
+#define MODEL_RCFG  0x1C
+#define MODEL_RHEAD 0x20
+#define MODEL_RTAIL 0x24
+#define MODEL_RCIDX 0x28
+
+#define MODEL_CTRL_OP	0x1u
+#define MODEL_CTRL_IE	0x2u
+#define MODEL_STAT_BUSY 0x1u
+#define MODEL_STAT_IRQ	0x2u
+#define MODEL_STAT_ERR_Pos 2
+#define MODEL_IRQ_COMPLETE 0x1u
+#define MODEL_IRQ_ERR	   0x2u
+#define MODEL_IRQ_RING	   0x4u
+#define MODEL_RCFG_EN	   0x1u
+#define MODEL_RCFG_SIZE	   0xF00u
+#define MODEL_RCFG_SIZE_Pos 8
+#define MODEL_RING_IDX	   0xFFFFu
+
+#define MODEL_DCTRL_OP	  0x1u
+#define MODEL_DCTRL_IRQ	  0x2u
+#define MODEL_DSTAT_DONE  0x1u
+
+#define MODEL_BLOCK_SIZE 16
+#define MODEL_DESC_SIZE	 32
+#define MODEL_DESC_WORDS (MODEL_DESC_SIZE / 4)
+
+//==============================================================================
+// Function Prototypes
+//==============================================================================
+
+// Device model
+
+static void *SimpleAESModel_Thread(void *data);
+static void SimpleAESModel_Start(SimpleAESModel *InstancePtr, uint64_t now);
+static void SimpleAESModel_Compute(SimpleAESModel *InstancePtr);
+static void SimpleAESModel_Retire(SimpleAESModel *InstancePtr, uint64_t now);
+static void SimpleAESModel_RingNext(SimpleAESModel *InstancePtr, uint64_t now);
+static void SimpleAESModel_RetireDesc(SimpleAESModel *InstancePtr);
+static void SimpleAESModel_Advance(SimpleAESModel *InstancePtr, uint64_t now);
+static void SimpleAESModel_UpdateLine(SimpleAESModel *InstancePtr);
+static uint64_t SimpleAESModel_TransferNs(SimpleAESModel *InstancePtr,
+					  uint64_t bytes);
+
+// AES
+
+static void SimpleAESModel_AesTables(void);
+
+//==============================================================================
+// Variable Definitions
+//==============================================================================
+
+static pthread_once_t aes_tables_once = PTHREAD_ONCE_INIT;
+static uint8_t aes_sbox[256];
+static uint8_t aes_inv_sbox[256];
+static uint32_t aes_te[256]; // (2s, s, s, 3s)
+static uint32_t aes_td[256]; // (14s', 9s', 13s', 11s'), s' = inverse S-box
+
+//==============================================================================
+// Function Definitions
+//==============================================================================
+
+// Device model
+
+void SimpleAESModel_DefaultConfig(SimpleAESModel_Config *ConfigPtr)
+{
+	memset(ConfigPtr, 0, sizeof(*ConfigPtr));
+
+	// 100 MHz AXI clock, one round per cycle plus load and store
+	ConfigPtr->clock_ns	  = 10;
+	ConfigPtr->core_cycles	  = 12;
+	ConfigPtr->dma_latency_ns = 250;
+	ConfigPtr->dma_mbps	  = 800;
+	ConfigPtr->mmio_read_ns	  = 150;
+	ConfigPtr->mmio_write_ns  = 50;
+	ConfigPtr->spin_ns	  = 50000;
+}
+
+int SimpleAESModel_Init(SimpleAESModel *InstancePtr,
+			const SimpleAESModel_Config *ConfigPtr)
+{
+	pthread_condattr_t attr;
+	int ret;
+
+	memset(InstancePtr, 0, sizeof(*InstancePtr));
+	InstancePtr->config = *ConfigPtr;
+
+	pthread_once(&aes_tables_once, SimpleAESModel_AesTables);
+
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&InstancePtr->wake, &attr);
+	pthread_condattr_destroy(&attr);
+	pthread_mutex_init(&InstancePtr->lock, NULL);
+
+	ret = pthread_create(&InstancePtr->thread, NULL, SimpleAESModel_Thread,
+			     InstancePtr);
+	if (ret) {
+		pthread_cond_destroy(&InstancePtr->wake);
+		pthread_mutex_destroy(&InstancePtr->lock);
+		return -ret;
+	}
+
+	return 0;
+}
+
+void SimpleAESModel_DeInit(SimpleAESModel *InstancePtr)
+{
+	pthread_mutex_lock(&InstancePtr->lock);
+	InstancePtr->stop = true;
+	pthread_cond_signal(&InstancePtr->wake);
+	pthread_mutex_unlock(&InstancePtr->lock);
+
+	pthread_join(InstancePtr->thread, NULL);
+	pthread_cond_destroy(&InstancePtr->wake);
+	pthread_mutex_destroy(&InstancePtr->lock);
+}
+
+// MMIO read callback (ctx is the SimpleAESModel)
+uint32_t SimpleAESModel_Read(void *ctx, uint32_t offset)
+{
+	SimpleAESModel *InstancePtr = ctx;
+	uint32_t val		    = 0;
+
+	SimpleAESModel_Delay(InstancePtr->config.mmio_read_ns);
+
+	pthread_mutex_lock(&InstancePtr->lock);
+	if (InstancePtr->gated) {
+		InstancePtr->stats.gated_io++;
+		pthread_mutex_unlock(&InstancePtr->lock);
+		return 0;
+	}
+	SimpleAESModel_Advance(InstancePtr, SimpleAESModel_Now());
+	InstancePtr->stats.mmio_reads++;
+
+	switch (offset) {
+	case MODEL_CTRL:
+		val = InstancePtr->ctrl;
+		break;
+	case MODEL_STAT:
+		val = (InstancePtr->state == SIMPLEAES_MODEL_RUNNING ?
+			       MODEL_STAT_BUSY :
+			       0) |
+		      (InstancePtr->irq_stat ? MODEL_STAT_IRQ : 0) |
+		      InstancePtr->err << MODEL_STAT_ERR_Pos;
+		break;
+	case MODEL_IRQ:
+		val = InstancePtr->irq_stat;
+		break;
+	case MODEL_KAR:
+		val = InstancePtr->kar;
+		break;
+	case MODEL_IAR:
+		val = InstancePtr->iar;
+		break;
+	case MODEL_OAR:
+		val = InstancePtr->oar;
+		break;
+	default:
+		break;
+	}
+
+	if (InstancePtr->config.ring) {
+		switch (offset) {
+		case MODEL_RBAR:
+			val = InstancePtr->rbar;
+			break;
+		case MODEL_RCFG:
+			val = InstancePtr->rcfg;
+			break;
+		case MODEL_RHEAD:
+			val = InstancePtr->rhead;
+			break;
+		case MODEL_RTAIL:
+			val = InstancePtr->rtail;
+			break;
+		case MODEL_RCIDX:
+			val = InstancePtr->rcidx;
+			break;
+		default:
+			break;
+		}
+	}
+
+	SimpleAESModel_UpdateLine(InstancePtr);
+	pthread_mutex_unlock(&InstancePtr->lock);
+	return val;
+}
+
+// MMIO write callback (ctx is the SimpleAESModel)
+void SimpleAESModel_Write(void *ctx, uint32_t offset, uint32_t val)
+{
+	SimpleAESModel *InstancePtr = ctx;
+	uint64_t now;
+
+	SimpleAESModel_Delay(InstancePtr->config.mmio_write_ns);
+
+	pthread_mutex_lock(&InstancePtr->lock);
+	if (InstancePtr->gated) {
+		InstancePtr->stats.gated_io++;
+		pthread_mutex_unlock(&InstancePtr->lock);
+		return;
+	}
+	now = SimpleAESModel_Now();
+	SimpleAESModel_Advance(InstancePtr, now);
+	InstancePtr->stats.mmio_writes++;
+
+	switch (offset) {
+	case MODEL_CTRL:
+		InstancePtr->ctrl = val & (MODEL_CTRL_OP | MODEL_CTRL_IE);
+		break;
+	case MODEL_IRQ:
+		InstancePtr->irq_stat &= ~val;
+		break;
+	case MODEL_KAR:
+		InstancePtr->kar = val;
+		break;
+	case MODEL_IAR:
+		InstancePtr->iar = val;
+		break;
+	case MODEL_OAR:
+		InstancePtr->oar = val;
+		SimpleAESModel_Start(InstancePtr, now);
+		break;
+	default: // STAT is read-only
+		break;
+	}
+
+	if (InstancePtr->config.ring) {
+		switch (offset) {
+		case MODEL_RBAR:
+			InstancePtr->rbar = val;
+			break;
+		case MODEL_RCFG:
+			// Enabling restarts fetching and completion at RTAIL
+			if (val & ~InstancePtr->rcfg & MODEL_RCFG_EN) {
+				InstancePtr->rhead = InstancePtr->rtail;
+				InstancePtr->rcidx = InstancePtr->rtail;
+			}
+			InstancePtr->rcfg =
+				val & (MODEL_RCFG_EN | MODEL_RCFG_SIZE);
+			SimpleAESModel_RingNext(InstancePtr, now);
+			break;
+		case MODEL_RTAIL: // Doorbell
+			InstancePtr->rtail = val & MODEL_RING_IDX;
+			SimpleAESModel_RingNext(InstancePtr, now);
+			break;
+		default: // RHEAD and RCIDX are read-only
+			break;
+		}
+	}
+
+	SimpleAESModel_UpdateLine(InstancePtr);
+	pthread_mutex_unlock(&InstancePtr->lock);
+}
+
+// Back to reset values; an operation in flight is dropped
+void SimpleAESModel_Reset(SimpleAESModel *InstancePtr)
+{
+	pthread_mutex_lock(&InstancePtr->lock);
+	InstancePtr->ctrl     = 0;
+	InstancePtr->irq_stat = 0;
+	InstancePtr->err      = 0;
+	InstancePtr->kar      = 0;
+	InstancePtr->iar      = 0;
+	InstancePtr->oar      = 0;
+	InstancePtr->rbar     = 0;
+	InstancePtr->rcfg     = 0;
+	InstancePtr->rhead    = 0;
+	InstancePtr->rtail    = 0;
+	InstancePtr->rcidx    = 0;
+	InstancePtr->state    = SIMPLEAES_MODEL_IDLE;
+	InstancePtr->stats.resets++;
+	SimpleAESModel_UpdateLine(InstancePtr);
+	pthread_cond_signal(&InstancePtr->wake);
+	pthread_mutex_unlock(&InstancePtr->lock);
+}
+
+// Clock off (reset values, registers stop responding) or back on
+void SimpleAESModel_Gate(SimpleAESModel *InstancePtr, bool gated)
+{
+	if (gated) {
+		SimpleAESModel_Reset(InstancePtr);
+	}
+
+	pthread_mutex_lock(&InstancePtr->lock);
+	InstancePtr->gated = gated;
+	pthread_mutex_unlock(&InstancePtr->lock);
+}
+
+// The next count operations fail with code (count 0 cancels)
+void SimpleAESModel_InjectError(SimpleAESModel *InstancePtr,
+				SimpleAESModel_Err code, unsigned int count)
+{
+	pthread_mutex_lock(&InstancePtr->lock);
+	InstancePtr->inject_code  = code;
+	InstancePtr->inject_count = code ? count : 0;
+	pthread_mutex_unlock(&InstancePtr->lock);
+}
+
+// The next count operations stay busy until a reset (count 0 cancels)
+void SimpleAESModel_InjectHang(SimpleAESModel *InstancePtr,
+			       unsigned int count)
+{
+	pthread_mutex_lock(&InstancePtr->lock);
+	InstancePtr->hang_count = count;
+	pthread_mutex_unlock(&InstancePtr->lock);
+}
+
+void SimpleAESModel_GetStats(SimpleAESModel *InstancePtr,
+			     SimpleAESModel_Stats *StatsPtr)
+{
+	pthread_mutex_lock(&InstancePtr->lock);
+	*StatsPtr = InstancePtr->stats;
+	pthread_mutex_unlock(&InstancePtr->lock);
+}
+
+// Same clock as the shim's ktime_get_ns()
+uint64_t SimpleAESModel_Now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// Busy wait (bus access time is spent by the CPU, not slept)
+void SimpleAESModel_Delay(uint64_t ns)
+{
+	uint64_t end;
+
+	if (!ns) {
+		return;
+	}
+
+	end = SimpleAESModel_Now() + ns;
+	while (SimpleAESModel_Now() < end) {
+#if defined(__x86_64__) || defined(__i386__)
+		__builtin_ia32_pause();
+#endif
+	}
+}
+
+// Sleeps until the operation in flight is due, then spins for the last
+// spin_ns so that completions are not late by a scheduler tick
+static void *SimpleAESModel_Thread(void *data)
+{
+	SimpleAESModel *InstancePtr = data;
+	struct timespec ts;
+	uint64_t now, wake_ns;
+
+	pthread_mutex_lock(&InstancePtr->lock);
+	while (!InstancePtr->stop) {
+		// A hung operation only ends with a reset
+		if (InstancePtr->state != SIMPLEAES_MODEL_RUNNING ||
+		    InstancePtr->done_ns == UINT64_MAX) {
+			pthread_cond_wait(&InstancePtr->wake,
+					  &InstancePtr->lock);
+			continue;
+		}
+
+		if (!InstancePtr->computed) {
+			SimpleAESModel_Compute(InstancePtr);
+		}
+
+		now = SimpleAESModel_Now();
+		if (now >= InstancePtr->done_ns) {
+			SimpleAESModel_Retire(InstancePtr, now);
+			SimpleAESModel_UpdateLine(InstancePtr);
+			continue;
+		}
+
+		if (InstancePtr->done_ns - now > InstancePtr->config.spin_ns) {
+			wake_ns = InstancePtr->done_ns -
+				  InstancePtr->config.spin_ns;
+			ts.tv_sec  = wake_ns / 1000000000ull;
+			ts.tv_nsec = wake_ns % 1000000000ull;
+			pthread_cond_timedwait(&InstancePtr->wake,
+					       &InstancePtr->lock, &ts);
+			continue;
+		}
+
+		wake_ns = InstancePtr->done_ns;
+		pthread_mutex_unlock(&InstancePtr->lock);
+		while (SimpleAESModel_Now() < wake_ns) {
+#if defined(__x86_64__) || defined(__i386__)
+			__builtin_ia32_pause();
+#endif
+		}
+		pthread_mutex_lock(&InstancePtr->lock);
+	}
+	pthread_mutex_unlock(&InstancePtr->lock);
+
+	return NULL;
+}
+
+// OAR written (lock held). OP and the three addresses are latched; the
+// outcome is decided now, the data moves in the engine thread.
+static void SimpleAESModel_Start(SimpleAESModel *InstancePtr, uint64_t now)
+{
+	uint64_t transfer_ns =
+		SimpleAESModel_TransferNs(InstancePtr, MODEL_BLOCK_SIZE);
+	uint64_t core_ns = (uint64_t)InstancePtr->config.core_cycles *
+			   InstancePtr->config.clock_ns;
+
+	if (InstancePtr->state == SIMPLEAES_MODEL_RUNNING) {
+		InstancePtr->stats.overruns++;
+		return;
+	}
+
+	InstancePtr->op		 = InstancePtr->ctrl & MODEL_CTRL_OP;
+	InstancePtr->key_addr	 = InstancePtr->kar;
+	InstancePtr->input_addr	 = InstancePtr->iar;
+	InstancePtr->output_addr = InstancePtr->oar;
+	InstancePtr->err	 = SIMPLEAES_MODEL_ERR_NONE;
+	InstancePtr->computed	 = false;
+	InstancePtr->fail	 = SIMPLEAES_MODEL_ERR_NONE;
+	InstancePtr->desc	 = false;
+
+	if (InstancePtr->inject_count) {
+		InstancePtr->inject_count--;
+		InstancePtr->fail = InstancePtr->inject_code;
+		InstancePtr->stats.injected++;
+	}
+
+	// A failed transfer ends the operation where it happened
+	switch (InstancePtr->fail) {
+	case SIMPLEAES_MODEL_ERR_KEY:
+		InstancePtr->duration_ns = transfer_ns;
+		break;
+	case SIMPLEAES_MODEL_ERR_INPUT:
+		InstancePtr->duration_ns = 2 * transfer_ns;
+		break;
+	default:
+		InstancePtr->duration_ns = 3 * transfer_ns + core_ns;
+		break;
+	}
+
+	InstancePtr->done_ns = now + InstancePtr->duration_ns;
+	if (InstancePtr->hang_count) {
+		InstancePtr->hang_count--;
+		InstancePtr->done_ns = UINT64_MAX;
+		InstancePtr->stats.hangs++;
+	}
+	InstancePtr->state = SIMPLEAES_MODEL_RUNNING;
+	InstancePtr->stats.ops++;
+	pthread_cond_signal(&InstancePtr->wake);
+}
+
+// Key and input fetch and the cipher itself (lock held). Addresses the bus
+// does not map fail like the transfer would.
+static void SimpleAESModel_Compute(SimpleAESModel *InstancePtr)
+{
+	SimpleAESModel_TranslateFn translate = InstancePtr->config.translate;
+	void *ctx			     = InstancePtr->config.ctx;
+	uint32_t enc[60], dec[60];
+	const uint8_t *key_ptr;
+	const uint8_t *input_ptr;
+
+	InstancePtr->computed = true;
+	if (InstancePtr->fail || InstancePtr->desc) {
+		return;
+	}
+
+	key_ptr = translate(ctx, InstancePtr->key_addr, MODEL_BLOCK_SIZE);
+	if (!key_ptr) {
+		InstancePtr->fail = SIMPLEAES_MODEL_ERR_KEY;
+		return;
+	}
+
+	input_ptr = translate(ctx, InstancePtr->input_addr, MODEL_BLOCK_SIZE);
+	if (!input_ptr) {
+		InstancePtr->fail = SIMPLEAES_MODEL_ERR_INPUT;
+		return;
+	}
+
+	SimpleAESModel_AesExpand(enc, dec, key_ptr, MODEL_BLOCK_SIZE);
+	if (InstancePtr->op) {
+		SimpleAESModel_AesDecrypt(dec, MODEL_BLOCK_SIZE,
+					  InstancePtr->block, input_ptr);
+	} else {
+		SimpleAESModel_AesEncrypt(enc, MODEL_BLOCK_SIZE,
+					  InstancePtr->block, input_ptr);
+	}
+}
+
+// Output write and status update at the deadline (lock held)
+static void SimpleAESModel_Retire(SimpleAESModel *InstancePtr, uint64_t now)
+{
+	uint8_t *output_ptr;
+
+	if (InstancePtr->desc) {
+		SimpleAESModel_RetireDesc(InstancePtr);
+		InstancePtr->stats.busy_ns += InstancePtr->duration_ns;
+		InstancePtr->stats.late_ns += now - InstancePtr->done_ns;
+		SimpleAESModel_RingNext(InstancePtr, InstancePtr->done_ns);
+		return;
+	}
+
+	if (!InstancePtr->computed) {
+		SimpleAESModel_Compute(InstancePtr);
+	}
+
+	if (!InstancePtr->fail) {
+		output_ptr = InstancePtr->config.translate(
+			InstancePtr->config.ctx, InstancePtr->output_addr,
+			MODEL_BLOCK_SIZE);
+		if (output_ptr) {
+			memcpy(output_ptr, InstancePtr->block,
+			       MODEL_BLOCK_SIZE);
+		} else {
+			InstancePtr->fail = SIMPLEAES_MODEL_ERR_OUTPUT;
+		}
+	}
+
+	InstancePtr->err = InstancePtr->fail;
+	// IRQ.COMPLETE for a successful operation, IRQ.ERR for a failed one
+	InstancePtr->irq_stat |= InstancePtr->err ? MODEL_IRQ_ERR :
+						    MODEL_IRQ_COMPLETE;
+	InstancePtr->state = SIMPLEAES_MODEL_IDLE;
+
+	InstancePtr->stats.errors[InstancePtr->err]++;
+	InstancePtr->stats.busy_ns += InstancePtr->duration_ns;
+	InstancePtr->stats.late_ns += now - InstancePtr->done_ns;
+
+	if (InstancePtr->config.ring) {
+		SimpleAESModel_RingNext(InstancePtr, now);
+	}
+}
+
+// Fetches and starts the descriptor at RHEAD if the engine is idle and the
+// ring enabled and not empty (lock held). A descriptor the bus does not map
+// halts the ring (RCFG.EN cleared, IRQ.RING).
+static void SimpleAESModel_RingNext(SimpleAESModel *InstancePtr, uint64_t now)
+{
+	uint64_t block_bytes, core_ns;
+	uint32_t words[MODEL_DESC_WORDS];
+	unsigned int size;
+	uint32_t addr;
+	const void *desc_ptr;
+
+	if (InstancePtr->state == SIMPLEAES_MODEL_RUNNING ||
+	    !(InstancePtr->rcfg & MODEL_RCFG_EN) ||
+	    InstancePtr->rhead == InstancePtr->rtail) {
+		return;
+	}
+
+	size = (InstancePtr->rcfg & MODEL_RCFG_SIZE) >> MODEL_RCFG_SIZE_Pos;
+	addr = InstancePtr->rbar +
+	       (InstancePtr->rhead & ((1u << size) - 1)) * MODEL_DESC_SIZE;
+	desc_ptr = InstancePtr->config.translate(InstancePtr->config.ctx, addr,
+						 MODEL_DESC_SIZE);
+	if (!desc_ptr) {
+		InstancePtr->rcfg &= ~MODEL_RCFG_EN;
+		InstancePtr->irq_stat |= MODEL_IRQ_RING;
+		return;
+	}
+
+	// Little-endian words, as the model's hosts are
+	memcpy(words, desc_ptr, sizeof(words));
+	InstancePtr->op		 = words[0] & MODEL_DCTRL_OP;
+	InstancePtr->desc_irq	 = words[0] & MODEL_DCTRL_IRQ;
+	InstancePtr->count	 = words[0] >> 16;
+	InstancePtr->key_addr	 = words[1];
+	InstancePtr->input_addr	 = words[2];
+	InstancePtr->output_addr = words[3];
+	InstancePtr->desc_addr	 = addr;
+	InstancePtr->desc	 = true;
+	InstancePtr->computed	 = true;
+	InstancePtr->fail	 = SIMPLEAES_MODEL_ERR_NONE;
+	InstancePtr->rhead	 = (InstancePtr->rhead + 1) & MODEL_RING_IDX;
+
+	if (InstancePtr->inject_count && InstancePtr->count) {
+		InstancePtr->inject_count--;
+		InstancePtr->fail = InstancePtr->inject_code;
+		InstancePtr->stats.injected++;
+	}
+
+	// Descriptor, key, input and output bursts and the status write
+	block_bytes = (uint64_t)InstancePtr->count * MODEL_BLOCK_SIZE;
+	core_ns = (uint64_t)InstancePtr->count *
+		  InstancePtr->config.core_cycles *
+		  InstancePtr->config.clock_ns;
+	InstancePtr->duration_ns =
+		SimpleAESModel_TransferNs(InstancePtr, MODEL_DESC_SIZE) +
+		SimpleAESModel_TransferNs(InstancePtr, MODEL_BLOCK_SIZE) +
+		2 * SimpleAESModel_TransferNs(InstancePtr, block_bytes) +
+		SimpleAESModel_TransferNs(InstancePtr, sizeof(uint32_t)) +
+		core_ns;
+
+	InstancePtr->done_ns = now + InstancePtr->duration_ns;
+	if (InstancePtr->hang_count) {
+		InstancePtr->hang_count--;
+		InstancePtr->done_ns = UINT64_MAX;
+		InstancePtr->stats.hangs++;
+	}
+	InstancePtr->state = SIMPLEAES_MODEL_RUNNING;
+	InstancePtr->stats.ops++;
+	pthread_cond_signal(&InstancePtr->wake);
+}
+
+// Runs the descriptor's blocks up to the first failure and writes DSTAT
+// (lock held). DSTAT is stored last, with release ordering, so software that
+// sees DONE sees the output.
+static void SimpleAESModel_RetireDesc(SimpleAESModel *InstancePtr)
+{
+	SimpleAESModel_TranslateFn translate = InstancePtr->config.translate;
+	void *ctx			     = InstancePtr->config.ctx;
+	uint32_t enc[60], dec[60];
+	const uint8_t *key_ptr = NULL;
+	const uint8_t *input_ptr;
+	uint8_t *output_ptr;
+	uint32_t *stat_ptr;
+	uint32_t stat;
+	uint32_t done = 0;
+	uint32_t offset;
+
+	if (InstancePtr->count && !InstancePtr->fail) {
+		key_ptr = translate(ctx, InstancePtr->key_addr,
+				    MODEL_BLOCK_SIZE);
+		if (!key_ptr) {
+			InstancePtr->fail = SIMPLEAES_MODEL_ERR_KEY;
+		} else {
+			SimpleAESModel_AesExpand(enc, dec, key_ptr,
+						 MODEL_BLOCK_SIZE);
+		}
+	}
+
+	for (; !InstancePtr->fail && done < InstancePtr->count; done++) {
+		offset	  = done * MODEL_BLOCK_SIZE;
+		input_ptr = translate(ctx, InstancePtr->input_addr + offset,
+				      MODEL_BLOCK_SIZE);
+		if (!input_ptr) {
+			InstancePtr->fail = SIMPLEAES_MODEL_ERR_INPUT;
+			break;
+		}
+		output_ptr = translate(ctx, InstancePtr->output_addr + offset,
+				       MODEL_BLOCK_SIZE);
+		if (!output_ptr) {
+			InstancePtr->fail = SIMPLEAES_MODEL_ERR_OUTPUT;
+			break;
+		}
+
+		if (InstancePtr->op) {
+			SimpleAESModel_AesDecrypt(dec, MODEL_BLOCK_SIZE,
+						  InstancePtr->block,
+						  input_ptr);
+		} else {
+			SimpleAESModel_AesEncrypt(enc, MODEL_BLOCK_SIZE,
+						  InstancePtr->block,
+						  input_ptr);
+		}
+		memcpy(output_ptr, InstancePtr->block, MODEL_BLOCK_SIZE);
+	}
+
+	// DSTAT: DONE, ERR and the blocks completed before the failure
+	stat_ptr = translate(ctx, InstancePtr->desc_addr, MODEL_DESC_SIZE);
+	if (stat_ptr) {
+		stat = MODEL_DSTAT_DONE |
+		       InstancePtr->fail << MODEL_STAT_ERR_Pos | done << 16;
+		__atomic_store_n(&stat_ptr[4], stat, __ATOMIC_RELEASE);
+	}
+
+	InstancePtr->rcidx = (InstancePtr->rcidx + 1) & MODEL_RING_IDX;
+	if (InstancePtr->desc_irq || InstancePtr->fail) {
+		InstancePtr->irq_stat |= MODEL_IRQ_RING;
+	}
+	InstancePtr->state = SIMPLEAES_MODEL_IDLE;
+
+	InstancePtr->stats.descs++;
+	InstancePtr->stats.desc_blocks += done;
+	InstancePtr->stats.errors[InstancePtr->fail]++;
+}
+
+// Retires the operation in flight if it is due (lock held)
+static void SimpleAESModel_Advance(SimpleAESModel *InstancePtr, uint64_t now)
+{
+	if (InstancePtr->state == SIMPLEAES_MODEL_RUNNING &&
+	    now >= InstancePtr->done_ns) {
+		SimpleAESModel_Retire(InstancePtr, now);
+	}
+}
+
+// Level-triggered: pending status with IE set (lock held)
+static void SimpleAESModel_UpdateLine(SimpleAESModel *InstancePtr)
+{
+	bool level = InstancePtr->irq_stat &&
+		     (InstancePtr->ctrl & MODEL_CTRL_IE);
+
+	if (level == InstancePtr->line) {
+		return;
+	}
+
+	InstancePtr->line = level;
+	if (level) {
+		InstancePtr->stats.irq_raised++;
+	}
+	if (InstancePtr->config.irq) {
+		InstancePtr->config.irq(InstancePtr->config.ctx, level);
+	}
+}
+
+// One AXI4 transfer (burst) of bytes
+static uint64_t SimpleAESModel_TransferNs(SimpleAESModel *InstancePtr,
+					  uint64_t bytes)
+{
+	uint64_t ns = InstancePtr->config.dma_latency_ns;
+
+	if (InstancePtr->config.dma_mbps) {
+		ns += bytes * 1000ull / InstancePtr->config.dma_mbps;
+	}
+	return ns;
+}
+
+// AES
+
+#define AES_ROR(w, n) (((w) >> (n)) | ((w) << (32 - (n))))
+
+static uint8_t SimpleAESModel_Mul(uint8_t a, uint8_t b)
+{
+	uint8_t p = 0;
+
+	while (b) {
+		if (b & 1) {
+			p ^= a;
+		}
+		a = (a << 1) ^ (a & 0x80 ? 0x1b : 0);
+		b >>= 1;
+	}
+	return p;
+}
+
+// S-box from the multiplicative inverse and the affine map, then the
+// combined SubBytes/MixColumns round tables
+static void SimpleAESModel_AesTables(void)
+{
+	uint8_t p = 1, q = 1, s;
+	unsigned int x;
+
+	do {
+		p = p ^ (p << 1) ^ (p & 0x80 ? 0x1b : 0);
+		q ^= q << 1;
+		q ^= q << 2;
+		q ^= q << 4;
+		if (q & 0x80) {
+			q ^= 0x09;
+		}
+		s = q ^ (uint8_t)(q << 1 | q >> 7) ^
+		    (uint8_t)(q << 2 | q >> 6) ^
+		    (uint8_t)(q << 3 | q >> 5) ^ (uint8_t)(q << 4 | q >> 4);
+		aes_sbox[p] = s ^ 0x63;
+	} while (p != 1);
+	aes_sbox[0] = 0x63;
+
+	for (x = 0; x < 256; x++) {
+		aes_inv_sbox[aes_sbox[x]] = x;
+	}
+
+	for (x = 0; x < 256; x++) {
+		s	  = aes_sbox[x];
+		aes_te[x] = (uint32_t)SimpleAESModel_Mul(s, 2) << 24 |
+			    (uint32_t)s << 16 | (uint32_t)s << 8 |
+			    SimpleAESModel_Mul(s, 3);
+		s	  = aes_inv_sbox[x];
+		aes_td[x] = (uint32_t)SimpleAESModel_Mul(s, 14) << 24 |
+			    (uint32_t)SimpleAESModel_Mul(s, 9) << 16 |
+			    (uint32_t)SimpleAESModel_Mul(s, 13) << 8 |
+			    SimpleAESModel_Mul(s, 11);
+	}
+}
+
+static uint32_t SimpleAESModel_Load(const uint8_t *p)
+{
+	return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 |
+	       (uint32_t)p[2] << 8 | p[3];
+}
+
+static void SimpleAESModel_Store(uint8_t *p, uint32_t w)
+{
+	p[0] = w >> 24;
+	p[1] = w >> 16;
+	p[2] = w >> 8;
+	p[3] = w;
+}
+
+static uint32_t SimpleAESModel_SubWord(uint32_t w)
+{
+	return (uint32_t)aes_sbox[w >> 24] << 24 |
+	       (uint32_t)aes_sbox[(w >> 16) & 0xff] << 16 |
+	       (uint32_t)aes_sbox[(w >> 8) & 0xff] << 8 | aes_sbox[w & 0xff];
+}
+
+// FIPS-197 key expansion; dec gets the equivalent inverse cipher schedule
+int SimpleAESModel_AesExpand(uint32_t enc[60], uint32_t dec[60],
+			     const uint8_t *key, unsigned int key_len)
+{
+	unsigned int nk = key_len / 4;
+	unsigned int rounds = nk + 6;
+	unsigned int words  = 4 * (rounds + 1);
+	uint32_t rcon	    = 1;
+	unsigned int i, j;
+	uint32_t w;
+
+	if (key_len != 16 && key_len != 24 && key_len != 32) {
+		return -EINVAL;
+	}
+
+	pthread_once(&aes_tables_once, SimpleAESModel_AesTables);
+
+	for (i = 0; i < nk; i++) {
+		enc[i] = SimpleAESModel_Load(key + 4 * i);
+	}
+	for (; i < words; i++) {
+		w = enc[i - 1];
+		if (i % nk == 0) {
+			w = SimpleAESModel_SubWord(w << 8 | w >> 24) ^
+			    rcon << 24;
+			rcon = SimpleAESModel_Mul(rcon, 2);
+		} else if (nk > 6 && i % nk == 4) {
+			w = SimpleAESModel_SubWord(w);
+		}
+		enc[i] = enc[i - nk] ^ w;
+	}
+
+	// Round keys in reverse order, InvMixColumns on the inner ones
+	for (i = 0; i <= rounds; i++) {
+		for (j = 0; j < 4; j++) {
+			w = enc[4 * (rounds - i) + j];
+			if (i && i < rounds) {
+				w = aes_td[aes_sbox[w >> 24]] ^
+				    AES_ROR(aes_td[aes_sbox[(w >> 16) & 0xff]],
+					    8) ^
+				    AES_ROR(aes_td[aes_sbox[(w >> 8) & 0xff]],
+					    16) ^
+				    AES_ROR(aes_td[aes_sbox[w & 0xff]], 24);
+			}
+			dec[4 * i + j] = w;
+		}
+	}
+
+	return 0;
+}
+
+void SimpleAESModel_AesEncrypt(const uint32_t enc[60], unsigned int key_len,
+			       uint8_t out[16], const uint8_t in[16])
+{
+	unsigned int rounds = key_len / 4 + 6;
+	const uint32_t *rk  = enc;
+	uint32_t s0, s1, s2, s3, t0, t1, t2, t3;
+	unsigned int r;
+
+	s0 = SimpleAESModel_Load(in) ^ rk[0];
+	s1 = SimpleAESModel_Load(in + 4) ^ rk[1];
+	s2 = SimpleAESModel_Load(in + 8) ^ rk[2];
+	s3 = SimpleAESModel_Load(in + 12) ^ rk[3];
+
+	for (r = 1; r < rounds; r++) {
+		rk += 4;
+		t0 = aes_te[s0 >> 24] ^ AES_ROR(aes_te[(s1 >> 16) & 0xff], 8) ^
+		     AES_ROR(aes_te[(s2 >> 8) & 0xff], 16) ^
+		     AES_ROR(aes_te[s3 & 0xff], 24) ^ rk[0];
+		t1 = aes_te[s1 >> 24] ^ AES_ROR(aes_te[(s2 >> 16) & 0xff], 8) ^
+		     AES_ROR(aes_te[(s3 >> 8) & 0xff], 16) ^
+		     AES_ROR(aes_te[s0 & 0xff], 24) ^ rk[1];
+		t2 = aes_te[s2 >> 24] ^ AES_ROR(aes_te[(s3 >> 16) & 0xff], 8) ^
+		     AES_ROR(aes_te[(s0 >> 8) & 0xff], 16) ^
+		     AES_ROR(aes_te[s1 & 0xff], 24) ^ rk[2];
+		t3 = aes_te[s3 >> 24] ^ AES_ROR(aes_te[(s0 >> 16) & 0xff], 8) ^
+		     AES_ROR(aes_te[(s1 >> 8) & 0xff], 16) ^
+		     AES_ROR(aes_te[s2 & 0xff], 24) ^ rk[3];
+		s0 = t0;
+		s1 = t1;
+		s2 = t2;
+		s3 = t3;
+	}
+
+	rk += 4;
+	t0 = SimpleAESModel_SubWord((s0 & 0xff000000) | (s1 & 0xff0000) |
+				    (s2 & 0xff00) | (s3 & 0xff));
+	t1 = SimpleAESModel_SubWord((s1 & 0xff000000) | (s2 & 0xff0000) |
+				    (s3 & 0xff00) | (s0 & 0xff));
+	t2 = SimpleAESModel_SubWord((s2 & 0xff000000) | (s3 & 0xff0000) |
+				    (s0 & 0xff00) | (s1 & 0xff));
+	t3 = SimpleAESModel_SubWord((s3 & 0xff000000) | (s0 & 0xff0000) |
+				    (s1 & 0xff00) | (s2 & 0xff));
+	SimpleAESModel_Store(out, t0 ^ rk[0]);
+	SimpleAESModel_Store(out + 4, t1 ^ rk[1]);
+	SimpleAESModel_Store(out + 8, t2 ^ rk[2]);
+	SimpleAESModel_Store(out + 12, t3 ^ rk[3]);
+}
+
+static uint32_t SimpleAESModel_InvSubWord(uint32_t w)
+{
+	return (uint32_t)aes_inv_sbox[w >> 24] << 24 |
+	       (uint32_t)aes_inv_sbox[(w >> 16) & 0xff] << 16 |
+	       (uint32_t)aes_inv_sbox[(w >> 8) & 0xff] << 8 |
+	       aes_inv_sbox[w & 0xff];
+}
+
+void SimpleAESModel_AesDecrypt(const uint32_t dec[60], unsigned int key_len,
+			       uint8_t out[16], const uint8_t in[16])
+{
+	unsigned int rounds = key_len / 4 + 6;
+	const uint32_t *rk  = dec;
+	uint32_t s0, s1, s2, s3, t0, t1, t2, t3;
+	unsigned int r;
+
+	s0 = SimpleAESModel_Load(in) ^ rk[0];
+	s1 = SimpleAESModel_Load(in + 4) ^ rk[1];
+	s2 = SimpleAESModel_Load(in + 8) ^ rk[2];
+	s3 = SimpleAESModel_Load(in + 12) ^ rk[3];
+
+	for (r = 1; r < rounds; r++) {
+		rk += 4;
+		t0 = aes_td[s0 >> 24] ^ AES_ROR(aes_td[(s3 >> 16) & 0xff], 8) ^
+		     AES_ROR(aes_td[(s2 >> 8) & 0xff], 16) ^
+		     AES_ROR(aes_td[s1 & 0xff], 24) ^ rk[0];
+		t1 = aes_td[s1 >> 24] ^ AES_ROR(aes_td[(s0 >> 16) & 0xff], 8) ^
+		     AES_ROR(aes_td[(s3 >> 8) & 0xff], 16) ^
+		     AES_ROR(aes_td[s2 & 0xff], 24) ^ rk[1];
+		t2 = aes_td[s2 >> 24] ^ AES_ROR(aes_td[(s1 >> 16) & 0xff], 8) ^
+		     AES_ROR(aes_td[(s0 >> 8) & 0xff], 16) ^
+		     AES_ROR(aes_td[s3 & 0xff], 24) ^ rk[2];
+		t3 = aes_td[s3 >> 24] ^ AES_ROR(aes_td[(s2 >> 16) & 0xff], 8) ^
+		     AES_ROR(aes_td[(s1 >> 8) & 0xff], 16) ^
+		     AES_ROR(aes_td[s0 & 0xff], 24) ^ rk[3];
+		s0 = t0;
+		s1 = t1;
+		s2 = t2;
+		s3 = t3;
+	}
+
+	rk += 4;
+	t0 = SimpleAESModel_InvSubWord((s0 & 0xff000000) | (s3 & 0xff0000) |
+				       (s2 & 0xff00) | (s1 & 0xff));
+	t1 = SimpleAESModel_InvSubWord((s1 & 0xff000000) | (s0 & 0xff0000) |
+				       (s3 & 0xff00) | (s2 & 0xff));
+	t2 = SimpleAESModel_InvSubWord((s2 & 0xff000000) | (s1 & 0xff0000) |
+				       (s0 & 0xff00) | (s3 & 0xff));
+	t3 = SimpleAESModel_InvSubWord((s3 & 0xff000000) | (s2 & 0xff0000) |
+				       (s1 & 0xff00) | (s0 & 0xff));
+	SimpleAESModel_Store(out, t0 ^ rk[0]);
+	SimpleAESModel_Store(out + 4, t1 ^ rk[1]);
+	SimpleAESModel_Store(out + 8, t2 ^ rk[2]);
+	SimpleAESModel_Store(out + 12, t3 ^ rk[3]);
+}
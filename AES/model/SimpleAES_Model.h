@@ -0,0 +1,179 @@
+#ifndef ORG_SIMPLE_SIMPLEAES_MODEL_H
+#define ORG_SIMPLE_SIMPLEAES_MODEL_H
+
+// Userspace model of the SimpleAES register file and engine (see
+// SimpleAES.md). It decodes CTRL, STAT, IRQ (write-one-to-clear), KAR, IAR
+// and OAR, starts an operation on every OAR write, moves key and data
+// through a caller-supplied bus translation and computes real AES-128.
+//
+// Timing is cycle-approximate: every operation takes
+//
+//	3 * (dma_latency_ns + 16 B / dma_mbps) + core_cycles * clock_ns
+//
+// (key fetch, input fetch, cipher core, output write), and every register
+// access costs mmio_read_ns / mmio_write_ns of busy time in the caller.
+// The operation retires at its deadline, either in the engine thread or
+// in the first register access that observes it, so polled and interrupt
+// completion see the same device.
+//
+// With config.ring the engine is SimpleAES_ver3.rseq: RBAR, RCFG, RHEAD,
+// RTAIL and RCIDX add a descriptor ring. Each descriptor runs COUNT
+// consecutive blocks with one key fetch and one burst each way:
+//
+//	4 * dma_latency_ns + (32 + 16 + 2 * COUNT * 16 + 4) B / dma_mbps
+//	+ COUNT * core_cycles * clock_ns
+//
+// (descriptor, key, input and output bursts, status write-back).
+//
+// Faults: SimpleAESModel_InjectError fails operations (or the first block
+// of descriptors) with an ERR code, SimpleAESModel_InjectHang leaves them
+// running (STAT.BUSY) until SimpleAESModel_Reset, which is what gating the
+// engine clock (SimpleAESModel_Gate) does. While the clock is off, register
+// reads return 0 and writes are dropped; both are counted, since on the
+// board such an access stalls the bus.
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+//==============================================================================
+// Type Definitions
+//==============================================================================
+
+// STAT.ERR codes
+typedef enum {
+	SIMPLEAES_MODEL_ERR_NONE   = 0,
+	SIMPLEAES_MODEL_ERR_KEY	   = 1, // Key read error
+	SIMPLEAES_MODEL_ERR_INPUT  = 2, // Input read error
+	SIMPLEAES_MODEL_ERR_OUTPUT = 3  // Output write error
+} SimpleAESModel_Err;
+
+// Host memory behind a bus address, or NULL if [addr, addr + len) is not
+// mapped for the device
+typedef void *(*SimpleAESModel_TranslateFn)(void *ctx, uint32_t addr,
+					     size_t len);
+
+// Interrupt line level changes
+typedef void (*SimpleAESModel_IrqFn)(void *ctx, bool level);
+
+typedef struct {
+	uint32_t clock_ns;	// Engine clock period
+	uint32_t core_cycles;	// Cipher core cycles per block
+	uint32_t dma_latency_ns; // Per AXI4 transfer
+	uint32_t dma_mbps;	// AXI4 bandwidth (MB/s), 0 for unlimited
+	uint32_t mmio_read_ns;	// AXI-Lite read round trip
+	uint32_t mmio_write_ns; // AXI-Lite (posted) write
+	uint32_t spin_ns;	// Engine thread spins this close to a deadline
+	bool ring;		// Descriptor ring registers (ver3)
+
+	SimpleAESModel_TranslateFn translate;
+	SimpleAESModel_IrqFn irq;
+	void *ctx; // Passed to translate and irq
+} SimpleAESModel_Config;
+
+// Counters (SimpleAESModel_GetStats)
+typedef struct {
+	uint64_t ops;	      // Operations and ring descriptors started
+	uint64_t errors[4];   // Completed ones by STAT.ERR (DSTAT.ERR) code
+	uint64_t overruns;    // OAR writes while busy (ignored)
+	uint64_t injected;    // Errors forced by SimpleAESModel_InjectError
+	uint64_t hangs;	      // Operations hung by SimpleAESModel_InjectHang
+	uint64_t resets;      // SimpleAESModel_Reset calls
+	uint64_t busy_ns;     // Sum of operation durations
+	uint64_t late_ns;     // Sum of retire time past the deadline
+	uint64_t mmio_reads;
+	uint64_t mmio_writes;
+	uint64_t irq_raised;  // Interrupt line low-to-high transitions
+	uint64_t gated_io;    // Register accesses with the clock off
+	uint64_t descs;	      // Ring descriptors completed
+	uint64_t desc_blocks; // Blocks completed by ring descriptors
+} SimpleAESModel_Stats;
+
+typedef enum {
+	SIMPLEAES_MODEL_IDLE,
+	SIMPLEAES_MODEL_RUNNING // Started, retires at done_ns
+} SimpleAESModel_State;
+
+typedef struct {
+	SimpleAESModel_Config config;
+
+	pthread_mutex_t lock; // Everything below
+	pthread_cond_t wake;  // Engine thread: operation started or stop
+	pthread_t thread;
+	bool stop;
+
+	// Registers
+	uint32_t ctrl;
+	uint32_t irq_stat;
+	uint32_t err;
+	uint32_t kar;
+	uint32_t iar;
+	uint32_t oar;
+	uint32_t rbar;
+	uint32_t rcfg;
+	uint32_t rhead;
+	uint32_t rtail;
+	uint32_t rcidx;
+	bool line;  // Interrupt line level
+	bool gated; // Clock off (SimpleAESModel_Gate)
+
+	// Operation in flight (latched at the OAR write)
+	SimpleAESModel_State state;
+	bool computed; // Key and input fetched, output computed
+	uint32_t op;
+	uint32_t key_addr;
+	uint32_t input_addr;
+	uint32_t output_addr;
+	uint32_t fail; // SimpleAESModel_Err decided at start
+	bool desc;     // Ring descriptor rather than an OAR start
+	bool desc_irq; // DCTRL.IRQ
+	uint32_t desc_addr;
+	uint32_t count; // DCTRL.COUNT
+	uint64_t done_ns;
+	uint64_t duration_ns;
+	uint8_t block[16];
+
+	// Error injection: the next inject_count operations fail
+	uint32_t inject_code;
+	unsigned int inject_count;
+
+	// Hang injection: the next hang_count operations never complete
+	unsigned int hang_count;
+
+	SimpleAESModel_Stats stats;
+} SimpleAESModel;
+
+//==============================================================================
+// Function Prototypes
+//==============================================================================
+
+// Device model
+
+void SimpleAESModel_DefaultConfig(SimpleAESModel_Config *ConfigPtr);
+int SimpleAESModel_Init(SimpleAESModel *InstancePtr,
+			const SimpleAESModel_Config *ConfigPtr);
+void SimpleAESModel_DeInit(SimpleAESModel *InstancePtr);
+uint32_t SimpleAESModel_Read(void *ctx, uint32_t offset);
+void SimpleAESModel_Write(void *ctx, uint32_t offset, uint32_t val);
+void SimpleAESModel_Reset(SimpleAESModel *InstancePtr);
+void SimpleAESModel_Gate(SimpleAESModel *InstancePtr, bool gated);
+void SimpleAESModel_InjectError(SimpleAESModel *InstancePtr,
+				SimpleAESModel_Err code, unsigned int count);
+void SimpleAESModel_InjectHang(SimpleAESModel *InstancePtr,
+			       unsigned int count);
+void SimpleAESModel_GetStats(SimpleAESModel *InstancePtr,
+			     SimpleAESModel_Stats *StatsPtr);
+uint64_t SimpleAESModel_Now(void);
+void SimpleAESModel_Delay(uint64_t ns);
+
+// AES (all key sizes; shared with the kernel crypto library shim)
+
+int SimpleAESModel_AesExpand(uint32_t enc[60], uint32_t dec[60],
+			     const uint8_t *key, unsigned int key_len);
+void SimpleAESModel_AesEncrypt(const uint32_t enc[60], unsigned int key_len,
+			       uint8_t out[16], const uint8_t in[16]);
+void SimpleAESModel_AesDecrypt(const uint32_t dec[60], unsigned int key_len,
+			       uint8_t out[16], const uint8_t in[16]);
+
+#endif // ORG_SIMPLE_SIMPLEAES_MODEL_H
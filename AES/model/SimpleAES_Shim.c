@@ -0,0 +1,2957 @@
+#include "SimpleAES_Shim.h"
+
+#include <malloc.h>
+#include <sched.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "SimpleAES_Model.h"
+
+//==============================================================================
+// Logging and Module Parameters
+//==============================================================================
+
+int SimpleAESShim_LogLevel = 4;
+
+bool SimpleAESShim_Capable = true;
+
+static void SimpleAESShim_VLog(const char *prefix, const char *fmt,
+			       va_list args)
+{
+	char line[512];
+	size_t len;
+
+	vsnprintf(line, sizeof(line), fmt, args);
+	len = strlen(line);
+	fprintf(stderr, "%s%s%s", prefix, line,
+		(len && line[len - 1] == '\n') ? "" : "\n");
+}
+
+void printk(const char *fmt, ...)
+{
+	va_list args;
+
+	va_start(args, fmt);
+	SimpleAESShim_VLog("", fmt, args);
+	va_end(args);
+}
+
+void SimpleAESShim_DevLog(const struct device *dev, int level,
+			  const char *fmt, ...)
+{
+	char prefix[64];
+	va_list args;
+
+	if (level > SimpleAESShim_LogLevel) {
+		return;
+	}
+	snprintf(prefix, sizeof(prefix), "%s: ", dev ? dev_name(dev) : "-");
+	va_start(args, fmt);
+	SimpleAESShim_VLog(prefix, fmt, args);
+	va_end(args);
+}
+
+extern const SimpleAESShim_Param __start_simpleaes_params[]
+	__attribute__((weak));
+extern const SimpleAESShim_Param __stop_simpleaes_params[]
+	__attribute__((weak));
+
+int SimpleAESShim_SetParam(const char *name, unsigned int val)
+{
+	const SimpleAESShim_Param *param_ptr;
+
+	for (param_ptr = __start_simpleaes_params;
+	     param_ptr < __stop_simpleaes_params; param_ptr++) {
+		if (strcmp(param_ptr->name, name)) {
+			continue;
+		}
+		switch (param_ptr->size) {
+		case sizeof(u8):
+			*(u8 *)param_ptr->ptr = (u8)val;
+			return 0;
+		case sizeof(u32):
+			*(u32 *)param_ptr->ptr = val;
+			return 0;
+		case sizeof(u64):
+			*(u64 *)param_ptr->ptr = val;
+			return 0;
+		default:
+			return -EINVAL;
+		}
+	}
+
+	return -ENOENT;
+}
+
+//==============================================================================
+// Bitmaps
+//==============================================================================
+
+static unsigned long SimpleAESShim_FindBit(const unsigned long *addr,
+					   unsigned long size,
+					   unsigned long offset,
+					   unsigned long invert)
+{
+	unsigned long word;
+
+	while (offset < size) {
+		word = (addr[BIT_WORD(offset)] ^ invert) &
+		       (~0ul << (offset % BITS_PER_LONG));
+		if (word) {
+			offset = (offset & ~(BITS_PER_LONG - 1ul)) +
+				 __builtin_ctzl(word);
+			return min(offset, size);
+		}
+		offset = (offset | (BITS_PER_LONG - 1ul)) + 1;
+	}
+
+	return size;
+}
+
+unsigned long find_next_bit(const unsigned long *addr, unsigned long size,
+			    unsigned long offset)
+{
+	return SimpleAESShim_FindBit(addr, size, offset, 0);
+}
+
+unsigned long find_next_zero_bit(const unsigned long *addr,
+				 unsigned long size, unsigned long offset)
+{
+	return SimpleAESShim_FindBit(addr, size, offset, ~0ul);
+}
+
+unsigned long *bitmap_zalloc(unsigned int nbits, gfp_t flags)
+{
+	return kcalloc(BITS_TO_LONGS(nbits), sizeof(unsigned long), flags);
+}
+
+void bitmap_free(const unsigned long *bitmap)
+{
+	kfree(bitmap);
+}
+
+void bitmap_fill(unsigned long *dst, unsigned int nbits)
+{
+	memset(dst, 0xff, BITS_TO_LONGS(nbits) * sizeof(unsigned long));
+}
+
+void bitmap_zero(unsigned long *dst, unsigned int nbits)
+{
+	memset(dst, 0, BITS_TO_LONGS(nbits) * sizeof(unsigned long));
+}
+
+//==============================================================================
+// Time
+//==============================================================================
+
+u64 ktime_get_ns(void)
+{
+	return SimpleAESModel_Now();
+}
+
+void ndelay(unsigned long ns)
+{
+	SimpleAESModel_Delay(ns);
+}
+
+void udelay(unsigned long us)
+{
+	SimpleAESModel_Delay(us * NSEC_PER_USEC);
+}
+
+void usleep_range(unsigned long min_us, unsigned long max_us)
+{
+	struct timespec ts = {
+		.tv_sec	 = min_us / 1000000,
+		.tv_nsec = (min_us % 1000000) * 1000,
+	};
+
+	(void)max_us;
+	nanosleep(&ts, NULL);
+}
+
+void msleep(unsigned int ms)
+{
+	usleep_range(ms * 1000ul, ms * 1000ul);
+}
+
+void cond_resched(void)
+{
+}
+
+//==============================================================================
+// Tasks
+//==============================================================================
+
+static __thread struct task_struct *simpleaes_shim_current;
+static pthread_key_t simpleaes_shim_task_key;
+static pthread_once_t simpleaes_shim_task_once = PTHREAD_ONCE_INIT;
+
+static void SimpleAESShim_TaskFree(void *task)
+{
+	struct task_struct *task_ptr = task;
+
+	pthread_mutex_destroy(&task_ptr->lock);
+	free(task_ptr);
+}
+
+static void SimpleAESShim_TaskKeyInit(void)
+{
+	pthread_key_create(&simpleaes_shim_task_key, SimpleAESShim_TaskFree);
+}
+
+static struct task_struct *SimpleAESShim_TaskAlloc(const char *name)
+{
+	struct task_struct *task_ptr = calloc(1, sizeof(*task_ptr));
+
+	if (!task_ptr) {
+		abort();
+	}
+	pthread_mutex_init(&task_ptr->lock, NULL);
+	snprintf(task_ptr->comm, sizeof(task_ptr->comm), "%s", name);
+
+	return task_ptr;
+}
+
+// Threads the shim did not start get a task on first use, freed at exit
+struct task_struct *SimpleAESShim_Current(void)
+{
+	struct task_struct *task_ptr = simpleaes_shim_current;
+
+	if (likely(task_ptr)) {
+		return task_ptr;
+	}
+
+	pthread_once(&simpleaes_shim_task_once, SimpleAESShim_TaskKeyInit);
+	task_ptr      = SimpleAESShim_TaskAlloc("user");
+	task_ptr->pid = gettid();
+	pthread_setspecific(simpleaes_shim_task_key, task_ptr);
+	simpleaes_shim_current = task_ptr;
+
+	return task_ptr;
+}
+
+static void *SimpleAESShim_KthreadMain(void *task)
+{
+	struct task_struct *task_ptr = task;
+
+	simpleaes_shim_current = task_ptr;
+	task_ptr->pid	       = gettid();
+	task_ptr->result       = task_ptr->threadfn(task_ptr->data);
+
+	return NULL;
+}
+
+struct task_struct *kthread_create_on_cpu_shim(int (*threadfn)(void *data),
+					       void *data, const char *name)
+{
+	struct task_struct *task_ptr = SimpleAESShim_TaskAlloc(name);
+
+	task_ptr->threadfn = threadfn;
+	task_ptr->data	   = data;
+	if (pthread_create(&task_ptr->thread, NULL, SimpleAESShim_KthreadMain,
+			   task_ptr)) {
+		SimpleAESShim_TaskFree(task_ptr);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	return task_ptr;
+}
+
+int kthread_stop(struct task_struct *task)
+{
+	int result;
+
+	__atomic_store_n(&task->should_stop, true, __ATOMIC_SEQ_CST);
+	wake_up_process(task);
+	pthread_join(task->thread, NULL);
+	result = task->result;
+	SimpleAESShim_TaskFree(task);
+
+	return result;
+}
+
+bool kthread_should_stop(void)
+{
+	return __atomic_load_n(&current->should_stop, __ATOMIC_SEQ_CST);
+}
+
+int wake_up_process(struct task_struct *task)
+{
+	__atomic_add_fetch(&task->wakes, 1, __ATOMIC_SEQ_CST);
+
+	pthread_mutex_lock(&task->lock);
+	if (task->waiting_on) {
+		pthread_mutex_lock(&task->waiting_on->lock);
+		pthread_cond_broadcast(&task->waiting_on->cond);
+		pthread_mutex_unlock(&task->waiting_on->lock);
+	}
+	pthread_mutex_unlock(&task->lock);
+
+	return 1;
+}
+
+//==============================================================================
+// Locks, Wait Queues and Completions
+//==============================================================================
+
+void SimpleAESShim_SpinWait(spinlock_t *lock)
+{
+	unsigned int spins = 0;
+
+	do {
+		while (__atomic_load_n(&lock->locked, __ATOMIC_RELAXED)) {
+			if (++spins < 1000) {
+				cpu_relax();
+			} else {
+				sched_yield();
+			}
+		}
+	} while (__atomic_exchange_n(&lock->locked, 1, __ATOMIC_ACQUIRE));
+}
+
+void init_waitqueue_head(wait_queue_head_t *wq)
+{
+	pthread_condattr_t attr;
+
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_mutex_init(&wq->lock, NULL);
+	pthread_cond_init(&wq->cond, &attr);
+	pthread_condattr_destroy(&attr);
+	wq->seq	    = 0;
+	wq->waiters = 0;
+}
+
+void SimpleAESShim_WakeUp(wait_queue_head_t *wq)
+{
+	__atomic_add_fetch(&wq->seq, 1, __ATOMIC_SEQ_CST);
+	if (!__atomic_load_n(&wq->waiters, __ATOMIC_SEQ_CST)) {
+		return;
+	}
+
+	pthread_mutex_lock(&wq->lock);
+	pthread_cond_broadcast(&wq->cond);
+	pthread_mutex_unlock(&wq->lock);
+}
+
+SimpleAESShim_WaitToken SimpleAESShim_WaitPrepare(wait_queue_head_t *wq)
+{
+	SimpleAESShim_WaitToken token = {
+		.seq   = __atomic_load_n(&wq->seq, __ATOMIC_SEQ_CST),
+		.wakes = __atomic_load_n(&current->wakes, __ATOMIC_SEQ_CST),
+	};
+
+	return token;
+}
+
+// Returns false if the deadline passed (0: no deadline)
+bool SimpleAESShim_WaitSleep(wait_queue_head_t *wq,
+			     SimpleAESShim_WaitToken *TokenPtr, u64 deadline)
+{
+	struct task_struct *task_ptr = current;
+	struct timespec ts = {
+		.tv_sec	 = deadline / NSEC_PER_SEC,
+		.tv_nsec = deadline % NSEC_PER_SEC,
+	};
+	bool in_time = true;
+
+	// waiting_on first: wake_up_process() nests the queue lock in it
+	pthread_mutex_lock(&task_ptr->lock);
+	task_ptr->waiting_on = wq;
+	pthread_mutex_unlock(&task_ptr->lock);
+
+	pthread_mutex_lock(&wq->lock);
+	__atomic_add_fetch(&wq->waiters, 1, __ATOMIC_SEQ_CST);
+	while (__atomic_load_n(&wq->seq, __ATOMIC_SEQ_CST) == TokenPtr->seq &&
+	       __atomic_load_n(&task_ptr->wakes, __ATOMIC_SEQ_CST) ==
+		       TokenPtr->wakes) {
+		if (!deadline) {
+			pthread_cond_wait(&wq->cond, &wq->lock);
+		} else if (pthread_cond_timedwait(&wq->cond, &wq->lock, &ts) ==
+			   ETIMEDOUT) {
+			in_time = false;
+			break;
+		}
+	}
+	__atomic_sub_fetch(&wq->waiters, 1, __ATOMIC_SEQ_CST);
+	pthread_mutex_unlock(&wq->lock);
+
+	pthread_mutex_lock(&task_ptr->lock);
+	task_ptr->waiting_on = NULL;
+	pthread_mutex_unlock(&task_ptr->lock);
+
+	return in_time;
+}
+
+void SimpleAESShim_RcuwaitPrepare(wait_queue_head_t *wq)
+{
+	current->rcuwait = wq;
+}
+
+void SimpleAESShim_RcuwaitFinish(void)
+{
+	current->rcuwait = NULL;
+}
+
+void set_current_state(int state)
+{
+	struct task_struct *task_ptr = current;
+
+	(void)state;
+	if (task_ptr->rcuwait) {
+		task_ptr->rcuwait_seq = __atomic_load_n(&task_ptr->rcuwait->seq,
+							__ATOMIC_SEQ_CST);
+		task_ptr->rcuwait_wakes =
+			__atomic_load_n(&task_ptr->wakes, __ATOMIC_SEQ_CST);
+	}
+}
+
+// Only sleeps on the queue of an rcuwait; returns the jiffies left, 0 once
+// timeout has passed
+long schedule_timeout(long timeout)
+{
+	struct task_struct *task_ptr = current;
+	u64 deadline = SimpleAESShim_Deadline(timeout);
+	SimpleAESShim_WaitToken token = {
+		.seq   = task_ptr->rcuwait_seq,
+		.wakes = task_ptr->rcuwait_wakes,
+	};
+
+	if (!task_ptr->rcuwait) {
+		msleep(timeout);
+		return 0;
+	}
+	if (!SimpleAESShim_WaitSleep(task_ptr->rcuwait, &token, deadline)) {
+		return 0;
+	}
+
+	return SimpleAESShim_Remaining(deadline);
+}
+
+u64 SimpleAESShim_Deadline(unsigned long timeout)
+{
+	if (timeout >= (unsigned long)MAX_SCHEDULE_TIMEOUT) {
+		return 0;
+	}
+
+	return ktime_get_ns() + (u64)timeout * NSEC_PER_MSEC;
+}
+
+long SimpleAESShim_Remaining(u64 deadline)
+{
+	u64 now;
+
+	if (!deadline) {
+		return MAX_SCHEDULE_TIMEOUT;
+	}
+	now = ktime_get_ns();
+	if (now >= deadline) {
+		return 1;
+	}
+
+	return max_t(long, 1, DIV_ROUND_UP(deadline - now, NSEC_PER_MSEC));
+}
+
+#define SIMPLEAES_SHIM_VAR_WQS 64
+
+static wait_queue_head_t simpleaes_shim_var_wqs[SIMPLEAES_SHIM_VAR_WQS];
+
+__attribute__((constructor)) static void SimpleAESShim_VarWqInit(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < SIMPLEAES_SHIM_VAR_WQS; i++) {
+		init_waitqueue_head(&simpleaes_shim_var_wqs[i]);
+	}
+}
+
+wait_queue_head_t *__var_waitqueue(void *var)
+{
+	uintptr_t key = (uintptr_t)var;
+
+	key = (key >> 3) * 0x9e3779b97f4a7c15ull;
+	return &simpleaes_shim_var_wqs[key >> 58];
+}
+
+void init_completion(struct completion *x)
+{
+	x->done = 0;
+	init_waitqueue_head(&x->wait);
+}
+
+void reinit_completion(struct completion *x)
+{
+	__atomic_store_n(&x->done, 0, __ATOMIC_SEQ_CST);
+}
+
+void complete(struct completion *x)
+{
+	__atomic_add_fetch(&x->done, 1, __ATOMIC_SEQ_CST);
+	SimpleAESShim_WakeUp(&x->wait);
+}
+
+void complete_all(struct completion *x)
+{
+	__atomic_store_n(&x->done, UINT_MAX / 2, __ATOMIC_SEQ_CST);
+	SimpleAESShim_WakeUp(&x->wait);
+}
+
+bool try_wait_for_completion(struct completion *x)
+{
+	unsigned int done = __atomic_load_n(&x->done, __ATOMIC_SEQ_CST);
+
+	do {
+		if (!done) {
+			return false;
+		}
+	} while (!__atomic_compare_exchange_n(&x->done, &done, done - 1, false,
+					      __ATOMIC_SEQ_CST,
+					      __ATOMIC_SEQ_CST));
+
+	return true;
+}
+
+bool completion_done(struct completion *x)
+{
+	return __atomic_load_n(&x->done, __ATOMIC_SEQ_CST) != 0;
+}
+
+//==============================================================================
+// Memory
+//==============================================================================
+
+void *kmalloc(size_t size, gfp_t flags)
+{
+	return (flags & __GFP_ZERO) ? calloc(1, size ? size : 1) :
+				      malloc(size ? size : 1);
+}
+
+void *kzalloc(size_t size, gfp_t flags)
+{
+	return kmalloc(size, flags | __GFP_ZERO);
+}
+
+void *kcalloc(size_t n, size_t size, gfp_t flags)
+{
+	if (size && n > SIZE_MAX / size) {
+		return NULL;
+	}
+
+	return kzalloc(n * size, flags);
+}
+
+void *kmalloc_array(size_t n, size_t size, gfp_t flags)
+{
+	if (size && n > SIZE_MAX / size) {
+		return NULL;
+	}
+
+	return kmalloc(n * size, flags);
+}
+
+void *kmemdup(const void *src, size_t len, gfp_t flags)
+{
+	void *dst = kmalloc(len, flags);
+
+	if (dst) {
+		memcpy(dst, src, len);
+	}
+
+	return dst;
+}
+
+void kfree(const void *ptr)
+{
+	free((void *)ptr);
+}
+
+void kfree_sensitive(const void *ptr)
+{
+	if (ptr) {
+		explicit_bzero((void *)ptr, malloc_usable_size((void *)ptr));
+	}
+	free((void *)ptr);
+}
+
+typedef struct {
+	struct list_head list;
+	max_align_t data[];
+} SimpleAESShim_Devres;
+
+static pthread_mutex_t simpleaes_shim_devres_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void *devm_kzalloc(struct device *dev, size_t size, gfp_t flags)
+{
+	SimpleAESShim_Devres *res_ptr =
+		kzalloc(sizeof(SimpleAESShim_Devres) + size, flags);
+
+	if (!res_ptr) {
+		return NULL;
+	}
+	pthread_mutex_lock(&simpleaes_shim_devres_lock);
+	list_add_tail(&res_ptr->list, &dev->devres);
+	pthread_mutex_unlock(&simpleaes_shim_devres_lock);
+
+	return res_ptr->data;
+}
+
+void *devm_kcalloc(struct device *dev, size_t n, size_t size, gfp_t flags)
+{
+	if (size && n > SIZE_MAX / size) {
+		return NULL;
+	}
+
+	return devm_kzalloc(dev, n * size, flags);
+}
+
+void SimpleAESShim_DevresRelease(struct device *dev)
+{
+	SimpleAESShim_Devres *res_ptr;
+
+	// Pop entries instead of list_for_each_entry_safe: the head is not
+	// embedded in a (16-byte aligned) SimpleAESShim_Devres
+	pthread_mutex_lock(&simpleaes_shim_devres_lock);
+	while (!list_empty(&dev->devres)) {
+		res_ptr = list_first_entry(&dev->devres, SimpleAESShim_Devres,
+					   list);
+		list_del(&res_ptr->list);
+		kfree(res_ptr);
+	}
+	pthread_mutex_unlock(&simpleaes_shim_devres_lock);
+}
+
+unsigned int nr_cpu_ids = 1;
+
+__attribute__((constructor)) static void SimpleAESShim_PercpuInit(void)
+{
+	long cpus = sysconf(_SC_NPROCESSORS_CONF);
+
+	nr_cpu_ids = cpus > 0 ? (unsigned int)cpus : 1;
+}
+
+unsigned int SimpleAESShim_Cpu(void)
+{
+	int cpu = sched_getcpu();
+
+	return cpu > 0 ? (unsigned int)cpu % nr_cpu_ids : 0;
+}
+
+// Untouched copies cost no memory: calloc() of this size maps zero pages
+void *SimpleAESShim_AllocPercpu(size_t size)
+{
+	if (size > SIMPLEAES_SHIM_PERCPU_STRIDE) {
+		return NULL;
+	}
+
+	return kcalloc(nr_cpu_ids, SIMPLEAES_SHIM_PERCPU_STRIDE, GFP_KERNEL);
+}
+
+void *SimpleAESShim_DevmAllocPercpu(struct device *dev, size_t size)
+{
+	if (size > SIMPLEAES_SHIM_PERCPU_STRIDE) {
+		return NULL;
+	}
+
+	return devm_kcalloc(dev, nr_cpu_ids, SIMPLEAES_SHIM_PERCPU_STRIDE,
+			    GFP_KERNEL);
+}
+
+unsigned long copy_from_user(void *to, const void __user *from,
+			     unsigned long n)
+{
+	memcpy(to, from, n);
+	return 0;
+}
+
+unsigned long copy_to_user(void __user *to, const void *from,
+			   unsigned long n)
+{
+	memcpy(to, from, n);
+	return 0;
+}
+
+void *memdup_user(const void __user *src, size_t len)
+{
+	void *dst = kmemdup(src, len, GFP_KERNEL);
+
+	return dst ? dst : ERR_PTR(-ENOMEM);
+}
+
+int pin_user_pages_fast(unsigned long start, int nr_pages,
+			unsigned int gup_flags, struct page **pages)
+{
+	int i;
+
+	(void)gup_flags;
+	for (i = 0; i < nr_pages; i++) {
+		pages[i] = (struct page *)(start + i * PAGE_SIZE);
+	}
+
+	return nr_pages;
+}
+
+void unpin_user_pages(struct page **pages, unsigned long npages)
+{
+	(void)pages;
+	(void)npages;
+}
+
+void unpin_user_pages_dirty_lock(struct page **pages, unsigned long npages,
+				 bool make_dirty)
+{
+	(void)pages;
+	(void)npages;
+	(void)make_dirty;
+}
+
+void sort(void *base, size_t num, size_t size,
+	  int (*cmp)(const void *, const void *),
+	  void (*swap_fn)(void *, void *, int))
+{
+	(void)swap_fn;
+	qsort(base, num, size, cmp);
+}
+
+//==============================================================================
+// Devices, Files and Registration
+//==============================================================================
+
+#define SIMPLEAES_SHIM_MAX_NODES 64
+
+typedef struct {
+	dev_t devt;
+	struct cdev *cdev;
+	struct device *device; // device_create()
+} SimpleAESShim_Node;
+
+static SimpleAESShim_Node simpleaes_shim_nodes[SIMPLEAES_SHIM_MAX_NODES];
+static pthread_mutex_t simpleaes_shim_nodes_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned int simpleaes_shim_next_major = 240;
+
+void SimpleAESShim_DeviceInit(struct device *dev, const char *name)
+{
+	memset(dev, 0, sizeof(*dev));
+	dev->init_name = name;
+	dev->dma_mask  = DMA_BIT_MASK(64);
+	INIT_LIST_HEAD(&dev->devres);
+}
+
+void cdev_init(struct cdev *cdev, const struct file_operations *fops)
+{
+	memset(cdev, 0, sizeof(*cdev));
+	cdev->ops = fops;
+}
+
+int cdev_add(struct cdev *cdev, dev_t dev, unsigned int count)
+{
+	unsigned int i;
+	int ret = -ENOSPC;
+
+	cdev->dev   = dev;
+	cdev->count = count;
+	pthread_mutex_lock(&simpleaes_shim_nodes_lock);
+	for (i = 0; i < SIMPLEAES_SHIM_MAX_NODES; i++) {
+		if (!simpleaes_shim_nodes[i].cdev &&
+		    !simpleaes_shim_nodes[i].device) {
+			simpleaes_shim_nodes[i].devt = dev;
+			simpleaes_shim_nodes[i].cdev = cdev;
+			ret			     = 0;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&simpleaes_shim_nodes_lock);
+
+	return ret;
+}
+
+void cdev_del(struct cdev *cdev)
+{
+	unsigned int i;
+
+	pthread_mutex_lock(&simpleaes_shim_nodes_lock);
+	for (i = 0; i < SIMPLEAES_SHIM_MAX_NODES; i++) {
+		if (simpleaes_shim_nodes[i].cdev == cdev) {
+			simpleaes_shim_nodes[i].cdev = NULL;
+		}
+	}
+	pthread_mutex_unlock(&simpleaes_shim_nodes_lock);
+}
+
+struct cdev *SimpleAESShim_CdevLookup(dev_t dev)
+{
+	struct cdev *cdev = NULL;
+	unsigned int i;
+
+	pthread_mutex_lock(&simpleaes_shim_nodes_lock);
+	for (i = 0; i < SIMPLEAES_SHIM_MAX_NODES; i++) {
+		if (simpleaes_shim_nodes[i].cdev &&
+		    simpleaes_shim_nodes[i].devt == dev) {
+			cdev = simpleaes_shim_nodes[i].cdev;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&simpleaes_shim_nodes_lock);
+
+	return cdev;
+}
+
+int alloc_chrdev_region(dev_t *dev, unsigned int baseminor,
+			unsigned int count, const char *name)
+{
+	(void)count;
+	(void)name;
+	pthread_mutex_lock(&simpleaes_shim_nodes_lock);
+	*dev = MKDEV(simpleaes_shim_next_major++, baseminor);
+	pthread_mutex_unlock(&simpleaes_shim_nodes_lock);
+
+	return 0;
+}
+
+void unregister_chrdev_region(dev_t dev, unsigned int count)
+{
+	(void)dev;
+	(void)count;
+}
+
+struct class *SimpleAESShim_ClassCreate(const char *name)
+{
+	struct class *cls = kzalloc(sizeof(*cls), GFP_KERNEL);
+
+	if (!cls) {
+		return ERR_PTR(-ENOMEM);
+	}
+	cls->name = name;
+
+	return cls;
+}
+
+void class_destroy(struct class *cls)
+{
+	kfree(cls);
+}
+
+struct device *device_create(struct class *cls, struct device *parent,
+			     dev_t devt, void *drvdata, const char *fmt, ...)
+{
+	struct device *dev = kzalloc(sizeof(*dev), GFP_KERNEL);
+	char *name	   = kzalloc(32, GFP_KERNEL);
+	unsigned int i;
+	va_list args;
+
+	(void)cls;
+	if (!dev || !name) {
+		goto __device_create_undo_res1;
+	}
+	va_start(args, fmt);
+	vsnprintf(name, 32, fmt, args);
+	va_end(args);
+	SimpleAESShim_DeviceInit(dev, name);
+	dev->parent	 = parent;
+	dev->devt	 = devt;
+	dev->driver_data = drvdata;
+
+	pthread_mutex_lock(&simpleaes_shim_nodes_lock);
+	for (i = 0; i < SIMPLEAES_SHIM_MAX_NODES; i++) {
+		if (simpleaes_shim_nodes[i].devt == devt &&
+		    !simpleaes_shim_nodes[i].device) {
+			simpleaes_shim_nodes[i].device = dev;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&simpleaes_shim_nodes_lock);
+	if (i == SIMPLEAES_SHIM_MAX_NODES) {
+		goto __device_create_undo_res1;
+	}
+
+	return dev;
+
+__device_create_undo_res1:
+	kfree(name);
+	kfree(dev);
+	return ERR_PTR(-ENOMEM);
+}
+
+void device_destroy(struct class *cls, dev_t devt)
+{
+	struct device *dev = NULL;
+	unsigned int i;
+
+	(void)cls;
+	pthread_mutex_lock(&simpleaes_shim_nodes_lock);
+	for (i = 0; i < SIMPLEAES_SHIM_MAX_NODES; i++) {
+		if (simpleaes_shim_nodes[i].devt == devt &&
+		    simpleaes_shim_nodes[i].device) {
+			dev = simpleaes_shim_nodes[i].device;
+			simpleaes_shim_nodes[i].device = NULL;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&simpleaes_shim_nodes_lock);
+
+	if (dev) {
+		kfree(dev->init_name);
+		kfree(dev);
+	}
+}
+
+int sysfs_emit(char *buf, const char *fmt, ...)
+{
+	va_list args;
+	int len;
+
+	va_start(args, fmt);
+	len = vsnprintf(buf, PAGE_SIZE, fmt, args);
+	va_end(args);
+
+	return min_t(int, len, PAGE_SIZE - 1);
+}
+
+int sysfs_emit_at(char *buf, int at, const char *fmt, ...)
+{
+	va_list args;
+	int len;
+
+	va_start(args, fmt);
+	len = vsnprintf(buf + at, PAGE_SIZE - at, fmt, args);
+	va_end(args);
+
+	return min_t(int, len, PAGE_SIZE - 1 - at);
+}
+
+#define SIMPLEAES_SHIM_MAX_DENTRIES 64
+
+struct dentry {
+	char path[64]; // Empty: free slot
+	void *data;
+	const struct file_operations *fops; // NULL for directories
+};
+
+static struct dentry simpleaes_shim_dentries[SIMPLEAES_SHIM_MAX_DENTRIES];
+static pthread_mutex_t simpleaes_shim_dentries_lock =
+	PTHREAD_MUTEX_INITIALIZER;
+
+static struct dentry *
+SimpleAESShim_DebugfsCreate(const char *name, struct dentry *parent,
+			    void *data, const struct file_operations *fops)
+{
+	struct dentry *dentry = ERR_PTR(-ENOMEM);
+	unsigned int i;
+	int len;
+
+	if (IS_ERR(parent)) {
+		return parent;
+	}
+
+	pthread_mutex_lock(&simpleaes_shim_dentries_lock);
+	for (i = 0; i < SIMPLEAES_SHIM_MAX_DENTRIES; i++) {
+		if (!simpleaes_shim_dentries[i].path[0]) {
+			dentry = &simpleaes_shim_dentries[i];
+			len = snprintf(dentry->path, sizeof(dentry->path),
+				       "%s%s%s", parent ? parent->path : "",
+				       parent ? "/" : "", name);
+
+			// A truncated path could match another file's
+			if (len >= (int)sizeof(dentry->path)) {
+				dentry->path[0] = '\0';
+				dentry = ERR_PTR(-ENAMETOOLONG);
+				break;
+			}
+			dentry->data = data;
+			dentry->fops = fops;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&simpleaes_shim_dentries_lock);
+
+	return dentry;
+}
+
+struct dentry *debugfs_create_dir(const char *name, struct dentry *parent)
+{
+	return SimpleAESShim_DebugfsCreate(name, parent, NULL, NULL);
+}
+
+struct dentry *debugfs_create_file(const char *name, umode_t mode,
+				   struct dentry *parent, void *data,
+				   const struct file_operations *fops)
+{
+	(void)mode;
+	return SimpleAESShim_DebugfsCreate(name, parent, data, fops);
+}
+
+void debugfs_remove_recursive(struct dentry *dentry)
+{
+	const char *path;
+	size_t len;
+	unsigned int i;
+
+	if (IS_ERR_OR_NULL(dentry)) {
+		return;
+	}
+
+	pthread_mutex_lock(&simpleaes_shim_dentries_lock);
+	len = strlen(dentry->path);
+	for (i = 0; i < SIMPLEAES_SHIM_MAX_DENTRIES; i++) {
+		path = simpleaes_shim_dentries[i].path;
+		if (!strncmp(path, dentry->path, len) && path[len] == '/') {
+			simpleaes_shim_dentries[i].path[0] = '\0';
+		}
+	}
+	dentry->path[0] = '\0';
+	pthread_mutex_unlock(&simpleaes_shim_dentries_lock);
+}
+
+// Opens, reads and releases the file as a read(2) loop would
+ssize_t SimpleAESShim_DebugfsRead(const char *path, char *buf, size_t len)
+{
+	const struct file_operations *fops = NULL;
+	struct inode inode		    = { 0 };
+	struct file filp		    = { 0 };
+	loff_t pos			    = 0;
+	ssize_t ret			    = 0;
+	ssize_t count;
+	unsigned int i;
+
+	pthread_mutex_lock(&simpleaes_shim_dentries_lock);
+	for (i = 0; i < SIMPLEAES_SHIM_MAX_DENTRIES; i++) {
+		if (simpleaes_shim_dentries[i].fops &&
+		    !strcmp(simpleaes_shim_dentries[i].path, path)) {
+			fops		= simpleaes_shim_dentries[i].fops;
+			inode.i_private = simpleaes_shim_dentries[i].data;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&simpleaes_shim_dentries_lock);
+	if (!fops) {
+		return -ENOENT;
+	}
+
+	filp.f_op    = fops;
+	filp.f_inode = &inode;
+	if (fops->open) {
+		ret = fops->open(&inode, &filp);
+		if (ret) {
+			return ret;
+		}
+	}
+	while ((size_t)ret < len) {
+		count = fops->read(&filp, buf + ret, len - ret, &pos);
+		if (count <= 0) {
+			ret = count < 0 ? count : ret;
+			break;
+		}
+		ret += count;
+	}
+	if (fops->release) {
+		fops->release(&inode, &filp);
+	}
+
+	return ret;
+}
+
+void seq_printf(struct seq_file *m, const char *fmt, ...)
+{
+	va_list args;
+	int len;
+
+	va_start(args, fmt);
+	len = vsnprintf(m->buf + m->count, m->size - m->count, fmt, args);
+	va_end(args);
+
+	// On overflow count == size: seq_read() retries with a larger buffer
+	m->count = min_t(size_t, m->count + len, m->size);
+}
+
+void seq_puts(struct seq_file *m, const char *s)
+{
+	seq_printf(m, "%s", s);
+}
+
+void seq_putc(struct seq_file *m, char c)
+{
+	seq_printf(m, "%c", c);
+}
+
+int single_open(struct file *filp, int (*show)(struct seq_file *, void *),
+		void *data)
+{
+	struct seq_file *m = kzalloc(sizeof(*m), GFP_KERNEL);
+
+	if (!m) {
+		return -ENOMEM;
+	}
+	m->show		  = show;
+	m->private	  = data;
+	filp->private_data = m;
+
+	return 0;
+}
+
+int single_release(struct inode *inode, struct file *filp)
+{
+	struct seq_file *m = filp->private_data;
+
+	(void)inode;
+	kfree(m->buf);
+	kfree(m);
+
+	return 0;
+}
+
+ssize_t seq_read(struct file *filp, char __user *buf, size_t count,
+		 loff_t *pos)
+{
+	struct seq_file *m = filp->private_data;
+	int ret;
+
+	while (!m->buf) {
+		m->size = m->size ? m->size * 2 : PAGE_SIZE;
+		m->buf	= kmalloc(m->size, GFP_KERNEL);
+		if (!m->buf) {
+			return -ENOMEM;
+		}
+		m->count = 0;
+		ret	 = m->show(m, NULL);
+		if (ret) {
+			return ret;
+		}
+		if (m->count == m->size) {
+			kfree(m->buf);
+			m->buf = NULL;
+		}
+	}
+
+	if ((size_t)*pos >= m->count) {
+		return 0;
+	}
+	count = min_t(size_t, count, m->count - *pos);
+	memcpy(buf, m->buf + *pos, count);
+	*pos += count;
+
+	return count;
+}
+
+loff_t seq_lseek(struct file *filp, loff_t off, int whence)
+{
+	(void)filp;
+	return whence == SEEK_SET && off >= 0 ? off : -EINVAL;
+}
+
+static int SimpleAESShim_Kstrtoull(const char *s, unsigned int base,
+				   unsigned long long *res)
+{
+	char *end;
+
+	if (*s == '-' || *s == '\0') {
+		return -EINVAL;
+	}
+	errno = 0;
+	*res  = strtoull(s, &end, base);
+	if (errno == ERANGE) {
+		return -ERANGE;
+	}
+	if (end == s || (*end && !(end[0] == '\n' && end[1] == '\0'))) {
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+int kstrtouint(const char *s, unsigned int base, unsigned int *res)
+{
+	unsigned long long val;
+	int ret = SimpleAESShim_Kstrtoull(s, base, &val);
+
+	if (ret) {
+		return ret;
+	}
+	if (val > UINT_MAX) {
+		return -ERANGE;
+	}
+	*res = (unsigned int)val;
+
+	return 0;
+}
+
+int kstrtoint(const char *s, unsigned int base, int *res)
+{
+	unsigned long long val;
+	bool neg = (*s == '-');
+	int ret	 = SimpleAESShim_Kstrtoull(s + neg, base, &val);
+
+	if (ret) {
+		return ret;
+	}
+	if (val > (unsigned long long)INT_MAX + neg) {
+		return -ERANGE;
+	}
+	*res = neg ? (int)-val : (int)val;
+
+	return 0;
+}
+
+int kstrtobool(const char *s, bool *res)
+{
+	switch (s[0]) {
+	case 'y': case 'Y': case '1':
+		*res = true;
+		return 0;
+	case 'n': case 'N': case '0':
+		*res = false;
+		return 0;
+	default:
+		return -EINVAL;
+	}
+}
+
+int ida_alloc_range(struct ida *ida, unsigned int min, unsigned int max,
+		    gfp_t gfp)
+{
+	unsigned long id;
+
+	(void)gfp;
+	max = min_t(unsigned int, max, 1023);
+	spin_lock(&ida->lock);
+	id = find_next_zero_bit(ida->ids, max + 1ul, min);
+	if (id > max) {
+		spin_unlock(&ida->lock);
+		return -ENOSPC;
+	}
+	set_bit(id, ida->ids);
+	spin_unlock(&ida->lock);
+
+	return (int)id;
+}
+
+void ida_free(struct ida *ida, unsigned int id)
+{
+	clear_bit(id, ida->ids);
+}
+
+void ida_destroy(struct ida *ida)
+{
+	bitmap_zero(ida->ids, 1024);
+}
+
+void idr_init(struct idr *idr)
+{
+	idr->ptrs = NULL;
+	idr->size = 0;
+}
+
+int idr_alloc(struct idr *idr, void *ptr, int start, int end, gfp_t gfp)
+{
+	unsigned int limit = end > 0 ? (unsigned int)end : INT_MAX;
+	unsigned int id, size;
+	void **ptrs;
+
+	(void)gfp;
+	for (id = start; id < idr->size && idr->ptrs[id]; id++) {
+	}
+	if (id >= limit) {
+		return -ENOSPC;
+	}
+	if (id >= idr->size) {
+		size = max(id + 1, idr->size * 2);
+		size = max(size, 16u);
+		ptrs = realloc(idr->ptrs, size * sizeof(void *));
+		if (!ptrs) {
+			return -ENOMEM;
+		}
+		memset(ptrs + idr->size, 0,
+		       (size - idr->size) * sizeof(void *));
+		idr->ptrs = ptrs;
+		idr->size = size;
+	}
+	idr->ptrs[id] = ptr;
+
+	return (int)id;
+}
+
+void *idr_find(const struct idr *idr, unsigned long id)
+{
+	return id < idr->size ? idr->ptrs[id] : NULL;
+}
+
+void *idr_remove(struct idr *idr, unsigned long id)
+{
+	void *ptr = idr_find(idr, id);
+
+	if (ptr) {
+		idr->ptrs[id] = NULL;
+	}
+
+	return ptr;
+}
+
+void *idr_get_next(const struct idr *idr, int *nextid)
+{
+	unsigned int id;
+
+	for (id = *nextid; id < idr->size; id++) {
+		if (idr->ptrs[id]) {
+			*nextid = (int)id;
+			return idr->ptrs[id];
+		}
+	}
+
+	return NULL;
+}
+
+void idr_destroy(struct idr *idr)
+{
+	free(idr->ptrs);
+	idr_init(idr);
+}
+
+struct eventfd_ctx {
+	int fd;
+};
+
+struct eventfd_ctx *eventfd_ctx_fdget(int fd)
+{
+	struct eventfd_ctx *ctx = kzalloc(sizeof(*ctx), GFP_KERNEL);
+
+	if (!ctx) {
+		return ERR_PTR(-ENOMEM);
+	}
+	ctx->fd = dup(fd);
+	if (ctx->fd < 0) {
+		kfree(ctx);
+		return ERR_PTR(-EBADF);
+	}
+
+	return ctx;
+}
+
+void eventfd_ctx_put(struct eventfd_ctx *ctx)
+{
+	close(ctx->fd);
+	kfree(ctx);
+}
+
+void eventfd_signal(struct eventfd_ctx *ctx, u64 n)
+{
+	ssize_t ret = write(ctx->fd, &n, sizeof(n));
+
+	(void)ret;
+}
+
+void poll_wait(struct file *filp, wait_queue_head_t *wq, poll_table *p)
+{
+	(void)filp;
+	if (p) {
+		p->wq	 = wq;
+		p->token = SimpleAESShim_WaitPrepare(wq);
+	}
+}
+
+//==============================================================================
+// Platform Devices, Clocks and Interrupts
+//==============================================================================
+
+struct platform_driver *SimpleAESShim_PlatformDriver;
+
+int platform_driver_register(struct platform_driver *drv)
+{
+	if (SimpleAESShim_PlatformDriver) {
+		return -EBUSY;
+	}
+	SimpleAESShim_PlatformDriver = drv;
+
+	return 0;
+}
+
+void platform_driver_unregister(struct platform_driver *drv)
+{
+	if (SimpleAESShim_PlatformDriver == drv) {
+		SimpleAESShim_PlatformDriver = NULL;
+	}
+}
+
+// The registered driver's entry for the device's compatible string
+const void *of_device_get_match_data(const struct device *dev)
+{
+	const struct platform_device *pdev =
+		container_of(dev, struct platform_device, dev);
+	const struct of_device_id *id;
+
+	if (!SimpleAESShim_PlatformDriver || !pdev->compatible) {
+		return NULL;
+	}
+	id = SimpleAESShim_PlatformDriver->driver.of_match_table;
+	for (; id && id->compatible[0]; id++) {
+		if (!strcmp(id->compatible, pdev->compatible)) {
+			return id->data;
+		}
+	}
+
+	return NULL;
+}
+
+int platform_get_irq_byname(struct platform_device *pdev, const char *name)
+{
+	(void)name;
+	return pdev->irq > 0 ? pdev->irq : -ENXIO;
+}
+
+void __iomem *
+devm_platform_ioremap_resource_byname(struct platform_device *pdev,
+				      const char *name)
+{
+	(void)name;
+	return pdev->regs ? pdev->regs : ERR_PTR(-ENODEV);
+}
+
+struct clock *SimpleAESShim_ClkGet(struct platform_device *pdev,
+				   const char *name)
+{
+	(void)name;
+	if (!pdev->clk.rate) {
+		pdev->clk.rate = 100000000;
+	}
+	return &pdev->clk;
+}
+
+int clk_prepare_enable(struct clock *clk)
+{
+	if (clk->fail_count) {
+		clk->fail_count--;
+		return -EIO;
+	}
+	if (!clk->enable_count++ && clk->gate) {
+		clk->gate(clk->ctx, true);
+	}
+	return 0;
+}
+
+void clk_disable_unprepare(struct clock *clk)
+{
+	// Unbalanced: the clock framework warns and leaves the clock alone
+	if (!clk->enable_count) {
+		fprintf(stderr, "clk_disable_unprepare: clock already off\n");
+		return;
+	}
+	if (!--clk->enable_count && clk->gate) {
+		clk->gate(clk->ctx, false);
+	}
+}
+
+// A hard handler thread runs while the line is high; IRQ_WAKE_THREAD hands
+// over to the handler thread, as in the kernel
+#define SIMPLEAES_SHIM_MAX_IRQS	 128
+#define SIMPLEAES_SHIM_SPURIOUS 100000
+
+typedef struct {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	irq_handler_t handler;
+	irq_handler_t thread_fn;
+	void *dev_id;
+	bool requested;
+	bool stop;
+	bool level;
+	bool disabled;	// Too many unhandled interrupts
+	unsigned int depth; // disable_irq() nesting
+	bool thread_pending;
+	unsigned int busy; // Handlers running
+	unsigned long unhandled;
+	pthread_t hard;
+	pthread_t threaded;
+} SimpleAESShim_Irq;
+
+static SimpleAESShim_Irq simpleaes_shim_irqs[SIMPLEAES_SHIM_MAX_IRQS];
+
+__attribute__((constructor)) static void SimpleAESShim_IrqInit(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < SIMPLEAES_SHIM_MAX_IRQS; i++) {
+		pthread_mutex_init(&simpleaes_shim_irqs[i].lock, NULL);
+		pthread_cond_init(&simpleaes_shim_irqs[i].cond, NULL);
+	}
+}
+
+static void *SimpleAESShim_IrqHardMain(void *desc)
+{
+	SimpleAESShim_Irq *desc_ptr = desc;
+	unsigned int irq	    = desc_ptr - simpleaes_shim_irqs;
+	irqreturn_t ret;
+
+	pthread_mutex_lock(&desc_ptr->lock);
+	for (;;) {
+		while (!desc_ptr->stop &&
+		       (!desc_ptr->level || desc_ptr->disabled ||
+			desc_ptr->depth)) {
+			pthread_cond_wait(&desc_ptr->cond, &desc_ptr->lock);
+		}
+		if (desc_ptr->stop) {
+			break;
+		}
+		desc_ptr->busy++;
+		pthread_mutex_unlock(&desc_ptr->lock);
+
+		ret = desc_ptr->handler(irq, desc_ptr->dev_id);
+
+		pthread_mutex_lock(&desc_ptr->lock);
+		desc_ptr->busy--;
+		if (ret == IRQ_WAKE_THREAD && desc_ptr->thread_fn) {
+			desc_ptr->thread_pending = true;
+		} else if (ret == IRQ_NONE &&
+			   ++desc_ptr->unhandled >= SIMPLEAES_SHIM_SPURIOUS) {
+			desc_ptr->disabled = true;
+			printk("irq %u: nobody cared, disabling", irq);
+		}
+		pthread_cond_broadcast(&desc_ptr->cond);
+	}
+	pthread_mutex_unlock(&desc_ptr->lock);
+
+	return NULL;
+}
+
+static void *SimpleAESShim_IrqThreadMain(void *desc)
+{
+	SimpleAESShim_Irq *desc_ptr = desc;
+	unsigned int irq	    = desc_ptr - simpleaes_shim_irqs;
+
+	pthread_mutex_lock(&desc_ptr->lock);
+	for (;;) {
+		while (!desc_ptr->stop && !desc_ptr->thread_pending) {
+			pthread_cond_wait(&desc_ptr->cond, &desc_ptr->lock);
+		}
+		if (!desc_ptr->thread_pending) {
+			break;
+		}
+		desc_ptr->thread_pending = false;
+		desc_ptr->busy++;
+		pthread_mutex_unlock(&desc_ptr->lock);
+
+		desc_ptr->thread_fn(irq, desc_ptr->dev_id);
+
+		pthread_mutex_lock(&desc_ptr->lock);
+		desc_ptr->busy--;
+		pthread_cond_broadcast(&desc_ptr->cond);
+	}
+	pthread_mutex_unlock(&desc_ptr->lock);
+
+	return NULL;
+}
+
+int request_threaded_irq(unsigned int irq, irq_handler_t handler,
+			 irq_handler_t thread_fn, unsigned long flags,
+			 const char *name, void *dev_id)
+{
+	SimpleAESShim_Irq *desc_ptr;
+
+	(void)flags;
+	(void)name;
+	if (irq >= SIMPLEAES_SHIM_MAX_IRQS || !handler) {
+		return -EINVAL;
+	}
+	desc_ptr = &simpleaes_shim_irqs[irq];
+
+	pthread_mutex_lock(&desc_ptr->lock);
+	if (desc_ptr->requested) {
+		pthread_mutex_unlock(&desc_ptr->lock);
+		return -EBUSY;
+	}
+	desc_ptr->handler	 = handler;
+	desc_ptr->thread_fn	 = thread_fn;
+	desc_ptr->dev_id	 = dev_id;
+	desc_ptr->requested	 = true;
+	desc_ptr->stop		 = false;
+	desc_ptr->disabled	 = false;
+	desc_ptr->depth		 = 0;
+	desc_ptr->thread_pending = false;
+	desc_ptr->unhandled	 = 0;
+	pthread_mutex_unlock(&desc_ptr->lock);
+
+	if (thread_fn && pthread_create(&desc_ptr->threaded, NULL,
+					SimpleAESShim_IrqThreadMain,
+					desc_ptr)) {
+		goto __request_threaded_irq_undo_res1;
+	}
+	if (pthread_create(&desc_ptr->hard, NULL, SimpleAESShim_IrqHardMain,
+			   desc_ptr)) {
+		goto __request_threaded_irq_undo_res2;
+	}
+
+	return 0;
+
+__request_threaded_irq_undo_res2:
+	if (thread_fn) {
+		pthread_mutex_lock(&desc_ptr->lock);
+		desc_ptr->stop = true;
+		pthread_cond_broadcast(&desc_ptr->cond);
+		pthread_mutex_unlock(&desc_ptr->lock);
+		pthread_join(desc_ptr->threaded, NULL);
+	}
+
+__request_threaded_irq_undo_res1:
+	desc_ptr->requested = false;
+	return -ENOMEM;
+}
+
+void free_irq(unsigned int irq, void *dev_id)
+{
+	SimpleAESShim_Irq *desc_ptr = &simpleaes_shim_irqs[irq];
+
+	pthread_mutex_lock(&desc_ptr->lock);
+	if (!desc_ptr->requested || desc_ptr->dev_id != dev_id) {
+		pthread_mutex_unlock(&desc_ptr->lock);
+		printk("free_irq: irq %u not requested by %p", irq, dev_id);
+		return;
+	}
+	desc_ptr->stop = true;
+	pthread_cond_broadcast(&desc_ptr->cond);
+	pthread_mutex_unlock(&desc_ptr->lock);
+
+	pthread_join(desc_ptr->hard, NULL);
+	if (desc_ptr->thread_fn) {
+		pthread_join(desc_ptr->threaded, NULL);
+	}
+	desc_ptr->requested = false;
+}
+
+void synchronize_irq(unsigned int irq)
+{
+	SimpleAESShim_Irq *desc_ptr = &simpleaes_shim_irqs[irq];
+
+	pthread_mutex_lock(&desc_ptr->lock);
+	while (desc_ptr->busy || desc_ptr->thread_pending) {
+		pthread_cond_wait(&desc_ptr->cond, &desc_ptr->lock);
+	}
+	pthread_mutex_unlock(&desc_ptr->lock);
+}
+
+// Masks the line and waits for running handlers, the thread included
+void disable_irq(unsigned int irq)
+{
+	SimpleAESShim_Irq *desc_ptr = &simpleaes_shim_irqs[irq];
+
+	pthread_mutex_lock(&desc_ptr->lock);
+	desc_ptr->depth++;
+	while (desc_ptr->busy || desc_ptr->thread_pending) {
+		pthread_cond_wait(&desc_ptr->cond, &desc_ptr->lock);
+	}
+	pthread_mutex_unlock(&desc_ptr->lock);
+}
+
+void enable_irq(unsigned int irq)
+{
+	SimpleAESShim_Irq *desc_ptr = &simpleaes_shim_irqs[irq];
+
+	pthread_mutex_lock(&desc_ptr->lock);
+	if (desc_ptr->depth && !--desc_ptr->depth) {
+		pthread_cond_broadcast(&desc_ptr->cond);
+	}
+	pthread_mutex_unlock(&desc_ptr->lock);
+}
+
+void SimpleAESShim_SetIrqLevel(unsigned int irq, bool level)
+{
+	SimpleAESShim_Irq *desc_ptr = &simpleaes_shim_irqs[irq];
+
+	if (irq >= SIMPLEAES_SHIM_MAX_IRQS) {
+		return;
+	}
+	pthread_mutex_lock(&desc_ptr->lock);
+	desc_ptr->level = level;
+	if (level) {
+		pthread_cond_broadcast(&desc_ptr->cond);
+	}
+	pthread_mutex_unlock(&desc_ptr->lock);
+}
+
+//==============================================================================
+// MMIO
+//==============================================================================
+
+#define SIMPLEAES_SHIM_MAX_MMIO 16
+
+// Bases are PROT_NONE reservations: a stray dereference faults
+typedef struct {
+	uintptr_t base;
+	size_t size;
+	SimpleAESShim_MmioReadFn read_fn;
+	SimpleAESShim_MmioWriteFn write_fn;
+	void *ctx;
+} SimpleAESShim_Mmio;
+
+static SimpleAESShim_Mmio simpleaes_shim_mmio[SIMPLEAES_SHIM_MAX_MMIO];
+static pthread_mutex_t simpleaes_shim_mmio_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void __iomem *SimpleAESShim_MapMmio(size_t size,
+				    SimpleAESShim_MmioReadFn read_fn,
+				    SimpleAESShim_MmioWriteFn write_fn,
+				    void *ctx)
+{
+	SimpleAESShim_Mmio *mmio_ptr = NULL;
+	unsigned int i;
+	void *base;
+
+	size = PAGE_ALIGN(size);
+	base = mmap(NULL, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (base == MAP_FAILED) {
+		return NULL;
+	}
+
+	pthread_mutex_lock(&simpleaes_shim_mmio_lock);
+	for (i = 0; i < SIMPLEAES_SHIM_MAX_MMIO; i++) {
+		if (!simpleaes_shim_mmio[i].base) {
+			mmio_ptr = &simpleaes_shim_mmio[i];
+			break;
+		}
+	}
+	if (mmio_ptr) {
+		mmio_ptr->size	   = size;
+		mmio_ptr->read_fn  = read_fn;
+		mmio_ptr->write_fn = write_fn;
+		mmio_ptr->ctx	   = ctx;
+		__atomic_store_n(&mmio_ptr->base, (uintptr_t)base,
+				 __ATOMIC_RELEASE);
+	}
+	pthread_mutex_unlock(&simpleaes_shim_mmio_lock);
+
+	if (!mmio_ptr) {
+		munmap(base, size);
+		return NULL;
+	}
+
+	return base;
+}
+
+void SimpleAESShim_UnmapMmio(void __iomem *base)
+{
+	unsigned int i;
+
+	pthread_mutex_lock(&simpleaes_shim_mmio_lock);
+	for (i = 0; i < SIMPLEAES_SHIM_MAX_MMIO; i++) {
+		if (simpleaes_shim_mmio[i].base == (uintptr_t)base) {
+			munmap(base, simpleaes_shim_mmio[i].size);
+			__atomic_store_n(&simpleaes_shim_mmio[i].base, 0,
+					 __ATOMIC_RELEASE);
+			break;
+		}
+	}
+	pthread_mutex_unlock(&simpleaes_shim_mmio_lock);
+}
+
+static SimpleAESShim_Mmio *SimpleAESShim_MmioLookup(const void __iomem *addr,
+						    u32 *OffsetPtr)
+{
+	uintptr_t a = (uintptr_t)addr;
+	uintptr_t base;
+	unsigned int i;
+
+	for (i = 0; i < SIMPLEAES_SHIM_MAX_MMIO; i++) {
+		base = __atomic_load_n(&simpleaes_shim_mmio[i].base,
+				       __ATOMIC_ACQUIRE);
+		if (base && a >= base &&
+		    a + sizeof(u32) <= base + simpleaes_shim_mmio[i].size) {
+			*OffsetPtr = (u32)(a - base);
+			return &simpleaes_shim_mmio[i];
+		}
+	}
+
+	printk("mmio: access to unmapped address %p", addr);
+	abort();
+}
+
+u32 ioread32(const void __iomem *addr)
+{
+	u32 offset;
+	SimpleAESShim_Mmio *mmio_ptr = SimpleAESShim_MmioLookup(addr, &offset);
+
+	return mmio_ptr->read_fn(mmio_ptr->ctx, offset);
+}
+
+void iowrite32(u32 val, void __iomem *addr)
+{
+	u32 offset;
+	SimpleAESShim_Mmio *mmio_ptr = SimpleAESShim_MmioLookup(addr, &offset);
+
+	mmio_ptr->write_fn(mmio_ptr->ctx, offset, val);
+}
+
+//==============================================================================
+// DMA
+//==============================================================================
+
+// 1 GiB of bus addresses in pages; each page maps a host page
+#define SIMPLEAES_SHIM_DMA_BASE	 0x40000000ull
+#define SIMPLEAES_SHIM_DMA_PAGES (0x40000000ull >> PAGE_SHIFT)
+
+static uintptr_t *simpleaes_shim_dma_pages;
+static unsigned long simpleaes_shim_dma_hint;
+static DEFINE_SPINLOCK(simpleaes_shim_dma_lock);
+
+__attribute__((constructor)) static void SimpleAESShim_DmaInit(void)
+{
+	simpleaes_shim_dma_pages =
+		calloc(SIMPLEAES_SHIM_DMA_PAGES, sizeof(uintptr_t));
+	if (!simpleaes_shim_dma_pages) {
+		abort();
+	}
+}
+
+static dma_addr_t SimpleAESShim_DmaMap(const void *ptr, size_t size)
+{
+	uintptr_t first		= (uintptr_t)ptr & PAGE_MASK;
+	unsigned long offset	= offset_in_page(ptr);
+	unsigned long npages	= DIV_ROUND_UP(offset + max(size, 1ul),
+					       PAGE_SIZE);
+	unsigned long scanned	= 0;
+	unsigned long run	= 0;
+	unsigned long page, i;
+
+	spin_lock(&simpleaes_shim_dma_lock);
+	page = simpleaes_shim_dma_hint;
+	while (run < npages && scanned < SIMPLEAES_SHIM_DMA_PAGES + npages) {
+		if (page + run >= SIMPLEAES_SHIM_DMA_PAGES) {
+			page = 0;
+			run  = 0;
+		} else if (simpleaes_shim_dma_pages[page + run]) {
+			page += run + 1;
+			run = 0;
+		} else {
+			run++;
+		}
+		scanned++;
+	}
+	if (run < npages) {
+		spin_unlock(&simpleaes_shim_dma_lock);
+		return DMA_MAPPING_ERROR;
+	}
+	for (i = 0; i < npages; i++) {
+		simpleaes_shim_dma_pages[page + i] = first + i * PAGE_SIZE;
+	}
+	simpleaes_shim_dma_hint = (page + npages) % SIMPLEAES_SHIM_DMA_PAGES;
+	spin_unlock(&simpleaes_shim_dma_lock);
+
+	return SIMPLEAES_SHIM_DMA_BASE + (page << PAGE_SHIFT) + offset;
+}
+
+static void SimpleAESShim_DmaUnmap(dma_addr_t addr, size_t size)
+{
+	unsigned long page    = (addr - SIMPLEAES_SHIM_DMA_BASE) >> PAGE_SHIFT;
+	unsigned long npages  = DIV_ROUND_UP(offset_in_page(addr) +
+					     max(size, 1ul), PAGE_SIZE);
+	unsigned long i;
+
+	if (addr < SIMPLEAES_SHIM_DMA_BASE ||
+	    page + npages > SIMPLEAES_SHIM_DMA_PAGES) {
+		printk("dma: unmap of bad address %#llx", addr);
+		return;
+	}
+
+	spin_lock(&simpleaes_shim_dma_lock);
+	for (i = 0; i < npages; i++) {
+		simpleaes_shim_dma_pages[page + i] = 0;
+	}
+	spin_unlock(&simpleaes_shim_dma_lock);
+}
+
+void *SimpleAESShim_DmaTranslate(u32 addr, size_t len)
+{
+	unsigned long page = (addr - SIMPLEAES_SHIM_DMA_BASE) >> PAGE_SHIFT;
+	unsigned long npages, i;
+	uintptr_t host = 0;
+
+	if (addr < SIMPLEAES_SHIM_DMA_BASE || !len) {
+		return NULL;
+	}
+	npages = DIV_ROUND_UP(offset_in_page(addr) + len, PAGE_SIZE);
+	if (page + npages > SIMPLEAES_SHIM_DMA_PAGES) {
+		return NULL;
+	}
+
+	// A burst may cross pages only where the host pages are contiguous
+	spin_lock(&simpleaes_shim_dma_lock);
+	for (i = 0; i < npages; i++) {
+		if (!simpleaes_shim_dma_pages[page + i] ||
+		    (i && simpleaes_shim_dma_pages[page + i] !=
+				  simpleaes_shim_dma_pages[page] +
+					  i * PAGE_SIZE)) {
+			break;
+		}
+	}
+	if (i == npages) {
+		host = simpleaes_shim_dma_pages[page] + offset_in_page(addr);
+	}
+	spin_unlock(&simpleaes_shim_dma_lock);
+
+	return (void *)host;
+}
+
+int dma_set_mask_and_coherent(struct device *dev, u64 mask)
+{
+	if (mask < DMA_BIT_MASK(32)) {
+		return -EIO;
+	}
+	dev->dma_mask = mask;
+
+	return 0;
+}
+
+u64 dma_get_mask(struct device *dev)
+{
+	return dev->dma_mask;
+}
+
+void *dma_alloc_coherent(struct device *dev, size_t size,
+			 dma_addr_t *dma_handle, gfp_t gfp)
+{
+	void *cpu_addr;
+
+	(void)dev;
+	(void)gfp;
+	size	 = PAGE_ALIGN(max(size, 1ul));
+	cpu_addr = aligned_alloc(PAGE_SIZE, size);
+	if (!cpu_addr) {
+		return NULL;
+	}
+	memset(cpu_addr, 0, size);
+
+	*dma_handle = SimpleAESShim_DmaMap(cpu_addr, size);
+	if (*dma_handle == DMA_MAPPING_ERROR) {
+		free(cpu_addr);
+		return NULL;
+	}
+
+	return cpu_addr;
+}
+
+void dma_free_coherent(struct device *dev, size_t size, void *cpu_addr,
+		       dma_addr_t dma_handle)
+{
+	(void)dev;
+	if (!cpu_addr) {
+		return;
+	}
+	SimpleAESShim_DmaUnmap(dma_handle, PAGE_ALIGN(max(size, 1ul)));
+	free(cpu_addr);
+}
+
+int dma_mmap_coherent(struct device *dev, struct vm_area_struct *vma,
+		      void *cpu_addr, dma_addr_t dma_addr, size_t size)
+{
+	(void)dev;
+	(void)dma_addr;
+	if (vma->vm_end - vma->vm_start + (vma->vm_pgoff << PAGE_SHIFT) >
+	    PAGE_ALIGN(size)) {
+		return -ENXIO;
+	}
+	vma->host_addr = (char *)cpu_addr + (vma->vm_pgoff << PAGE_SHIFT);
+
+	return 0;
+}
+
+dma_addr_t dma_map_single(struct device *dev, void *ptr, size_t size,
+			  enum dma_data_direction dir)
+{
+	(void)dev;
+	(void)dir;
+	return SimpleAESShim_DmaMap(ptr, size);
+}
+
+void dma_unmap_single(struct device *dev, dma_addr_t addr, size_t size,
+		      enum dma_data_direction dir)
+{
+	(void)dev;
+	(void)dir;
+	SimpleAESShim_DmaUnmap(addr, size);
+}
+
+// A free block holds the free list link and its own bus address
+typedef struct SimpleAESShim_DmaPoolBlock {
+	struct SimpleAESShim_DmaPoolBlock *next;
+	dma_addr_t dma;
+} SimpleAESShim_DmaPoolBlock;
+
+typedef struct {
+	struct list_head node;
+	void *vaddr;
+	dma_addr_t dma;
+} SimpleAESShim_DmaPoolPage;
+
+struct dma_pool {
+	struct device *dev;
+	size_t size; // Block stride (size rounded up to the alignment)
+	spinlock_t lock;
+	struct list_head pages;
+	SimpleAESShim_DmaPoolBlock *free_list;
+};
+
+struct dma_pool *dma_pool_create(const char *name, struct device *dev,
+				 size_t size, size_t align, size_t boundary)
+{
+	struct dma_pool *pool;
+
+	(void)name;
+	(void)boundary;
+	align = max_t(size_t, align, sizeof(SimpleAESShim_DmaPoolBlock));
+	size  = ALIGN(max_t(size_t, size, 1), align);
+	if (size > PAGE_SIZE) {
+		return NULL;
+	}
+
+	pool = kzalloc(sizeof(*pool), GFP_KERNEL);
+	if (!pool) {
+		return NULL;
+	}
+	pool->dev  = dev;
+	pool->size = size;
+	spin_lock_init(&pool->lock);
+	INIT_LIST_HEAD(&pool->pages);
+
+	return pool;
+}
+
+void dma_pool_destroy(struct dma_pool *pool)
+{
+	SimpleAESShim_DmaPoolPage *page, *next;
+
+	if (!pool) {
+		return;
+	}
+	list_for_each_entry_safe(page, next, &pool->pages, node) {
+		dma_free_coherent(pool->dev, PAGE_SIZE, page->vaddr,
+				  page->dma);
+		kfree(page);
+	}
+	kfree(pool);
+}
+
+// Adds one coherent page of blocks to the free list (lock held)
+static int SimpleAESShim_DmaPoolGrow(struct dma_pool *pool)
+{
+	SimpleAESShim_DmaPoolBlock *block;
+	SimpleAESShim_DmaPoolPage *page;
+	size_t offset;
+
+	page = kzalloc(sizeof(*page), GFP_KERNEL);
+	if (!page) {
+		return -ENOMEM;
+	}
+	page->vaddr = dma_alloc_coherent(pool->dev, PAGE_SIZE, &page->dma,
+					 GFP_KERNEL);
+	if (!page->vaddr) {
+		kfree(page);
+		return -ENOMEM;
+	}
+	list_add(&page->node, &pool->pages);
+
+	for (offset = 0; offset + pool->size <= PAGE_SIZE;
+	     offset += pool->size) {
+		block		= (void *)((char *)page->vaddr + offset);
+		block->dma	= page->dma + offset;
+		block->next	= pool->free_list;
+		pool->free_list = block;
+	}
+
+	return 0;
+}
+
+void *dma_pool_alloc(struct dma_pool *pool, gfp_t mem_flags,
+		     dma_addr_t *handle)
+{
+	SimpleAESShim_DmaPoolBlock *block;
+
+	(void)mem_flags;
+	spin_lock(&pool->lock);
+	if (!pool->free_list && SimpleAESShim_DmaPoolGrow(pool)) {
+		spin_unlock(&pool->lock);
+		return NULL;
+	}
+	block		= pool->free_list;
+	pool->free_list = block->next;
+	spin_unlock(&pool->lock);
+
+	*handle = block->dma;
+
+	return block;
+}
+
+void *dma_pool_zalloc(struct dma_pool *pool, gfp_t mem_flags,
+		      dma_addr_t *handle)
+{
+	void *vaddr = dma_pool_alloc(pool, mem_flags, handle);
+
+	if (vaddr) {
+		memset(vaddr, 0, pool->size);
+	}
+
+	return vaddr;
+}
+
+void dma_pool_free(struct dma_pool *pool, void *vaddr, dma_addr_t addr)
+{
+	SimpleAESShim_DmaPoolBlock *block = vaddr;
+
+	spin_lock(&pool->lock);
+	block->dma	= addr;
+	block->next	= pool->free_list;
+	pool->free_list = block;
+	spin_unlock(&pool->lock);
+}
+
+void sg_init_table(struct scatterlist *sgl, unsigned int nents)
+{
+	memset(sgl, 0, nents * sizeof(*sgl));
+	sgl[nents - 1].page_link = SG_END;
+}
+
+void sg_set_buf(struct scatterlist *sg, const void *buf, unsigned int len)
+{
+	sg->page_link = ((uintptr_t)buf & PAGE_MASK) |
+			(sg->page_link & (SG_CHAIN | SG_END));
+	sg->offset = offset_in_page(buf);
+	sg->length = len;
+}
+
+void sg_init_one(struct scatterlist *sg, const void *buf, unsigned int len)
+{
+	sg_init_table(sg, 1);
+	sg_set_buf(sg, buf, len);
+}
+
+struct scatterlist *sg_next(struct scatterlist *sg)
+{
+	return sg_is_last(sg) ? NULL : sg + 1;
+}
+
+int sg_nents(struct scatterlist *sg)
+{
+	int nents;
+
+	for (nents = 0; sg; sg = sg_next(sg)) {
+		nents++;
+	}
+
+	return nents;
+}
+
+static size_t SimpleAESShim_SgCopy(struct scatterlist *sgl,
+				   unsigned int nents, void *buf,
+				   size_t buflen, off_t skip, bool to_buffer)
+{
+	struct scatterlist *sg;
+	size_t done = 0;
+	size_t n;
+
+	for (sg = sgl; sg && nents && done < buflen;
+	     sg = sg_next(sg), nents--) {
+		if ((size_t)skip >= sg->length) {
+			skip -= sg->length;
+			continue;
+		}
+		n = min_t(size_t, sg->length - skip, buflen - done);
+		if (to_buffer) {
+			memcpy((char *)buf + done, (char *)sg_virt(sg) + skip,
+			       n);
+		} else {
+			memcpy((char *)sg_virt(sg) + skip, (char *)buf + done,
+			       n);
+		}
+		done += n;
+		skip = 0;
+	}
+
+	return done;
+}
+
+size_t sg_pcopy_to_buffer(struct scatterlist *sgl, unsigned int nents,
+			  void *buf, size_t buflen, off_t skip)
+{
+	return SimpleAESShim_SgCopy(sgl, nents, buf, buflen, skip, true);
+}
+
+size_t sg_pcopy_from_buffer(struct scatterlist *sgl, unsigned int nents,
+			    const void *buf, size_t buflen, off_t skip)
+{
+	return SimpleAESShim_SgCopy(sgl, nents, (void *)buf, buflen, skip,
+				    false);
+}
+
+// Contiguous pages merge into one segment
+int sg_alloc_table_from_pages(struct sg_table *sgt, struct page **pages,
+			      unsigned int n_pages, unsigned int offset,
+			      unsigned long size, gfp_t gfp)
+{
+	unsigned int nsegs = 0;
+	unsigned int i, seg;
+	unsigned long len;
+
+	for (i = 0; i < n_pages; i++) {
+		if (!i || (uintptr_t)pages[i] !=
+				  (uintptr_t)pages[i - 1] + PAGE_SIZE) {
+			nsegs++;
+		}
+	}
+	if (!nsegs) {
+		return -EINVAL;
+	}
+	sgt->sgl = kcalloc(nsegs, sizeof(struct scatterlist), gfp);
+	if (!sgt->sgl) {
+		return -ENOMEM;
+	}
+	sg_init_table(sgt->sgl, nsegs);
+
+	for (i = 0, seg = 0; seg < nsegs; seg++) {
+		sgt->sgl[seg].page_link |= (uintptr_t)pages[i];
+		sgt->sgl[seg].offset = seg ? 0 : offset;
+		len		     = 0;
+		do {
+			len += PAGE_SIZE;
+			i++;
+		} while (i < n_pages && (uintptr_t)pages[i] ==
+					       (uintptr_t)pages[i - 1] +
+						       PAGE_SIZE);
+		len -= sgt->sgl[seg].offset;
+		sgt->sgl[seg].length = min(len, size);
+		size -= sgt->sgl[seg].length;
+	}
+	sgt->nents	= nsegs;
+	sgt->orig_nents = nsegs;
+
+	return 0;
+}
+
+void sg_free_table(struct sg_table *sgt)
+{
+	kfree(sgt->sgl);
+	sgt->sgl	= NULL;
+	sgt->nents	= 0;
+	sgt->orig_nents = 0;
+}
+
+int dma_map_sgtable(struct device *dev, struct sg_table *sgt,
+		    enum dma_data_direction dir, unsigned long attrs)
+{
+	struct scatterlist *sg;
+	unsigned int i, j;
+
+	(void)dev;
+	(void)dir;
+	(void)attrs;
+	for (i = 0, sg = sgt->sgl; i < sgt->orig_nents; i++, sg++) {
+		sg->dma_address = SimpleAESShim_DmaMap(sg_virt(sg), sg->length);
+		if (sg->dma_address == DMA_MAPPING_ERROR) {
+			for (j = 0; j < i; j++) {
+				SimpleAESShim_DmaUnmap(sgt->sgl[j].dma_address,
+						       sgt->sgl[j].length);
+			}
+			return -ENOMEM;
+		}
+		sg->dma_length = sg->length;
+	}
+	sgt->nents = sgt->orig_nents;
+
+	return 0;
+}
+
+void dma_unmap_sgtable(struct device *dev, struct sg_table *sgt,
+		       enum dma_data_direction dir, unsigned long attrs)
+{
+	unsigned int i;
+
+	(void)dev;
+	(void)dir;
+	(void)attrs;
+	for (i = 0; i < sgt->orig_nents; i++) {
+		SimpleAESShim_DmaUnmap(sgt->sgl[i].dma_address,
+				       sgt->sgl[i].length);
+	}
+}
+
+//==============================================================================
+// Workqueues
+//==============================================================================
+
+#define SIMPLEAES_SHIM_WQ_THREADS 4
+
+struct workqueue_struct {
+	pthread_mutex_t lock;
+	pthread_cond_t cond; // Work queued, idle or stop
+	struct list_head works;
+	unsigned int active;
+	bool stop;
+	unsigned int num_threads;
+	pthread_t threads[SIMPLEAES_SHIM_WQ_THREADS];
+};
+
+static void *SimpleAESShim_WorkerMain(void *wq)
+{
+	struct workqueue_struct *wq_ptr = wq;
+	struct work_struct *work_ptr;
+
+	pthread_mutex_lock(&wq_ptr->lock);
+	for (;;) {
+		while (!wq_ptr->stop && list_empty(&wq_ptr->works)) {
+			pthread_cond_wait(&wq_ptr->cond, &wq_ptr->lock);
+		}
+		if (list_empty(&wq_ptr->works)) {
+			break;
+		}
+		work_ptr = list_first_entry(&wq_ptr->works, struct work_struct,
+					    entry);
+		list_del_init(&work_ptr->entry);
+		wq_ptr->active++;
+		pthread_mutex_unlock(&wq_ptr->lock);
+
+		// Requeueing from the callback runs it again
+		clear_bit(0, &work_ptr->pending);
+		work_ptr->func(work_ptr);
+
+		pthread_mutex_lock(&wq_ptr->lock);
+		if (!--wq_ptr->active && list_empty(&wq_ptr->works)) {
+			pthread_cond_broadcast(&wq_ptr->cond);
+		}
+	}
+	pthread_mutex_unlock(&wq_ptr->lock);
+
+	return NULL;
+}
+
+struct workqueue_struct *alloc_workqueue(const char *fmt, unsigned int flags,
+					 int max_active, ...)
+{
+	struct workqueue_struct *wq_ptr = kzalloc(sizeof(*wq_ptr), GFP_KERNEL);
+	unsigned int i;
+
+	(void)fmt;
+	(void)flags;
+	if (!wq_ptr) {
+		return NULL;
+	}
+	pthread_mutex_init(&wq_ptr->lock, NULL);
+	pthread_cond_init(&wq_ptr->cond, NULL);
+	INIT_LIST_HEAD(&wq_ptr->works);
+	wq_ptr->num_threads =
+		(max_active > 0) ?
+			min_t(unsigned int, max_active,
+			      SIMPLEAES_SHIM_WQ_THREADS) :
+			SIMPLEAES_SHIM_WQ_THREADS;
+
+	for (i = 0; i < wq_ptr->num_threads; i++) {
+		if (pthread_create(&wq_ptr->threads[i], NULL,
+				   SimpleAESShim_WorkerMain, wq_ptr)) {
+			wq_ptr->num_threads = i;
+			destroy_workqueue(wq_ptr);
+			return NULL;
+		}
+	}
+
+	return wq_ptr;
+}
+
+bool queue_work(struct workqueue_struct *wq, struct work_struct *work)
+{
+	if (test_and_set_bit(0, &work->pending)) {
+		return false;
+	}
+
+	pthread_mutex_lock(&wq->lock);
+	list_add_tail(&work->entry, &wq->works);
+	pthread_cond_broadcast(&wq->cond);
+	pthread_mutex_unlock(&wq->lock);
+
+	return true;
+}
+
+void flush_workqueue(struct workqueue_struct *wq)
+{
+	pthread_mutex_lock(&wq->lock);
+	while (wq->active || !list_empty(&wq->works)) {
+		pthread_cond_wait(&wq->cond, &wq->lock);
+	}
+	pthread_mutex_unlock(&wq->lock);
+}
+
+void destroy_workqueue(struct workqueue_struct *wq)
+{
+	unsigned int i;
+
+	flush_workqueue(wq);
+	pthread_mutex_lock(&wq->lock);
+	wq->stop = true;
+	pthread_cond_broadcast(&wq->cond);
+	pthread_mutex_unlock(&wq->lock);
+
+	for (i = 0; i < wq->num_threads; i++) {
+		pthread_join(wq->threads[i], NULL);
+	}
+	kfree(wq);
+}
+
+//==============================================================================
+// High-Resolution Timers
+//==============================================================================
+
+// Armed timers, unsorted; the thread sleeps until the earliest expiry
+static pthread_mutex_t simpleaes_shim_hrtimer_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t simpleaes_shim_hrtimer_cond;
+static LIST_HEAD(simpleaes_shim_hrtimers);
+static struct hrtimer *simpleaes_shim_hrtimer_running;
+static pthread_once_t simpleaes_shim_hrtimer_once = PTHREAD_ONCE_INIT;
+
+static void *SimpleAESShim_HrtimerMain(void *arg)
+{
+	struct hrtimer *timer, *first;
+	struct timespec ts;
+	u64 now;
+
+	(void)arg;
+	pthread_mutex_lock(&simpleaes_shim_hrtimer_lock);
+	for (;;) {
+		first = NULL;
+		list_for_each_entry(timer, &simpleaes_shim_hrtimers, node) {
+			if (!first || timer->expires < first->expires) {
+				first = timer;
+			}
+		}
+		if (!first) {
+			pthread_cond_wait(&simpleaes_shim_hrtimer_cond,
+					  &simpleaes_shim_hrtimer_lock);
+			continue;
+		}
+
+		now = ktime_get_ns();
+		if ((u64)first->expires > now) {
+			ts.tv_sec  = first->expires / NSEC_PER_SEC;
+			ts.tv_nsec = first->expires % NSEC_PER_SEC;
+			pthread_cond_timedwait(&simpleaes_shim_hrtimer_cond,
+					       &simpleaes_shim_hrtimer_lock,
+					       &ts);
+			continue;
+		}
+
+		list_del_init(&first->node);
+		simpleaes_shim_hrtimer_running = first;
+		pthread_mutex_unlock(&simpleaes_shim_hrtimer_lock);
+
+		first->function(first);
+
+		pthread_mutex_lock(&simpleaes_shim_hrtimer_lock);
+		simpleaes_shim_hrtimer_running = NULL;
+		pthread_cond_broadcast(&simpleaes_shim_hrtimer_cond);
+	}
+
+	return NULL;
+}
+
+static void SimpleAESShim_HrtimerStart(void)
+{
+	pthread_condattr_t attr;
+	pthread_t thread;
+
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&simpleaes_shim_hrtimer_cond, &attr);
+	pthread_condattr_destroy(&attr);
+
+	pthread_create(&thread, NULL, SimpleAESShim_HrtimerMain, NULL);
+	pthread_detach(thread);
+}
+
+void hrtimer_init(struct hrtimer *timer, clockid_t clock_id,
+		  enum hrtimer_mode mode)
+{
+	(void)clock_id;
+	(void)mode;
+	pthread_once(&simpleaes_shim_hrtimer_once, SimpleAESShim_HrtimerStart);
+	INIT_LIST_HEAD(&timer->node);
+	timer->expires	= 0;
+	timer->function = NULL;
+}
+
+void hrtimer_start(struct hrtimer *timer, ktime_t tim, enum hrtimer_mode mode)
+{
+	pthread_mutex_lock(&simpleaes_shim_hrtimer_lock);
+	timer->expires = mode == HRTIMER_MODE_REL ? ktime_get() + tim : tim;
+	list_move_tail(&timer->node, &simpleaes_shim_hrtimers);
+	pthread_cond_broadcast(&simpleaes_shim_hrtimer_cond);
+	pthread_mutex_unlock(&simpleaes_shim_hrtimer_lock);
+}
+
+// 1 if the timer was armed, 0 if not, -1 if its callback is running
+int hrtimer_try_to_cancel(struct hrtimer *timer)
+{
+	int ret = 0;
+
+	pthread_mutex_lock(&simpleaes_shim_hrtimer_lock);
+	if (simpleaes_shim_hrtimer_running == timer) {
+		ret = -1;
+	} else if (!list_empty(&timer->node)) {
+		list_del_init(&timer->node);
+		ret = 1;
+	}
+	pthread_mutex_unlock(&simpleaes_shim_hrtimer_lock);
+
+	return ret;
+}
+
+// Also waits for a running callback to return
+int hrtimer_cancel(struct hrtimer *timer)
+{
+	int ret = 0;
+
+	pthread_mutex_lock(&simpleaes_shim_hrtimer_lock);
+	if (!list_empty(&timer->node)) {
+		list_del_init(&timer->node);
+		ret = 1;
+	}
+	while (simpleaes_shim_hrtimer_running == timer) {
+		pthread_cond_wait(&simpleaes_shim_hrtimer_cond,
+				  &simpleaes_shim_hrtimer_lock);
+	}
+	pthread_mutex_unlock(&simpleaes_shim_hrtimer_lock);
+
+	return ret;
+}
+
+//==============================================================================
+// Crypto Library
+//==============================================================================
+
+int aes_check_keylen(unsigned int keylen)
+{
+	switch (keylen) {
+	case AES_KEYSIZE_128:
+	case AES_KEYSIZE_192:
+	case AES_KEYSIZE_256:
+		return 0;
+	default:
+		return -EINVAL;
+	}
+}
+
+int aes_expandkey(struct crypto_aes_ctx *ctx, const u8 *in_key,
+		  unsigned int key_len)
+{
+	int ret = SimpleAESModel_AesExpand(ctx->key_enc, ctx->key_dec, in_key,
+					   key_len);
+
+	if (ret) {
+		return ret;
+	}
+	ctx->key_length = key_len;
+
+	return 0;
+}
+
+void aes_encrypt(const struct crypto_aes_ctx *ctx, u8 *out, const u8 *in)
+{
+	SimpleAESModel_AesEncrypt(ctx->key_enc, ctx->key_length, out, in);
+}
+
+void aes_decrypt(const struct crypto_aes_ctx *ctx, u8 *out, const u8 *in)
+{
+	SimpleAESModel_AesDecrypt(ctx->key_dec, ctx->key_length, out, in);
+}
+
+void crypto_xor(u8 *dst, const u8 *src, unsigned int size)
+{
+	while (size--) {
+		*dst++ ^= *src++;
+	}
+}
+
+void crypto_xor_cpy(u8 *dst, const u8 *src1, const u8 *src2,
+		    unsigned int size)
+{
+	while (size--) {
+		*dst++ = *src1++ ^ *src2++;
+	}
+}
+
+// Big-endian counter increment
+void crypto_inc(u8 *a, unsigned int size)
+{
+	while (size--) {
+		if (++a[size]) {
+			break;
+		}
+	}
+}
+
+// Multiply by x in GF(2^128), XTS (little-endian) convention
+void gf128mul_x_ble(le128 *r, const le128 *x)
+{
+	u64 a  = x->a;
+	u64 b  = x->b;
+	u64 tt = (a >> 63) ? 0x87 : 0;
+
+	r->a = (a << 1) | (b >> 63);
+	r->b = (b << 1) ^ tt;
+}
+
+//==============================================================================
+// Crypto API
+//==============================================================================
+
+static LIST_HEAD(simpleaes_shim_algs);
+static pthread_mutex_t simpleaes_shim_algs_lock = PTHREAD_MUTEX_INITIALIZER;
+
+int crypto_register_skcipher(struct skcipher_alg *alg)
+{
+	pthread_mutex_lock(&simpleaes_shim_algs_lock);
+	list_add_tail(&alg->base.cra_list, &simpleaes_shim_algs);
+	pthread_mutex_unlock(&simpleaes_shim_algs_lock);
+
+	return 0;
+}
+
+void crypto_unregister_skcipher(struct skcipher_alg *alg)
+{
+	pthread_mutex_lock(&simpleaes_shim_algs_lock);
+	list_del(&alg->base.cra_list);
+	pthread_mutex_unlock(&simpleaes_shim_algs_lock);
+}
+
+// Matches by algorithm or driver name; (flags ^ type) & mask must be zero
+struct crypto_skcipher *crypto_alloc_skcipher(const char *alg_name, u32 type,
+					      u32 mask)
+{
+	struct skcipher_alg *alg, *best = NULL;
+	struct crypto_skcipher *tfm;
+	size_t size;
+	int ret;
+
+	pthread_mutex_lock(&simpleaes_shim_algs_lock);
+	list_for_each_entry(alg, &simpleaes_shim_algs, base.cra_list) {
+		if ((strcmp(alg->base.cra_name, alg_name) &&
+		     strcmp(alg->base.cra_driver_name, alg_name)) ||
+		    ((alg->base.cra_flags ^ type) & mask)) {
+			continue;
+		}
+		if (!best || alg->base.cra_priority > best->base.cra_priority) {
+			best = alg;
+		}
+	}
+	pthread_mutex_unlock(&simpleaes_shim_algs_lock);
+	if (!best) {
+		return ERR_PTR(-ENOENT);
+	}
+
+	size = ALIGN(sizeof(*tfm) + best->base.cra_ctxsize, 16);
+	tfm  = aligned_alloc(16, size);
+	if (!tfm) {
+		return ERR_PTR(-ENOMEM);
+	}
+	memset(tfm, 0, size);
+	tfm->base.__crt_alg = &best->base;
+	if (best->init) {
+		ret = best->init(tfm);
+		if (ret) {
+			free(tfm);
+			return ERR_PTR(ret);
+		}
+	}
+
+	return tfm;
+}
+
+void crypto_free_skcipher(struct crypto_skcipher *tfm)
+{
+	if (IS_ERR_OR_NULL(tfm)) {
+		return;
+	}
+	if (crypto_skcipher_alg(tfm)->exit) {
+		crypto_skcipher_alg(tfm)->exit(tfm);
+	}
+	free(tfm);
+}
+
+int crypto_skcipher_setkey(struct crypto_skcipher *tfm, const u8 *key,
+			   unsigned int keylen)
+{
+	return crypto_skcipher_alg(tfm)->setkey(tfm, key, keylen);
+}
+
+int crypto_skcipher_encrypt(struct skcipher_request *req)
+{
+	return crypto_skcipher_alg(crypto_skcipher_reqtfm(req))->encrypt(req);
+}
+
+int crypto_skcipher_decrypt(struct skcipher_request *req)
+{
+	return crypto_skcipher_alg(crypto_skcipher_reqtfm(req))->decrypt(req);
+}
+
+struct skcipher_request *skcipher_request_alloc(struct crypto_skcipher *tfm,
+						gfp_t gfp)
+{
+	struct skcipher_request *req;
+
+	req = kzalloc(sizeof(*req) + crypto_skcipher_reqsize(tfm), gfp);
+	if (req) {
+		skcipher_request_set_tfm(req, tfm);
+	}
+
+	return req;
+}
+
+void skcipher_request_free(struct skcipher_request *req)
+{
+	kfree_sensitive(req);
+}
+
+void crypto_init_wait(struct crypto_wait *wait)
+{
+	init_completion(&wait->completion);
+	wait->err = 0;
+}
+
+// Completion callback of requests waited for with crypto_wait_req()
+void crypto_req_done(void *data, int err)
+{
+	struct crypto_wait *wait = data;
+
+	if (err == -EINPROGRESS) {
+		return;
+	}
+	wait->err = err;
+	complete(&wait->completion);
+}
+
+int crypto_wait_req(int err, struct crypto_wait *wait)
+{
+	if (err == -EINPROGRESS || err == -EBUSY) {
+		wait_for_completion(&wait->completion);
+		reinit_completion(&wait->completion);
+		err = wait->err;
+	}
+
+	return err;
+}
+
+// Synchronous software ecb/cbc/ctr(aes): the fallbacks the driver allocates
+
+typedef enum { SHIM_AES_ECB, SHIM_AES_CBC, SHIM_AES_CTR } SimpleAESShim_Mode;
+
+static int SimpleAESShim_AesSetkey(struct crypto_skcipher *tfm,
+				   const u8 *key, unsigned int keylen)
+{
+	return aes_expandkey(crypto_skcipher_ctx(tfm), key, keylen);
+}
+
+static int SimpleAESShim_AesCrypt(struct skcipher_request *req,
+				  SimpleAESShim_Mode mode, bool encrypt)
+{
+	struct crypto_aes_ctx *ctx =
+		crypto_skcipher_ctx(crypto_skcipher_reqtfm(req));
+	unsigned int len = req->cryptlen;
+	u8 block[AES_BLOCK_SIZE], prev[AES_BLOCK_SIZE];
+	unsigned int off, n;
+	u8 *buf;
+
+	if (mode != SHIM_AES_CTR && len % AES_BLOCK_SIZE) {
+		return -EINVAL;
+	}
+	buf = kmalloc(len, GFP_KERNEL);
+	if (!buf) {
+		return -ENOMEM;
+	}
+	sg_pcopy_to_buffer(req->src, sg_nents(req->src), buf, len, 0);
+
+	for (off = 0; off < len; off += AES_BLOCK_SIZE) {
+		n = min_t(unsigned int, len - off, AES_BLOCK_SIZE);
+		switch (mode) {
+		case SHIM_AES_ECB:
+			(encrypt ? aes_encrypt : aes_decrypt)(ctx, buf + off,
+							      buf + off);
+			break;
+		case SHIM_AES_CBC:
+			if (encrypt) {
+				crypto_xor(buf + off, req->iv, AES_BLOCK_SIZE);
+				aes_encrypt(ctx, buf + off, buf + off);
+				memcpy(req->iv, buf + off, AES_BLOCK_SIZE);
+			} else {
+				memcpy(prev, buf + off, AES_BLOCK_SIZE);
+				aes_decrypt(ctx, buf + off, buf + off);
+				crypto_xor(buf + off, req->iv, AES_BLOCK_SIZE);
+				memcpy(req->iv, prev, AES_BLOCK_SIZE);
+			}
+			break;
+		case SHIM_AES_CTR:
+			aes_encrypt(ctx, block, req->iv);
+			crypto_xor(buf + off, block, n);
+			crypto_inc(req->iv, AES_BLOCK_SIZE);
+			break;
+		}
+	}
+
+	sg_pcopy_from_buffer(req->dst, sg_nents(req->dst), buf, len, 0);
+	kfree_sensitive(buf);
+
+	return 0;
+}
+
+#define SIMPLEAES_SHIM_AES_OPS(name, mode) \
+	static int SimpleAESShim_##name##Encrypt(struct skcipher_request *req) \
+	{ \
+		return SimpleAESShim_AesCrypt(req, mode, true); \
+	} \
+	static int SimpleAESShim_##name##Decrypt(struct skcipher_request *req) \
+	{ \
+		return SimpleAESShim_AesCrypt(req, mode, false); \
+	}
+
+SIMPLEAES_SHIM_AES_OPS(Ecb, SHIM_AES_ECB)
+SIMPLEAES_SHIM_AES_OPS(Cbc, SHIM_AES_CBC)
+SIMPLEAES_SHIM_AES_OPS(Ctr, SHIM_AES_CTR)
+
+#define SIMPLEAES_SHIM_AES_ALG(mode, name, blocksize, iv) \
+	{ \
+		.setkey		     = SimpleAESShim_AesSetkey, \
+		.encrypt	     = SimpleAESShim_##name##Encrypt, \
+		.decrypt	     = SimpleAESShim_##name##Decrypt, \
+		.min_keysize	     = AES_MIN_KEY_SIZE, \
+		.max_keysize	     = AES_MAX_KEY_SIZE, \
+		.ivsize		     = iv, \
+		.chunksize	     = AES_BLOCK_SIZE, \
+		.base.cra_name	     = mode "(aes)", \
+		.base.cra_driver_name = mode "-aes-generic", \
+		.base.cra_priority   = 100, \
+		.base.cra_blocksize  = blocksize, \
+		.base.cra_ctxsize    = sizeof(struct crypto_aes_ctx), \
+	}
+
+static struct skcipher_alg simpleaes_shim_aes_algs[] = {
+	SIMPLEAES_SHIM_AES_ALG("ecb", Ecb, AES_BLOCK_SIZE, 0),
+	SIMPLEAES_SHIM_AES_ALG("cbc", Cbc, AES_BLOCK_SIZE, AES_BLOCK_SIZE),
+	SIMPLEAES_SHIM_AES_ALG("ctr", Ctr, 1, AES_BLOCK_SIZE),
+};
+
+__attribute__((constructor)) static void SimpleAESShim_AesAlgInit(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(simpleaes_shim_aes_algs); i++) {
+		crypto_register_skcipher(&simpleaes_shim_aes_algs[i]);
+	}
+}
+
+// One request in flight: the next is issued when the current one finalizes
+struct crypto_engine {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	struct list_head queue;
+	struct crypto_async_request *cur;
+	bool running;
+	bool stop;
+	pthread_t thread;
+};
+
+static void *SimpleAESShim_EngineMain(void *engine)
+{
+	struct crypto_engine *engine_ptr = engine;
+	struct crypto_async_request *areq;
+	struct crypto_engine_ctx *enginectx;
+	int ret;
+
+	pthread_mutex_lock(&engine_ptr->lock);
+	for (;;) {
+		while (!engine_ptr->stop &&
+		       (engine_ptr->cur || list_empty(&engine_ptr->queue))) {
+			pthread_cond_wait(&engine_ptr->cond, &engine_ptr->lock);
+		}
+		if (engine_ptr->stop) {
+			break;
+		}
+		areq = list_first_entry(&engine_ptr->queue,
+					struct crypto_async_request, list);
+		list_del(&areq->list);
+		engine_ptr->cur = areq;
+		pthread_mutex_unlock(&engine_ptr->lock);
+
+		enginectx = crypto_tfm_ctx(areq->tfm);
+		ret	  = enginectx->op.do_one_request(engine_ptr, areq);
+
+		pthread_mutex_lock(&engine_ptr->lock);
+		if (ret < 0 && engine_ptr->cur == areq) {
+			engine_ptr->cur = NULL;
+			pthread_mutex_unlock(&engine_ptr->lock);
+			areq->complete(areq->data, ret);
+			pthread_mutex_lock(&engine_ptr->lock);
+		}
+	}
+	pthread_mutex_unlock(&engine_ptr->lock);
+
+	return NULL;
+}
+
+struct crypto_engine *crypto_engine_alloc_init(struct device *dev, bool rt)
+{
+	struct crypto_engine *engine_ptr =
+		kzalloc(sizeof(*engine_ptr), GFP_KERNEL);
+
+	(void)dev;
+	(void)rt;
+	if (!engine_ptr) {
+		return NULL;
+	}
+	pthread_mutex_init(&engine_ptr->lock, NULL);
+	pthread_cond_init(&engine_ptr->cond, NULL);
+	INIT_LIST_HEAD(&engine_ptr->queue);
+
+	return engine_ptr;
+}
+
+int crypto_engine_start(struct crypto_engine *engine)
+{
+	if (pthread_create(&engine->thread, NULL, SimpleAESShim_EngineMain,
+			   engine)) {
+		return -ENOMEM;
+	}
+	engine->running = true;
+
+	return 0;
+}
+
+int crypto_engine_exit(struct crypto_engine *engine)
+{
+	if (engine->running) {
+		pthread_mutex_lock(&engine->lock);
+		engine->stop = true;
+		pthread_cond_broadcast(&engine->cond);
+		pthread_mutex_unlock(&engine->lock);
+		pthread_join(engine->thread, NULL);
+	}
+	kfree(engine);
+
+	return 0;
+}
+
+int crypto_transfer_skcipher_request_to_engine(struct crypto_engine *engine,
+					       struct skcipher_request *req)
+{
+	pthread_mutex_lock(&engine->lock);
+	if (engine->stop) {
+		pthread_mutex_unlock(&engine->lock);
+		return -ESHUTDOWN;
+	}
+	list_add_tail(&req->base.list, &engine->queue);
+	pthread_cond_broadcast(&engine->cond);
+	pthread_mutex_unlock(&engine->lock);
+
+	return -EINPROGRESS;
+}
+
+void crypto_finalize_skcipher_request(struct crypto_engine *engine,
+				      struct skcipher_request *req, int err)
+{
+	pthread_mutex_lock(&engine->lock);
+	if (engine->cur == &req->base) {
+		engine->cur = NULL;
+		pthread_cond_broadcast(&engine->cond);
+	}
+	pthread_mutex_unlock(&engine->lock);
+
+	req->base.complete(req->base.data, err);
+}
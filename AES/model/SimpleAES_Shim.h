@@ -0,0 +1,1725 @@
+#ifndef ORG_SIMPLE_SIMPLEAES_SHIM_H
+#define ORG_SIMPLE_SIMPLEAES_SHIM_H
+
+// Kernel API shim: the subset of the Linux kernel API SimpleAES_Linux.c
+// uses, implemented on POSIX threads so that the unmodified driver runs in
+// a process against SimpleAES_Model.
+//
+// - Execution contexts are threads: kthreads, workqueue workers, the crypto
+//   engine, a hard and a threaded handler per requested interrupt
+//   (SimpleAESShim_SetIrqLevel drives the line), and one for hrtimers.
+// - Spinlocks spin (yielding after a while), mutexes and rwsems are pthread
+//   locks, wait queues sleep on condition variables.
+// - MMIO goes to callbacks registered with SimpleAESShim_MapMmio.
+// - DMA goes through a 1 GiB IOMMU-like window below 4 GiB: every mapping
+//   gets a bus address that SimpleAESShim_DmaTranslate turns back into
+//   host memory, so the device model sees exactly what the driver mapped.
+// - "User" memory is process memory: copy_{from,to}_user are memcpy and
+//   pinning is free.
+// - Registration (chrdev, class, sysfs, platform driver, crypto algorithms)
+//   is recorded for SimpleAES_Host; nothing else is emulated.
+//
+// The headers in model/include forward here. linux/errno.h is deliberately
+// not among them: the UAPI header has the kernel's values.
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/types.h>
+
+//==============================================================================
+// Types and Compiler
+//==============================================================================
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef unsigned long long u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef long long s64;
+typedef u64 dma_addr_t;
+typedef u64 phys_addr_t;
+typedef unsigned int gfp_t;
+typedef unsigned int __poll_t;
+typedef unsigned short umode_t;
+typedef s64 ktime_t;
+typedef u32 __le32;
+typedef u64 __le64;
+typedef struct {
+	__le64 b, a;
+} le128;
+
+// The model runs on little-endian hosts only
+#define cpu_to_le32(x) ((__le32)(x))
+#define le32_to_cpu(x) ((u32)(x))
+
+#define __iomem
+#define __user
+#define __init
+#define __exit
+#define __percpu
+#define __maybe_unused	     __attribute__((unused))
+#define __aligned(x)	     __attribute__((aligned(x)))
+#define __packed	     __attribute__((packed))
+#define ____cacheline_aligned __attribute__((aligned(SMP_CACHE_BYTES)))
+#define likely(x)	     __builtin_expect(!!(x), 1)
+#define unlikely(x)	     __builtin_expect(!!(x), 0)
+#define fallthrough	     __attribute__((fallthrough))
+
+#define SMP_CACHE_BYTES 64
+#define BITS_PER_LONG	64
+
+#define U32_MAX ((u32)~0u)
+#define U64_MAX ((u64)~0ull)
+#define S64_MAX ((s64)(U64_MAX >> 1))
+
+#define container_of(ptr, type, member) \
+	((type *)((char *)(ptr) - offsetof(type, member)))
+#define struct_size(p, member, n) \
+	(sizeof(*(p)) + sizeof(*(p)->member) * (size_t)(n))
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+#define BUILD_BUG_ON(c) _Static_assert(!(c), #c)
+#define WARN_ON(c)	({ bool __c = !!(c); __c; })
+#define WARN_ON_ONCE(c) WARN_ON(c)
+#define BUG_ON(c)	do { if (c) abort(); } while (0)
+#define lockdep_assert_held(l) do { (void)(l); } while (0)
+#define might_sleep()	       do { } while (0)
+
+#define min(a, b) \
+	({ __typeof__(a) __a = (a); __typeof__(b) __b = (b); \
+	   __a < __b ? __a : __b; })
+#define max(a, b) \
+	({ __typeof__(a) __a = (a); __typeof__(b) __b = (b); \
+	   __a > __b ? __a : __b; })
+#define min_t(t, a, b) min((t)(a), (t)(b))
+#define max_t(t, a, b) max((t)(a), (t)(b))
+#define clamp(v, lo, hi) min(max(v, lo), hi)
+#define clamp_t(t, v, lo, hi) min_t(t, max_t(t, v, lo), hi)
+#define swap(a, b) \
+	do { __typeof__(a) __t = (a); (a) = (b); (b) = __t; } while (0)
+
+#define BIT(n)		(1ul << (n))
+#define BIT_ULL(n)	(1ull << (n))
+#define GENMASK(h, l) \
+	(((~0ul) << (l)) & (~0ul >> (BITS_PER_LONG - 1 - (h))))
+#define ALIGN(x, a)	(((x) + (a) - 1) & ~((__typeof__(x))(a) - 1))
+#define IS_ALIGNED(x, a) (((x) & ((__typeof__(x))(a) - 1)) == 0)
+#define DIV_ROUND_UP(n, d) (((n) + (d) - 1) / (d))
+#define is_power_of_2(n) ((n) != 0 && (((n) & ((n) - 1)) == 0))
+#define ilog2(n)	 ((int)(63 - __builtin_clzll(n)))
+#define fls64(n)	 ((n) ? 64 - __builtin_clzll(n) : 0)
+#define upper_32_bits(n) ((u32)(((u64)(n)) >> 32))
+#define lower_32_bits(n) ((u32)(n))
+#define div_u64(a, b)	 ((u64)(a) / (u32)(b))
+#define div64_u64(a, b)	 ((u64)(a) / (u64)(b))
+
+#define PAGE_SHIFT	12
+#define PAGE_SIZE	(1ul << PAGE_SHIFT)
+#define PAGE_MASK	(~(PAGE_SIZE - 1))
+#define PAGE_ALIGN(x)	ALIGN(x, PAGE_SIZE)
+#define offset_in_page(p) ((unsigned long)(p) & ~PAGE_MASK)
+
+#define MAX_ERRNO	 4095
+#define IS_ERR_VALUE(x) \
+	((unsigned long)(x) >= (unsigned long)-MAX_ERRNO)
+#define IS_ERR(p)	 IS_ERR_VALUE((unsigned long)(p))
+#define IS_ERR_OR_NULL(p) (!(p) || IS_ERR(p))
+#define PTR_ERR(p)	 ((long)(p))
+#define ERR_PTR(e)	 ((void *)(long)(e))
+
+//==============================================================================
+// Module
+//==============================================================================
+
+struct module;
+#define THIS_MODULE ((struct module *)0)
+
+#define MODULE_LICENSE(x)
+#define MODULE_AUTHOR(x)
+#define MODULE_DESCRIPTION(x)
+#define MODULE_VERSION(x)
+#define MODULE_DEVICE_TABLE(type, name)
+#define MODULE_PARM_DESC(name, desc)
+#define EXPORT_SYMBOL_GPL(x)
+
+// Module parameters are collected in a section (SimpleAESShim_SetParam)
+typedef struct {
+	const char *name;
+	void *ptr;
+	size_t size;
+} SimpleAESShim_Param;
+
+#define module_param(name, type, perm) \
+	static const SimpleAESShim_Param __param_##name \
+		__attribute__((used, section("simpleaes_params"), \
+			       aligned(sizeof(void *)))) = { \
+		#name, &name, sizeof(name) }
+
+// The translation unit that includes the driver defines these
+#define module_init(fn) int (*const SimpleAESShim_ModuleInit)(void) = fn
+#define module_exit(fn) void (*const SimpleAESShim_ModuleExit)(void) = fn
+
+extern int (*const SimpleAESShim_ModuleInit)(void);
+extern void (*const SimpleAESShim_ModuleExit)(void);
+
+int SimpleAESShim_SetParam(const char *name, unsigned int val);
+
+//==============================================================================
+// Logging
+//==============================================================================
+
+struct device;
+
+void printk(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+void SimpleAESShim_DevLog(const struct device *dev, int level,
+			  const char *fmt, ...)
+	__attribute__((format(printf, 3, 4)));
+
+#define pr_err(fmt, ...)  printk(fmt, ##__VA_ARGS__)
+#define pr_warn(fmt, ...) printk(fmt, ##__VA_ARGS__)
+#define pr_info(fmt, ...) printk(fmt, ##__VA_ARGS__)
+#define pr_debug(fmt, ...) \
+	do { if (0) printk(fmt, ##__VA_ARGS__); } while (0)
+
+#define dev_emerg(dev, fmt, ...) \
+	SimpleAESShim_DevLog(dev, 0, fmt, ##__VA_ARGS__)
+#define dev_alert(dev, fmt, ...) \
+	SimpleAESShim_DevLog(dev, 1, fmt, ##__VA_ARGS__)
+#define dev_crit(dev, fmt, ...) \
+	SimpleAESShim_DevLog(dev, 2, fmt, ##__VA_ARGS__)
+#define dev_err(dev, fmt, ...) \
+	SimpleAESShim_DevLog(dev, 3, fmt, ##__VA_ARGS__)
+#define dev_warn(dev, fmt, ...) \
+	SimpleAESShim_DevLog(dev, 4, fmt, ##__VA_ARGS__)
+#define dev_notice(dev, fmt, ...) \
+	SimpleAESShim_DevLog(dev, 5, fmt, ##__VA_ARGS__)
+#define dev_info(dev, fmt, ...) \
+	SimpleAESShim_DevLog(dev, 6, fmt, ##__VA_ARGS__)
+#define dev_dbg(dev, fmt, ...) \
+	SimpleAESShim_DevLog(dev, 7, fmt, ##__VA_ARGS__)
+#define dev_warn_once		  dev_warn
+#define dev_err_ratelimited	  dev_err
+#define dev_warn_ratelimited	  dev_warn
+
+// Messages up to this level are printed (default: warnings)
+extern int SimpleAESShim_LogLevel;
+
+//==============================================================================
+// Atomics and Bit Operations
+//==============================================================================
+
+// Relaxed atomics rather than volatile accesses, so race detectors see the
+// same marked accesses the kernel memory model does
+#define READ_ONCE(x) __atomic_load_n(&(x), __ATOMIC_RELAXED)
+#define WRITE_ONCE(x, val) __atomic_store_n(&(x), (val), __ATOMIC_RELAXED)
+#define smp_load_acquire(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define smp_store_release(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#define smp_mb()  __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define smp_rmb() __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define smp_wmb() __atomic_thread_fence(__ATOMIC_RELEASE)
+#define dma_rmb() smp_rmb()
+#define dma_wmb() smp_wmb()
+#define barrier() __asm__ __volatile__("" ::: "memory")
+#define xchg(p, v) __atomic_exchange_n(p, v, __ATOMIC_SEQ_CST)
+#define cmpxchg(p, o, n) \
+	({ __typeof__(*(p)) __o = (o); \
+	   __atomic_compare_exchange_n(p, &__o, n, false, __ATOMIC_SEQ_CST, \
+				       __ATOMIC_SEQ_CST); \
+	   __o; })
+
+#if defined(__x86_64__) || defined(__i386__)
+#define cpu_relax() __builtin_ia32_pause()
+#else
+#define cpu_relax() barrier()
+#endif
+
+typedef struct {
+	int counter;
+} atomic_t;
+
+typedef struct {
+	s64 counter;
+} atomic64_t;
+
+#define ATOMIC_INIT(i) { (i) }
+#define ATOMIC64_INIT(i) { (i) }
+
+#define __SHIM_ATOMIC_OPS(pfx, type, T) \
+	static inline T pfx##_read(const type *v) \
+	{ return __atomic_load_n(&v->counter, __ATOMIC_RELAXED); } \
+	static inline void pfx##_set(type *v, T i) \
+	{ __atomic_store_n(&v->counter, i, __ATOMIC_RELAXED); } \
+	static inline void pfx##_add(T i, type *v) \
+	{ __atomic_fetch_add(&v->counter, i, __ATOMIC_RELAXED); } \
+	static inline void pfx##_sub(T i, type *v) \
+	{ __atomic_fetch_sub(&v->counter, i, __ATOMIC_RELAXED); } \
+	static inline void pfx##_inc(type *v) { pfx##_add(1, v); } \
+	static inline void pfx##_dec(type *v) { pfx##_sub(1, v); } \
+	static inline T pfx##_add_return(T i, type *v) \
+	{ return __atomic_add_fetch(&v->counter, i, __ATOMIC_SEQ_CST); } \
+	static inline T pfx##_inc_return(type *v) \
+	{ return pfx##_add_return(1, v); } \
+	static inline T pfx##_dec_return(type *v) \
+	{ return pfx##_add_return(-1, v); } \
+	static inline bool pfx##_dec_and_test(type *v) \
+	{ return pfx##_dec_return(v) == 0; } \
+	static inline T pfx##_xchg(type *v, T i) \
+	{ return __atomic_exchange_n(&v->counter, i, __ATOMIC_SEQ_CST); } \
+	static inline bool pfx##_try_cmpxchg(type *v, T *o, T n) \
+	{ return __atomic_compare_exchange_n(&v->counter, o, n, false, \
+					     __ATOMIC_SEQ_CST, \
+					     __ATOMIC_SEQ_CST); } \
+	static inline T pfx##_cmpxchg(type *v, T o, T n) \
+	{ pfx##_try_cmpxchg(v, &o, n); return o; } \
+	static inline T pfx##_fetch_add_unless(type *v, T a, T u) \
+	{ T c = pfx##_read(v); \
+	  do { if (c == u) break; } while (!pfx##_try_cmpxchg(v, &c, c + a)); \
+	  return c; }
+
+__SHIM_ATOMIC_OPS(atomic, atomic_t, int)
+__SHIM_ATOMIC_OPS(atomic64, atomic64_t, s64)
+
+#define BITS_TO_LONGS(n) DIV_ROUND_UP(n, BITS_PER_LONG)
+#define DECLARE_BITMAP(name, bits) unsigned long name[BITS_TO_LONGS(bits)]
+#define BIT_WORD(n) ((n) / BITS_PER_LONG)
+#define BIT_MASK(n) (1ul << ((n) % BITS_PER_LONG))
+
+static inline void set_bit(long nr, volatile unsigned long *addr)
+{
+	__atomic_fetch_or(addr + BIT_WORD(nr), BIT_MASK(nr), __ATOMIC_RELAXED);
+}
+
+static inline void clear_bit(long nr, volatile unsigned long *addr)
+{
+	__atomic_fetch_and(addr + BIT_WORD(nr), ~BIT_MASK(nr),
+			   __ATOMIC_RELAXED);
+}
+
+static inline bool test_bit(long nr, const volatile unsigned long *addr)
+{
+	return __atomic_load_n(addr + BIT_WORD(nr), __ATOMIC_RELAXED) &
+	       BIT_MASK(nr);
+}
+
+static inline bool test_and_set_bit(long nr, volatile unsigned long *addr)
+{
+	return __atomic_fetch_or(addr + BIT_WORD(nr), BIT_MASK(nr),
+				 __ATOMIC_SEQ_CST) &
+	       BIT_MASK(nr);
+}
+
+static inline bool test_and_clear_bit(long nr, volatile unsigned long *addr)
+{
+	return __atomic_fetch_and(addr + BIT_WORD(nr), ~BIT_MASK(nr),
+				  __ATOMIC_SEQ_CST) &
+	       BIT_MASK(nr);
+}
+
+static inline bool test_and_set_bit_lock(long nr,
+					 volatile unsigned long *addr)
+{
+	return __atomic_fetch_or(addr + BIT_WORD(nr), BIT_MASK(nr),
+				 __ATOMIC_ACQUIRE) &
+	       BIT_MASK(nr);
+}
+
+static inline void clear_bit_unlock(long nr, volatile unsigned long *addr)
+{
+	__atomic_fetch_and(addr + BIT_WORD(nr), ~BIT_MASK(nr),
+			   __ATOMIC_RELEASE);
+}
+
+unsigned long find_next_bit(const unsigned long *addr, unsigned long size,
+			    unsigned long offset);
+unsigned long find_next_zero_bit(const unsigned long *addr,
+				 unsigned long size, unsigned long offset);
+#define find_first_bit(addr, size)	find_next_bit(addr, size, 0)
+#define find_first_zero_bit(addr, size) find_next_zero_bit(addr, size, 0)
+#define for_each_set_bit(bit, addr, size) \
+	for ((bit) = find_first_bit(addr, size); (bit) < (size); \
+	     (bit) = find_next_bit(addr, size, (bit) + 1))
+
+unsigned long *bitmap_zalloc(unsigned int nbits, gfp_t flags);
+void bitmap_free(const unsigned long *bitmap);
+void bitmap_fill(unsigned long *dst, unsigned int nbits);
+void bitmap_zero(unsigned long *dst, unsigned int nbits);
+
+//==============================================================================
+// Lists
+//==============================================================================
+
+struct list_head {
+	struct list_head *next, *prev;
+};
+
+#define LIST_HEAD_INIT(name) { &(name), &(name) }
+#define LIST_HEAD(name) struct list_head name = LIST_HEAD_INIT(name)
+
+static inline void INIT_LIST_HEAD(struct list_head *list)
+{
+	list->next = list;
+	list->prev = list;
+}
+
+static inline void __list_add(struct list_head *entry, struct list_head *prev,
+			      struct list_head *next)
+{
+	next->prev  = entry;
+	entry->next = next;
+	entry->prev = prev;
+	prev->next  = entry;
+}
+
+static inline void list_add(struct list_head *entry, struct list_head *head)
+{
+	__list_add(entry, head, head->next);
+}
+
+static inline void list_add_tail(struct list_head *entry,
+				 struct list_head *head)
+{
+	__list_add(entry, head->prev, head);
+}
+
+static inline void __list_del(struct list_head *entry)
+{
+	entry->next->prev = entry->prev;
+	entry->prev->next = entry->next;
+}
+
+static inline void list_del(struct list_head *entry)
+{
+	__list_del(entry);
+	entry->next = NULL;
+	entry->prev = NULL;
+}
+
+static inline void list_del_init(struct list_head *entry)
+{
+	__list_del(entry);
+	INIT_LIST_HEAD(entry);
+}
+
+static inline void list_move(struct list_head *entry, struct list_head *head)
+{
+	__list_del(entry);
+	list_add(entry, head);
+}
+
+static inline void list_move_tail(struct list_head *entry,
+				  struct list_head *head)
+{
+	__list_del(entry);
+	list_add_tail(entry, head);
+}
+
+static inline bool list_empty(const struct list_head *head)
+{
+	return READ_ONCE(head->next) == head;
+}
+
+static inline bool list_is_singular(const struct list_head *head)
+{
+	return !list_empty(head) && head->next == head->prev;
+}
+
+static inline void list_splice_init(struct list_head *list,
+				    struct list_head *head)
+{
+	if (list_empty(list)) {
+		return;
+	}
+	list->next->prev = head;
+	list->prev->next = head->next;
+	head->next->prev = list->prev;
+	head->next	 = list->next;
+	INIT_LIST_HEAD(list);
+}
+
+#define list_entry(ptr, type, member) container_of(ptr, type, member)
+#define list_first_entry(head, type, member) \
+	list_entry((head)->next, type, member)
+#define list_last_entry(head, type, member) \
+	list_entry((head)->prev, type, member)
+#define list_first_entry_or_null(head, type, member) \
+	(list_empty(head) ? NULL : list_first_entry(head, type, member))
+#define list_next_entry(pos, member) \
+	list_entry((pos)->member.next, __typeof__(*(pos)), member)
+#define list_prev_entry(pos, member) \
+	list_entry((pos)->member.prev, __typeof__(*(pos)), member)
+#define list_for_each_entry(pos, head, member) \
+	for (pos = list_first_entry(head, __typeof__(*pos), member); \
+	     &pos->member != (head); pos = list_next_entry(pos, member))
+#define list_for_each_entry_reverse(pos, head, member) \
+	for (pos = list_last_entry(head, __typeof__(*pos), member); \
+	     &pos->member != (head); pos = list_prev_entry(pos, member))
+#define list_for_each_entry_safe(pos, n, head, member) \
+	for (pos = list_first_entry(head, __typeof__(*pos), member), \
+	     n = list_next_entry(pos, member); \
+	     &pos->member != (head); pos = n, n = list_next_entry(n, member))
+
+//==============================================================================
+// Time
+//==============================================================================
+
+#define HZ	       1000
+#define NSEC_PER_USEC  1000ull
+#define NSEC_PER_MSEC  1000000ull
+#define USEC_PER_MSEC  1000ull
+#define NSEC_PER_SEC   1000000000ull
+#define MAX_SCHEDULE_TIMEOUT LONG_MAX
+
+u64 ktime_get_ns(void);
+#define ktime_get()	     ((ktime_t)ktime_get_ns())
+#define ktime_to_ns(k)	     ((s64)(k))
+#define ktime_sub(a, b)	     ((a) - (b))
+#define ktime_add_ns(k, ns)  ((k) + (ns))
+#define ns_to_ktime(ns)	     ((ktime_t)(ns))
+
+// One jiffy is a millisecond
+#define jiffies ((unsigned long)(ktime_get_ns() / NSEC_PER_MSEC))
+#define msecs_to_jiffies(m)    ((unsigned long)(m))
+#define usecs_to_jiffies(u)    ((unsigned long)DIV_ROUND_UP(u, 1000))
+#define nsecs_to_jiffies(n)    ((unsigned long)((n) / NSEC_PER_MSEC))
+#define jiffies_to_msecs(j)    ((unsigned int)(j))
+#define time_after(a, b)       ((long)((b) - (a)) < 0)
+#define time_before(a, b)      time_after(b, a)
+#define time_after_eq(a, b)    ((long)((a) - (b)) >= 0)
+
+void ndelay(unsigned long ns);
+void udelay(unsigned long us);
+void usleep_range(unsigned long min_us, unsigned long max_us);
+void msleep(unsigned int ms);
+void cond_resched(void);
+#define need_resched() false
+
+//==============================================================================
+// Tasks
+//==============================================================================
+
+struct wait_queue_head;
+struct mm_struct;
+
+struct task_struct {
+	pid_t pid;
+	char comm[16];
+	struct mm_struct *mm;
+
+	// kthread
+	pthread_t thread;
+	int (*threadfn)(void *data);
+	void *data;
+	int result;
+	bool should_stop;
+
+	// wake_up_process() reaches the wait queue the task sleeps on
+	pthread_mutex_t lock;
+	unsigned long wakes;
+	struct wait_queue_head *waiting_on;
+
+	// Between prepare_to_rcuwait() and finish_rcuwait(): the queue that
+	// schedule_timeout() sleeps on, and its state at set_current_state()
+	struct wait_queue_head *rcuwait;
+	unsigned long rcuwait_seq;
+	unsigned long rcuwait_wakes;
+};
+
+struct task_struct *SimpleAESShim_Current(void);
+#define current SimpleAESShim_Current()
+
+#define TASK_RUNNING	     0
+#define TASK_INTERRUPTIBLE   1
+#define TASK_UNINTERRUPTIBLE 2
+
+// No signals are delivered
+#define signal_pending(t)	((void)(t), 0)
+#define fatal_signal_pending(t) ((void)(t), 0)
+
+struct task_struct *kthread_create_on_cpu_shim(int (*threadfn)(void *data),
+					       void *data, const char *name);
+#define kthread_run(fn, data, fmt, ...) \
+	kthread_create_on_cpu_shim(fn, data, fmt)
+int kthread_stop(struct task_struct *task);
+bool kthread_should_stop(void);
+int wake_up_process(struct task_struct *task);
+
+// The host process holds every capability unless a program clears this
+#define CAP_SYS_NICE 23
+extern bool SimpleAESShim_Capable;
+#define capable(cap) ((void)(cap), READ_ONCE(SimpleAESShim_Capable))
+
+//==============================================================================
+// Locks
+//==============================================================================
+
+// Also reachable as struct spinlock_t
+typedef struct spinlock_t {
+	int locked;
+} spinlock_t;
+
+#define __SPIN_LOCK_UNLOCKED(name) { 0 }
+#define DEFINE_SPINLOCK(name) spinlock_t name = __SPIN_LOCK_UNLOCKED(name)
+
+void SimpleAESShim_SpinWait(spinlock_t *lock);
+
+static inline void spin_lock_init(spinlock_t *lock)
+{
+	lock->locked = 0;
+}
+
+static inline void spin_lock(spinlock_t *lock)
+{
+	if (__atomic_exchange_n(&lock->locked, 1, __ATOMIC_ACQUIRE)) {
+		SimpleAESShim_SpinWait(lock);
+	}
+}
+
+static inline bool spin_trylock(spinlock_t *lock)
+{
+	return !__atomic_exchange_n(&lock->locked, 1, __ATOMIC_ACQUIRE);
+}
+
+static inline void spin_unlock(spinlock_t *lock)
+{
+	__atomic_store_n(&lock->locked, 0, __ATOMIC_RELEASE);
+}
+
+// Interrupt handlers are threads here: the lock alone excludes them
+#define spin_lock_irq(l)	       spin_lock(l)
+#define spin_unlock_irq(l)	       spin_unlock(l)
+#define spin_lock_bh(l)		       spin_lock(l)
+#define spin_unlock_bh(l)	       spin_unlock(l)
+#define spin_lock_irqsave(l, flags) \
+	do { (flags) = 0; spin_lock(l); } while (0)
+#define spin_unlock_irqrestore(l, flags) \
+	do { (void)(flags); spin_unlock(l); } while (0)
+#define spin_trylock_irqsave(l, flags) \
+	({ (flags) = 0; spin_trylock(l); })
+
+struct mutex {
+	pthread_mutex_t m;
+};
+
+#define DEFINE_MUTEX(name) struct mutex name = { PTHREAD_MUTEX_INITIALIZER }
+
+static inline void mutex_init(struct mutex *lock)
+{
+	pthread_mutex_init(&lock->m, NULL);
+}
+
+static inline void mutex_destroy(struct mutex *lock)
+{
+	(void)lock;
+}
+
+static inline void mutex_lock(struct mutex *lock)
+{
+	pthread_mutex_lock(&lock->m);
+}
+
+static inline int mutex_lock_interruptible(struct mutex *lock)
+{
+	pthread_mutex_lock(&lock->m);
+	return 0;
+}
+
+static inline bool mutex_trylock(struct mutex *lock)
+{
+	return !pthread_mutex_trylock(&lock->m);
+}
+
+static inline void mutex_unlock(struct mutex *lock)
+{
+	pthread_mutex_unlock(&lock->m);
+}
+
+struct rw_semaphore {
+	pthread_rwlock_t l;
+};
+
+static inline void init_rwsem(struct rw_semaphore *sem)
+{
+	pthread_rwlock_init(&sem->l, NULL);
+}
+
+static inline void down_read(struct rw_semaphore *sem)
+{
+	pthread_rwlock_rdlock(&sem->l);
+}
+
+static inline void up_read(struct rw_semaphore *sem)
+{
+	pthread_rwlock_unlock(&sem->l);
+}
+
+static inline void down_write(struct rw_semaphore *sem)
+{
+	pthread_rwlock_wrlock(&sem->l);
+}
+
+static inline void up_write(struct rw_semaphore *sem)
+{
+	pthread_rwlock_unlock(&sem->l);
+}
+
+//==============================================================================
+// Wait Queues and Completions
+//==============================================================================
+
+// Waiters snapshot seq before testing their condition and sleep only while
+// it is unchanged; wakers bump it. Conditions are evaluated without the
+// queue lock, as in the kernel.
+typedef struct wait_queue_head {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	unsigned long seq;
+	unsigned int waiters;
+} wait_queue_head_t;
+
+typedef struct {
+	unsigned long seq;
+	unsigned long wakes; // current->wakes
+} SimpleAESShim_WaitToken;
+
+void init_waitqueue_head(wait_queue_head_t *wq);
+void SimpleAESShim_WakeUp(wait_queue_head_t *wq);
+SimpleAESShim_WaitToken SimpleAESShim_WaitPrepare(wait_queue_head_t *wq);
+bool SimpleAESShim_WaitSleep(wait_queue_head_t *wq,
+			     SimpleAESShim_WaitToken *TokenPtr, u64 deadline);
+u64 SimpleAESShim_Deadline(unsigned long timeout);
+long SimpleAESShim_Remaining(u64 deadline);
+
+#define wake_up(wq)			   SimpleAESShim_WakeUp(wq)
+#define wake_up_all(wq)			   SimpleAESShim_WakeUp(wq)
+#define wake_up_interruptible(wq)	   SimpleAESShim_WakeUp(wq)
+#define wake_up_interruptible_all(wq)	   SimpleAESShim_WakeUp(wq)
+#define wake_up_poll(wq, mask)		   SimpleAESShim_WakeUp(wq)
+#define wake_up_interruptible_poll(wq, mask) SimpleAESShim_WakeUp(wq)
+
+static inline bool waitqueue_active(wait_queue_head_t *wq)
+{
+	return __atomic_load_n(&wq->waiters, __ATOMIC_SEQ_CST) != 0;
+}
+
+#define wq_has_sleeper(wq) waitqueue_active(wq)
+
+// Timed waits return 0 on timeout, else the jiffies left (at least 1)
+#define ___wait_event(wq_ptr, condition, timed, timeout) \
+	({ \
+		u64 __deadline = \
+			(timed) ? SimpleAESShim_Deadline(timeout) : 0; \
+		long __ret = 0; \
+		for (;;) { \
+			SimpleAESShim_WaitToken __tok = \
+				SimpleAESShim_WaitPrepare(wq_ptr); \
+			if (condition) { \
+				if (timed) \
+					__ret = SimpleAESShim_Remaining( \
+						__deadline); \
+				break; \
+			} \
+			if (!SimpleAESShim_WaitSleep(wq_ptr, &__tok, \
+						     __deadline)) { \
+				__ret = (condition) ? 1 : 0; \
+				break; \
+			} \
+		} \
+		__ret; \
+	})
+
+#define wait_event(wq, condition) \
+	do { ___wait_event(&(wq), condition, 0, 0); } while (0)
+#define wait_event_interruptible(wq, condition) \
+	___wait_event(&(wq), condition, 0, 0)
+#define wait_event_killable(wq, condition) \
+	___wait_event(&(wq), condition, 0, 0)
+#define wait_event_interruptible_exclusive(wq, condition) \
+	___wait_event(&(wq), condition, 0, 0)
+#define wait_event_timeout(wq, condition, timeout) \
+	___wait_event(&(wq), condition, 1, timeout)
+#define wait_event_interruptible_timeout(wq, condition, timeout) \
+	___wait_event(&(wq), condition, 1, timeout)
+#define wait_event_idle_timeout(wq, condition, timeout) \
+	___wait_event(&(wq), condition, 1, timeout)
+
+// wait_var_event() queues are hashed by address
+wait_queue_head_t *__var_waitqueue(void *var);
+#define wait_var_event(var, condition) \
+	do { ___wait_event(__var_waitqueue(var), condition, 0, 0); } while (0)
+#define wake_up_var(var) SimpleAESShim_WakeUp(__var_waitqueue(var))
+
+struct rcuwait {
+	wait_queue_head_t wq;
+};
+
+#define rcuwait_init(w) init_waitqueue_head(&(w)->wq)
+#define rcuwait_wait_event(w, condition, state) \
+	({ ___wait_event(&(w)->wq, condition, 0, 0); 0; })
+#define rcuwait_wake_up(w) ({ SimpleAESShim_WakeUp(&(w)->wq); 1; })
+
+// Open-coded rcuwait waits: set_current_state() snapshots the queue, so a
+// wakeup between the condition test and schedule_timeout() is not lost
+void SimpleAESShim_RcuwaitPrepare(wait_queue_head_t *wq);
+void SimpleAESShim_RcuwaitFinish(void);
+void set_current_state(int state);
+long schedule_timeout(long timeout);
+#define prepare_to_rcuwait(w) SimpleAESShim_RcuwaitPrepare(&(w)->wq)
+#define finish_rcuwait(w)     SimpleAESShim_RcuwaitFinish()
+
+struct completion {
+	unsigned int done;
+	wait_queue_head_t wait;
+};
+
+void init_completion(struct completion *x);
+void reinit_completion(struct completion *x);
+void complete(struct completion *x);
+void complete_all(struct completion *x);
+bool try_wait_for_completion(struct completion *x);
+bool completion_done(struct completion *x);
+#define wait_for_completion(x) \
+	wait_event((x)->wait, try_wait_for_completion(x))
+#define wait_for_completion_timeout(x, timeout) \
+	((unsigned long)wait_event_timeout((x)->wait, \
+					   try_wait_for_completion(x), timeout))
+#define wait_for_completion_interruptible(x) \
+	wait_event_interruptible((x)->wait, try_wait_for_completion(x))
+
+//==============================================================================
+// Memory
+//==============================================================================
+
+#define GFP_KERNEL  0x0u
+#define GFP_ATOMIC  0x1u
+#define GFP_DMA32   0x2u
+#define __GFP_ZERO  0x4u
+#define __GFP_NOWARN 0x8u
+
+void *kmalloc(size_t size, gfp_t flags);
+void *kzalloc(size_t size, gfp_t flags);
+void *kcalloc(size_t n, size_t size, gfp_t flags);
+void *kmalloc_array(size_t n, size_t size, gfp_t flags);
+void *kmemdup(const void *src, size_t len, gfp_t flags);
+void kfree(const void *ptr);
+void kfree_sensitive(const void *ptr);
+#define kvmalloc(size, flags)	       kmalloc(size, flags)
+#define kvzalloc(size, flags)	       kzalloc(size, flags)
+#define kvmalloc_array(n, size, flags) kmalloc_array(n, size, flags)
+#define kvcalloc(n, size, flags)       kcalloc(n, size, flags)
+#define kvfree(ptr)		       kfree(ptr)
+#define memzero_explicit(p, n)	       explicit_bzero(p, n)
+
+// Freed by SimpleAESShim_DevresRelease (device removal)
+void *devm_kzalloc(struct device *dev, size_t size, gfp_t flags);
+void *devm_kcalloc(struct device *dev, size_t n, size_t size, gfp_t flags);
+
+// Per-CPU data: copy N of an allocation sits N strides above copy 0, as with
+// the kernel's per-CPU offsets. A thread can migrate between picking its CPU
+// and updating the copy, so this_cpu_*() are atomic.
+#define SIMPLEAES_SHIM_PERCPU_STRIDE 65536ul
+
+extern unsigned int nr_cpu_ids;
+unsigned int SimpleAESShim_Cpu(void);
+void *SimpleAESShim_AllocPercpu(size_t size);
+void *SimpleAESShim_DevmAllocPercpu(struct device *dev, size_t size);
+#define alloc_percpu(type) \
+	((type __percpu *)SimpleAESShim_AllocPercpu(sizeof(type)))
+#define devm_alloc_percpu(dev, type) \
+	((type __percpu *)SimpleAESShim_DevmAllocPercpu(dev, sizeof(type)))
+#define free_percpu(ptr) kfree(ptr)
+#define per_cpu_ptr(ptr, cpu) \
+	((__typeof__(ptr))((char *)(ptr) + \
+			   (size_t)(cpu) * SIMPLEAES_SHIM_PERCPU_STRIDE))
+#define this_cpu_ptr(ptr) per_cpu_ptr(ptr, SimpleAESShim_Cpu())
+#define this_cpu_add(pcp, val) \
+	((void)__atomic_fetch_add(this_cpu_ptr(&(pcp)), (val), \
+				  __ATOMIC_RELAXED))
+#define this_cpu_inc(pcp) this_cpu_add(pcp, 1)
+#define for_each_possible_cpu(cpu) \
+	for ((cpu) = 0; (cpu) < (int)nr_cpu_ids; (cpu)++)
+
+unsigned long copy_from_user(void *to, const void __user *from,
+			     unsigned long n);
+unsigned long copy_to_user(void __user *to, const void *from,
+			   unsigned long n);
+void *memdup_user(const void __user *src, size_t len);
+#define get_user(x, ptr) ({ (x) = *(ptr); 0; })
+#define put_user(x, ptr) ({ *(ptr) = (x); 0; })
+#define u64_to_user_ptr(x) ((void __user *)(uintptr_t)(x))
+
+// Pages are identified by their address
+struct page;
+struct mm_struct;
+
+#define FOLL_WRITE    0x01
+#define FOLL_LONGTERM 0x10000
+
+int pin_user_pages_fast(unsigned long start, int nr_pages,
+			unsigned int gup_flags, struct page **pages);
+void unpin_user_pages(struct page **pages, unsigned long npages);
+void unpin_user_pages_dirty_lock(struct page **pages, unsigned long npages,
+				 bool make_dirty);
+#define page_to_phys(page)     ((phys_addr_t)(uintptr_t)(page))
+#define page_address(page)     ((void *)(page))
+#define kmap_local_page(page)  page_address(page)
+#define kunmap_local(addr)     ((void)(addr))
+#define virt_to_page(addr) \
+	((struct page *)((uintptr_t)(addr) & PAGE_MASK))
+
+void sort(void *base, size_t num, size_t size,
+	  int (*cmp)(const void *, const void *),
+	  void (*swap_fn)(void *, void *, int));
+
+//==============================================================================
+// Devices, Files and Registration
+//==============================================================================
+
+struct device {
+	const char *init_name;
+	struct device *parent;
+	void *driver_data;
+	dev_t devt;
+	u64 dma_mask;
+	struct list_head devres; // devm_* allocations
+};
+
+static inline void *dev_get_drvdata(const struct device *dev)
+{
+	return dev->driver_data;
+}
+
+static inline void dev_set_drvdata(struct device *dev, void *data)
+{
+	dev->driver_data = data;
+}
+
+static inline const char *dev_name(const struct device *dev)
+{
+	return dev->init_name ? dev->init_name : "(null)";
+}
+
+void SimpleAESShim_DeviceInit(struct device *dev, const char *name);
+void SimpleAESShim_DevresRelease(struct device *dev);
+
+struct attribute {
+	const char *name;
+	unsigned short mode;
+};
+
+struct device_attribute {
+	struct attribute attr;
+	ssize_t (*show)(struct device *dev, struct device_attribute *attr,
+			char *buf);
+	ssize_t (*store)(struct device *dev, struct device_attribute *attr,
+			 const char *buf, size_t count);
+};
+
+struct attribute_group {
+	const char *name;
+	struct attribute **attrs;
+};
+
+#define __ATTR(_name, _mode, _show, _store) \
+	{ .attr = { .name = #_name, .mode = _mode }, \
+	  .show = _show, .store = _store }
+#define DEVICE_ATTR_RO(_name) \
+	struct device_attribute dev_attr_##_name = \
+		__ATTR(_name, 0444, _name##_show, NULL)
+#define DEVICE_ATTR_RW(_name) \
+	struct device_attribute dev_attr_##_name = \
+		__ATTR(_name, 0644, _name##_show, _name##_store)
+#define DEVICE_ATTR_WO(_name) \
+	struct device_attribute dev_attr_##_name = \
+		__ATTR(_name, 0200, NULL, _name##_store)
+#define ATTRIBUTE_GROUPS(_name) \
+	static const struct attribute_group _name##_group = { \
+		.attrs = _name##_attrs, \
+	}; \
+	static const struct attribute_group *_name##_groups[] = { \
+		&_name##_group, NULL, \
+	}
+
+int sysfs_emit(char *buf, const char *fmt, ...)
+	__attribute__((format(printf, 2, 3)));
+int sysfs_emit_at(char *buf, int at, const char *fmt, ...)
+	__attribute__((format(printf, 3, 4)));
+int kstrtouint(const char *s, unsigned int base, unsigned int *res);
+int kstrtoint(const char *s, unsigned int base, int *res);
+int kstrtobool(const char *s, bool *res);
+
+#define MINORBITS 20
+#define MINORMASK ((1u << MINORBITS) - 1)
+#define MAJOR(dev) ((unsigned int)((dev) >> MINORBITS))
+#define MINOR(dev) ((unsigned int)((dev) & MINORMASK))
+#define MKDEV(ma, mi) (((dev_t)(ma) << MINORBITS) | (mi))
+
+struct file;
+struct inode;
+struct vm_area_struct;
+
+// poll_wait() records the queue so that SimpleAES_Host can sleep on it
+typedef struct poll_table_struct {
+	wait_queue_head_t *wq;
+	SimpleAESShim_WaitToken token;
+} poll_table;
+
+#define EPOLLIN	    0x0001u
+#define EPOLLPRI    0x0002u
+#define EPOLLOUT    0x0004u
+#define EPOLLERR    0x0008u
+#define EPOLLHUP    0x0010u
+#define EPOLLRDNORM 0x0040u
+#define EPOLLWRNORM 0x0100u
+
+void poll_wait(struct file *filp, wait_queue_head_t *wq, poll_table *p);
+
+struct file_operations {
+	struct module *owner;
+	loff_t (*llseek)(struct file *filp, loff_t off, int whence);
+	ssize_t (*read)(struct file *filp, char __user *buf, size_t count,
+			loff_t *pos);
+	ssize_t (*write)(struct file *filp, const char __user *buf,
+			 size_t count, loff_t *pos);
+	__poll_t (*poll)(struct file *filp, poll_table *wait);
+	long (*unlocked_ioctl)(struct file *filp, unsigned int cmd,
+			       unsigned long arg);
+	long (*compat_ioctl)(struct file *filp, unsigned int cmd,
+			     unsigned long arg);
+	int (*mmap)(struct file *filp, struct vm_area_struct *vma);
+	int (*open)(struct inode *inode, struct file *filp);
+	int (*release)(struct inode *inode, struct file *filp);
+};
+
+struct cdev {
+	struct module *owner;
+	const struct file_operations *ops;
+	dev_t dev;
+	unsigned int count;
+};
+
+struct inode {
+	dev_t i_rdev;
+	struct cdev *i_cdev;
+	void *i_private;
+};
+
+#ifndef O_NONBLOCK
+#define O_NONBLOCK 04000
+#endif
+
+struct file {
+	const struct file_operations *f_op;
+	struct inode *f_inode;
+	unsigned int f_flags;
+	void *private_data;
+};
+
+static inline unsigned int iminor(const struct inode *inode)
+{
+	return MINOR(inode->i_rdev);
+}
+
+#define VM_DONTEXPAND 0x00040000ul
+#define VM_DONTDUMP   0x04000000ul
+
+// host_addr is where dma_mmap_coherent() "mapped" the region
+struct vm_area_struct {
+	unsigned long vm_start;
+	unsigned long vm_end;
+	unsigned long vm_pgoff;
+	unsigned long vm_flags;
+	void *vm_private_data;
+	void *host_addr;
+};
+
+void cdev_init(struct cdev *cdev, const struct file_operations *fops);
+int cdev_add(struct cdev *cdev, dev_t dev, unsigned int count);
+void cdev_del(struct cdev *cdev);
+struct cdev *SimpleAESShim_CdevLookup(dev_t dev);
+int alloc_chrdev_region(dev_t *dev, unsigned int baseminor,
+			unsigned int count, const char *name);
+void unregister_chrdev_region(dev_t dev, unsigned int count);
+
+struct class {
+	const char *name;
+};
+
+struct class *SimpleAESShim_ClassCreate(const char *name);
+#define class_create(owner, name) SimpleAESShim_ClassCreate(name)
+void class_destroy(struct class *cls);
+struct device *device_create(struct class *cls, struct device *parent,
+			     dev_t devt, void *drvdata, const char *fmt, ...)
+	__attribute__((format(printf, 5, 6)));
+void device_destroy(struct class *cls, dev_t devt);
+
+// debugfs files are recorded by path ("simpleaes/simpleaes0/stats") and read
+// through their file_operations by SimpleAESShim_DebugfsRead
+struct dentry;
+
+struct dentry *debugfs_create_dir(const char *name, struct dentry *parent);
+struct dentry *debugfs_create_file(const char *name, umode_t mode,
+				   struct dentry *parent, void *data,
+				   const struct file_operations *fops);
+void debugfs_remove_recursive(struct dentry *dentry);
+ssize_t SimpleAESShim_DebugfsRead(const char *path, char *buf, size_t len);
+
+// seq_file output is built whole on the first read, growing the buffer
+// until show() fits
+struct seq_file {
+	char *buf;
+	size_t size;
+	size_t count;
+	int (*show)(struct seq_file *m, void *v);
+	void *private;
+};
+
+void seq_printf(struct seq_file *m, const char *fmt, ...)
+	__attribute__((format(printf, 2, 3)));
+void seq_puts(struct seq_file *m, const char *s);
+void seq_putc(struct seq_file *m, char c);
+int single_open(struct file *filp, int (*show)(struct seq_file *, void *),
+		void *data);
+int single_release(struct inode *inode, struct file *filp);
+ssize_t seq_read(struct file *filp, char __user *buf, size_t count,
+		 loff_t *pos);
+loff_t seq_lseek(struct file *filp, loff_t off, int whence);
+
+#define DEFINE_SHOW_ATTRIBUTE(__name) \
+	static int __name##_open(struct inode *inode, struct file *filp) \
+	{ \
+		return single_open(filp, __name##_show, inode->i_private); \
+	} \
+	static const struct file_operations __name##_fops = { \
+		.owner	 = THIS_MODULE, \
+		.open	 = __name##_open, \
+		.read	 = seq_read, \
+		.llseek	 = seq_lseek, \
+		.release = single_release, \
+	}
+
+struct ida {
+	spinlock_t lock;
+	DECLARE_BITMAP(ids, 1024);
+};
+
+#define DEFINE_IDA(name) struct ida name = { 0 }
+
+int ida_alloc_range(struct ida *ida, unsigned int min, unsigned int max,
+		    gfp_t gfp);
+#define ida_alloc_max(ida, max, gfp) ida_alloc_range(ida, 0, max, gfp)
+#define ida_alloc(ida, gfp)	     ida_alloc_range(ida, 0, 1023, gfp)
+void ida_free(struct ida *ida, unsigned int id);
+void ida_destroy(struct ida *ida);
+
+// Callers serialize, as with the kernel's IDR
+struct idr {
+	void **ptrs;
+	unsigned int size;
+};
+
+void idr_init(struct idr *idr);
+int idr_alloc(struct idr *idr, void *ptr, int start, int end, gfp_t gfp);
+void *idr_find(const struct idr *idr, unsigned long id);
+void *idr_remove(struct idr *idr, unsigned long id);
+void *idr_get_next(const struct idr *idr, int *nextid);
+void idr_destroy(struct idr *idr);
+#define idr_for_each_entry(idr, entry, id) \
+	for ((id) = 0; ((entry) = idr_get_next(idr, &(id))) != NULL; (id)++)
+
+// eventfd contexts wrap a duplicate of the process's eventfd
+struct eventfd_ctx;
+struct eventfd_ctx *eventfd_ctx_fdget(int fd);
+void eventfd_ctx_put(struct eventfd_ctx *ctx);
+void eventfd_signal(struct eventfd_ctx *ctx, u64 n);
+
+//==============================================================================
+// Platform Devices, Clocks and Interrupts
+//==============================================================================
+
+// A device's clock. Gating it (enable count back to 0) calls gate, which
+// resets the device model behind it. The next fail_count enables fail.
+struct clock {
+	int rate;
+	unsigned int enable_count;
+	unsigned int fail_count;
+	void (*gate)(void *ctx, bool enabled);
+	void *ctx;
+};
+
+// compatible, irq, regs and clk stand in for the device tree node
+struct platform_device {
+	const char *name;
+	int id;
+	struct device dev;
+	const char *compatible;
+	int irq;
+	void __iomem *regs;
+	struct clock clk;
+};
+
+struct of_device_id {
+	char name[32];
+	char type[32];
+	char compatible[128];
+	const void *data;
+};
+
+struct platform_driver {
+	int (*probe)(struct platform_device *pdev);
+	int (*remove)(struct platform_device *pdev);
+	struct {
+		const char *name;
+		const struct of_device_id *of_match_table;
+		const struct attribute_group **dev_groups;
+	} driver;
+};
+
+int platform_driver_register(struct platform_driver *drv);
+void platform_driver_unregister(struct platform_driver *drv);
+extern struct platform_driver *SimpleAESShim_PlatformDriver;
+
+static inline void *platform_get_drvdata(const struct platform_device *pdev)
+{
+	return dev_get_drvdata(&pdev->dev);
+}
+
+static inline void platform_set_drvdata(struct platform_device *pdev,
+					void *data)
+{
+	dev_set_drvdata(&pdev->dev, data);
+}
+
+const void *of_device_get_match_data(const struct device *dev);
+int platform_get_irq_byname(struct platform_device *pdev, const char *name);
+void __iomem *
+devm_platform_ioremap_resource_byname(struct platform_device *pdev,
+				      const char *name);
+
+struct clock *SimpleAESShim_ClkGet(struct platform_device *pdev,
+				   const char *name);
+int clk_prepare_enable(struct clock *clk);
+void clk_disable_unprepare(struct clock *clk);
+#define devm_clk_get_byname(pdev, name) SimpleAESShim_ClkGet(pdev, name)
+
+typedef enum { IRQ_NONE, IRQ_HANDLED, IRQ_WAKE_THREAD } irqreturn_t;
+typedef irqreturn_t (*irq_handler_t)(int irq, void *dev_id);
+
+#define IRQF_SHARED  0x00000080ul
+#define IRQF_ONESHOT 0x00002000ul
+
+int request_threaded_irq(unsigned int irq, irq_handler_t handler,
+			 irq_handler_t thread_fn, unsigned long flags,
+			 const char *name, void *dev_id);
+#define request_irq(irq, handler, flags, name, dev_id) \
+	request_threaded_irq(irq, handler, NULL, flags, name, dev_id)
+void free_irq(unsigned int irq, void *dev_id);
+void synchronize_irq(unsigned int irq);
+void disable_irq(unsigned int irq);
+void enable_irq(unsigned int irq);
+
+// Drives an interrupt line (level-triggered)
+void SimpleAESShim_SetIrqLevel(unsigned int irq, bool level);
+
+//==============================================================================
+// MMIO and DMA
+//==============================================================================
+
+typedef u32 (*SimpleAESShim_MmioReadFn)(void *ctx, u32 offset);
+typedef void (*SimpleAESShim_MmioWriteFn)(void *ctx, u32 offset, u32 val);
+
+void __iomem *SimpleAESShim_MapMmio(size_t size,
+				    SimpleAESShim_MmioReadFn read_fn,
+				    SimpleAESShim_MmioWriteFn write_fn,
+				    void *ctx);
+void SimpleAESShim_UnmapMmio(void __iomem *base);
+
+u32 ioread32(const void __iomem *addr);
+void iowrite32(u32 val, void __iomem *addr);
+#define readl(addr)		ioread32(addr)
+#define writel(val, addr)	iowrite32(val, addr)
+#define readl_relaxed(addr)	ioread32(addr)
+#define writel_relaxed(val, addr) iowrite32(val, addr)
+
+enum dma_data_direction {
+	DMA_BIDIRECTIONAL = 0,
+	DMA_TO_DEVICE	  = 1,
+	DMA_FROM_DEVICE	  = 2,
+	DMA_NONE	  = 3,
+};
+
+#define DMA_BIT_MASK(n) (((n) == 64) ? ~0ull : ((1ull << (n)) - 1))
+#define DMA_MAPPING_ERROR (~(dma_addr_t)0)
+
+int dma_set_mask_and_coherent(struct device *dev, u64 mask);
+u64 dma_get_mask(struct device *dev);
+void *dma_alloc_coherent(struct device *dev, size_t size,
+			 dma_addr_t *dma_handle, gfp_t gfp);
+void dma_free_coherent(struct device *dev, size_t size, void *cpu_addr,
+		       dma_addr_t dma_handle);
+int dma_mmap_coherent(struct device *dev, struct vm_area_struct *vma,
+		      void *cpu_addr, dma_addr_t dma_addr, size_t size);
+dma_addr_t dma_map_single(struct device *dev, void *ptr, size_t size,
+			  enum dma_data_direction dir);
+void dma_unmap_single(struct device *dev, dma_addr_t addr, size_t size,
+		      enum dma_data_direction dir);
+
+// Coherent pools of small fixed-size blocks, carved out of coherent pages
+struct dma_pool;
+
+struct dma_pool *dma_pool_create(const char *name, struct device *dev,
+				 size_t size, size_t align, size_t boundary);
+void dma_pool_destroy(struct dma_pool *pool);
+void *dma_pool_alloc(struct dma_pool *pool, gfp_t mem_flags,
+		     dma_addr_t *handle);
+void *dma_pool_zalloc(struct dma_pool *pool, gfp_t mem_flags,
+		      dma_addr_t *handle);
+void dma_pool_free(struct dma_pool *pool, void *vaddr, dma_addr_t addr);
+#define dma_mapping_error(dev, addr) ((addr) == DMA_MAPPING_ERROR)
+#define dev_is_dma_coherent(dev) true
+
+// The DMA window is an IOMMU for every device
+#define device_iommu_mapped(dev) true
+
+// Host memory behind [addr, addr + len), or NULL if it is not mapped
+void *SimpleAESShim_DmaTranslate(u32 addr, size_t len);
+
+static inline dma_addr_t dma_map_page(struct device *dev, struct page *page,
+				      size_t offset, size_t size,
+				      enum dma_data_direction dir)
+{
+	return dma_map_single(dev, (char *)page_address(page) + offset, size,
+			      dir);
+}
+
+static inline void dma_unmap_page(struct device *dev, dma_addr_t addr,
+				  size_t size, enum dma_data_direction dir)
+{
+	dma_unmap_single(dev, addr, size, dir);
+}
+
+// Memory is coherent, so a sync is only a barrier. Like the DMA API debug
+// checks, it complains about a range that no single mapping covers.
+static inline void SimpleAESShim_DmaSync(const char *name, struct device *dev,
+					 dma_addr_t addr, size_t size,
+					 enum dma_data_direction dir)
+{
+	if (!dev || dir == DMA_NONE || addr > U32_MAX ||
+	    !SimpleAESShim_DmaTranslate((u32)addr, size)) {
+		fprintf(stderr, "%s: %#llx+%zu is not mapped\n", name,
+			(unsigned long long)addr, size);
+	}
+	smp_mb();
+}
+
+static inline void dma_sync_single_for_cpu(struct device *dev,
+					   dma_addr_t addr, size_t size,
+					   enum dma_data_direction dir)
+{
+	SimpleAESShim_DmaSync(__func__, dev, addr, size, dir);
+}
+
+static inline void dma_sync_single_for_device(struct device *dev,
+					      dma_addr_t addr, size_t size,
+					      enum dma_data_direction dir)
+{
+	SimpleAESShim_DmaSync(__func__, dev, addr, size, dir);
+}
+
+static inline void dma_sync_single_range_for_cpu(struct device *dev,
+						 dma_addr_t addr,
+						 unsigned long offset,
+						 size_t size,
+						 enum dma_data_direction dir)
+{
+	SimpleAESShim_DmaSync(__func__, dev, addr + offset, size, dir);
+}
+
+static inline void dma_sync_single_range_for_device(struct device *dev,
+						    dma_addr_t addr,
+						    unsigned long offset,
+						    size_t size,
+						    enum dma_data_direction dir)
+{
+	SimpleAESShim_DmaSync(__func__, dev, addr + offset, size, dir);
+}
+
+// Scatterlists hold page addresses: sg_virt() is the buffer itself
+struct scatterlist {
+	unsigned long page_link; // Page address | SG_CHAIN | SG_END
+	unsigned int offset;
+	unsigned int length;
+	dma_addr_t dma_address;
+	unsigned int dma_length;
+};
+
+#define SG_CHAIN 0x01ul
+#define SG_END	 0x02ul
+
+struct sg_table {
+	struct scatterlist *sgl;
+	unsigned int nents;
+	unsigned int orig_nents;
+};
+
+#define sg_dma_address(sg) ((sg)->dma_address)
+#define sg_dma_len(sg)	   ((sg)->dma_length)
+#define sg_is_last(sg)	   ((sg)->page_link & SG_END)
+#define sg_page(sg) ((struct page *)((sg)->page_link & ~(SG_CHAIN | SG_END)))
+#define sg_virt(sg) ((void *)((char *)sg_page(sg) + (sg)->offset))
+
+void sg_init_table(struct scatterlist *sgl, unsigned int nents);
+void sg_set_buf(struct scatterlist *sg, const void *buf, unsigned int len);
+void sg_init_one(struct scatterlist *sg, const void *buf, unsigned int len);
+struct scatterlist *sg_next(struct scatterlist *sg);
+int sg_nents(struct scatterlist *sg);
+size_t sg_pcopy_to_buffer(struct scatterlist *sgl, unsigned int nents,
+			  void *buf, size_t buflen, off_t skip);
+size_t sg_pcopy_from_buffer(struct scatterlist *sgl, unsigned int nents,
+			    const void *buf, size_t buflen, off_t skip);
+int sg_alloc_table_from_pages(struct sg_table *sgt, struct page **pages,
+			      unsigned int n_pages, unsigned int offset,
+			      unsigned long size, gfp_t gfp);
+void sg_free_table(struct sg_table *sgt);
+int dma_map_sgtable(struct device *dev, struct sg_table *sgt,
+		    enum dma_data_direction dir, unsigned long attrs);
+void dma_unmap_sgtable(struct device *dev, struct sg_table *sgt,
+		       enum dma_data_direction dir, unsigned long attrs);
+#define for_each_sgtable_dma_sg(sgt, sg, i) \
+	for ((i) = 0, (sg) = (sgt)->sgl; (i) < (sgt)->nents; \
+	     (i)++, (sg) = sg_next(sg))
+
+//==============================================================================
+// Workqueues
+//==============================================================================
+
+struct work_struct;
+typedef void (*work_func_t)(struct work_struct *work);
+
+struct work_struct {
+	struct list_head entry;
+	work_func_t func;
+	unsigned long pending;
+};
+
+#define INIT_WORK(w, f) \
+	do { INIT_LIST_HEAD(&(w)->entry); (w)->func = (f); \
+	     (w)->pending = 0; } while (0)
+
+#define WQ_UNBOUND	0x0002u
+#define WQ_HIGHPRI	0x0010u
+#define WQ_MEM_RECLAIM	0x0008u
+
+struct workqueue_struct;
+struct workqueue_struct *alloc_workqueue(const char *fmt, unsigned int flags,
+					 int max_active, ...);
+#define alloc_ordered_workqueue(fmt, flags, ...) \
+	alloc_workqueue(fmt, flags, 1, ##__VA_ARGS__)
+bool queue_work(struct workqueue_struct *wq, struct work_struct *work);
+void flush_workqueue(struct workqueue_struct *wq);
+void destroy_workqueue(struct workqueue_struct *wq);
+
+//==============================================================================
+// High-Resolution Timers
+//==============================================================================
+
+// Callbacks run one at a time on a shared timer thread, standing in for
+// hard interrupt context; HRTIMER_RESTART is not supported
+enum hrtimer_restart {
+	HRTIMER_NORESTART,
+	HRTIMER_RESTART,
+};
+
+enum hrtimer_mode {
+	HRTIMER_MODE_ABS = 0x0,
+	HRTIMER_MODE_REL = 0x1,
+};
+
+struct hrtimer {
+	struct list_head node;
+	ktime_t expires;
+	enum hrtimer_restart (*function)(struct hrtimer *timer);
+};
+
+void hrtimer_init(struct hrtimer *timer, clockid_t clock_id,
+		  enum hrtimer_mode mode);
+void hrtimer_start(struct hrtimer *timer, ktime_t tim,
+		   enum hrtimer_mode mode);
+int hrtimer_try_to_cancel(struct hrtimer *timer);
+int hrtimer_cancel(struct hrtimer *timer);
+
+//==============================================================================
+// Crypto
+//==============================================================================
+
+#define AES_BLOCK_SIZE	 16
+#define AES_KEYSIZE_128	 16
+#define AES_KEYSIZE_192	 24
+#define AES_KEYSIZE_256	 32
+#define AES_MIN_KEY_SIZE 16
+#define AES_MAX_KEY_SIZE 32
+
+struct crypto_aes_ctx {
+	u32 key_enc[60];
+	u32 key_dec[60];
+	u32 key_length;
+};
+
+int aes_check_keylen(unsigned int keylen);
+int aes_expandkey(struct crypto_aes_ctx *ctx, const u8 *in_key,
+		  unsigned int key_len);
+void aes_encrypt(const struct crypto_aes_ctx *ctx, u8 *out, const u8 *in);
+void aes_decrypt(const struct crypto_aes_ctx *ctx, u8 *out, const u8 *in);
+
+void crypto_xor(u8 *dst, const u8 *src, unsigned int size);
+void crypto_xor_cpy(u8 *dst, const u8 *src1, const u8 *src2,
+		    unsigned int size);
+void crypto_inc(u8 *a, unsigned int size);
+void gf128mul_x_ble(le128 *r, const le128 *x);
+
+#define CRYPTO_MAX_ALG_NAME	    128
+#define CRYPTO_ALG_ASYNC	    0x00000080u
+#define CRYPTO_ALG_NEED_FALLBACK    0x00000100u
+#define CRYPTO_ALG_KERN_DRIVER_ONLY 0x00001000u
+#define CRYPTO_ALG_ALLOCATES_MEMORY 0x00010000u
+#define CRYPTO_TFM_REQ_MASK	    0x000fff00u
+#define CRYPTO_TFM_REQ_MAY_SLEEP    0x00000200u
+#define CRYPTO_TFM_REQ_MAY_BACKLOG  0x00000400u
+
+struct crypto_alg {
+	struct list_head cra_list;
+	u32 cra_flags;
+	unsigned int cra_blocksize;
+	unsigned int cra_ctxsize;
+	unsigned int cra_alignmask;
+	int cra_priority;
+	char cra_name[CRYPTO_MAX_ALG_NAME];
+	char cra_driver_name[CRYPTO_MAX_ALG_NAME];
+	struct module *cra_module;
+};
+
+struct crypto_tfm {
+	u32 crt_flags;
+	struct crypto_alg *__crt_alg;
+	void *__crt_ctx[] __aligned(16);
+};
+
+typedef void (*crypto_completion_t)(void *data, int err);
+
+struct crypto_async_request {
+	struct list_head list;
+	crypto_completion_t complete;
+	void *data;
+	struct crypto_tfm *tfm;
+	u32 flags;
+};
+
+struct crypto_skcipher {
+	unsigned int reqsize;
+	struct crypto_tfm base;
+};
+
+struct skcipher_request {
+	unsigned int cryptlen;
+	u8 *iv;
+	struct scatterlist *src;
+	struct scatterlist *dst;
+	struct crypto_async_request base;
+	void *__ctx[] __aligned(16);
+};
+
+struct skcipher_alg {
+	int (*setkey)(struct crypto_skcipher *tfm, const u8 *key,
+		      unsigned int keylen);
+	int (*encrypt)(struct skcipher_request *req);
+	int (*decrypt)(struct skcipher_request *req);
+	int (*init)(struct crypto_skcipher *tfm);
+	void (*exit)(struct crypto_skcipher *tfm);
+	unsigned int min_keysize;
+	unsigned int max_keysize;
+	unsigned int ivsize;
+	unsigned int chunksize;
+	unsigned int walksize;
+	struct crypto_alg base;
+};
+
+int crypto_register_skcipher(struct skcipher_alg *alg);
+void crypto_unregister_skcipher(struct skcipher_alg *alg);
+struct crypto_skcipher *crypto_alloc_skcipher(const char *alg_name, u32 type,
+					      u32 mask);
+void crypto_free_skcipher(struct crypto_skcipher *tfm);
+int crypto_skcipher_setkey(struct crypto_skcipher *tfm, const u8 *key,
+			   unsigned int keylen);
+int crypto_skcipher_encrypt(struct skcipher_request *req);
+int crypto_skcipher_decrypt(struct skcipher_request *req);
+
+static inline struct crypto_tfm *
+crypto_skcipher_tfm(struct crypto_skcipher *tfm)
+{
+	return &tfm->base;
+}
+
+static inline void *crypto_tfm_ctx(struct crypto_tfm *tfm)
+{
+	return tfm->__crt_ctx;
+}
+
+static inline void *crypto_skcipher_ctx(struct crypto_skcipher *tfm)
+{
+	return crypto_tfm_ctx(&tfm->base);
+}
+
+static inline const char *crypto_tfm_alg_name(struct crypto_tfm *tfm)
+{
+	return tfm->__crt_alg->cra_name;
+}
+
+static inline struct skcipher_alg *
+crypto_skcipher_alg(struct crypto_skcipher *tfm)
+{
+	return container_of(tfm->base.__crt_alg, struct skcipher_alg, base);
+}
+
+static inline unsigned int crypto_skcipher_reqsize(struct crypto_skcipher *tfm)
+{
+	return tfm->reqsize;
+}
+
+static inline void crypto_skcipher_set_reqsize(struct crypto_skcipher *tfm,
+					       unsigned int reqsize)
+{
+	tfm->reqsize = reqsize;
+}
+
+static inline u32 crypto_skcipher_get_flags(struct crypto_skcipher *tfm)
+{
+	return tfm->base.crt_flags;
+}
+
+static inline void crypto_skcipher_set_flags(struct crypto_skcipher *tfm,
+					     u32 flags)
+{
+	tfm->base.crt_flags |= flags;
+}
+
+static inline void crypto_skcipher_clear_flags(struct crypto_skcipher *tfm,
+					       u32 flags)
+{
+	tfm->base.crt_flags &= ~flags;
+}
+
+static inline struct crypto_skcipher *
+crypto_skcipher_reqtfm(struct skcipher_request *req)
+{
+	return container_of(req->base.tfm, struct crypto_skcipher, base);
+}
+
+static inline void *skcipher_request_ctx(struct skcipher_request *req)
+{
+	return req->__ctx;
+}
+
+static inline void skcipher_request_set_tfm(struct skcipher_request *req,
+					    struct crypto_skcipher *tfm)
+{
+	req->base.tfm = crypto_skcipher_tfm(tfm);
+}
+
+struct skcipher_request *skcipher_request_alloc(struct crypto_skcipher *tfm,
+						gfp_t gfp);
+void skcipher_request_free(struct skcipher_request *req);
+
+static inline void
+skcipher_request_set_callback(struct skcipher_request *req, u32 flags,
+			      crypto_completion_t compl, void *data)
+{
+	req->base.complete = compl;
+	req->base.data	   = data;
+	req->base.flags	   = flags;
+}
+
+static inline void skcipher_request_set_crypt(struct skcipher_request *req,
+					      struct scatterlist *src,
+					      struct scatterlist *dst,
+					      unsigned int cryptlen, void *iv)
+{
+	req->src      = src;
+	req->dst      = dst;
+	req->cryptlen = cryptlen;
+	req->iv	      = iv;
+}
+
+// Waiting for a request that may complete asynchronously
+struct crypto_wait {
+	struct completion completion;
+	int err;
+};
+
+void crypto_init_wait(struct crypto_wait *wait);
+void crypto_req_done(void *data, int err);
+int crypto_wait_req(int err, struct crypto_wait *wait);
+
+// crypto_engine (pre-6.6 API: the tfm context starts with the ops)
+struct crypto_engine;
+
+struct crypto_engine_op {
+	int (*prepare_request)(struct crypto_engine *engine, void *areq);
+	int (*unprepare_request)(struct crypto_engine *engine, void *areq);
+	int (*do_one_request)(struct crypto_engine *engine, void *areq);
+};
+
+struct crypto_engine_ctx {
+	struct crypto_engine_op op;
+};
+
+struct crypto_engine *crypto_engine_alloc_init(struct device *dev, bool rt);
+int crypto_engine_start(struct crypto_engine *engine);
+int crypto_engine_exit(struct crypto_engine *engine);
+int crypto_transfer_skcipher_request_to_engine(struct crypto_engine *engine,
+					       struct skcipher_request *req);
+void crypto_finalize_skcipher_request(struct crypto_engine *engine,
+				      struct skcipher_request *req, int err);
+
+//==============================================================================
+// Tracepoints
+//==============================================================================
+
+// Events are never enabled: TRACE_EVENT() and DEFINE_EVENT() only declare
+// empty trace_<name>() and trace_<name>_enabled() stubs
+#define TP_PROTO(args...) args
+#define TP_ARGS(args...)  args
+#define TRACE_EVENT(name, proto, args, tstruct, assign, print) \
+	static inline void trace_##name(proto) \
+	{ \
+	} \
+	static inline bool trace_##name##_enabled(void) \
+	{ \
+		return false; \
+	}
+#define DECLARE_EVENT_CLASS(name, proto, args, tstruct, assign, print)
+#define DEFINE_EVENT(template, name, proto, args) \
+	TRACE_EVENT(name, PARAMS(proto), PARAMS(args), , , )
+#define PARAMS(args...) args
+
+//==============================================================================
+// IOCTL Numbers
+//==============================================================================
+
+// The Linux encoding from <sys/ioctl.h>, so a program that also issues real
+// ioctl(2) calls on /dev/simpleaes computes the driver's numbers
+#define __IOWR(type, nr, T) _IOWR(type, nr, T)
+
+#endif // ORG_SIMPLE_SIMPLEAES_SHIM_H
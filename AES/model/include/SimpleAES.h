@@ -0,0 +1 @@
+#include "../../SimpleAES_Linux.h"
@@ -0,0 +1 @@
+#include "../../../SimpleAES_Shim.h"
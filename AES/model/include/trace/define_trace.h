@@ -0,0 +1 @@
+// Tracepoints are stubs (SimpleAES_Shim.h): nothing to define
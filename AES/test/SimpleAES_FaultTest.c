@@ -0,0 +1,350 @@
+// simpleaes-faulttest: engine hang and clock-loss recovery test for the
+// SimpleAES driver.
+//
+// Loads the driver in-process against one SimpleAESModel engine (see
+// model/SimpleAES_Host.h), once with the ver2 register interface and once
+// with the ver3 descriptor ring, and injects faults:
+//
+//	requeue     one hung operation is reset and rerun
+//	retries     an operation still hung after op_retries resets fails
+//	batch       hung blocks of a pipelined or ring batch are rerun, or
+//		    fail alone once out of retries
+//	clock       the clock cannot be re-enabled after a reset in the
+//		    middle of a batch: the blocks in flight fail, the rest
+//		    run in software. Run once more with the file in poll
+//		    mode, where the batch runs block by block on pages
+//		    mapped for DMA (zero-copy).
+//	faulted     every later request runs in software
+//	fixed       ops on registered buffers that start inside a page, on
+//		    the engine before the clock scenario and in software
+//		    after it
+//
+// Throughout, the engine must never see a register access while its clock
+// is off (SimpleAESModel_Stats.gated_io).
+//
+// Build and run (from AES/):
+//
+//	cc -O2 -pthread -I model/include -I model test/SimpleAES_FaultTest.c
+//	   model/SimpleAES_Host.c model/SimpleAES_Shim.c
+//	   model/SimpleAES_Model.c -o simpleaes-faulttest
+//	./simpleaes-faulttest
+//
+// Prints one line per failed check and exits non-zero if there was any.
+
+#include <stdio.h>
+
+#include "SimpleAES_Host.h"
+
+//==============================================================================
+// Constant Definitions
+//==============================================================================
+
+// Requests hang for this long before the driver resets the engine
+#define SIMPLEAES_FAULTTEST_TIMEOUT_US 2000
+
+#define SIMPLEAES_FAULTTEST_RETRIES 2
+
+// Batches outgrow one ring (32 descriptors of 8 blocks): a ver3 engine lost
+// in the middle of one fails the whole ring, and the rest is left
+#define SIMPLEAES_FAULTTEST_BLOCKS 512
+
+// Registered buffers start this far into their first page
+#define SIMPLEAES_FAULTTEST_FIXED_IN  48
+#define SIMPLEAES_FAULTTEST_FIXED_OUT 80
+#define SIMPLEAES_FAULTTEST_FIXED_BLOCKS \
+	(SIMPLEAES_FAULTTEST_BLOCKS - SIMPLEAES_FAULTTEST_FIXED_OUT / 16)
+
+//==============================================================================
+// Variable Definitions
+//==============================================================================
+
+// FIPS-197 C.1 (AES-128)
+static const u8 simpleaes_faulttest_key[16] = {
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+	0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+};
+static const u8 simpleaes_faulttest_plain[16] = {
+	0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+	0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff
+};
+static const u8 simpleaes_faulttest_cipher[16] = {
+	0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+	0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a
+};
+
+// Request buffers
+static u8 simpleaes_faulttest_keybuf[ORG_SIMPLE_KEY_SIZE];
+static u8 simpleaes_faulttest_in[SIMPLEAES_FAULTTEST_BLOCKS *
+				 ORG_SIMPLE_BLOCK_SIZE]
+	__attribute__((aligned(4096)));
+static u8 simpleaes_faulttest_out[SIMPLEAES_FAULTTEST_BLOCKS *
+				  ORG_SIMPLE_BLOCK_SIZE]
+	__attribute__((aligned(4096)));
+static ORG_SIMPLE_Error simpleaes_faulttest_errs[SIMPLEAES_FAULTTEST_BLOCKS];
+
+static const char *simpleaes_faulttest_hw;
+static unsigned int simpleaes_faulttest_failures;
+
+//==============================================================================
+// Function Definitions
+//==============================================================================
+
+#define SIMPLEAES_FAULTTEST_CHECK(cond, ...) \
+	SimpleAESFaultTest_Check(!!(cond), #cond, __VA_ARGS__)
+
+static void SimpleAESFaultTest_Check(bool ok, const char *cond,
+				     const char *scenario, long ret)
+{
+	if (!ok) {
+		printf("FAIL %s/%s: %s (ret %ld)\n", simpleaes_faulttest_hw,
+		       scenario, cond, ret);
+		simpleaes_faulttest_failures++;
+	}
+}
+
+static SimpleAESModel_Stats SimpleAESFaultTest_Stats(void)
+{
+	SimpleAESModel_Stats stats;
+
+	SimpleAESModel_GetStats(SimpleAESHost_Model(0), &stats);
+	return stats;
+}
+
+static bool SimpleAESFaultTest_Faulted(void)
+{
+	char buf[4096];
+
+	return SimpleAESHost_ReadAttr(0, "engine_faulted", buf) > 0 &&
+	       buf[0] == '1';
+}
+
+static long SimpleAESFaultTest_Encrypt(SimpleAESHost_File *FilePtr)
+{
+	IOCTL_Data data = { simpleaes_faulttest_keybuf,
+			    simpleaes_faulttest_in, simpleaes_faulttest_out };
+
+	memset(simpleaes_faulttest_out, 0, ORG_SIMPLE_BLOCK_SIZE);
+	return SimpleAESHost_Ioctl(FilePtr, IOCTL_ENCRYPT, &data);
+}
+
+static bool SimpleAESFaultTest_BlockOk(unsigned int idx)
+{
+	return !memcmp(simpleaes_faulttest_out + idx * ORG_SIMPLE_BLOCK_SIZE,
+		       simpleaes_faulttest_cipher, 16);
+}
+
+// Runs a contiguous batch and checks that every block either holds the
+// known answer or failed with ERROR_TIMEOUT. Returns the failed blocks.
+static unsigned int SimpleAESFaultTest_Batch(SimpleAESHost_File *FilePtr,
+					     const char *scenario)
+{
+	IOCTL_BatchData batch = {
+		.key_ptr    = simpleaes_faulttest_keybuf,
+		.i_data_ptr = simpleaes_faulttest_in,
+		.o_data_ptr = simpleaes_faulttest_out,
+		.err_ptr    = simpleaes_faulttest_errs,
+		.num_blocks = SIMPLEAES_FAULTTEST_BLOCKS,
+	};
+	unsigned int i, failed = 0;
+	long ret;
+
+	memset(simpleaes_faulttest_out, 0, sizeof(simpleaes_faulttest_out));
+	ret = SimpleAESHost_Ioctl(FilePtr, IOCTL_ENCRYPT_BATCH, &batch);
+	SIMPLEAES_FAULTTEST_CHECK(ret == 0, scenario, ret);
+	SIMPLEAES_FAULTTEST_CHECK(
+		batch.num_done == SIMPLEAES_FAULTTEST_BLOCKS, scenario,
+		batch.num_done);
+
+	for (i = 0; i < SIMPLEAES_FAULTTEST_BLOCKS; i++) {
+		if (simpleaes_faulttest_errs[i] == ERROR_OK) {
+			SIMPLEAES_FAULTTEST_CHECK(SimpleAESFaultTest_BlockOk(i),
+						  scenario, i);
+		} else {
+			SIMPLEAES_FAULTTEST_CHECK(simpleaes_faulttest_errs[i] ==
+							  ERROR_TIMEOUT,
+						  scenario, i);
+			failed++;
+		}
+	}
+	SIMPLEAES_FAULTTEST_CHECK(batch.num_failed == failed, scenario,
+				  batch.num_failed);
+
+	return failed;
+}
+
+// Registers both buffers at an offset into their first page and runs the
+// blocks through them, every one of which must hold the known answer
+static void SimpleAESFaultTest_Fixed(SimpleAESHost_File *FilePtr,
+				     const char *scenario)
+{
+	IOCTL_BufferRegion regions[2] = {
+		{ simpleaes_faulttest_in + SIMPLEAES_FAULTTEST_FIXED_IN,
+		  sizeof(simpleaes_faulttest_in) -
+			  SIMPLEAES_FAULTTEST_FIXED_IN },
+		{ simpleaes_faulttest_out + SIMPLEAES_FAULTTEST_FIXED_OUT,
+		  sizeof(simpleaes_faulttest_out) -
+			  SIMPLEAES_FAULTTEST_FIXED_OUT },
+	};
+	IOCTL_BufferSet set = { regions, 2 };
+	IOCTL_KeyData key   = { .key_ptr = simpleaes_faulttest_keybuf };
+	IOCTL_FixedData fixed = {
+		.in_index   = 0,
+		.out_index  = 1,
+		.num_blocks = SIMPLEAES_FAULTTEST_FIXED_BLOCKS,
+	};
+	unsigned int i;
+	long ret;
+
+	memset(simpleaes_faulttest_out, 0, sizeof(simpleaes_faulttest_out));
+	ret = SimpleAESHost_Ioctl(FilePtr, IOCTL_REGISTER_BUFFERS, &set);
+	SIMPLEAES_FAULTTEST_CHECK(ret == 0, scenario, ret);
+	ret = SimpleAESHost_Ioctl(FilePtr, IOCTL_SET_KEY, &key);
+	SIMPLEAES_FAULTTEST_CHECK(ret == 0, scenario, ret);
+
+	fixed.handle = key.handle;
+	ret = SimpleAESHost_Ioctl(FilePtr, IOCTL_ENCRYPT_FIXED, &fixed);
+	SIMPLEAES_FAULTTEST_CHECK(ret == 0, scenario, ret);
+	SIMPLEAES_FAULTTEST_CHECK(
+		fixed.num_done == SIMPLEAES_FAULTTEST_FIXED_BLOCKS, scenario,
+		fixed.num_done);
+	for (i = 0; i < SIMPLEAES_FAULTTEST_FIXED_BLOCKS; i++) {
+		SIMPLEAES_FAULTTEST_CHECK(
+			!memcmp(simpleaes_faulttest_out +
+					SIMPLEAES_FAULTTEST_FIXED_OUT +
+					i * ORG_SIMPLE_BLOCK_SIZE,
+				simpleaes_faulttest_cipher, 16),
+			scenario, i);
+	}
+
+	ret = SimpleAESHost_Ioctl(FilePtr, IOCTL_UNREGISTER_BUFFERS, &set);
+	SIMPLEAES_FAULTTEST_CHECK(ret == 0, scenario, ret);
+}
+
+static void SimpleAESFaultTest_Run(bool ring, bool poll)
+{
+	SimpleAESModel *model_ptr;
+	SimpleAESModel_Config config;
+	SimpleAESModel_Stats before, after;
+	SimpleAESHost_File *file_ptr;
+	IOCTL_CompletionData completion = { ORG_SIMPLE_COMPLETION_POLL };
+	unsigned int failed;
+	long ret;
+
+	if (poll) {
+		simpleaes_faulttest_hw = ring ? "ver3-poll" : "ver2-poll";
+	} else {
+		simpleaes_faulttest_hw = ring ? "ver3" : "ver2";
+	}
+
+	SimpleAESModel_DefaultConfig(&config);
+	config.ring = ring;
+	ret	    = SimpleAESHost_Init(1, &config);
+	SIMPLEAES_FAULTTEST_CHECK(ret == 0, "init", ret);
+	if (ret) {
+		return;
+	}
+	model_ptr = SimpleAESHost_Model(0);
+
+	ret = SimpleAESHost_Open(1, 0, &file_ptr);
+	SIMPLEAES_FAULTTEST_CHECK(ret == 0, "open", ret);
+	if (ret) {
+		SimpleAESHost_DeInit();
+		return;
+	}
+
+	// requeue
+	before = SimpleAESFaultTest_Stats();
+	SimpleAESModel_InjectHang(model_ptr, 1);
+	ret = SimpleAESFaultTest_Encrypt(file_ptr);
+	after = SimpleAESFaultTest_Stats();
+	SIMPLEAES_FAULTTEST_CHECK(ret == 0, "requeue", ret);
+	SIMPLEAES_FAULTTEST_CHECK(SimpleAESFaultTest_BlockOk(0), "requeue",
+				  ret);
+	SIMPLEAES_FAULTTEST_CHECK(after.resets > before.resets, "requeue",
+				  ret);
+
+	// retries
+	SimpleAESModel_InjectHang(model_ptr, SIMPLEAES_FAULTTEST_RETRIES + 1);
+	ret = SimpleAESFaultTest_Encrypt(file_ptr);
+	SIMPLEAES_FAULTTEST_CHECK(ret != 0, "retries", ret);
+	SimpleAESModel_InjectHang(model_ptr, 0);
+	ret = SimpleAESFaultTest_Encrypt(file_ptr);
+	SIMPLEAES_FAULTTEST_CHECK(ret == 0, "retries", ret);
+	SIMPLEAES_FAULTTEST_CHECK(SimpleAESFaultTest_BlockOk(0), "retries",
+				  ret);
+
+	// batch
+	SimpleAESModel_InjectHang(model_ptr, SIMPLEAES_FAULTTEST_RETRIES);
+	failed = SimpleAESFaultTest_Batch(file_ptr, "batch");
+	SIMPLEAES_FAULTTEST_CHECK(failed == 0, "batch", failed);
+	SimpleAESModel_InjectHang(model_ptr, SIMPLEAES_FAULTTEST_RETRIES + 1);
+	failed = SimpleAESFaultTest_Batch(file_ptr, "batch");
+	SIMPLEAES_FAULTTEST_CHECK(failed > 0 && failed <= 8, "batch", failed);
+	SimpleAESModel_InjectHang(model_ptr, 0);
+	SIMPLEAES_FAULTTEST_CHECK(!SimpleAESFaultTest_Faulted(), "batch", 0);
+
+	// fixed, on the engine
+	before = SimpleAESFaultTest_Stats();
+	SimpleAESFaultTest_Fixed(file_ptr, "fixed");
+	after = SimpleAESFaultTest_Stats();
+	SIMPLEAES_FAULTTEST_CHECK(after.ops > before.ops, "fixed", 0);
+
+	// clock
+	if (poll) {
+		ret = SimpleAESHost_Ioctl(file_ptr, IOCTL_SET_COMPLETION,
+					  &completion);
+		SIMPLEAES_FAULTTEST_CHECK(ret == 0, "clock", ret);
+	}
+	SimpleAESHost_FailClock(0, 1);
+	SimpleAESModel_InjectHang(model_ptr, 1);
+	failed = SimpleAESFaultTest_Batch(file_ptr, "clock");
+	SIMPLEAES_FAULTTEST_CHECK(failed > 0 &&
+					  failed < SIMPLEAES_FAULTTEST_BLOCKS,
+				  "clock", failed);
+	SIMPLEAES_FAULTTEST_CHECK(SimpleAESFaultTest_Faulted(), "clock", 0);
+
+	// faulted
+	before = SimpleAESFaultTest_Stats();
+	ret    = SimpleAESFaultTest_Encrypt(file_ptr);
+	SIMPLEAES_FAULTTEST_CHECK(ret == 0, "faulted", ret);
+	SIMPLEAES_FAULTTEST_CHECK(SimpleAESFaultTest_BlockOk(0), "faulted",
+				  ret);
+	failed = SimpleAESFaultTest_Batch(file_ptr, "faulted");
+	SIMPLEAES_FAULTTEST_CHECK(failed == 0, "faulted", failed);
+	SimpleAESFaultTest_Fixed(file_ptr, "fixed");
+	after = SimpleAESFaultTest_Stats();
+	SIMPLEAES_FAULTTEST_CHECK(after.ops == before.ops, "faulted",
+				  (long)(after.ops - before.ops));
+
+	SIMPLEAES_FAULTTEST_CHECK(after.gated_io == 0, "gated",
+				  (long)after.gated_io);
+
+	SimpleAESHost_Close(file_ptr);
+	SimpleAESHost_DeInit();
+}
+
+int main(void)
+{
+	unsigned int i;
+
+	memcpy(simpleaes_faulttest_keybuf, simpleaes_faulttest_key,
+	       ORG_SIMPLE_KEY_SIZE);
+	for (i = 0; i < SIMPLEAES_FAULTTEST_BLOCKS; i++) {
+		memcpy(simpleaes_faulttest_in + i * ORG_SIMPLE_BLOCK_SIZE,
+		       simpleaes_faulttest_plain, 16);
+	}
+
+	SimpleAESHost_SetParam("op_timeout_us", SIMPLEAES_FAULTTEST_TIMEOUT_US);
+	SimpleAESHost_SetParam("op_retries", SIMPLEAES_FAULTTEST_RETRIES);
+	SimpleAESHost_SetParam("cpu_dispatch", ORG_SIMPLE_DISPATCH_ENGINE);
+
+	SimpleAESFaultTest_Run(false, false);
+	SimpleAESFaultTest_Run(true, false);
+	SimpleAESFaultTest_Run(false, true);
+	SimpleAESFaultTest_Run(true, true);
+
+	printf("%s (%u failures)\n",
+	       simpleaes_faulttest_failures ? "FAILED" : "PASSED",
+	       simpleaes_faulttest_failures);
+	return simpleaes_faulttest_failures ? 1 : 0;
+}
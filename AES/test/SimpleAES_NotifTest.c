@@ -0,0 +1,219 @@
+// simpleaes-notiftest: contention stress test for the driver's
+// std.Notification<T> materialization (NOTIFICATION_* in SimpleAES_Linux.h).
+//
+// Instantiates the notification for u64 on top of the userspace shim and
+// keeps every slot busy: one receiver thread per slot waits for the tags of
+// its slot, round after round, while several producer threads post their
+// completions concurrently, in a shuffled order, flushing after batches of
+// 1 to 4 posts. Receivers sometimes arrive before the post and sleep,
+// sometimes after it and take the completion without sleeping.
+//
+// Every receive must return its own tag's data, none may time out, and a
+// slot is never posted again before its receiver took the last completion
+// (the driver's scheduler gives the same guarantee).
+//
+// Build and run (from AES/):
+//
+//	cc -O2 -pthread -I model/include -I model test/SimpleAES_NotifTest.c
+//	   model/SimpleAES_Host.c model/SimpleAES_Shim.c
+//	   model/SimpleAES_Model.c -o simpleaes-notiftest
+//	./simpleaes-notiftest
+//
+// Prints one line per failed check and exits non-zero if there was any.
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+
+#include "SimpleAES_Host.h"
+
+//==============================================================================
+// Constant Definitions
+//==============================================================================
+
+#define SIMPLEAES_NOTIFTEST_PRODUCERS 4
+#define SIMPLEAES_NOTIFTEST_ROUNDS    20000
+
+// A receive this late is a lost wakeup
+#define SIMPLEAES_NOTIFTEST_TIMEOUT_MS 5000
+
+//==============================================================================
+// Type Definitions
+//==============================================================================
+
+NOTIFICATION_DECLARE_TYPE(Test, u64);
+NOTIFICATION_DECLARE_FUNCS(Test, u64);
+
+//==============================================================================
+// Variable Definitions
+//==============================================================================
+
+static Notification_Test simpleaes_notiftest_notif;
+
+// Rounds each slot's receiver has completed
+static unsigned long simpleaes_notiftest_consumed[NOTIFICATION_DEPTH];
+
+// Set when a receiver gives up, so the producers do not wait for it forever
+static bool simpleaes_notiftest_abort;
+
+static unsigned int simpleaes_notiftest_failures;
+static pthread_mutex_t simpleaes_notiftest_lock = PTHREAD_MUTEX_INITIALIZER;
+
+//==============================================================================
+// Function Definitions
+//==============================================================================
+
+NOTIFICATION_DEFINE_FUNCS(Test, u64)
+
+#define SIMPLEAES_NOTIFTEST_CHECK(cond, ...) \
+	SimpleAESNotifTest_Check(!!(cond), #cond, __VA_ARGS__)
+
+static void SimpleAESNotifTest_Check(bool ok, const char *cond,
+				     unsigned int slot, long ret)
+{
+	if (!ok) {
+		pthread_mutex_lock(&simpleaes_notiftest_lock);
+		printf("FAIL slot %u: %s (ret %ld)\n", slot, cond, ret);
+		simpleaes_notiftest_failures++;
+		pthread_mutex_unlock(&simpleaes_notiftest_lock);
+	}
+}
+
+static u64 SimpleAESNotifTest_Tag(unsigned long round, unsigned int slot)
+{
+	return (u64)round * NOTIFICATION_DEPTH + slot + NOTIFICATION_DEPTH;
+}
+
+// Data posted for a tag; differs from the data of every other tag
+static u64 SimpleAESNotifTest_Data(u64 tag)
+{
+	return tag * 0x9e3779b97f4a7c15ULL;
+}
+
+static void *SimpleAESNotifTest_Receiver(void *arg)
+{
+	unsigned int slot = (uintptr_t)arg;
+	unsigned long round;
+	u64 tag, data;
+	int ret;
+
+	for (round = 0; round < SIMPLEAES_NOTIFTEST_ROUNDS; round++) {
+		tag = SimpleAESNotifTest_Tag(round, slot);
+
+		// Now and then arrive after the producer
+		if (round % 3 == slot % 3) {
+			sched_yield();
+		}
+
+		ret = Notification_Test_Receive(
+			&simpleaes_notiftest_notif, tag, &data,
+			msecs_to_jiffies(SIMPLEAES_NOTIFTEST_TIMEOUT_MS));
+		SIMPLEAES_NOTIFTEST_CHECK(ret == 0, slot, (long)round);
+		if (ret) {
+			WRITE_ONCE(simpleaes_notiftest_abort, true);
+			break;
+		}
+		SIMPLEAES_NOTIFTEST_CHECK(data == SimpleAESNotifTest_Data(tag),
+					  slot, (long)round);
+
+		smp_store_release(&simpleaes_notiftest_consumed[slot],
+				  round + 1);
+	}
+	return NULL;
+}
+
+// Posts the completions of slots slot % SIMPLEAES_NOTIFTEST_PRODUCERS ==
+// producer, each round in an order of its own
+static void *SimpleAESNotifTest_Producer(void *arg)
+{
+	unsigned int producer = (uintptr_t)arg;
+	unsigned int slots[NOTIFICATION_DEPTH], num_slots = 0;
+	unsigned int i, j, tmp, batch = 0, seed = producer + 1;
+	unsigned long round;
+	u64 tag;
+
+	for (i = producer; i < NOTIFICATION_DEPTH;
+	     i += SIMPLEAES_NOTIFTEST_PRODUCERS) {
+		slots[num_slots++] = i;
+	}
+
+	for (round = 0; round < SIMPLEAES_NOTIFTEST_ROUNDS; round++) {
+		for (i = num_slots - 1; i > 0; i--) {
+			seed = seed * 1103515245 + 12345;
+			j	 = (seed >> 16) % (i + 1);
+			tmp	 = slots[i];
+			slots[i] = slots[j];
+			slots[j] = tmp;
+		}
+
+		for (i = 0; i < num_slots; i++) {
+			// The slot's last completion must have been taken,
+			// which needs this producer's own posts flushed
+			while (smp_load_acquire(
+				       &simpleaes_notiftest_consumed[slots[i]]) <
+			       round) {
+				if (batch) {
+					Notification_Test_Flush(
+						&simpleaes_notiftest_notif);
+					batch = 0;
+				}
+				if (READ_ONCE(simpleaes_notiftest_abort)) {
+					return NULL;
+				}
+				sched_yield();
+			}
+
+			tag = SimpleAESNotifTest_Tag(round, slots[i]);
+			Notification_Test_Post(&simpleaes_notiftest_notif,
+					       SimpleAESNotifTest_Data(tag),
+					       tag);
+
+			if (!batch) {
+				seed  = seed * 1103515245 + 12345;
+				batch = 1 + (seed >> 16) % 4;
+			}
+			if (!--batch) {
+				Notification_Test_Flush(
+					&simpleaes_notiftest_notif);
+			}
+		}
+	}
+	Notification_Test_Flush(&simpleaes_notiftest_notif);
+
+	return NULL;
+}
+
+int main(void)
+{
+	pthread_t receivers[NOTIFICATION_DEPTH];
+	pthread_t producers[SIMPLEAES_NOTIFTEST_PRODUCERS];
+	uintptr_t i;
+
+	Notification_Test_Init(&simpleaes_notiftest_notif);
+
+	for (i = 0; i < NOTIFICATION_DEPTH; i++) {
+		pthread_create(&receivers[i], NULL,
+			       SimpleAESNotifTest_Receiver, (void *)i);
+	}
+	for (i = 0; i < SIMPLEAES_NOTIFTEST_PRODUCERS; i++) {
+		pthread_create(&producers[i], NULL,
+			       SimpleAESNotifTest_Producer, (void *)i);
+	}
+	for (i = 0; i < SIMPLEAES_NOTIFTEST_PRODUCERS; i++) {
+		pthread_join(producers[i], NULL);
+	}
+	for (i = 0; i < NOTIFICATION_DEPTH; i++) {
+		pthread_join(receivers[i], NULL);
+		SIMPLEAES_NOTIFTEST_CHECK(simpleaes_notiftest_consumed[i] ==
+						  SIMPLEAES_NOTIFTEST_ROUNDS,
+					  (unsigned int)i,
+					  (long)simpleaes_notiftest_consumed[i]);
+	}
+
+	Notification_Test_DeInit(&simpleaes_notiftest_notif);
+
+	printf("%s (%u failures)\n",
+	       simpleaes_notiftest_failures ? "FAILED" : "PASSED",
+	       simpleaes_notiftest_failures);
+	return simpleaes_notiftest_failures ? 1 : 0;
+}
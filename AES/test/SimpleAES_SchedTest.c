@@ -0,0 +1,272 @@
+// simpleaes-schedtest: engine share test for the SimpleAES driver's
+// scheduling weights (IOCTL_SET_WEIGHT).
+//
+// Loads the driver in-process against one SimpleAESModel engine (see
+// model/SimpleAES_Host.h). Two threads, each with its own file on the engine
+// node and one request at a time, run the same request back to back for a
+// fixed time:
+//
+//	single      single-block IOCTL_ENCRYPT
+//	batch       SIMPLEAES_SCHEDTEST_BATCH-block IOCTL_ENCRYPT_BATCH
+//
+// once with weights 4 and 1, where the first must run about 4 times the
+// blocks of the second, and once with weights 1 and 1, where they must run
+// about as many. Every block must hold the known answer.
+//
+// Build and run (from AES/):
+//
+//	cc -O2 -pthread -I model/include -I model test/SimpleAES_SchedTest.c
+//	   model/SimpleAES_Host.c model/SimpleAES_Shim.c
+//	   model/SimpleAES_Model.c -o simpleaes-schedtest
+//	./simpleaes-schedtest
+//
+// Prints the blocks each thread ran, one line per failed check, and exits
+// non-zero if there was any.
+
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "SimpleAES_Host.h"
+
+//==============================================================================
+// Constant Definitions
+//==============================================================================
+
+#define SIMPLEAES_SCHEDTEST_THREADS 2
+
+// Blocks per batch request
+#define SIMPLEAES_SCHEDTEST_BATCH 16
+
+// How long each measurement runs
+#define SIMPLEAES_SCHEDTEST_RUN_MS 1000
+
+// Accepted block ratio, as a fraction of the weight ratio, in percent
+#define SIMPLEAES_SCHEDTEST_MIN_PCT 70
+#define SIMPLEAES_SCHEDTEST_MAX_PCT 130
+
+//==============================================================================
+// Type Definitions
+//==============================================================================
+
+typedef struct {
+	SimpleAESHost_File *file_ptr;
+	unsigned int num_blocks; // Per request
+	u8 key[ORG_SIMPLE_KEY_SIZE];
+	u8 in[SIMPLEAES_SCHEDTEST_BATCH * ORG_SIMPLE_BLOCK_SIZE];
+	u8 out[SIMPLEAES_SCHEDTEST_BATCH * ORG_SIMPLE_BLOCK_SIZE];
+	ORG_SIMPLE_Error errs[SIMPLEAES_SCHEDTEST_BATCH];
+	unsigned long blocks;	 // Run while both threads were running
+	unsigned int bad;	 // Failed requests and wrong blocks
+} SimpleAESSchedTest_Thread;
+
+//==============================================================================
+// Variable Definitions
+//==============================================================================
+
+// FIPS-197 C.1 (AES-128)
+static const u8 simpleaes_schedtest_key[16] = {
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+	0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+};
+static const u8 simpleaes_schedtest_plain[16] = {
+	0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+	0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff
+};
+static const u8 simpleaes_schedtest_cipher[16] = {
+	0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+	0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a
+};
+
+static SimpleAESSchedTest_Thread
+	simpleaes_schedtest_threads[SIMPLEAES_SCHEDTEST_THREADS];
+static pthread_barrier_t simpleaes_schedtest_start;
+
+// Set once either thread finishes, so only blocks run in contention count
+static volatile bool simpleaes_schedtest_stop;
+
+static unsigned int simpleaes_schedtest_failures;
+
+//==============================================================================
+// Function Definitions
+//==============================================================================
+
+#define SIMPLEAES_SCHEDTEST_CHECK(cond, ...) \
+	SimpleAESSchedTest_Check(!!(cond), #cond, __VA_ARGS__)
+
+static void SimpleAESSchedTest_Check(bool ok, const char *cond,
+				     const char *scenario, long ret)
+{
+	if (!ok) {
+		printf("FAIL %s: %s (ret %ld)\n", scenario, cond, ret);
+		simpleaes_schedtest_failures++;
+	}
+}
+
+static u64 SimpleAESSchedTest_NowMs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Runs one request and counts its blocks that hold the known answer
+static unsigned int
+SimpleAESSchedTest_Request(SimpleAESSchedTest_Thread *ThreadPtr)
+{
+	IOCTL_Data data = { ThreadPtr->key, ThreadPtr->in, ThreadPtr->out };
+	IOCTL_BatchData batch = {
+		.key_ptr    = ThreadPtr->key,
+		.i_data_ptr = ThreadPtr->in,
+		.o_data_ptr = ThreadPtr->out,
+		.err_ptr    = ThreadPtr->errs,
+		.num_blocks = ThreadPtr->num_blocks,
+	};
+	unsigned int i, good = 0;
+	long ret;
+
+	memset(ThreadPtr->out, 0, sizeof(ThreadPtr->out));
+	if (ThreadPtr->num_blocks == 1) {
+		ret = SimpleAESHost_Ioctl(ThreadPtr->file_ptr, IOCTL_ENCRYPT,
+					  &data);
+	} else {
+		ret = SimpleAESHost_Ioctl(ThreadPtr->file_ptr,
+					  IOCTL_ENCRYPT_BATCH, &batch);
+		ret = ret ? ret : batch.num_failed;
+	}
+	if (ret) {
+		return 0;
+	}
+
+	for (i = 0; i < ThreadPtr->num_blocks; i++) {
+		good += !memcmp(ThreadPtr->out + i * ORG_SIMPLE_BLOCK_SIZE,
+				simpleaes_schedtest_cipher, 16);
+	}
+	return good;
+}
+
+static void *SimpleAESSchedTest_Worker(void *arg)
+{
+	SimpleAESSchedTest_Thread *thread_ptr = arg;
+	u64 end_ms;
+	unsigned int good;
+
+	pthread_barrier_wait(&simpleaes_schedtest_start);
+	end_ms = SimpleAESSchedTest_NowMs() + SIMPLEAES_SCHEDTEST_RUN_MS;
+
+	while (!simpleaes_schedtest_stop) {
+		good = SimpleAESSchedTest_Request(thread_ptr);
+		thread_ptr->bad += good != thread_ptr->num_blocks;
+		if (simpleaes_schedtest_stop) {
+			break;
+		}
+		thread_ptr->blocks += good;
+		if (SimpleAESSchedTest_NowMs() >= end_ms) {
+			simpleaes_schedtest_stop = true;
+		}
+	}
+	return NULL;
+}
+
+// Runs both threads with the given weights and checks the ratio of their
+// blocks against the ratio of the weights
+static void SimpleAESSchedTest_Run(const char *scenario,
+				   unsigned int num_blocks,
+				   const unsigned int *weights)
+{
+	pthread_t tids[SIMPLEAES_SCHEDTEST_THREADS];
+	SimpleAESSchedTest_Thread *thread_ptr;
+	IOCTL_WeightData weight;
+	unsigned long share, expected;
+	unsigned int i, j;
+	long ret;
+
+	simpleaes_schedtest_stop = false;
+	pthread_barrier_init(&simpleaes_schedtest_start, NULL,
+			     SIMPLEAES_SCHEDTEST_THREADS);
+
+	for (i = 0; i < SIMPLEAES_SCHEDTEST_THREADS; i++) {
+		thread_ptr = &simpleaes_schedtest_threads[i];
+		memset(thread_ptr, 0, sizeof(*thread_ptr));
+		memcpy(thread_ptr->key, simpleaes_schedtest_key, 16);
+		for (j = 0; j < SIMPLEAES_SCHEDTEST_BATCH; j++) {
+			memcpy(thread_ptr->in + j * ORG_SIMPLE_BLOCK_SIZE,
+			       simpleaes_schedtest_plain, 16);
+		}
+		thread_ptr->num_blocks = num_blocks;
+
+		ret = SimpleAESHost_Open(1, 0, &thread_ptr->file_ptr);
+		SIMPLEAES_SCHEDTEST_CHECK(ret == 0, scenario, ret);
+		if (ret) {
+			return;
+		}
+		weight.weight = weights[i];
+		ret = SimpleAESHost_Ioctl(thread_ptr->file_ptr,
+					  IOCTL_SET_WEIGHT, &weight);
+		SIMPLEAES_SCHEDTEST_CHECK(ret == 0, scenario, ret);
+	}
+
+	for (i = 0; i < SIMPLEAES_SCHEDTEST_THREADS; i++) {
+		pthread_create(&tids[i], NULL, SimpleAESSchedTest_Worker,
+			       &simpleaes_schedtest_threads[i]);
+	}
+	for (i = 0; i < SIMPLEAES_SCHEDTEST_THREADS; i++) {
+		pthread_join(tids[i], NULL);
+	}
+	pthread_barrier_destroy(&simpleaes_schedtest_start);
+
+	printf("%s %u:%u blocks %lu %lu\n", scenario, weights[0], weights[1],
+	       simpleaes_schedtest_threads[0].blocks,
+	       simpleaes_schedtest_threads[1].blocks);
+
+	// blocks[0] / blocks[1] within the accepted fraction of the weight
+	// ratio, cross-multiplied
+	share	 = simpleaes_schedtest_threads[0].blocks * weights[1] * 100;
+	expected = simpleaes_schedtest_threads[1].blocks * weights[0];
+	for (i = 0; i < SIMPLEAES_SCHEDTEST_THREADS; i++) {
+		thread_ptr = &simpleaes_schedtest_threads[i];
+		SIMPLEAES_SCHEDTEST_CHECK(thread_ptr->bad == 0, scenario,
+					  thread_ptr->bad);
+		SIMPLEAES_SCHEDTEST_CHECK(thread_ptr->blocks > 0, scenario, i);
+		SimpleAESHost_Close(thread_ptr->file_ptr);
+	}
+	SIMPLEAES_SCHEDTEST_CHECK(share >=
+					  expected * SIMPLEAES_SCHEDTEST_MIN_PCT,
+				  scenario, (long)share);
+	SIMPLEAES_SCHEDTEST_CHECK(share <=
+					  expected * SIMPLEAES_SCHEDTEST_MAX_PCT,
+				  scenario, (long)share);
+}
+
+int main(void)
+{
+	static const unsigned int weighted[SIMPLEAES_SCHEDTEST_THREADS] = {
+		4, 1
+	};
+	static const unsigned int equal[SIMPLEAES_SCHEDTEST_THREADS] = {
+		1, 1
+	};
+	SimpleAESModel_Config config;
+	long ret;
+
+	SimpleAESHost_SetParam("cpu_dispatch", ORG_SIMPLE_DISPATCH_ENGINE);
+
+	SimpleAESModel_DefaultConfig(&config);
+	ret = SimpleAESHost_Init(1, &config);
+	SIMPLEAES_SCHEDTEST_CHECK(ret == 0, "init", ret);
+	if (!ret) {
+		SimpleAESSchedTest_Run("single", 1, weighted);
+		SimpleAESSchedTest_Run("single", 1, equal);
+		SimpleAESSchedTest_Run("batch", SIMPLEAES_SCHEDTEST_BATCH,
+				       weighted);
+		SimpleAESSchedTest_Run("batch", SIMPLEAES_SCHEDTEST_BATCH,
+				       equal);
+		SimpleAESHost_DeInit();
+	}
+
+	printf("%s (%u failures)\n",
+	       simpleaes_schedtest_failures ? "FAILED" : "PASSED",
+	       simpleaes_schedtest_failures);
+	return simpleaes_schedtest_failures ? 1 : 0;
+}
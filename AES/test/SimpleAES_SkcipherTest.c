@@ -0,0 +1,351 @@
+// simpleaes-skciphertest: known-answer test of the SimpleAES Crypto API
+// algorithms.
+//
+// Loads the driver in-process against two SimpleAESModel engines (see
+// model/SimpleAES_Host.h) and runs the NIST SP 800-38A vectors through the
+// skciphers it registers, by driver name (ecb-aes-simpleaes,
+// cbc-aes-simpleaes, ctr-aes-simpleaes), both ways:
+//
+//	whole       the four-block vector in one request
+//	sg          the same split over scatterlist entries whose boundaries
+//		    fall inside blocks, out of place and in place
+//	chained     two requests of two blocks each, the second continuing
+//		    from the IV the first handed back
+//	partial     CTR requests that end inside a block; ECB and CBC
+//		    refuse them with -EINVAL
+//
+// AES-128 runs on the engines (cpu_dispatch=0), AES-256 on the software
+// fallback. Zero-length requests must succeed without touching the data.
+//
+// Build and run (from AES/):
+//
+//	cc -O2 -pthread -I model/include -I model test/SimpleAES_SkcipherTest.c
+//	   model/SimpleAES_Host.c model/SimpleAES_Shim.c
+//	   model/SimpleAES_Model.c -o simpleaes-skciphertest
+//	./simpleaes-skciphertest
+//
+// Prints one line per failed check and exits non-zero if there was any.
+
+#include <stdio.h>
+
+#include "SimpleAES_Host.h"
+
+//==============================================================================
+// Constant Definitions
+//==============================================================================
+
+#define SIMPLEAES_SKCIPHERTEST_ENGINES 2
+#define SIMPLEAES_SKCIPHERTEST_LEN     64
+
+//==============================================================================
+// Type Definitions
+//==============================================================================
+
+typedef struct {
+	const char *alg_name;
+	unsigned int key_len;
+	const u8 *key;
+	const u8 *iv;	  // NULL for ECB
+	const u8 *iv_out; // IV handed back after the whole request
+	const u8 *cipher;
+	bool stream; // Any length (CTR)
+} SimpleAESSkcipherTest_Vector;
+
+//==============================================================================
+// Variable Definitions
+//==============================================================================
+
+// SP 800-38A Appendix F: one plaintext for every mode and key size
+static const u8 simpleaes_skciphertest_plain[SIMPLEAES_SKCIPHERTEST_LEN] = {
+	0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96,
+	0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+	0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c,
+	0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+	0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11,
+	0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+	0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17,
+	0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10
+};
+
+static const u8 simpleaes_skciphertest_key128[16] = {
+	0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+	0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+
+static const u8 simpleaes_skciphertest_key256[32] = {
+	0x60, 0x3d, 0xeb, 0x10, 0x15, 0xca, 0x71, 0xbe,
+	0x2b, 0x73, 0xae, 0xf0, 0x85, 0x7d, 0x77, 0x81,
+	0x1f, 0x35, 0x2c, 0x07, 0x3b, 0x61, 0x08, 0xd7,
+	0x2d, 0x98, 0x10, 0xa3, 0x09, 0x14, 0xdf, 0xf4
+};
+
+static const u8 simpleaes_skciphertest_cbc_iv[16] = {
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+	0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+};
+
+static const u8 simpleaes_skciphertest_ctr_iv[16] = {
+	0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7,
+	0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff
+};
+
+// The counter after four blocks
+static const u8 simpleaes_skciphertest_ctr_iv_out[16] = {
+	0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7,
+	0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xff, 0x03
+};
+
+// F.1.1, F.1.5
+static const u8 simpleaes_skciphertest_ecb128[SIMPLEAES_SKCIPHERTEST_LEN] = {
+	0x3a, 0xd7, 0x7b, 0xb4, 0x0d, 0x7a, 0x36, 0x60,
+	0xa8, 0x9e, 0xca, 0xf3, 0x24, 0x66, 0xef, 0x97,
+	0xf5, 0xd3, 0xd5, 0x85, 0x03, 0xb9, 0x69, 0x9d,
+	0xe7, 0x85, 0x89, 0x5a, 0x96, 0xfd, 0xba, 0xaf,
+	0x43, 0xb1, 0xcd, 0x7f, 0x59, 0x8e, 0xce, 0x23,
+	0x88, 0x1b, 0x00, 0xe3, 0xed, 0x03, 0x06, 0x88,
+	0x7b, 0x0c, 0x78, 0x5e, 0x27, 0xe8, 0xad, 0x3f,
+	0x82, 0x23, 0x20, 0x71, 0x04, 0x72, 0x5d, 0xd4
+};
+static const u8 simpleaes_skciphertest_ecb256[SIMPLEAES_SKCIPHERTEST_LEN] = {
+	0xf3, 0xee, 0xd1, 0xbd, 0xb5, 0xd2, 0xa0, 0x3c,
+	0x06, 0x4b, 0x5a, 0x7e, 0x3d, 0xb1, 0x81, 0xf8,
+	0x59, 0x1c, 0xcb, 0x10, 0xd4, 0x10, 0xed, 0x26,
+	0xdc, 0x5b, 0xa7, 0x4a, 0x31, 0x36, 0x28, 0x70,
+	0xb6, 0xed, 0x21, 0xb9, 0x9c, 0xa6, 0xf4, 0xf9,
+	0xf1, 0x53, 0xe7, 0xb1, 0xbe, 0xaf, 0xed, 0x1d,
+	0x23, 0x30, 0x4b, 0x7a, 0x39, 0xf9, 0xf3, 0xff,
+	0x06, 0x7d, 0x8d, 0x8f, 0x9e, 0x24, 0xec, 0xc7
+};
+
+// F.2.1, F.2.5
+static const u8 simpleaes_skciphertest_cbc128[SIMPLEAES_SKCIPHERTEST_LEN] = {
+	0x76, 0x49, 0xab, 0xac, 0x81, 0x19, 0xb2, 0x46,
+	0xce, 0xe9, 0x8e, 0x9b, 0x12, 0xe9, 0x19, 0x7d,
+	0x50, 0x86, 0xcb, 0x9b, 0x50, 0x72, 0x19, 0xee,
+	0x95, 0xdb, 0x11, 0x3a, 0x91, 0x76, 0x78, 0xb2,
+	0x73, 0xbe, 0xd6, 0xb8, 0xe3, 0xc1, 0x74, 0x3b,
+	0x71, 0x16, 0xe6, 0x9e, 0x22, 0x22, 0x95, 0x16,
+	0x3f, 0xf1, 0xca, 0xa1, 0x68, 0x1f, 0xac, 0x09,
+	0x12, 0x0e, 0xca, 0x30, 0x75, 0x86, 0xe1, 0xa7
+};
+static const u8 simpleaes_skciphertest_cbc256[SIMPLEAES_SKCIPHERTEST_LEN] = {
+	0xf5, 0x8c, 0x4c, 0x04, 0xd6, 0xe5, 0xf1, 0xba,
+	0x77, 0x9e, 0xab, 0xfb, 0x5f, 0x7b, 0xfb, 0xd6,
+	0x9c, 0xfc, 0x4e, 0x96, 0x7e, 0xdb, 0x80, 0x8d,
+	0x67, 0x9f, 0x77, 0x7b, 0xc6, 0x70, 0x2c, 0x7d,
+	0x39, 0xf2, 0x33, 0x69, 0xa9, 0xd9, 0xba, 0xcf,
+	0xa5, 0x30, 0xe2, 0x63, 0x04, 0x23, 0x14, 0x61,
+	0xb2, 0xeb, 0x05, 0xe2, 0xc3, 0x9b, 0xe9, 0xfc,
+	0xda, 0x6c, 0x19, 0x07, 0x8c, 0x6a, 0x9d, 0x1b
+};
+
+// F.5.1, F.5.5
+static const u8 simpleaes_skciphertest_ctr128[SIMPLEAES_SKCIPHERTEST_LEN] = {
+	0x87, 0x4d, 0x61, 0x91, 0xb6, 0x20, 0xe3, 0x26,
+	0x1b, 0xef, 0x68, 0x64, 0x99, 0x0d, 0xb6, 0xce,
+	0x98, 0x06, 0xf6, 0x6b, 0x79, 0x70, 0xfd, 0xff,
+	0x86, 0x17, 0x18, 0x7b, 0xb9, 0xff, 0xfd, 0xff,
+	0x5a, 0xe4, 0xdf, 0x3e, 0xdb, 0xd5, 0xd3, 0x5e,
+	0x5b, 0x4f, 0x09, 0x02, 0x0d, 0xb0, 0x3e, 0xab,
+	0x1e, 0x03, 0x1d, 0xda, 0x2f, 0xbe, 0x03, 0xd1,
+	0x79, 0x21, 0x70, 0xa0, 0xf3, 0x00, 0x9c, 0xee
+};
+static const u8 simpleaes_skciphertest_ctr256[SIMPLEAES_SKCIPHERTEST_LEN] = {
+	0x60, 0x1e, 0xc3, 0x13, 0x77, 0x57, 0x89, 0xa5,
+	0xb7, 0xa7, 0xf5, 0x04, 0xbb, 0xf3, 0xd2, 0x28,
+	0xf4, 0x43, 0xe3, 0xca, 0x4d, 0x62, 0xb5, 0x9a,
+	0xca, 0x84, 0xe9, 0x90, 0xca, 0xca, 0xf5, 0xc5,
+	0x2b, 0x09, 0x30, 0xda, 0xa2, 0x3d, 0xe9, 0x4c,
+	0xe8, 0x70, 0x17, 0xba, 0x2d, 0x84, 0x98, 0x8d,
+	0xdf, 0xc9, 0xc5, 0x8d, 0xb6, 0x7a, 0xad, 0xa6,
+	0x13, 0xc2, 0xdd, 0x08, 0x45, 0x79, 0x41, 0xa6
+};
+
+static const SimpleAESSkcipherTest_Vector simpleaes_skciphertest_vectors[] = {
+	{ "ecb-aes-simpleaes", 16, simpleaes_skciphertest_key128, NULL, NULL,
+	  simpleaes_skciphertest_ecb128, false },
+	{ "ecb-aes-simpleaes", 32, simpleaes_skciphertest_key256, NULL, NULL,
+	  simpleaes_skciphertest_ecb256, false },
+	{ "cbc-aes-simpleaes", 16, simpleaes_skciphertest_key128,
+	  simpleaes_skciphertest_cbc_iv, simpleaes_skciphertest_cbc128 + 48,
+	  simpleaes_skciphertest_cbc128, false },
+	{ "cbc-aes-simpleaes", 32, simpleaes_skciphertest_key256,
+	  simpleaes_skciphertest_cbc_iv, simpleaes_skciphertest_cbc256 + 48,
+	  simpleaes_skciphertest_cbc256, false },
+	{ "ctr-aes-simpleaes", 16, simpleaes_skciphertest_key128,
+	  simpleaes_skciphertest_ctr_iv, simpleaes_skciphertest_ctr_iv_out,
+	  simpleaes_skciphertest_ctr128, true },
+	{ "ctr-aes-simpleaes", 32, simpleaes_skciphertest_key256,
+	  simpleaes_skciphertest_ctr_iv, simpleaes_skciphertest_ctr_iv_out,
+	  simpleaes_skciphertest_ctr256, true },
+};
+
+// Scatterlist layouts: entry boundaries inside blocks and a one-byte entry
+static const unsigned int simpleaes_skciphertest_segs[][4] = {
+	{ 16, 16, 16, 16 },
+	{ 5, 27, 1, 31 },
+	{ 40, 3, 13, 8 },
+};
+
+static unsigned int simpleaes_skciphertest_failures;
+
+//==============================================================================
+// Function Definitions
+//==============================================================================
+
+static void SimpleAESSkcipherTest_Check(bool ok, const char *what,
+					const SimpleAESSkcipherTest_Vector *VecPtr,
+					bool encrypt, int ret)
+{
+	if (!ok) {
+		printf("FAIL %s/aes%u/%s: %s (ret %d)\n", VecPtr->alg_name,
+		       VecPtr->key_len * 8, encrypt ? "enc" : "dec", what,
+		       ret);
+		simpleaes_skciphertest_failures++;
+	}
+}
+
+// One request over len bytes of the vector starting at offset, with the
+// IV it would have there. Checks the output and returns the call's result.
+static int SimpleAESSkcipherTest_Request(const SimpleAESSkcipherTest_Vector
+						 *VecPtr,
+					 bool encrypt, unsigned int offset,
+					 unsigned int len, u8 iv[16],
+					 const unsigned int *seg_lens,
+					 unsigned int num_segs, bool in_place,
+					 const char *what)
+{
+	const u8 *src = (encrypt ? simpleaes_skciphertest_plain :
+				   VecPtr->cipher) +
+			offset;
+	const u8 *expect = (encrypt ? VecPtr->cipher :
+				      simpleaes_skciphertest_plain) +
+			   offset;
+	u8 in[SIMPLEAES_SKCIPHERTEST_LEN], out[SIMPLEAES_SKCIPHERTEST_LEN];
+	int ret;
+
+	memcpy(in, src, len);
+	memset(out, 0, sizeof(out));
+	ret = SimpleAESHost_SkcipherSg(VecPtr->alg_name, encrypt, VecPtr->key,
+				       VecPtr->key_len, iv, in,
+				       in_place ? in : out, len, seg_lens,
+				       num_segs);
+	SimpleAESSkcipherTest_Check(ret == 0, what, VecPtr, encrypt, ret);
+	SimpleAESSkcipherTest_Check(!memcmp(in_place ? in : out, expect, len),
+				    what, VecPtr, encrypt, ret);
+	return ret;
+}
+
+static void SimpleAESSkcipherTest_Run(const SimpleAESSkcipherTest_Vector
+					      *VecPtr,
+				      bool encrypt)
+{
+	u8 iv[16], in[SIMPLEAES_SKCIPHERTEST_LEN];
+	unsigned int i;
+	int ret;
+
+	// whole
+	memcpy(iv, VecPtr->iv ? VecPtr->iv : simpleaes_skciphertest_cbc_iv,
+	       16);
+	SimpleAESSkcipherTest_Request(VecPtr, encrypt, 0,
+				      SIMPLEAES_SKCIPHERTEST_LEN, iv, NULL, 0,
+				      false, "whole");
+	if (VecPtr->iv_out) {
+		SimpleAESSkcipherTest_Check(!memcmp(iv, VecPtr->iv_out, 16),
+					    "whole iv", VecPtr, encrypt, 0);
+	}
+
+	// sg
+	for (i = 0; i < ARRAY_SIZE(simpleaes_skciphertest_segs); i++) {
+		if (VecPtr->iv) {
+			memcpy(iv, VecPtr->iv, 16);
+		}
+		SimpleAESSkcipherTest_Request(
+			VecPtr, encrypt, 0, SIMPLEAES_SKCIPHERTEST_LEN, iv,
+			simpleaes_skciphertest_segs[i], 4, false, "sg");
+		if (VecPtr->iv) {
+			memcpy(iv, VecPtr->iv, 16);
+		}
+		SimpleAESSkcipherTest_Request(
+			VecPtr, encrypt, 0, SIMPLEAES_SKCIPHERTEST_LEN, iv,
+			simpleaes_skciphertest_segs[i], 4, true, "sg in place");
+	}
+
+	// chained
+	if (VecPtr->iv) {
+		memcpy(iv, VecPtr->iv, 16);
+	}
+	SimpleAESSkcipherTest_Request(VecPtr, encrypt, 0, 32, iv, NULL, 0,
+				      false, "chained");
+	SimpleAESSkcipherTest_Request(VecPtr, encrypt, 32, 32, iv, NULL, 0,
+				      false, "chained");
+
+	// partial
+	if (VecPtr->stream) {
+		memcpy(iv, VecPtr->iv, 16);
+		SimpleAESSkcipherTest_Request(VecPtr, encrypt, 0, 50, iv,
+					      simpleaes_skciphertest_segs[1], 4,
+					      false, "partial");
+		memcpy(iv, VecPtr->iv, 16);
+		SimpleAESSkcipherTest_Request(VecPtr, encrypt, 0, 7, iv, NULL,
+					      0, false, "partial");
+	} else {
+		memcpy(in, simpleaes_skciphertest_plain, sizeof(in));
+		memcpy(iv, simpleaes_skciphertest_cbc_iv, 16);
+		ret = SimpleAESHost_Skcipher(VecPtr->alg_name, encrypt,
+					     VecPtr->key, VecPtr->key_len, iv,
+					     in, in, 50);
+		SimpleAESSkcipherTest_Check(ret == -EINVAL, "partial", VecPtr,
+					    encrypt, ret);
+	}
+
+	// Zero length
+	memcpy(in, simpleaes_skciphertest_plain, sizeof(in));
+	memcpy(iv, simpleaes_skciphertest_cbc_iv, 16);
+	ret = SimpleAESHost_Skcipher(VecPtr->alg_name, encrypt, VecPtr->key,
+				     VecPtr->key_len, iv, in, in, 0);
+	SimpleAESSkcipherTest_Check(ret == 0 &&
+					    !memcmp(in,
+						    simpleaes_skciphertest_plain,
+						    sizeof(in)),
+				    "empty", VecPtr, encrypt, ret);
+}
+
+int main(void)
+{
+	SimpleAESModel_Stats stats;
+	uint64_t ops = 0;
+	unsigned int i;
+	int ret;
+
+	SimpleAESHost_SetParam("cpu_dispatch", ORG_SIMPLE_DISPATCH_ENGINE);
+	ret = SimpleAESHost_Init(SIMPLEAES_SKCIPHERTEST_ENGINES, NULL);
+	if (ret) {
+		printf("FAIL init (ret %d)\n", ret);
+		return 1;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(simpleaes_skciphertest_vectors); i++) {
+		SimpleAESSkcipherTest_Run(&simpleaes_skciphertest_vectors[i],
+					  true);
+		SimpleAESSkcipherTest_Run(&simpleaes_skciphertest_vectors[i],
+					  false);
+	}
+
+	// AES-128 requests must have reached the engines
+	for (i = 0; i < SIMPLEAES_SKCIPHERTEST_ENGINES; i++) {
+		SimpleAESModel_GetStats(SimpleAESHost_Model(i), &stats);
+		ops += stats.ops;
+	}
+	if (!ops) {
+		printf("FAIL no request ran on the engines\n");
+		simpleaes_skciphertest_failures++;
+	}
+
+	SimpleAESHost_DeInit();
+
+	printf("%s (%u failures)\n",
+	       simpleaes_skciphertest_failures ? "FAILED" : "PASSED",
+	       simpleaes_skciphertest_failures);
+	return simpleaes_skciphertest_failures ? 1 : 0;
+}